@@ -5,8 +5,10 @@
 #include "formats.h"
 #include "globvars.h"
 #include "globvrbm.h"
+#include "harness/config.h"
 #include "harness/trace.h"
 #include "init.h"
+#include "loading.h"
 #include "pd/sys.h"
 #include "utility.h"
 #include "world.h"
@@ -66,6 +68,8 @@ void DisposeColumns(tTrack_spec* pTrack_spec) {
     if (pTrack_spec->non_car_list != NULL && (0 < pTrack_spec->ampersand_digits)) {
         BrMemFree(pTrack_spec->non_car_list);
     }
+    DisposeColumnCulling(pTrack_spec); // Added by dethrace
+    DisposeLollipopStore(pTrack_spec); // Added by dethrace
 }
 
 // IDA: void __usercall XZToColumnXZ(tU8 *pColumn_x@<EAX>, tU8 *pColumn_z@<EDX>, br_scalar pX, br_scalar pZ, tTrack_spec *pTrack_spec)
@@ -303,6 +307,8 @@ void ExtractColumns(tTrack_spec* pTrack_spec) {
     } else {
         ProcessModels(pTrack_spec);
     }
+    ComputeColumnBounds(pTrack_spec); // Added by dethrace
+    BuildLollipopStore(pTrack_spec);  // Added by dethrace
 }
 
 // IDA: void __usercall LollipopizeActor4(br_actor *pActor@<EAX>, br_matrix34 *pRef_to_world@<EDX>, br_actor *pCamera@<EBX>)
@@ -344,6 +350,10 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
     br_actor* blended_polys;
 
     maa.m = pCamera_to_world;
+    // Added by dethrace
+    if (!pDraw_blends) {
+        TurnLollipopsTo(pCamera_to_world);
+    }
     if (fabs(pCamera_to_world->m[2][2]) < fabs(pCamera_to_world->m[2][0])) {
         for (column_x = pMin_x; column_x <= pMax_x; ++column_x) {
             for (column_z = pMin_z; column_z <= pMax_z; ++column_z) {
@@ -357,6 +367,10 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                 } else {
                     column_z2 = pMin_z + pMax_z - column_z;
                 }
+                // Added by dethrace
+                if (!ColumnVisible(pTrack_spec, column_x2, column_z2)) {
+                    continue;
+                }
                 if (pDraw_blends) {
                     blended_polys = pTrack_spec->blends[column_z2][column_x2];
                     if (blended_polys) {
@@ -369,8 +383,9 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                         BrZbSceneRenderAdd(pTrack_spec->columns[column_z2][column_x2]);
                     }
                     if (pTrack_spec->lollipops[column_z2][column_x2]) {
-                        maa.a = pTrack_spec->lollipops[column_z2][column_x2];
-                        BrActorEnum(pTrack_spec->lollipops[column_z2][column_x2], LollipopizeChildren, &maa);
+                        // maa.a = pTrack_spec->lollipops[column_z2][column_x2];
+                        // BrActorEnum(pTrack_spec->lollipops[column_z2][column_x2], LollipopizeChildren, &maa);
+                        FaceColumnLollipops(pTrack_spec, pCamera_to_world, column_x2, column_z2); // changed by dethrace
                         BrZbSceneRenderAdd(pTrack_spec->lollipops[column_z2][column_x2]);
                     }
                 }
@@ -390,6 +405,10 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                 } else {
                     column_z2 = (pMin_z + pMax_z) - column_z;
                 }
+                // Added by dethrace
+                if (!ColumnVisible(pTrack_spec, column_x2, column_z2)) {
+                    continue;
+                }
                 if (pDraw_blends) {
                     blended_polys = pTrack_spec->blends[column_z2][column_x2];
                     if (blended_polys) {
@@ -402,8 +421,9 @@ void DrawColumns(int pDraw_blends, tTrack_spec* pTrack_spec, int pMin_x, int pMa
                         BrZbSceneRenderAdd(pTrack_spec->columns[column_z2][column_x2]);
                     }
                     if (pTrack_spec->lollipops[column_z2][column_x2]) {
-                        maa.a = pTrack_spec->lollipops[column_z2][column_x2];
-                        BrActorEnum(pTrack_spec->lollipops[column_z2][column_x2], LollipopizeChildren, &maa);
+                        // maa.a = pTrack_spec->lollipops[column_z2][column_x2];
+                        // BrActorEnum(pTrack_spec->lollipops[column_z2][column_x2], LollipopizeChildren, &maa);
+                        FaceColumnLollipops(pTrack_spec, pCamera_to_world, column_x2, column_z2); // changed by dethrace
                         BrZbSceneRenderAdd(pTrack_spec->lollipops[column_z2][column_x2]);
                     }
                 }
@@ -522,6 +542,10 @@ void RenderTrack(br_actor* pWorld, tTrack_spec* pTrack_spec, br_actor* pCamera,
             if (pTrack_spec->ncolumns_z - 1 > max_z) {
                 max_z++;
             }
+            // Added by dethrace: drop the columns of the rectangle that are outside the view
+            if (pTrack_spec->column_visible != NULL) {
+                CullColumns(pTrack_spec, pCamera, pCamera_to_world, min_x, max_x, min_z, max_z);
+            }
             DrawColumns(0, pTrack_spec, min_x, max_x, min_z, max_z, pCamera_to_world);
         }
     }
@@ -540,3 +564,1007 @@ void SetYonFactor(br_scalar pNew) {
 
     gYon_factor = pNew;
 }
+
+// Added by dethrace: per column culling.
+//
+// RenderTrack narrows the columns down to the rectangle around the corners of the view, which holds about
+// twice the view wedge when looking along a diagonal. Every column also gets its bounds when the track is
+// loaded and is tested against the planes of the view frustum. With harness_game_config.column_culling 2
+// the columns that can't be seen from anywhere near the camera's column are dropped as well. That visibility
+// set is sampled by casting rays from just above the surfaces in one column to points throughout the bounds
+// of every other column, through the solid faces of the track. It is built when a track is first loaded and
+// cached next to the track actor.
+
+#define COLUMN_BOUNDS_MARGIN 0.25f // of a column; non-cars and groovidelics wander a little
+#define PVS_MAGIC 0x53565044       // "DPVS"
+#define PVS_VERSION 1
+#define PVS_MAX_COLUMNS 4096
+#define PVS_EYE_SAMPLES 3    // per axis and column
+#define PVS_EYE_LAYERS 3     // surfaces stood on at each sample
+#define PVS_EYE_HEIGHT 1.f   // above the surface
+#define PVS_TARGET_SAMPLES 3 // per axis of the target column's bounds
+#define PVS_GRID_SUBDIVISION 4
+#define PVS_RADIUS_FACTOR 2.f // of the yon; columns further apart are left visible
+
+typedef struct tPVS_header {
+    tU32 magic;
+    tU32 version;
+    tU32 ncolumns_x;
+    tU32 ncolumns_z;
+    tU32 checksum;
+    br_scalar radius;
+} tPVS_header;
+
+typedef struct tPVS_grid {
+    int ncells_x;
+    int ncells_z;
+    br_scalar origin_x;
+    br_scalar origin_z;
+    br_scalar cell_size_x;
+    br_scalar cell_size_z;
+    br_vector3* triangles;
+    int* cell_first; // ncells + 1
+    int* cell_triangles;
+    br_scalar* cell_min_y;
+    br_scalar* cell_max_y;
+    int* stamps;
+    int ray;
+} tPVS_grid;
+
+int gColumn_actors_drawn;
+int gColumn_actors_culled;
+int gColumn_frames;
+int gColumn_pvs_views_built;
+int gColumn_pvs_views_reused;
+
+// the rows or'ed into column_pvs_view
+static int gPVS_view_rows[9];
+static int gPVS_view_row_count;
+
+static void AddColumnActorBounds(br_bounds* pBounds, br_actor* pActor, br_actor* pTrack, int pLollipop) {
+    br_bounds b;
+    br_matrix34 m;
+    br_vector3 corner;
+    br_vector3 p;
+    br_scalar spread;
+    int i;
+
+    if (pActor == NULL) {
+        return;
+    }
+    BrActorToBounds(&b, pActor);
+    if (b.min.v[0] > b.max.v[0]) {
+        return;
+    }
+    if (pLollipop) {
+        // the children get turned to face the camera
+        spread = MAX(b.max.v[0] - b.min.v[0], b.max.v[2] - b.min.v[2]);
+        b.min.v[0] -= spread;
+        b.max.v[0] += spread;
+        b.min.v[2] -= spread;
+        b.max.v[2] += spread;
+    }
+    BrActorToActorMatrix34(&m, pActor, pTrack);
+    for (i = 0; i < 8; i++) {
+        corner.v[0] = (i & 1) ? b.max.v[0] : b.min.v[0];
+        corner.v[1] = (i & 2) ? b.max.v[1] : b.min.v[1];
+        corner.v[2] = (i & 4) ? b.max.v[2] : b.min.v[2];
+        BrMatrix34ApplyP(&p, &corner, &m);
+        pBounds->min.v[0] = MIN(pBounds->min.v[0], p.v[0]);
+        pBounds->min.v[1] = MIN(pBounds->min.v[1], p.v[1]);
+        pBounds->min.v[2] = MIN(pBounds->min.v[2], p.v[2]);
+        pBounds->max.v[0] = MAX(pBounds->max.v[0], p.v[0]);
+        pBounds->max.v[1] = MAX(pBounds->max.v[1], p.v[1]);
+        pBounds->max.v[2] = MAX(pBounds->max.v[2], p.v[2]);
+    }
+}
+
+void ComputeColumnBounds(tTrack_spec* pTrack_spec) {
+    br_bounds* bounds;
+    br_scalar margin;
+    int count;
+    int x;
+    int z;
+
+    pTrack_spec->column_bounds = NULL;
+    pTrack_spec->column_visible = NULL;
+    pTrack_spec->column_pvs = NULL;
+    pTrack_spec->column_eye_top = NULL;
+    pTrack_spec->column_pvs_view = NULL;
+    if (harness_game_config.column_culling == 0) {
+        return;
+    }
+    count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    pTrack_spec->column_bounds = BrMemAllocate(sizeof(br_bounds) * count, kMem_misc);
+    pTrack_spec->column_visible = BrMemAllocate(count, kMem_misc);
+    memset(pTrack_spec->column_visible, 1, count);
+    margin = COLUMN_BOUNDS_MARGIN * MIN(pTrack_spec->column_size_x, pTrack_spec->column_size_z);
+    for (z = 0; z < pTrack_spec->ncolumns_z; z++) {
+        for (x = 0; x < pTrack_spec->ncolumns_x; x++) {
+            bounds = &pTrack_spec->column_bounds[z * pTrack_spec->ncolumns_x + x];
+            BrVector3Set(&bounds->min, BR_SCALAR_MAX, BR_SCALAR_MAX, BR_SCALAR_MAX);
+            BrVector3Set(&bounds->max, -BR_SCALAR_MAX, -BR_SCALAR_MAX, -BR_SCALAR_MAX);
+            AddColumnActorBounds(bounds, pTrack_spec->columns[z][x], pTrack_spec->the_actor, 0);
+            AddColumnActorBounds(bounds, pTrack_spec->lollipops[z][x], pTrack_spec->the_actor, 1);
+            if (bounds->min.v[0] <= bounds->max.v[0]) {
+                bounds->min.v[0] -= margin;
+                bounds->min.v[1] -= margin;
+                bounds->min.v[2] -= margin;
+                bounds->max.v[0] += margin;
+                bounds->max.v[1] += margin;
+                bounds->max.v[2] += margin;
+            }
+        }
+    }
+}
+
+void DisposeColumnCulling(tTrack_spec* pTrack_spec) {
+
+    if (gColumn_frames != 0) {
+        dr_dprintf("Column culling: %d column actors drawn, %d culled per view", gColumn_actors_drawn / gColumn_frames, gColumn_actors_culled / gColumn_frames);
+    }
+    if (gColumn_pvs_views_built + gColumn_pvs_views_reused != 0) {
+        dr_dprintf("Column visibility set: rows merged for %d views, reused for %d", gColumn_pvs_views_built, gColumn_pvs_views_reused);
+    }
+    gColumn_actors_drawn = 0;
+    gColumn_actors_culled = 0;
+    gColumn_frames = 0;
+    gColumn_pvs_views_built = 0;
+    gColumn_pvs_views_reused = 0;
+    gPVS_view_row_count = 0;
+    if (pTrack_spec->column_bounds != NULL) {
+        BrMemFree(pTrack_spec->column_bounds);
+        pTrack_spec->column_bounds = NULL;
+    }
+    if (pTrack_spec->column_visible != NULL) {
+        BrMemFree(pTrack_spec->column_visible);
+        pTrack_spec->column_visible = NULL;
+    }
+    if (pTrack_spec->column_pvs != NULL) {
+        BrMemFree(pTrack_spec->column_pvs);
+        pTrack_spec->column_pvs = NULL;
+    }
+    if (pTrack_spec->column_eye_top != NULL) {
+        BrMemFree(pTrack_spec->column_eye_top);
+        pTrack_spec->column_eye_top = NULL;
+    }
+    if (pTrack_spec->column_pvs_view != NULL) {
+        BrMemFree(pTrack_spec->column_pvs_view);
+        pTrack_spec->column_pvs_view = NULL;
+    }
+}
+
+int ColumnVisible(tTrack_spec* pTrack_spec, int pColumn_x, int pColumn_z) {
+
+    return pTrack_spec->column_visible == NULL || pTrack_spec->column_visible[pColumn_z * pTrack_spec->ncolumns_x + pColumn_x];
+}
+
+static int BoundsInFrustum(br_bounds* pBounds, br_vector3* pNormals, br_scalar* pDistances) {
+    br_vector3 p;
+    int i;
+
+    if (pBounds->min.v[0] > pBounds->max.v[0]) {
+        return 0;
+    }
+    for (i = 0; i < 5; i++) {
+        // the corner furthest along the plane normal
+        p.v[0] = pNormals[i].v[0] >= 0.f ? pBounds->max.v[0] : pBounds->min.v[0];
+        p.v[1] = pNormals[i].v[1] >= 0.f ? pBounds->max.v[1] : pBounds->min.v[1];
+        p.v[2] = pNormals[i].v[2] >= 0.f ? pBounds->max.v[2] : pBounds->min.v[2];
+        if (BrVector3Dot(&pNormals[i], &p) + pDistances[i] < 0.f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Ors together the visibility set rows of the camera's column and of the neighbours it is close to
+static int GetPVSRows(tTrack_spec* pTrack_spec, br_matrix34* pCamera_to_world, int* pRows) {
+    br_scalar cx;
+    br_scalar cz;
+    br_scalar dx;
+    br_scalar dz;
+    br_scalar near_enough;
+    int column_x;
+    int column_z;
+    int x;
+    int z;
+    int count;
+
+    cx = (pCamera_to_world->m[3][0] - pTrack_spec->origin_x) / pTrack_spec->column_size_x;
+    cz = (pCamera_to_world->m[3][2] - pTrack_spec->origin_z) / pTrack_spec->column_size_z;
+    if (cx < 0.f || cz < 0.f || cx >= pTrack_spec->ncolumns_x || cz >= pTrack_spec->ncolumns_z) {
+        return 0;
+    }
+    column_x = (int)cx;
+    column_z = (int)cz;
+    // the set only knows about viewpoints near the ground
+    if (pCamera_to_world->m[3][1] > pTrack_spec->column_eye_top[column_z * pTrack_spec->ncolumns_x + column_x] + PVS_EYE_HEIGHT) {
+        return 0;
+    }
+    near_enough = .25f;
+    count = 0;
+    for (z = MAX(column_z - 1, 0); z <= MIN(column_z + 1, pTrack_spec->ncolumns_z - 1); z++) {
+        for (x = MAX(column_x - 1, 0); x <= MIN(column_x + 1, pTrack_spec->ncolumns_x - 1); x++) {
+            dx = MAX(MAX(x - cx, cx - (x + 1)), 0.f);
+            dz = MAX(MAX(z - cz, cz - (z + 1)), 0.f);
+            if (dx <= near_enough && dz <= near_enough) {
+                pRows[count++] = z * pTrack_spec->ncolumns_x + x;
+            }
+        }
+    }
+    return count;
+}
+
+// Ors the rows together into column_pvs_view, unless the last camera (the main view, when this is the
+// rear view mirror sitting in the same car) already used the same rows
+static void MergePVSRows(tTrack_spec* pTrack_spec, int* pRows, int pRow_count) {
+    int count;
+    int bit;
+    int i;
+    int j;
+
+    if (pRow_count == gPVS_view_row_count && memcmp(pRows, gPVS_view_rows, sizeof(int) * pRow_count) == 0) {
+        gColumn_pvs_views_reused++;
+        return;
+    }
+    count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    memset(pTrack_spec->column_pvs_view, 0, count);
+    for (i = 0; i < pRow_count; i++) {
+        for (j = 0; j < count; j++) {
+            bit = pRows[i] * count + j;
+            pTrack_spec->column_pvs_view[j] |= (pTrack_spec->column_pvs[bit >> 3] >> (bit & 7)) & 1;
+        }
+    }
+    memcpy(gPVS_view_rows, pRows, sizeof(int) * pRow_count);
+    gPVS_view_row_count = pRow_count;
+    gColumn_pvs_views_built++;
+}
+
+void CullColumns(tTrack_spec* pTrack_spec, br_actor* pCamera, br_matrix34* pCamera_to_world, int pMin_x, int pMax_x, int pMin_z, int pMax_z) {
+    br_camera* camera;
+    br_vector3 normals[5];
+    br_vector3 n;
+    br_scalar distances[5];
+    br_scalar tan_fov;
+    int rows[9];
+    int row_count;
+    int column;
+    int actors;
+    int visible;
+    int x;
+    int z;
+    int i;
+
+    camera = (br_camera*)pCamera->type_data;
+    tan_fov = BR_DIV(BR_SIN(camera->field_of_view / 2), BR_COS(camera->field_of_view / 2));
+    // inward facing planes in camera space, the camera looks down -z
+    for (i = 0; i < 5; i++) {
+        switch (i) {
+        case 0:
+            BrVector3Set(&n, 1.f, 0.f, -tan_fov * camera->aspect);
+            break;
+        case 1:
+            BrVector3Set(&n, -1.f, 0.f, -tan_fov * camera->aspect);
+            break;
+        case 2:
+            BrVector3Set(&n, 0.f, 1.f, -tan_fov);
+            break;
+        case 3:
+            BrVector3Set(&n, 0.f, -1.f, -tan_fov);
+            break;
+        default:
+            BrVector3Set(&n, 0.f, 0.f, 1.f);
+            break;
+        }
+        BrMatrix34ApplyV(&normals[i], &n, pCamera_to_world);
+        distances[i] = (i == 4 ? camera->yon_z * gYon_factor : 0.f) - BrVector3Dot(&normals[i], (br_vector3*)pCamera_to_world->m[3]);
+    }
+
+    row_count = 0;
+    if (harness_game_config.column_culling >= 2 && pTrack_spec->column_pvs != NULL) {
+        row_count = GetPVSRows(pTrack_spec, pCamera_to_world, rows);
+        if (row_count != 0) {
+            MergePVSRows(pTrack_spec, rows, row_count);
+        }
+    }
+    for (z = pMin_z; z <= pMax_z; z++) {
+        for (x = pMin_x; x <= pMax_x; x++) {
+            column = z * pTrack_spec->ncolumns_x + x;
+            visible = BoundsInFrustum(&pTrack_spec->column_bounds[column], normals, distances);
+            if (visible && row_count != 0) {
+                visible = pTrack_spec->column_pvs_view[column];
+            }
+            pTrack_spec->column_visible[column] = visible;
+            actors = (pTrack_spec->columns[z][x] != NULL) + (pTrack_spec->lollipops[z][x] != NULL);
+            if (visible) {
+                gColumn_actors_drawn += actors;
+            } else {
+                gColumn_actors_culled += actors;
+            }
+        }
+    }
+    gColumn_frames++;
+}
+
+static int MaterialOccludes(br_material* pMaterial) {
+    static br_pixelmap* maps[256];
+    static tU8 see_through[256];
+    static int map_count;
+    br_pixelmap* map;
+    tU8* row;
+    int result;
+    int x;
+    int y;
+    int i;
+
+    if (pMaterial == NULL) {
+        return 1;
+    }
+    if (pMaterial->identifier != NULL && pMaterial->identifier[0] == '!') {
+        return 0;
+    }
+    map = pMaterial->colour_map;
+    if (map == NULL || map->pixels == NULL || map->type != BR_PMT_INDEX_8) {
+        return 1;
+    }
+    for (i = 0; i < map_count; i++) {
+        if (maps[i] == map) {
+            return !see_through[i];
+        }
+    }
+    // colour 0 is see-through: fences, trees and railings don't hide anything
+    result = 1;
+    for (y = 0; y < map->height && result; y++) {
+        row = (tU8*)map->pixels + (map->base_y + y) * map->row_bytes + map->base_x;
+        for (x = 0; x < map->width; x++) {
+            if (row[x] == 0) {
+                result = 0;
+                break;
+            }
+        }
+    }
+    if (map_count == COUNT_OF(maps)) {
+        map_count = 0;
+    }
+    maps[map_count] = map;
+    see_through[map_count] = !result;
+    map_count++;
+    return result;
+}
+
+static int IsGroovidelicActor(br_actor* pActor) {
+    int i;
+
+    for (i = 0; i < gGroovidelics_array_size; i++) {
+        if (gGroovidelics_array[i].actor == pActor) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void CollectPVSTriangles(br_actor* pActor, br_matrix34* pTo_track, br_vector3** pTriangles, int* pCount, int* pCapacity) {
+    br_matrix34 to_track;
+    br_vector3* grown;
+    br_actor* child;
+    br_model* model;
+    br_face* face;
+    int i;
+    int j;
+
+    // non-cars get knocked about, lollipops are see-through, groovidelics move
+    if (pActor->identifier != NULL && (pActor->identifier[0] == '&' || pActor->identifier[0] == '%')) {
+        return;
+    }
+    if (IsGroovidelicActor(pActor)) {
+        return;
+    }
+    model = pActor->model;
+    if (pActor->type == BR_ACTOR_MODEL && model != NULL && pActor->render_style != BR_RSTYLE_NONE) {
+        for (i = 0, face = model->faces; i < model->nfaces; i++, face++) {
+            if (!MaterialOccludes(face->material != NULL ? face->material : pActor->material)) {
+                continue;
+            }
+            if (*pCount == *pCapacity) {
+                *pCapacity = MAX(1024, *pCapacity * 2);
+                grown = BrMemAllocate(sizeof(br_vector3) * 3 * *pCapacity, kMem_misc);
+                if (*pTriangles != NULL) {
+                    memcpy(grown, *pTriangles, sizeof(br_vector3) * 3 * *pCount);
+                    BrMemFree(*pTriangles);
+                }
+                *pTriangles = grown;
+            }
+            for (j = 0; j < 3; j++) {
+                BrMatrix34ApplyP(&(*pTriangles)[*pCount * 3 + j], &model->vertices[face->vertices[j]].p, pTo_track);
+            }
+            (*pCount)++;
+        }
+    }
+    for (child = pActor->children; child != NULL; child = child->next) {
+        BrMatrix34Mul(&to_track, &child->t.t.mat, pTo_track);
+        CollectPVSTriangles(child, &to_track, pTriangles, pCount, pCapacity);
+    }
+}
+
+static void BuildPVSGrid(tPVS_grid* pGrid, tTrack_spec* pTrack_spec, br_vector3* pTriangles, int pTriangle_count) {
+    br_vector3* v;
+    int ncells;
+    int min_x;
+    int max_x;
+    int min_z;
+    int max_z;
+    int pass;
+    int cell;
+    int x;
+    int z;
+    int i;
+
+    pGrid->ncells_x = pTrack_spec->ncolumns_x * PVS_GRID_SUBDIVISION;
+    pGrid->ncells_z = pTrack_spec->ncolumns_z * PVS_GRID_SUBDIVISION;
+    pGrid->origin_x = pTrack_spec->origin_x;
+    pGrid->origin_z = pTrack_spec->origin_z;
+    pGrid->cell_size_x = pTrack_spec->column_size_x / PVS_GRID_SUBDIVISION;
+    pGrid->cell_size_z = pTrack_spec->column_size_z / PVS_GRID_SUBDIVISION;
+    pGrid->triangles = pTriangles;
+    ncells = pGrid->ncells_x * pGrid->ncells_z;
+    pGrid->cell_first = BrMemAllocate(sizeof(int) * (ncells + 1), kMem_misc);
+    pGrid->cell_min_y = BrMemAllocate(sizeof(br_scalar) * ncells, kMem_misc);
+    pGrid->cell_max_y = BrMemAllocate(sizeof(br_scalar) * ncells, kMem_misc);
+    pGrid->stamps = BrMemAllocate(sizeof(int) * MAX(MAX(pTriangle_count, ncells), 1), kMem_misc);
+    memset(pGrid->cell_first, 0, sizeof(int) * (ncells + 1));
+    pGrid->ray = 0;
+    for (i = 0; i < ncells; i++) {
+        pGrid->cell_min_y[i] = BR_SCALAR_MAX;
+        pGrid->cell_max_y[i] = -BR_SCALAR_MAX;
+    }
+    pGrid->cell_triangles = NULL;
+
+    // count, then fill
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0, v = pTriangles; i < pTriangle_count; i++, v += 3) {
+            min_x = (int)floorf((MIN(MIN(v[0].v[0], v[1].v[0]), v[2].v[0]) - pGrid->origin_x) / pGrid->cell_size_x);
+            max_x = (int)floorf((MAX(MAX(v[0].v[0], v[1].v[0]), v[2].v[0]) - pGrid->origin_x) / pGrid->cell_size_x);
+            min_z = (int)floorf((MIN(MIN(v[0].v[2], v[1].v[2]), v[2].v[2]) - pGrid->origin_z) / pGrid->cell_size_z);
+            max_z = (int)floorf((MAX(MAX(v[0].v[2], v[1].v[2]), v[2].v[2]) - pGrid->origin_z) / pGrid->cell_size_z);
+            min_x = CONSTRAIN_BETWEEN(0, pGrid->ncells_x - 1, min_x);
+            max_x = CONSTRAIN_BETWEEN(0, pGrid->ncells_x - 1, max_x);
+            min_z = CONSTRAIN_BETWEEN(0, pGrid->ncells_z - 1, min_z);
+            max_z = CONSTRAIN_BETWEEN(0, pGrid->ncells_z - 1, max_z);
+            for (z = min_z; z <= max_z; z++) {
+                for (x = min_x; x <= max_x; x++) {
+                    cell = z * pGrid->ncells_x + x;
+                    if (pass == 0) {
+                        pGrid->cell_first[cell + 1]++;
+                        pGrid->cell_min_y[cell] = MIN(pGrid->cell_min_y[cell], MIN(MIN(v[0].v[1], v[1].v[1]), v[2].v[1]));
+                        pGrid->cell_max_y[cell] = MAX(pGrid->cell_max_y[cell], MAX(MAX(v[0].v[1], v[1].v[1]), v[2].v[1]));
+                    } else {
+                        pGrid->cell_triangles[pGrid->stamps[cell]++] = i;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (cell = 0; cell < ncells; cell++) {
+                pGrid->cell_first[cell + 1] += pGrid->cell_first[cell];
+            }
+            pGrid->cell_triangles = BrMemAllocate(sizeof(int) * MAX(pGrid->cell_first[ncells], 1), kMem_misc);
+            // the stamps double as fill positions until the rays start
+            memcpy(pGrid->stamps, pGrid->cell_first, sizeof(int) * ncells);
+        }
+    }
+    memset(pGrid->stamps, 0, sizeof(int) * MAX(MAX(pTriangle_count, ncells), 1));
+}
+
+static void DisposePVSGrid(tPVS_grid* pGrid) {
+
+    BrMemFree(pGrid->cell_first);
+    BrMemFree(pGrid->cell_triangles);
+    BrMemFree(pGrid->cell_min_y);
+    BrMemFree(pGrid->cell_max_y);
+    BrMemFree(pGrid->stamps);
+}
+
+// Segment from pFrom to pTo against a double sided triangle
+static int SegmentHitsTriangle(br_vector3* pFrom, br_vector3* pDir, br_vector3* pTriangle) {
+    br_vector3 e1;
+    br_vector3 e2;
+    br_vector3 p;
+    br_vector3 s;
+    br_vector3 q;
+    br_scalar det;
+    br_scalar u;
+    br_scalar v;
+    br_scalar t;
+
+    BrVector3Sub(&e1, &pTriangle[1], &pTriangle[0]);
+    BrVector3Sub(&e2, &pTriangle[2], &pTriangle[0]);
+    BrVector3Cross(&p, pDir, &e2);
+    det = BrVector3Dot(&e1, &p);
+    if (fabsf(det) < 1e-12f) {
+        return 0;
+    }
+    BrVector3Sub(&s, pFrom, &pTriangle[0]);
+    u = BrVector3Dot(&s, &p) / det;
+    if (u < 0.f || u > 1.f) {
+        return 0;
+    }
+    BrVector3Cross(&q, &s, &e1);
+    v = BrVector3Dot(pDir, &q) / det;
+    if (v < 0.f || u + v > 1.f) {
+        return 0;
+    }
+    t = BrVector3Dot(&e2, &q) / det;
+    return t > 1e-4f && t < 1.f - 1e-4f;
+}
+
+static int PVSCellBlocks(tPVS_grid* pGrid, int pCell, br_vector3* pFrom, br_vector3* pDir, br_scalar pT0, br_scalar pT1) {
+    br_scalar y0;
+    br_scalar y1;
+    int triangle;
+    int i;
+
+    y0 = pFrom->v[1] + pDir->v[1] * pT0;
+    y1 = pFrom->v[1] + pDir->v[1] * pT1;
+    if (MAX(y0, y1) < pGrid->cell_min_y[pCell] || MIN(y0, y1) > pGrid->cell_max_y[pCell]) {
+        return 0;
+    }
+    for (i = pGrid->cell_first[pCell]; i < pGrid->cell_first[pCell + 1]; i++) {
+        triangle = pGrid->cell_triangles[i];
+        if (pGrid->stamps[triangle] == pGrid->ray) {
+            continue;
+        }
+        pGrid->stamps[triangle] = pGrid->ray;
+        if (SegmentHitsTriangle(pFrom, pDir, &pGrid->triangles[triangle * 3])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Walks the cells under the segment (Amanatides & Woo)
+static int PVSSegmentBlocked(tPVS_grid* pGrid, br_vector3* pFrom, br_vector3* pTo) {
+    br_vector3 dir;
+    br_scalar t0;
+    br_scalar t1;
+    br_scalar t;
+    br_scalar next_x;
+    br_scalar next_z;
+    br_scalar delta_x;
+    br_scalar delta_z;
+    br_scalar gx;
+    br_scalar gz;
+    int step_x;
+    int step_z;
+    int x;
+    int z;
+
+    pGrid->ray++;
+    BrVector3Sub(&dir, pTo, pFrom);
+    gx = (pFrom->v[0] - pGrid->origin_x) / pGrid->cell_size_x;
+    gz = (pFrom->v[2] - pGrid->origin_z) / pGrid->cell_size_z;
+    delta_x = dir.v[0] / pGrid->cell_size_x;
+    delta_z = dir.v[2] / pGrid->cell_size_z;
+
+    // clip to the grid
+    t0 = 0.f;
+    t1 = 1.f;
+    if (delta_x != 0.f) {
+        t = (0.f - gx) / delta_x;
+        next_x = (pGrid->ncells_x - gx) / delta_x;
+        t0 = MAX(t0, MIN(t, next_x));
+        t1 = MIN(t1, MAX(t, next_x));
+    } else if (gx < 0.f || gx >= pGrid->ncells_x) {
+        return 0;
+    }
+    if (delta_z != 0.f) {
+        t = (0.f - gz) / delta_z;
+        next_z = (pGrid->ncells_z - gz) / delta_z;
+        t0 = MAX(t0, MIN(t, next_z));
+        t1 = MIN(t1, MAX(t, next_z));
+    } else if (gz < 0.f || gz >= pGrid->ncells_z) {
+        return 0;
+    }
+    if (t0 > t1) {
+        return 0;
+    }
+
+    x = CONSTRAIN_BETWEEN(0, pGrid->ncells_x - 1, (int)floorf(gx + delta_x * t0));
+    z = CONSTRAIN_BETWEEN(0, pGrid->ncells_z - 1, (int)floorf(gz + delta_z * t0));
+    step_x = delta_x > 0.f ? 1 : -1;
+    step_z = delta_z > 0.f ? 1 : -1;
+    next_x = delta_x != 0.f ? (x + (step_x > 0) - gx) / delta_x : BR_SCALAR_MAX;
+    next_z = delta_z != 0.f ? (z + (step_z > 0) - gz) / delta_z : BR_SCALAR_MAX;
+    t = t0;
+    for (;;) {
+        if (PVSCellBlocks(pGrid, z * pGrid->ncells_x + x, pFrom, &dir, t, MIN(MIN(next_x, next_z), t1))) {
+            return 1;
+        }
+        if (next_x < next_z) {
+            if (next_x > t1) {
+                break;
+            }
+            t = next_x;
+            x += step_x;
+            next_x += step_x / delta_x;
+        } else {
+            if (next_z > t1) {
+                break;
+            }
+            t = next_z;
+            z += step_z;
+            next_z += step_z / delta_z;
+        }
+        if (x < 0 || x >= pGrid->ncells_x || z < 0 || z >= pGrid->ncells_z) {
+            break;
+        }
+    }
+    return 0;
+}
+
+// Viewpoints just above every surface under a few points of the column, returns how many
+static int GetPVSEyes(tPVS_grid* pGrid, tTrack_spec* pTrack_spec, int pColumn_x, int pColumn_z, br_vector3* pEyes) {
+    br_scalar heights[PVS_EYE_LAYERS + 1];
+    br_scalar x;
+    br_scalar z;
+    br_scalar y;
+    br_scalar above;
+    br_scalar d;
+    br_scalar u;
+    br_scalar v;
+    br_vector3* tri;
+    int height_count;
+    int count;
+    int cell;
+    int sx;
+    int sz;
+    int i;
+    int j;
+
+    count = 0;
+    for (sz = 0; sz < PVS_EYE_SAMPLES; sz++) {
+        for (sx = 0; sx < PVS_EYE_SAMPLES; sx++) {
+            x = pTrack_spec->origin_x + (pColumn_x + (sx + .5f) / PVS_EYE_SAMPLES) * pTrack_spec->column_size_x;
+            z = pTrack_spec->origin_z + (pColumn_z + (sz + .5f) / PVS_EYE_SAMPLES) * pTrack_spec->column_size_z;
+            cell = CONSTRAIN_BETWEEN(0, pGrid->ncells_z - 1, (int)((z - pGrid->origin_z) / pGrid->cell_size_z)) * pGrid->ncells_x
+                + CONSTRAIN_BETWEEN(0, pGrid->ncells_x - 1, (int)((x - pGrid->origin_x) / pGrid->cell_size_x));
+            // the highest surfaces under the point, highest first
+            height_count = 0;
+            for (i = pGrid->cell_first[cell]; i < pGrid->cell_first[cell + 1]; i++) {
+                tri = &pGrid->triangles[pGrid->cell_triangles[i] * 3];
+                d = (tri[1].v[2] - tri[2].v[2]) * (tri[0].v[0] - tri[2].v[0]) + (tri[2].v[0] - tri[1].v[0]) * (tri[0].v[2] - tri[2].v[2]);
+                if (fabsf(d) < 1e-12f) {
+                    continue;
+                }
+                u = ((tri[1].v[2] - tri[2].v[2]) * (x - tri[2].v[0]) + (tri[2].v[0] - tri[1].v[0]) * (z - tri[2].v[2])) / d;
+                v = ((tri[2].v[2] - tri[0].v[2]) * (x - tri[2].v[0]) + (tri[0].v[0] - tri[2].v[0]) * (z - tri[2].v[2])) / d;
+                if (u < 0.f || v < 0.f || u + v > 1.f) {
+                    continue;
+                }
+                y = u * tri[0].v[1] + v * tri[1].v[1] + (1.f - u - v) * tri[2].v[1];
+                for (j = height_count; j > 0 && heights[j - 1] < y; j--) {
+                    heights[j] = heights[j - 1];
+                }
+                heights[j] = y;
+                if (height_count < PVS_EYE_LAYERS) {
+                    height_count++;
+                }
+            }
+            above = BR_SCALAR_MAX;
+            for (i = 0; i < height_count; i++) {
+                // stay under whatever is overhead, a tunnel roof is close
+                y = heights[i] + MIN(PVS_EYE_HEIGHT, (above - heights[i]) / 2.f);
+                above = heights[i];
+                if (i != 0 && heights[i - 1] - heights[i] < .01f) {
+                    continue;
+                }
+                BrVector3Set(&pEyes[count], x, y, z);
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static int GetPVSTargets(br_bounds* pBounds, br_vector3* pTargets) {
+    br_scalar f[PVS_TARGET_SAMPLES];
+    int count;
+    int x;
+    int y;
+    int z;
+
+    for (x = 0; x < PVS_TARGET_SAMPLES; x++) {
+        f[x] = (x + .5f) / PVS_TARGET_SAMPLES;
+    }
+    count = 0;
+    for (y = 0; y < PVS_TARGET_SAMPLES; y++) {
+        for (z = 0; z < PVS_TARGET_SAMPLES; z++) {
+            for (x = 0; x < PVS_TARGET_SAMPLES; x++) {
+                pTargets[count].v[0] = pBounds->min.v[0] + (pBounds->max.v[0] - pBounds->min.v[0]) * f[x];
+                pTargets[count].v[1] = pBounds->min.v[1] + (pBounds->max.v[1] - pBounds->min.v[1]) * f[y];
+                pTargets[count].v[2] = pBounds->min.v[2] + (pBounds->max.v[2] - pBounds->min.v[2]) * f[z];
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// Fills in column_pvs and column_eye_top from the solid triangles of the track (three vertices each, track
+// space). Columns further apart than pRadius are left visible. Returns the number of visible pairs
+int BuildColumnPVS(tTrack_spec* pTrack_spec, br_vector3* pTriangles, int pTriangle_count, br_scalar pRadius) {
+    tPVS_grid grid;
+    br_vector3 eyes[PVS_EYE_SAMPLES * PVS_EYE_SAMPLES * PVS_EYE_LAYERS];
+    br_vector3 targets[PVS_TARGET_SAMPLES * PVS_TARGET_SAMPLES * PVS_TARGET_SAMPLES];
+    br_bounds* bounds;
+    br_scalar dx;
+    br_scalar dz;
+    br_scalar cx;
+    br_scalar cz;
+    int eye_count;
+    int target_count;
+    int count;
+    int from;
+    int to;
+    int visible;
+    int visible_pairs;
+    int i;
+    int j;
+
+    count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    memset(pTrack_spec->column_pvs, 0, (count * count + 7) / 8);
+    BuildPVSGrid(&grid, pTrack_spec, pTriangles, pTriangle_count);
+    visible_pairs = 0;
+    for (from = 0; from < count; from++) {
+        eye_count = GetPVSEyes(&grid, pTrack_spec, from % pTrack_spec->ncolumns_x, from / pTrack_spec->ncolumns_x, eyes);
+        pTrack_spec->column_eye_top[from] = eye_count != 0 ? -BR_SCALAR_MAX : BR_SCALAR_MAX;
+        for (i = 0; i < eye_count; i++) {
+            pTrack_spec->column_eye_top[from] = MAX(pTrack_spec->column_eye_top[from], eyes[i].v[1]);
+        }
+        cx = pTrack_spec->origin_x + (from % pTrack_spec->ncolumns_x + .5f) * pTrack_spec->column_size_x;
+        cz = pTrack_spec->origin_z + (from / pTrack_spec->ncolumns_x + .5f) * pTrack_spec->column_size_z;
+        for (to = 0; to < count; to++) {
+            bounds = &pTrack_spec->column_bounds[to];
+            if (bounds->min.v[0] > bounds->max.v[0]) {
+                continue;
+            }
+            dx = MAX(MAX(bounds->min.v[0] - cx, cx - bounds->max.v[0]), 0.f);
+            dz = MAX(MAX(bounds->min.v[2] - cz, cz - bounds->max.v[2]), 0.f);
+            visible = to == from || eye_count == 0 || dx * dx + dz * dz > pRadius * pRadius;
+            if (!visible) {
+                target_count = GetPVSTargets(bounds, targets);
+                for (i = 0; i < eye_count && !visible; i++) {
+                    for (j = 0; j < target_count && !visible; j++) {
+                        visible = !PVSSegmentBlocked(&grid, &eyes[i], &targets[j]);
+                    }
+                }
+            }
+            if (visible) {
+                pTrack_spec->column_pvs[(from * count + to) >> 3] |= 1 << ((from * count + to) & 7);
+                visible_pairs++;
+            }
+        }
+    }
+    DisposePVSGrid(&grid);
+    gPVS_view_row_count = 0;
+    return visible_pairs;
+}
+
+static tU32 ColumnBoundsChecksum(tTrack_spec* pTrack_spec) {
+    tU8* p;
+    tU32 hash;
+    int i;
+
+    // FNV-1a
+    hash = 2166136261u;
+    p = (tU8*)pTrack_spec->column_bounds;
+    for (i = 0; i < (int)sizeof(br_bounds) * pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void LoadColumnPVS(tTrack_spec* pTrack_spec, char* pActor_path) {
+    tPVS_header header;
+    tPVS_header cached;
+    br_vector3* triangles;
+    br_matrix34 identity;
+    br_actor* child;
+    char path[256];
+    char* dot;
+    FILE* f;
+    int triangle_count;
+    int capacity;
+    int count;
+    int size;
+    int visible_pairs;
+    tU32 start_time;
+
+    count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    if (harness_game_config.column_culling < 2 || pTrack_spec->column_bounds == NULL || count < 2 || count > PVS_MAX_COLUMNS) {
+        return;
+    }
+    size = (count * count + 7) / 8;
+    pTrack_spec->column_pvs = BrMemAllocate(size, kMem_misc);
+    pTrack_spec->column_eye_top = BrMemAllocate(sizeof(br_scalar) * count, kMem_misc);
+    pTrack_spec->column_pvs_view = BrMemAllocate(count, kMem_misc);
+    gPVS_view_row_count = 0;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = PVS_MAGIC;
+    header.version = PVS_VERSION;
+    header.ncolumns_x = pTrack_spec->ncolumns_x;
+    header.ncolumns_z = pTrack_spec->ncolumns_z;
+    header.checksum = ColumnBoundsChecksum(pTrack_spec);
+    header.radius = PVS_RADIUS_FACTOR * gCamera_yon * gYon_multiplier;
+
+    strncpy(path, pActor_path, sizeof(path) - 5);
+    path[sizeof(path) - 5] = '\0';
+    dot = strrchr(path, '.');
+    if (dot != NULL && strchr(dot, '/') == NULL && strchr(dot, '\\') == NULL) {
+        *dot = '\0';
+    }
+    strcat(path, ".PVS");
+
+    f = DRfopen(path, "rb");
+    if (f != NULL) {
+        if (fread(&cached, sizeof(cached), 1, f) == 1
+            && cached.magic == header.magic
+            && cached.version == header.version
+            && cached.ncolumns_x == header.ncolumns_x
+            && cached.ncolumns_z == header.ncolumns_z
+            && cached.checksum == header.checksum
+            && cached.radius >= header.radius
+            && fread(pTrack_spec->column_pvs, size, 1, f) == 1
+            && fread(pTrack_spec->column_eye_top, sizeof(br_scalar) * count, 1, f) == 1) {
+            fclose(f);
+            dr_dprintf("Column visibility set read from %s", path);
+            return;
+        }
+        fclose(f);
+    }
+
+    start_time = PDGetTotalTime();
+    triangles = NULL;
+    triangle_count = 0;
+    capacity = 0;
+    BrMatrix34Identity(&identity);
+    CollectPVSTriangles(pTrack_spec->the_actor, &identity, &triangles, &triangle_count, &capacity);
+    visible_pairs = BuildColumnPVS(pTrack_spec, triangles, triangle_count, header.radius);
+    if (triangles != NULL) {
+        BrMemFree(triangles);
+    }
+    dr_dprintf("Column visibility set: %d triangles, %d of %d column pairs visible, built in %d ms", triangle_count, visible_pairs, count * count, PDGetTotalTime() - start_time);
+
+    f = DRfopen(path, "wb");
+    if (f == NULL) {
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(pTrack_spec->column_pvs, size, 1, f);
+    fwrite(pTrack_spec->column_eye_top, sizeof(br_scalar) * count, 1, f);
+    fclose(f);
+}
+
+// Added by dethrace: lollipops.
+//
+// Every child of a column's lollipops actor is a billboard DrawColumns turns to face the camera. They all get
+// the same rotation, which only changes when the camera turns, so it is worked out once per view and the
+// children are gathered into one list when the track is loaded. A column's children are only rewritten when
+// the rotation differs from the one they were last given.
+
+int gLollipop_columns_turned;
+int gLollipop_columns_kept;
+
+// holds the rotation LollipopizeActor4 gives the current view
+static br_actor gLollipop_facer;
+// bumped whenever that rotation changes
+static tU32 gLollipop_facing;
+
+static br_uintptr_t CountLollipopsCB(br_actor* pActor, void* pArg) {
+
+    (*(int*)pArg)++;
+    return 0;
+}
+
+static br_uintptr_t GatherLollipopsCB(br_actor* pActor, void* pArg) {
+    br_actor*** next;
+
+    next = pArg;
+    **next = pActor;
+    (*next)++;
+    return 0;
+}
+
+void BuildLollipopStore(tTrack_spec* pTrack_spec) {
+    br_actor** next;
+    int count;
+    int total;
+    int x;
+    int z;
+
+    pTrack_spec->lollipop_actors = NULL;
+    pTrack_spec->lollipop_first = NULL;
+    pTrack_spec->lollipop_facing = NULL;
+    count = pTrack_spec->ncolumns_x * pTrack_spec->ncolumns_z;
+    total = 0;
+    for (z = 0; z < pTrack_spec->ncolumns_z; z++) {
+        for (x = 0; x < pTrack_spec->ncolumns_x; x++) {
+            if (pTrack_spec->lollipops[z][x] != NULL) {
+                BrActorEnum(pTrack_spec->lollipops[z][x], CountLollipopsCB, &total);
+            }
+        }
+    }
+    if (total == 0) {
+        return;
+    }
+    pTrack_spec->lollipop_actors = BrMemAllocate(sizeof(br_actor*) * total, kMem_misc);
+    pTrack_spec->lollipop_first = BrMemAllocate(sizeof(int) * (count + 1), kMem_misc);
+    pTrack_spec->lollipop_facing = BrMemAllocate(sizeof(tU32) * count, kMem_misc);
+    memset(pTrack_spec->lollipop_facing, 0, sizeof(tU32) * count);
+    next = pTrack_spec->lollipop_actors;
+    for (z = 0; z < pTrack_spec->ncolumns_z; z++) {
+        for (x = 0; x < pTrack_spec->ncolumns_x; x++) {
+            pTrack_spec->lollipop_first[z * pTrack_spec->ncolumns_x + x] = next - pTrack_spec->lollipop_actors;
+            if (pTrack_spec->lollipops[z][x] != NULL) {
+                BrActorEnum(pTrack_spec->lollipops[z][x], GatherLollipopsCB, &next);
+            }
+        }
+    }
+    pTrack_spec->lollipop_first[count] = total;
+    dr_dprintf("Lollipops: %d billboards", total);
+}
+
+void DisposeLollipopStore(tTrack_spec* pTrack_spec) {
+
+    if (gLollipop_columns_turned + gLollipop_columns_kept != 0) {
+        dr_dprintf("Lollipops: columns turned %d times, already facing %d times", gLollipop_columns_turned, gLollipop_columns_kept);
+    }
+    gLollipop_columns_turned = 0;
+    gLollipop_columns_kept = 0;
+    if (pTrack_spec->lollipop_actors != NULL) {
+        BrMemFree(pTrack_spec->lollipop_actors);
+        pTrack_spec->lollipop_actors = NULL;
+    }
+    if (pTrack_spec->lollipop_first != NULL) {
+        BrMemFree(pTrack_spec->lollipop_first);
+        pTrack_spec->lollipop_first = NULL;
+    }
+    if (pTrack_spec->lollipop_facing != NULL) {
+        BrMemFree(pTrack_spec->lollipop_facing);
+        pTrack_spec->lollipop_facing = NULL;
+    }
+}
+
+void TurnLollipopsTo(br_matrix34* pCamera_to_world) {
+    br_matrix34 old_rotation;
+
+    old_rotation = gLollipop_facer.t.t.mat;
+    LollipopizeActor4(&gLollipop_facer, pCamera_to_world, NULL);
+    if (memcmp(old_rotation.m, gLollipop_facer.t.t.mat.m, sizeof(br_scalar) * 9) != 0) {
+        gLollipop_facing++;
+    }
+}
+
+void FaceColumnLollipops(tTrack_spec* pTrack_spec, br_matrix34* pCamera_to_world, int pColumn_x, int pColumn_z) {
+    tMatrix_and_actor maa;
+    int column;
+    int i;
+
+    if (pTrack_spec->lollipop_first == NULL) {
+        maa.m = pCamera_to_world;
+        maa.a = pTrack_spec->lollipops[pColumn_z][pColumn_x];
+        BrActorEnum(pTrack_spec->lollipops[pColumn_z][pColumn_x], LollipopizeChildren, &maa);
+        return;
+    }
+    column = pColumn_z * pTrack_spec->ncolumns_x + pColumn_x;
+    if (pTrack_spec->lollipop_facing[column] == gLollipop_facing) {
+        gLollipop_columns_kept++;
+        return;
+    }
+    pTrack_spec->lollipop_facing[column] = gLollipop_facing;
+    for (i = pTrack_spec->lollipop_first[column]; i < pTrack_spec->lollipop_first[column + 1]; i++) {
+        memcpy(pTrack_spec->lollipop_actors[i]->t.t.mat.m, gLollipop_facer.t.t.mat.m, sizeof(br_scalar) * 9);
+    }
+    gLollipop_columns_turned++;
+}
@@ -6,6 +6,13 @@
 
 extern br_actor* gMr_blendy;
 extern int gDefault_blend_pc;
+extern int gColumn_actors_drawn;
+extern int gColumn_actors_culled;
+extern int gColumn_frames;
+extern int gColumn_pvs_views_built;
+extern int gColumn_pvs_views_reused;
+extern int gLollipop_columns_turned;
+extern int gLollipop_columns_kept;
 
 void AllocateActorMatrix(tTrack_spec* pTrack_spec, br_actor**** pDst);
 
@@ -37,4 +44,24 @@ br_scalar GetYonFactor(void);
 
 void SetYonFactor(br_scalar pNew);
 
+void ComputeColumnBounds(tTrack_spec* pTrack_spec);
+
+void DisposeColumnCulling(tTrack_spec* pTrack_spec);
+
+int ColumnVisible(tTrack_spec* pTrack_spec, int pColumn_x, int pColumn_z);
+
+void CullColumns(tTrack_spec* pTrack_spec, br_actor* pCamera, br_matrix34* pCamera_to_world, int pMin_x, int pMax_x, int pMin_z, int pMax_z);
+
+int BuildColumnPVS(tTrack_spec* pTrack_spec, br_vector3* pTriangles, int pTriangle_count, br_scalar pRadius);
+
+void LoadColumnPVS(tTrack_spec* pTrack_spec, char* pActor_path);
+
+void BuildLollipopStore(tTrack_spec* pTrack_spec);
+
+void DisposeLollipopStore(tTrack_spec* pTrack_spec);
+
+void TurnLollipopsTo(br_matrix34* pCamera_to_world);
+
+void FaceColumnLollipops(tTrack_spec* pTrack_spec, br_matrix34* pCamera_to_world, int pColumn_x, int pColumn_z);
+
 #endif
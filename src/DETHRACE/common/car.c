@@ -1141,6 +1141,95 @@ void FinishCars(tU32 pLast_frame_time, tU32 pTime) {
     }
 }
 
+// Added by dethrace: most game time simulated in one frame when physics_max_steps is 0; 5 of the original steps
+#define PHYSICS_MAX_CATCH_UP 200
+
+// Added by dethrace: the poses each active car (or non-car) had before and after the last physics step, so
+// InterpolateCars can draw it in between
+typedef struct tPhysics_pose {
+    tCar_spec* car;
+    tU32 start_time;
+    tU32 end_time;
+    br_matrix34 mat;
+    br_matrix34 end_mat; // anything else moving the car since shows up as a difference here
+} tPhysics_pose;
+
+static tPhysics_pose gPhysics_poses[COUNT_OF(gActive_car_list)];
+
+// Added by dethrace: counted for ReportPhysicsStats
+static int gPhysics_frames;
+static int gPhysics_steps;
+static tU32 gPhysics_time_dropped;
+static tU32 gPhysics_first_frame;
+
+// Added by dethrace
+static void RecordPhysicsPoses(tU32 pStep_start, tU32 pStep_end) {
+    int i;
+
+    for (i = 0; i < gNum_cars_and_non_cars && i < COUNT_OF(gPhysics_poses); i++) {
+        gPhysics_poses[i].car = gActive_car_list[i];
+        gPhysics_poses[i].start_time = pStep_start;
+        gPhysics_poses[i].end_time = pStep_end;
+        BrMatrix34Copy(&gPhysics_poses[i].mat, &gActive_car_list[i]->car_master_actor->t.t.mat);
+    }
+}
+
+// Added by dethrace
+static void RecordPhysicsPoseEnds(void) {
+    int i;
+
+    for (i = 0; i < gNum_cars_and_non_cars && i < COUNT_OF(gPhysics_poses); i++) {
+        if (gPhysics_poses[i].car == gActive_car_list[i]) {
+            BrMatrix34Copy(&gPhysics_poses[i].end_mat, &gActive_car_list[i]->car_master_actor->t.t.mat);
+        }
+    }
+}
+
+// Added by dethrace: puts the car where it was at pFrame_time, between the poses before and after the last
+// physics step. Returns 0 if that step's starting pose wasn't recorded for this car
+static int InterpolatePhysicsPose(tCar_spec* pCar, int pIndex, tU32 pFrame_time) {
+    tPhysics_pose* pose;
+    br_matrix34 mat;
+    br_scalar t;
+    int row;
+    int col;
+
+    if (!harness_game_config.physics_interpolation || pIndex >= COUNT_OF(gPhysics_poses)) {
+        return 0;
+    }
+    pose = &gPhysics_poses[pIndex];
+    if (pose->car != pCar
+        || pose->end_time != gLast_mechanics_time
+        || pFrame_time < pose->start_time
+        || memcmp(&pose->end_mat, &pCar->car_master_actor->t.t.mat, sizeof(br_matrix34)) != 0) {
+        return 0;
+    }
+    t = (pFrame_time - pose->start_time) / (br_scalar)(pose->end_time - pose->start_time);
+    for (row = 0; row < 4; row++) {
+        for (col = 0; col < 3; col++) {
+            mat.m[row][col] = pose->mat.m[row][col] + (pCar->car_master_actor->t.t.mat.m[row][col] - pose->mat.m[row][col]) * t;
+        }
+    }
+    BrMatrix34LPNormalise(&pCar->car_master_actor->t.t.mat, &mat);
+    return 1;
+}
+
+// Added by dethrace
+void ReportPhysicsStats(void) {
+    float seconds;
+
+    if (gPhysics_frames != 0) {
+        seconds = (PDGetTotalTime() - gPhysics_first_frame) / 1000.f;
+        if (seconds > 0.f) {
+            dr_dprintf("Physics: %d steps in %d frames, %.1f steps/s at %.1f frames/s, %u ms of game time dropped",
+                gPhysics_steps, gPhysics_frames, gPhysics_steps / seconds, gPhysics_frames / seconds, gPhysics_time_dropped);
+        }
+    }
+    gPhysics_frames = 0;
+    gPhysics_steps = 0;
+    gPhysics_time_dropped = 0;
+}
+
 // IDA: void __usercall InterpolateCars(tU32 pLast_frame_time@<EAX>, tU32 pTime@<EDX>)
 // FUNCTION: CARM95 0x00478928
 void InterpolateCars(tU32 pLast_frame_time, tU32 pTime) {
@@ -1149,7 +1238,11 @@ void InterpolateCars(tU32 pLast_frame_time, tU32 pTime) {
     int i;
 
     dt = ((int)(gLast_mechanics_time - pLast_frame_time)) / 1000.0;
+#ifdef DETHRACE_FIX_BUGS
+    if (dt > harness_game_config.physics_step_time / 1000.0 || dt < 0)
+#else
     if (dt > 0.04 || dt < 0)
+#endif
         dt = 0;
 
     gOver_shoot = dt > 0.0f;
@@ -1157,8 +1250,11 @@ void InterpolateCars(tU32 pLast_frame_time, tU32 pTime) {
     for (i = 0; i < gNum_cars_and_non_cars; i++) {
         car = gActive_car_list[i];
         BrMatrix34Copy(&car->oldmat, &car->car_master_actor->t.t.mat);
-        SimpleRotate((tCollision_info*)car, -dt);
-        TranslateCar((tCollision_info*)car, -dt);
+        // Added by dethrace: rather than winding the last step back along the car's velocity
+        if (!gOver_shoot || !InterpolatePhysicsPose(car, i, pLast_frame_time)) {
+            SimpleRotate((tCollision_info*)car, -dt);
+            TranslateCar((tCollision_info*)car, -dt);
+        }
         BrMatrix34ApplyP(&car->pos, &car->cmpos, &car->car_master_actor->t.t.mat);
         BrVector3InvScale(&car->pos, &car->pos, WORLD_SCALE);
     }
@@ -1286,12 +1382,18 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
     tNon_car_spec* non_car;
     tU32 time_step;
     tU32 frame_end_time;
+    int max_steps;
 
     step_number = 0;
     frame_end_time = last_frame_time + pTime_difference;
     if (gFreeze_mechanics) {
         return;
     }
+    // Added by dethrace
+    if (gPhysics_frames == 0) {
+        gPhysics_first_frame = PDGetTotalTime();
+    }
+    gPhysics_frames++;
     if (gNet_mode == eNet_mode_client) {
         ForceRebuildActiveCarList();
     }
@@ -1321,10 +1423,19 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
     gDt = 40 / 1000.0;
 #endif
 
+    // Added by dethrace
+    max_steps = harness_game_config.physics_max_steps;
+    if (max_steps <= 0) {
+        max_steps = MAX(5, PHYSICS_MAX_CATCH_UP / (int)time_step);
+    }
+
     gMechanics_time_sync = pTime_difference - (gLast_mechanics_time - last_frame_time);
-    while (gLast_mechanics_time < frame_end_time && step_number < 5) {
+    // while (gLast_mechanics_time < frame_end_time && step_number < 5) {
+    while (gLast_mechanics_time < frame_end_time && step_number < max_steps) { // changed by dethrace
         step_number++;
         ResetOldmat();
+        RecordPhysicsPoses(gLast_mechanics_time, gLast_mechanics_time + time_step); // Added by dethrace
+        gPhysics_steps++;                                                           // Added by dethrace
         BrVector3Copy(&gProgram_state.current_car.old_v, &gProgram_state.current_car.v);
         if (&gProgram_state.current_car != gCar_to_view) {
             BrVector3Copy(&gCar_to_view->old_v, &gCar_to_view->v);
@@ -1333,6 +1444,10 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
             car = gActive_car_list[i];
             car_info = (tCollision_info*)car;
             car->dt = -1.f;
+            // Added by dethrace: remote cars are played out of their jitter buffer, one sample per step
+            if (IsNetSnapshotCar(car)) {
+                SampleNetSnapshots(car, gLast_mechanics_time + time_step);
+            }
             if (car->message.type == NETMSGID_MECHANICS && car->message.time >= gLast_mechanics_time && car->message.time <= gLast_mechanics_time + time_step) {
                 // time between car message and next mechanics
                 car->dt = (gLast_mechanics_time + time_step - car->message.time) / 1000.0f;
@@ -1396,6 +1511,11 @@ void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference) {
         gMechanics_time_sync -= time_step;
         gLast_mechanics_time += time_step;
     }
+    // Added by dethrace
+    if (gLast_mechanics_time < frame_end_time) {
+        gPhysics_time_dropped += frame_end_time - gLast_mechanics_time;
+    }
+    RecordPhysicsPoseEnds();
     gMechanics_time_sync = 1;
     SendCarData(gLast_mechanics_time);
     InterpolateCars(frame_end_time, pTime_difference);
@@ -2261,6 +2381,7 @@ void CalcForce(tCar_spec* c, br_scalar dt) {
     BrVector3Set(&c->road_normal, 0, 0, 0);
     for (i = 0; i < 4; ++i) {
         BrMatrix34ApplyP(&wheel_pos[i], &c->wpos[i], mat);
+        BrVector3Copy(&c->wheel_world[i], &wheel_pos[i]); // added by dethrace
     }
     MultiFindFloorInBoxM(4, wheel_pos, &b, c->nor, d, c, c->material_index);
     if (c->last_special_volume && c->last_special_volume->material_modifier_index) {
@@ -4451,6 +4572,7 @@ void MungeCarGraphics(tU32 pFrame_period) {
     br_material* the_material;
     tU32 the_time;
     br_actor* oily_actor;
+    int* oily_spills; // added by dethrace
 
     if (gNet_mode != eNet_mode_none
         && ((gCurrent_net_game->type == eNet_game_type_foxy && gThis_net_player_index == gIt_or_fox)
@@ -4486,18 +4608,15 @@ void MungeCarGraphics(tU32 pFrame_period) {
             car_x = the_car->car_master_actor->t.t.translate.t.v[0];
             car_z = the_car->car_master_actor->t.t.translate.t.v[2];
             the_car->shadow_intersection_flags = 0;
-            oily_count = GetOilSpillCount();
-            for (i = 0; i < oily_count; i++) {
-                GetOilSpillDetails(i, &oily_actor, &oily_size);
-                if (oily_actor != NULL) {
-                    car_radius = the_car->bounds[1].max.v[2] / WORLD_SCALE * 1.5f;
-                    if (oily_actor->t.t.translate.t.v[0] - oily_size < car_x + car_radius
-                        && oily_actor->t.t.translate.t.v[0] + oily_size > car_x - car_radius
-                        && oily_actor->t.t.translate.t.v[2] - oily_size < car_z + car_radius
-                        && oily_actor->t.t.translate.t.v[2] + oily_size > car_z - car_radius) {
-                        the_car->shadow_intersection_flags |= 1 << i;
-                    }
-                }
+            // changed by dethrace: there can be more spills than bits, so the flags only say whether
+            // any spill is near. FindOilSpillsNearCar gives the spills themselves.
+            // oily_count = GetOilSpillCount();
+            // for (i = 0; i < oily_count; i++) {
+            //     GetOilSpillDetails(i, &oily_actor, &oily_size);
+            //     ...
+            //             the_car->shadow_intersection_flags |= 1 << i;
+            if (FindOilSpillsNearCar(the_car, car_x, car_z, &oily_spills) != 0) {
+                the_car->shadow_intersection_flags = 1;
             }
             if (the_car->driver < eDriver_net_human && (!gAction_replay_mode || !ReplayIsPaused())) {
                 if (gCountdown) {
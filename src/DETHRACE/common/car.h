@@ -139,6 +139,8 @@ void GetNetPos(tCar_spec* pCar);
 
 void ApplyPhysicsToCars(tU32 last_frame_time, tU32 pTime_difference);
 
+void ReportPhysicsStats(void);
+
 void MungeSpecialVolume(tCollision_info* pCar);
 
 void ResetCarSpecialVolume(tCollision_info* pCar);
@@ -23,7 +23,9 @@
 #include "structur.h"
 #include "utility.h"
 #include "world.h"
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 // GLOBAL: CARM95 0x00521370
 float gWobble_spam_y[8] = { 0.0f, -0.15f, 0.4f, 0.15f, -0.4f, 0.25f, 0.0f, -0.25f };
@@ -42,6 +44,25 @@ int gSteal_ranks[5] = { 89, 72, 55, 38, 21 };
 
 #define BIGAPC_OPPONENT_INDEX 4
 
+// Added by dethrace: crush point vertices are binned into at most this many cells per axis
+#define CRUSH_GRID_MAX_CELLS 16
+
+// Added by dethrace: spatial lookup over the crush point vertices of a car actor, plus
+// a bitmap of the vertices that may no longer match the undamaged model
+typedef struct tCrush_lookup {
+    br_model* model;
+    int out_of_date; // vertices were moved without saying which
+    int cells[3];
+    br_vector3 origin;
+    br_scalar cell_size;
+    br_scalar drift;    // furthest any vertex has moved since the grid was built
+    int* cell_start;    // first entry of each cell in cell_points, plus an end marker
+    int* cell_points;   // crush point indices grouped by cell
+    br_vector3* binned; // vertex positions when the grid was built
+    tU32* deflected;    // one bit per vertex
+    int vertices_moved; // by the crush or repair currently being applied
+} tCrush_lookup;
+
 // IDA: int __usercall ReadCrushData@<EAX>(FILE *pF@<EAX>, tCrush_data *pCrush_data@<EDX>)
 // FUNCTION: CARM95 0x004bca50
 int ReadCrushData(FILE* pF, tCrush_data* pCrush_data) {
@@ -152,6 +173,298 @@ void DisposeCrushData(tCrush_data* pCrush_data) {
     }
 }
 
+// Added by dethrace
+void DisposeCrushLookup(tCar_actor* pCar_actor) {
+    tCrush_lookup* lookup;
+
+    lookup = pCar_actor->crush_lookup;
+    if (lookup == NULL) {
+        return;
+    }
+    if (lookup->cell_start != NULL) {
+        BrMemFree(lookup->cell_start);
+    }
+    if (lookup->cell_points != NULL) {
+        BrMemFree(lookup->cell_points);
+    }
+    BrMemFree(lookup->binned);
+    BrMemFree(lookup->deflected);
+    BrMemFree(lookup);
+    pCar_actor->crush_lookup = NULL;
+}
+
+// Added by dethrace
+static int CrushCellIndex(tCrush_lookup* pLookup, br_vector3* pPoint, int pAxis) {
+    br_scalar cell;
+
+    cell = (pPoint->v[pAxis] - pLookup->origin.v[pAxis]) / pLookup->cell_size;
+    if (!(cell >= 0.0f)) {
+        return 0;
+    }
+    if (cell >= pLookup->cells[pAxis]) {
+        return pLookup->cells[pAxis] - 1;
+    }
+    return (int)cell;
+}
+
+// Added by dethrace
+static int CrushCell(tCrush_lookup* pLookup, int pX, int pY, int pZ) {
+
+    return (pZ * pLookup->cells[1] + pY) * pLookup->cells[0] + pX;
+}
+
+// Added by dethrace: bins the crush point vertices where they are now and works out
+// which vertices differ from the undamaged model
+static void RebuildCrushLookup(tCrush_lookup* pLookup, tCar_actor* pCar_actor) {
+    int i;
+    int j;
+    int axis;
+    int count;
+    int total_cells;
+    int cell;
+    br_model* model;
+    br_vector3* p;
+    br_vector3 extent;
+    br_bounds bounds;
+    tCrush_data* crush_data;
+
+    model = pLookup->model;
+    crush_data = &pCar_actor->crush_data;
+    memset(pLookup->deflected, 0, sizeof(tU32) * ((model->nvertices + 31) / 32));
+    for (i = 0; i < model->nvertices; i++) {
+        pLookup->binned[i] = model->vertices[i].p;
+        if (pCar_actor->undamaged_vertices != NULL && !Vector3AreEqual(&pCar_actor->undamaged_vertices[i].p, &model->vertices[i].p)) {
+            pLookup->deflected[i >> 5] |= 1u << (i & 31);
+        }
+    }
+    pLookup->drift = 0.0f;
+    pLookup->out_of_date = 0;
+
+    if (pLookup->cell_start != NULL) {
+        BrMemFree(pLookup->cell_start);
+        pLookup->cell_start = NULL;
+    }
+    count = 0;
+    for (i = 0; i < crush_data->number_of_crush_points; i++) {
+        if (crush_data->crush_points[i].vertex_index >= model->nvertices) {
+            continue;
+        }
+        p = &model->vertices[crush_data->crush_points[i].vertex_index].p;
+        if (count == 0) {
+            bounds.min = *p;
+            bounds.max = *p;
+        } else {
+            for (axis = 0; axis < 3; axis++) {
+                bounds.min.v[axis] = MIN(bounds.min.v[axis], p->v[axis]);
+                bounds.max.v[axis] = MAX(bounds.max.v[axis], p->v[axis]);
+            }
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    BrVector3Sub(&extent, &bounds.max, &bounds.min);
+    // Roughly one crush point per cell, but never more than CRUSH_GRID_MAX_CELLS along an axis
+    pLookup->cell_size = MAX(MAX(extent.v[0], extent.v[1]), extent.v[2]) / CRUSH_GRID_MAX_CELLS;
+    pLookup->cell_size = MAX(pLookup->cell_size, cbrtf((extent.v[0] + 0.01f) * (extent.v[1] + 0.01f) * (extent.v[2] + 0.01f) / count));
+    pLookup->origin = bounds.min;
+    total_cells = 1;
+    for (axis = 0; axis < 3; axis++) {
+        pLookup->cells[axis] = MIN((int)(extent.v[axis] / pLookup->cell_size) + 1, CRUSH_GRID_MAX_CELLS);
+        total_cells *= pLookup->cells[axis];
+    }
+    pLookup->cell_start = BrMemAllocate(sizeof(int) * (total_cells + 1), kMem_crush_data);
+    memset(pLookup->cell_start, 0, sizeof(int) * (total_cells + 1));
+    for (i = 0; i < crush_data->number_of_crush_points; i++) {
+        if (crush_data->crush_points[i].vertex_index >= model->nvertices) {
+            continue;
+        }
+        p = &model->vertices[crush_data->crush_points[i].vertex_index].p;
+        cell = CrushCell(pLookup, CrushCellIndex(pLookup, p, 0), CrushCellIndex(pLookup, p, 1), CrushCellIndex(pLookup, p, 2));
+        pLookup->cell_start[cell + 1]++;
+    }
+    for (j = 0; j < total_cells; j++) {
+        pLookup->cell_start[j + 1] += pLookup->cell_start[j];
+    }
+    // Each cell lists its crush points in ascending order; cell_start[c] ends up as the
+    // end of cell c and is shifted back afterwards
+    for (i = 0; i < crush_data->number_of_crush_points; i++) {
+        if (crush_data->crush_points[i].vertex_index >= model->nvertices) {
+            continue;
+        }
+        p = &model->vertices[crush_data->crush_points[i].vertex_index].p;
+        cell = CrushCell(pLookup, CrushCellIndex(pLookup, p, 0), CrushCellIndex(pLookup, p, 1), CrushCellIndex(pLookup, p, 2));
+        pLookup->cell_points[pLookup->cell_start[cell]] = i;
+        pLookup->cell_start[cell]++;
+    }
+    for (j = total_cells; j > 0; j--) {
+        pLookup->cell_start[j] = pLookup->cell_start[j - 1];
+    }
+    pLookup->cell_start[0] = 0;
+}
+
+// Added by dethrace
+static tCrush_lookup* GetCrushLookup(tCar_spec* pCar, int pModel_index) {
+    tCar_actor* car_actor;
+    tCrush_lookup* lookup;
+    br_model* model;
+
+    car_actor = &pCar->car_model_actors[pModel_index];
+    model = car_actor->actor->model;
+    lookup = car_actor->crush_lookup;
+    if (lookup != NULL && lookup->model != model) {
+        DisposeCrushLookup(car_actor);
+        lookup = NULL;
+    }
+    if (lookup == NULL) {
+        lookup = BrMemAllocate(sizeof(tCrush_lookup), kMem_crush_data);
+        memset(lookup, 0, sizeof(tCrush_lookup));
+        lookup->model = model;
+        lookup->binned = BrMemAllocate(sizeof(br_vector3) * (model->nvertices + 1), kMem_crush_data);
+        lookup->deflected = BrMemAllocate(sizeof(tU32) * ((model->nvertices + 31) / 32 + 1), kMem_crush_data);
+        if (car_actor->crush_data.number_of_crush_points != 0) {
+            lookup->cell_points = BrMemAllocate(sizeof(int) * car_actor->crush_data.number_of_crush_points, kMem_crush_data);
+        }
+        lookup->out_of_date = 1;
+        car_actor->crush_lookup = lookup;
+    }
+    if (lookup->out_of_date) {
+        RebuildCrushLookup(lookup, car_actor);
+    }
+    return lookup;
+}
+
+// Added by dethrace
+static void ScanCrushCell(tCrush_lookup* pLookup, tCrush_data* pCrush_data, br_vertex* pVertices, br_vector3* pImpact_point, int pCell, br_scalar* pNearest_so_far, int* pNearest_index) {
+    int i;
+    int k;
+    br_scalar this_distance;
+    br_vertex* the_vertex;
+
+    for (k = pLookup->cell_start[pCell]; k < pLookup->cell_start[pCell + 1]; k++) {
+        i = pLookup->cell_points[k];
+        the_vertex = &pVertices[pCrush_data->crush_points[i].vertex_index];
+        this_distance = (pImpact_point->v[2] - the_vertex->p.v[2]) * (pImpact_point->v[2] - the_vertex->p.v[2]) + (pImpact_point->v[1] - the_vertex->p.v[1]) * (pImpact_point->v[1] - the_vertex->p.v[1]) + (pImpact_point->v[0] - the_vertex->p.v[0]) * (pImpact_point->v[0] - the_vertex->p.v[0]);
+        // ties go to the lowest index, as they did when every crush point was scanned in order
+        if (this_distance < *pNearest_so_far || (this_distance == *pNearest_so_far && i < *pNearest_index)) {
+            *pNearest_so_far = this_distance;
+            *pNearest_index = i;
+        }
+    }
+}
+
+// Added by dethrace: searches outwards in shells of cells around the impact. Vertices
+// have moved by at most `drift` since they were binned, so once a shell is further
+// away than the nearest crush point found so far, nothing outside it can be nearer.
+static int NearestCrushPoint(tCrush_lookup* pLookup, tCrush_data* pCrush_data, br_vertex* pVertices, br_vector3* pImpact_point) {
+    int centre[3];
+    int lo[3];
+    int hi[3];
+    int radius;
+    int max_radius;
+    int axis;
+    int x;
+    int y;
+    int z;
+    int nearest_index;
+    br_scalar nearest_so_far;
+    br_scalar reach;
+
+    nearest_so_far = BR_SCALAR_MAX;
+    nearest_index = -1;
+    if (pLookup->cell_start == NULL) {
+        return -1;
+    }
+    max_radius = 0;
+    for (axis = 0; axis < 3; axis++) {
+        centre[axis] = CrushCellIndex(pLookup, pImpact_point, axis);
+        max_radius = MAX(max_radius, MAX(centre[axis], pLookup->cells[axis] - 1 - centre[axis]));
+    }
+    for (radius = 0; radius <= max_radius; radius++) {
+        for (axis = 0; axis < 3; axis++) {
+            lo[axis] = MAX(centre[axis] - radius, 0);
+            hi[axis] = MIN(centre[axis] + radius, pLookup->cells[axis] - 1);
+        }
+        for (z = lo[2]; z <= hi[2]; z++) {
+            for (y = lo[1]; y <= hi[1]; y++) {
+                if (abs(z - centre[2]) == radius || abs(y - centre[1]) == radius) {
+                    for (x = lo[0]; x <= hi[0]; x++) {
+                        ScanCrushCell(pLookup, pCrush_data, pVertices, pImpact_point, CrushCell(pLookup, x, y, z), &nearest_so_far, &nearest_index);
+                    }
+                } else {
+                    if (centre[0] - radius >= 0) {
+                        ScanCrushCell(pLookup, pCrush_data, pVertices, pImpact_point, CrushCell(pLookup, centre[0] - radius, y, z), &nearest_so_far, &nearest_index);
+                    }
+                    if (centre[0] + radius < pLookup->cells[0]) {
+                        ScanCrushCell(pLookup, pCrush_data, pVertices, pImpact_point, CrushCell(pLookup, centre[0] + radius, y, z), &nearest_so_far, &nearest_index);
+                    }
+                }
+            }
+        }
+        // a little slack for points binned on a cell boundary
+        reach = radius * pLookup->cell_size * 0.999f - pLookup->drift;
+        if (nearest_index >= 0 && reach > 0.0f && reach * reach > nearest_so_far) {
+            break;
+        }
+    }
+    return nearest_index;
+}
+
+// Added by dethrace: returns the first vertex from pFrom on that may be deflected, or nvertices
+static int NextDeflectedVertex(tCrush_lookup* pLookup, int pFrom) {
+    int word;
+    int word_count;
+    int vertex;
+    tU32 bits;
+
+    word_count = (pLookup->model->nvertices + 31) / 32;
+    word = pFrom >> 5;
+    if (word >= word_count) {
+        return pLookup->model->nvertices;
+    }
+    bits = pLookup->deflected[word] & (0xffffffffu << (pFrom & 31));
+    while (bits == 0) {
+        word++;
+        if (word >= word_count) {
+            return pLookup->model->nvertices;
+        }
+        bits = pLookup->deflected[word];
+    }
+    vertex = word * 32;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        vertex++;
+    }
+    return vertex;
+}
+
+static void FlagModelForUpdate(br_model* pModel, tCar_spec* pCar, int crush_only, int pVertices_moved);
+
+// Added by dethrace: called for every vertex a crush or repair actually moves
+static void CrushVertexMoved(tCrush_lookup* pLookup, int pVertex_index) {
+    br_vector3 moved;
+    br_scalar distance;
+
+    if (pLookup == NULL) {
+        return;
+    }
+    pLookup->vertices_moved++;
+    if (pLookup->out_of_date) {
+        return;
+    }
+    BrVector3Sub(&moved, &pLookup->model->vertices[pVertex_index].p, &pLookup->binned[pVertex_index]);
+    distance = BrVector3Length(&moved);
+    if (distance > pLookup->drift) {
+        pLookup->drift = distance;
+        if (pLookup->cell_start != NULL && distance > pLookup->cell_size) {
+            // cheaper to bin everything again than to keep widening the search
+            pLookup->out_of_date = 1;
+        }
+    }
+    pLookup->deflected[pVertex_index >> 5] |= 1u << (pVertex_index & 31);
+}
+
 // IDA: void __usercall CrushModelPoint(tCar_spec *pCar@<EAX>, int pModel_index@<EDX>, br_model *pModel@<EBX>, int pCrush_point_index@<ECX>, br_vector3 *pEnergy_vector, br_scalar total_energy, tCrush_data *pCrush_data)
 // FUNCTION: CARM95 0x004bd17b
 void CrushModelPoint(tCar_spec* pCar, int pModel_index, br_model* pModel, int pCrush_point_index, br_vector3* pEnergy_vector, br_scalar total_energy, tCrush_data* pCrush_data) {
@@ -182,8 +495,14 @@ void CrushModelPoint(tCar_spec* pCar, int pModel_index, br_model* pModel, int pC
 
     float v12;
     int axis_tmp;
+    tCrush_lookup* lookup; // added by dethrace
 
     pipe_vertex_count = 0;
+    // Added by dethrace
+    lookup = pCar->car_model_actors[pModel_index].crush_lookup;
+    if (lookup != NULL && lookup->model != pModel) {
+        lookup = NULL;
+    }
     if (gNet_mode == eNet_mode_host && pCar->car_model_actors[pModel_index].min_distance_squared == 0.0f) {
         NetSendPointCrush(pCar, pCrush_point_index, pEnergy_vector);
     }
@@ -222,6 +541,10 @@ void CrushModelPoint(tCar_spec* pCar, int pModel_index, br_model* pModel, int pC
             target_point->v[i] = old_vector.v[i];
         }
     }
+    // Added by dethrace
+    if (!Vector3AreEqual(target_point, &old_vector)) {
+        CrushVertexMoved(lookup, the_crush_point->vertex_index);
+    }
 
     if (IsActionReplayAvailable()) {
         pipe_array[pipe_vertex_count].vertex_index = the_crush_point->vertex_index;
@@ -259,6 +582,10 @@ void CrushModelPoint(tCar_spec* pCar, int pModel_index, br_model* pModel, int pC
                 axis_tmp = (((int)((target_point->v[2] + target_point->v[1] + target_point->v[0]) * 100.0f) + bend_axis - 1) & 1) % 3;
                 target_point->v[axis_tmp] += fabs(movement.v[bend_axis]) * bend_amount;
             }
+            // Added by dethrace
+            if (!Vector3AreEqual(target_point, &old_vector)) {
+                CrushVertexMoved(lookup, neighbour_index);
+            }
             if (IsActionReplayAvailable() && pipe_vertex_count < 600) {
                 pipe_array[pipe_vertex_count].vertex_index = neighbour_index;
                 BrVector3Sub(&pipe_array[pipe_vertex_count].delta_coordinates, target_point, &old_vector);
@@ -287,6 +614,7 @@ void CrushModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, br_vector3*
     br_vertex* vertices;
     br_vertex* the_vertex;
     br_matrix34 inverse_transform;
+    tCrush_lookup* lookup; // added by dethrace
 
     if (gArrow_mode) {
         return;
@@ -301,20 +629,16 @@ void CrushModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, br_vector3*
         return;
     }
     BrVector3Scale(&energy_vector_scaled, &energy_vector_model, (total_energy - 0.06f) / total_energy);
-    nearest_so_far = BR_SCALAR_MAX;
-    vertices = pActor->model->vertices;
-    nearest_index = -1;
-    for (i = 0; i < pCrush_data->number_of_crush_points; i++) {
-        the_vertex = &vertices[pCrush_data->crush_points[i].vertex_index];
-        this_distance = (impact_point_model.v[2] - the_vertex->p.v[2]) * (impact_point_model.v[2] - the_vertex->p.v[2]) + (impact_point_model.v[1] - the_vertex->p.v[1]) * (impact_point_model.v[1] - the_vertex->p.v[1]) + (impact_point_model.v[0] - the_vertex->p.v[0]) * (impact_point_model.v[0] - the_vertex->p.v[0]);
-        if (this_distance < nearest_so_far) {
-            nearest_so_far = this_distance;
-            nearest_index = i;
-        }
-    }
+    // changed by dethrace: look the nearest crush point up in a grid rather than measuring
+    // the distance to every one of them
+    lookup = GetCrushLookup(pCar, pModel_index);
+    nearest_index = NearestCrushPoint(lookup, pCrush_data, pActor->model->vertices, &impact_point_model);
     if (nearest_index >= 0) {
+        lookup->vertices_moved = 0;
         CrushModelPoint(pCar, pModel_index, pActor->model, nearest_index, &energy_vector_scaled, total_energy, pCrush_data);
-        SetModelForUpdate(pActor->model, pCar, 1);
+        // changed by dethrace: a crush point already at its limits doesn't need the model re-preparing
+        // SetModelForUpdate(pActor->model, pCar, 1);
+        FlagModelForUpdate(pActor->model, pCar, 1, lookup->vertices_moved);
     }
 }
 
@@ -327,10 +651,37 @@ void JitModelUpdate(br_actor* actor, br_model* model, br_material* material, voi
     BrZbModelRender(actor, model, material, style, BrOnScreenCheck(&model->bounds), 0);
 }
 
+// Added by dethrace: SetModelForUpdate for callers in here, which report each vertex they
+// move to the crush lookup. Nothing needs re-preparing if no vertex moved.
+static void FlagModelForUpdate(br_model* pModel, tCar_spec* pCar, int crush_only, int pVertices_moved) {
+
+    if (crush_only && pCar != NULL && pCar->car_model_actors[pCar->principal_car_actor].actor->model == pModel) {
+        CrushBoundingBox(pCar, crush_only);
+    }
+    if (pVertices_moved == 0) {
+        return;
+    }
+    if ((pModel->flags & BR_MODF_CUSTOM) != 0) {
+        pModel->user = JitModelUpdate;
+    } else {
+        pModel->custom = JitModelUpdate;
+        pModel->flags |= BR_MODF_CUSTOM;
+    }
+}
+
 // IDA: void __usercall SetModelForUpdate(br_model *pModel@<EAX>, tCar_spec *pCar@<EDX>, int crush_only@<EBX>)
 // FUNCTION: CARM95 0x004bdb2f
 void SetModelForUpdate(br_model* pModel, tCar_spec* pCar, int crush_only) {
+    int i; // added by dethrace
 
+    // Added by dethrace: the caller moved vertices without saying which
+    if (pCar != NULL) {
+        for (i = 0; i < pCar->car_actor_count; i++) {
+            if (pCar->car_model_actors[i].crush_lookup != NULL && pCar->car_model_actors[i].actor->model == pModel) {
+                pCar->car_model_actors[i].crush_lookup->out_of_date = 1;
+            }
+        }
+    }
     if (crush_only && pCar != NULL && pCar->car_model_actors[pCar->principal_car_actor].actor->model == pModel) {
         CrushBoundingBox(pCar, crush_only);
     }
@@ -351,10 +702,13 @@ void TotallySpamTheModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, tC
     int the_index;
     br_vertex* the_vertex;
     br_vertex* vertices;
+    tCrush_lookup* lookup; // added by dethrace
 
     if (gArrow_mode || pCrush_data->number_of_crush_points == 0) {
         return;
     }
+    lookup = GetCrushLookup(pCar, pModel_index); // added by dethrace
+    lookup->vertices_moved = 0;                  // added by dethrace
     the_vertex = pActor->model->vertices;
     for (i = 0; i < 15; i++) {
         the_index = IRandomBetween(0, pCrush_data->number_of_crush_points - 1);
@@ -363,7 +717,9 @@ void TotallySpamTheModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, tC
         BrVector3Scale(&energy_vector_model, &energy_vector_model, -pMagnitude);
         CrushModelPoint(pCar, pModel_index, pActor->model, the_index, &energy_vector_model, pMagnitude, pCrush_data);
     }
-    SetModelForUpdate(pActor->model, pCar, 1);
+    // changed by dethrace
+    // SetModelForUpdate(pActor->model, pCar, 1);
+    FlagModelForUpdate(pActor->model, pCar, 1, lookup->vertices_moved);
 }
 
 // IDA: br_scalar __usercall RepairModel@<ST0>(tCar_spec *pCar@<EAX>, int pModel_index@<EDX>, br_actor *pActor@<EBX>, br_vertex *pUndamaged_vertices@<ECX>, br_scalar pAmount, br_scalar *pTotal_deflection)
@@ -377,12 +733,22 @@ br_scalar RepairModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, br_ve
     br_scalar amount;
     br_scalar deviation;
     tChanged_vertex pipe_array[600];
+    tCrush_lookup* lookup;         // added by dethrace
+    br_vertex* undamaged_vertices; // added by dethrace
 
     pipe_vertex_count = 0;
     amount = 0.0f;
     *pTotal_deflection = 0.0f;
 
-    for (i = 0; i < pActor->model->nvertices; i++) {
+    // Added by dethrace
+    lookup = GetCrushLookup(pCar, pModel_index);
+    lookup->vertices_moved = 0;
+    undamaged_vertices = pUndamaged_vertices;
+
+    // changed by dethrace: undeflected vertices add nothing, so only visit the ones that may be deflected
+    // for (i = 0; i < pActor->model->nvertices; i++) {
+    for (i = NextDeflectedVertex(lookup, 0); i < pActor->model->nvertices; i = NextDeflectedVertex(lookup, i + 1)) {
+        pUndamaged_vertices = &undamaged_vertices[i]; // added by dethrace
         model_vertex = &pActor->model->vertices[i];
         old_point = model_vertex->p;
         for (j = 0; j < 3; ++j) {
@@ -408,9 +774,19 @@ br_scalar RepairModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, br_ve
             BrVector3Sub(&pipe_array[pipe_vertex_count].delta_coordinates, &model_vertex->p, &old_point);
             pipe_vertex_count++;
         }
-        pUndamaged_vertices++;
+        // Added by dethrace
+        if (!Vector3AreEqual(&model_vertex->p, &old_point)) {
+            CrushVertexMoved(lookup, i);
+        }
+        if (Vector3AreEqual(&model_vertex->p, &pUndamaged_vertices->p)) {
+            lookup->deflected[i >> 5] &= ~(1u << (i & 31));
+        }
+        // changed by dethrace
+        // pUndamaged_vertices++;
     }
-    SetModelForUpdate(pActor->model, pCar, 0);
+    // changed by dethrace
+    // SetModelForUpdate(pActor->model, pCar, 0);
+    FlagModelForUpdate(pActor->model, pCar, 0, lookup->vertices_moved);
     if (IsActionReplayAvailable() && pipe_vertex_count) {
         PipeSingleModelGeometry(pCar->car_ID, pModel_index, pipe_vertex_count, pipe_array);
     }
@@ -497,6 +873,10 @@ void TotallyRepairACar(tCar_spec* pCar) {
                 memcpy(the_car_actor->actor->model->vertices,
                     the_car_actor->undamaged_vertices,
                     the_car_actor->actor->model->nvertices * sizeof(br_vertex));
+                // Added by dethrace
+                if (the_car_actor->crush_lookup != NULL) {
+                    the_car_actor->crush_lookup->out_of_date = 1;
+                }
                 BrModelUpdate(the_car_actor->actor->model, BR_MODU_VERTEX_COLOURS | BR_MODU_VERTEX_POSITIONS);
                 if (pipe_vertex_count != 0 && IsActionReplayAvailable()) {
                     PipeSingleModelGeometry(pCar->car_ID, j, pipe_vertex_count, pipe_array);
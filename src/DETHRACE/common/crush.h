@@ -17,6 +17,8 @@ int WriteCrushData(FILE* pF, tCrush_data* pCrush_data);
 
 void DisposeCrushData(tCrush_data* pCrush_data);
 
+void DisposeCrushLookup(tCar_actor* pCar_actor);
+
 void CrushModelPoint(tCar_spec* pCar, int pModel_index, br_model* pModel, int pCrush_point_index, br_vector3* pEnergy_vector, br_scalar total_energy, tCrush_data* pCrush_data);
 
 void CrushModel(tCar_spec* pCar, int pModel_index, br_actor* pActor, br_vector3* pImpact_point, br_vector3* pEnergy_vector, tCrush_data* pCrush_data);
@@ -7,6 +7,7 @@
 #include "globvrbm.h"
 #include "globvrkm.h"
 #include "globvrpb.h"
+#include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/trace.h"
 #include "init.h"
@@ -630,8 +631,155 @@ void ExternalSky(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_act
     }
 }
 
+// Added by dethrace: ExternalSky, put off until the scene is drawn. DepthEffect then writes the sky only
+// where the depth buffer is still clear, in the same pass as the depth cueing or fog
+typedef struct tDeferred_sky {
+    br_pixelmap* render_buffer; // NULL when nothing is deferred
+    br_pixelmap* col_map;
+    int dx;    // sky image column at the left edge
+    int top_y; // render buffer row of the sky image's first row
+} tDeferred_sky;
+
+static tDeferred_sky gDeferred_sky;
+
+// Added by dethrace: where ExternalSky would put the sky image, worked out the same way
+static void GetExternalSkyPosition(br_pixelmap* pRender_buffer, br_actor* pCamera, br_matrix34* pCamera_to_world, int* pDx, int* pTop_y) {
+    int dx;
+    int hori_y;
+    br_angle hori_sky;
+    br_angle vert_sky;
+    br_camera* camera;
+    br_scalar tan_half_fov;
+    br_scalar tan_half_hori_fov;
+    br_scalar tan_half_hori_sky;
+    br_scalar hshift;
+    br_scalar tan_pitch;
+    br_pixelmap* col_map;
+
+    col_map = gHorizon_material->colour_map;
+    camera = (br_camera*)pCamera->type_data;
+    tan_half_fov = Tan(camera->field_of_view / 2);
+    tan_half_hori_fov = tan_half_fov * camera->aspect;
+
+    vert_sky = BrRadianToAngle(atan2(pCamera_to_world->m[2][0], pCamera_to_world->m[2][2]));
+    hori_sky = BrRadianToAngle(atan2(col_map->width * tan_half_hori_fov / (double)pRender_buffer->width, 1));
+
+    tan_half_hori_sky = -BrFixedToFloat(vert_sky) / BrFixedToFloat(BR_ANGLE_DEG(360) / (int)(1.0f / BrFixedToFloat(2 * hori_sky) + 0.5f));
+
+    dx = col_map->width * tan_half_hori_sky;
+    while (dx < 0) {
+        dx += col_map->width;
+    }
+    while (dx > col_map->width) {
+        dx -= col_map->width;
+    }
+
+    hshift = col_map->height - gSky_image_underground * col_map->height / gSky_image_height;
+    tan_pitch = sqrt(pCamera_to_world->m[2][0] * pCamera_to_world->m[2][0] + pCamera_to_world->m[2][2] * pCamera_to_world->m[2][2]);
+    hori_y = -(pCamera_to_world->m[2][1]
+                 / tan_pitch
+                 / tan_half_fov * pRender_buffer->height / 2.0f)
+        - hshift;
+
+    *pDx = dx % col_map->width;
+    *pTop_y = hori_y + pRender_buffer->origin_y;
+}
+
+// Added by dethrace: ExternalSky for the scene about to be drawn into pRender_buffer, done by the next
+// DepthEffect on it when the buffers are ones the depth pass can read
+void DeferExternalSky(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_actor* pCamera, br_matrix34* pCamera_to_world) {
+
+#ifndef DETHRACE_3DFX_PATCH
+    if (harness_game_config.deferred_sky
+        && pRender_buffer->type == BR_PMT_INDEX_8
+        && pDepth_buffer->type == BR_PMT_DEPTH_16
+        && gHorizon_material->colour_map->type == BR_PMT_INDEX_8) {
+        gDeferred_sky.render_buffer = pRender_buffer;
+        gDeferred_sky.col_map = gHorizon_material->colour_map;
+        GetExternalSkyPosition(pRender_buffer, pCamera, pCamera_to_world, &gDeferred_sky.dx, &gDeferred_sky.top_y);
+        return;
+    }
+#endif
+    ExternalSky(pRender_buffer, pDepth_buffer, pCamera, pCamera_to_world);
+}
+
+// Added by dethrace: DoDepthByShadeTable (pShade_table may be NULL for none), also writing the deferred sky
+// wherever nothing was drawn
+static void DoDepthByShadeTableAndSky(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_pixelmap* pShade_table, int pShade_table_power, int pStart, int pEnd) {
+    tU8* render_ptr;
+    tU8* shade_table_pixels;
+    tU8* sky_row;
+    tU16* depth_ptr;
+    tU16 depth_value;
+    tU16 too_near;
+    tU8 top_col;
+    tU8 bot_col;
+    tU8 sky_col;
+    int depth_shift_amount;
+    int sky_x;
+    int y;
+    int x;
+    int depth_line_skip;
+    int render_line_skip;
+    br_pixelmap* col_map;
+
+    col_map = gDeferred_sky.col_map;
+    top_col = ((tU8*)col_map->pixels)[0];
+    bot_col = ((tU8*)col_map->pixels)[col_map->row_bytes * (col_map->height - 1)];
+    too_near = 0xffff - (1 << pStart);
+    shade_table_pixels = pShade_table != NULL ? pShade_table->pixels : NULL;
+    depth_shift_amount = pShade_table_power + 8 - pStart - pEnd;
+    render_ptr = (tU8*)pRender_buffer->pixels + pRender_buffer->base_x + pRender_buffer->base_y * pRender_buffer->row_bytes;
+    depth_ptr = pDepth_buffer->pixels;
+    render_line_skip = pRender_buffer->row_bytes - pRender_buffer->width;
+    depth_line_skip = pDepth_buffer->row_bytes / 2 - pRender_buffer->width;
+
+    for (y = 0; y < pRender_buffer->height; y++) {
+        sky_row = NULL;
+        sky_col = top_col;
+        if (y >= gDeferred_sky.top_y + col_map->height) {
+            sky_col = bot_col;
+        } else if (y >= gDeferred_sky.top_y) {
+            sky_row = (tU8*)col_map->pixels + (y - gDeferred_sky.top_y) * col_map->row_bytes;
+        }
+        sky_x = gDeferred_sky.dx;
+        for (x = 0; x < pRender_buffer->width; x++) {
+            if (*depth_ptr == 0xFFFF) {
+                *render_ptr = sky_row != NULL ? sky_row[sky_x] : sky_col;
+            } else if (shade_table_pixels != NULL) {
+                depth_value = *depth_ptr - too_near;
+                if (depth_value < -(tS16)too_near) {
+                    if (depth_shift_amount >= 0) {
+                        *render_ptr = shade_table_pixels[*render_ptr + ((depth_value << depth_shift_amount) & 0xFF00)];
+                    } else {
+                        *render_ptr = shade_table_pixels[*render_ptr + ((depth_value >> -depth_shift_amount) & 0xFF00)];
+                    }
+                }
+            }
+            sky_x++;
+            if (sky_x == col_map->width) {
+                sky_x = 0;
+            }
+            ++render_ptr;
+            ++depth_ptr;
+        }
+        render_ptr += render_line_skip;
+        depth_ptr += depth_line_skip;
+    }
+}
+
 #define ACTOR_CAMERA(ACTOR) ((br_camera*)((ACTOR)->type_data))
 
+// Added by dethrace: whether DoHorizon draws the horizon model this frame
+static int HorizonIsDrawn(void) {
+
+    return !(!gProgram_state.cockpit_on && !gAction_replay_mode && gAction_replay_camera_mode != eAction_replay_standard
+#ifdef DETHRACE_3DFX_PATCH
+        && !gBlitting_is_slow
+#endif
+    );
+}
+
 // IDA: void __usercall DoHorizon(br_pixelmap *pRender_buffer@<EAX>, br_pixelmap *pDepth_buffer@<EDX>, br_actor *pCamera@<EBX>, br_matrix34 *pCamera_to_world@<ECX>)
 // FUNCTION: CARM95 0x00462658
 void DoHorizon(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_actor* pCamera, br_matrix34* pCamera_to_world) {
@@ -639,12 +787,13 @@ void DoHorizon(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_actor
     br_actor* actor;
 
     yaw = BrRadianToAngle(atan2(pCamera_to_world->m[2][0], pCamera_to_world->m[2][2]));
-    if (!gProgram_state.cockpit_on && !gAction_replay_mode && gAction_replay_camera_mode != eAction_replay_standard
-
-#ifdef DETHRACE_3DFX_PATCH
-        && !gBlitting_is_slow
-#endif
-    ) {
+    // changed by dethrace: the test is shared with DepthEffectSky
+    // if (!gProgram_state.cockpit_on && !gAction_replay_mode && gAction_replay_camera_mode != eAction_replay_standard
+    // #ifdef DETHRACE_3DFX_PATCH
+    //     && !gBlitting_is_slow
+    // #endif
+    // ) {
+    if (!HorizonIsDrawn()) {
         return;
     }
 
@@ -707,6 +856,21 @@ void DepthEffect(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_act
         return;
     }
 #endif
+    // Added by dethrace
+    if (gDeferred_sky.render_buffer == pRender_buffer) {
+        gDeferred_sky.render_buffer = NULL;
+        if (gProgram_state.current_depth_effect.type == eDepth_effect_darkness) {
+            DoDepthByShadeTableAndSky(pRender_buffer, pDepth_buffer, gDepth_shade_table, gDepth_shade_table_power,
+                gProgram_state.current_depth_effect.start, gProgram_state.current_depth_effect.end);
+        } else if (gProgram_state.current_depth_effect.type == eDepth_effect_fog) {
+            DoDepthByShadeTableAndSky(pRender_buffer, pDepth_buffer, gFog_shade_table, gFog_shade_table_power,
+                gProgram_state.current_depth_effect.start, gProgram_state.current_depth_effect.end);
+        } else {
+            DoDepthByShadeTableAndSky(pRender_buffer, pDepth_buffer, NULL, 0, 0, 0);
+        }
+        return;
+    }
+    // ---
     if (gProgram_state.current_depth_effect.type == eDepth_effect_darkness) {
         DoDepthCue(pRender_buffer, pDepth_buffer);
     }
@@ -721,6 +885,11 @@ void DepthEffectSky(br_pixelmap* pRender_buffer, br_pixelmap* pDepth_buffer, br_
 
     if (gProgram_state.current_depth_effect.sky_texture != NULL
         && (gLast_camera_special_volume == NULL || gLast_camera_special_volume->sky_col < 0)) {
+        // Added by dethrace: the horizon model goes over the sky image, so that has to be drawn first
+        if (gDeferred_sky.render_buffer == pRender_buffer && HorizonIsDrawn()) {
+            gDeferred_sky.render_buffer = NULL;
+            DoDepthByShadeTableAndSky(pRender_buffer, pDepth_buffer, NULL, 0, 0, 0);
+        }
         DoHorizon(pRender_buffer, pDepth_buffer, pCamera, pCamera_to_world);
     }
 }
@@ -3,6 +3,7 @@
 #include "errors.h"
 #include "harness/trace.h"
 #include <stdlib.h>
+#include <string.h>
 
 // GLOBAL: CARM95 0x00513600
 br_allocator gAllocator = { "Death Race", DRStdlibAllocate, DRStdlibFree, DRStdlibInquire, Claim4ByteAlignment };
@@ -265,6 +266,189 @@ char* gMem_names[246] = {
 // GLOBAL: CARM95 0x00537960
 br_resource_class gStainless_classes[117];
 
+// Added by dethrace.
+// Every block handed out by DRStdlibAllocate starts with a header recording its size, tag and where it
+// came from. Small blocks come from per size class pools, blocks allocated while the race arena is open
+// are carved out of large arena chunks, everything else comes from malloc. Like BRender itself, this
+// is only used from the game thread.
+#define MEM_HEADER_SIZE 16
+#define MEM_ARENA_CHUNK_START 16
+#define MEM_POOL_CHUNK_SIZE 0x10000
+#define MEM_ARENA_CHUNK_SIZE 0x40000
+#define MEM_ARENA_MAX_BLOCK 0x8000
+
+typedef enum tMem_source {
+    eMem_source_malloc,
+    eMem_source_pool,
+    eMem_source_arena
+} tMem_source;
+
+typedef struct tMem_header {
+    void* owner; // tMem_pool or tMem_arena_chunk
+    br_uint_32 size;
+    br_uint_8 type;
+    br_uint_8 source;
+} tMem_header;
+
+typedef struct tMem_pool {
+    br_size_t block_size; // including the header
+    void* free_list;
+} tMem_pool;
+
+typedef struct tMem_arena_chunk {
+    br_size_t used;
+    int live_blocks;
+    int pad;
+} tMem_arena_chunk;
+
+static br_size_t gMem_pool_sizes[] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+static tMem_pool gMem_pools[BR_ASIZE(gMem_pool_sizes)];
+static tMem_pool* gMem_pool_for_size[257];
+static int gMem_pools_initialised;
+static tMem_arena_chunk* gMem_arena_chunk;
+static int gMem_arena_open;
+static tMem_type_stats gMem_type_stats[256];
+static tMem_type_stats gMem_total_stats;
+static int gMem_arena_chunks_live;
+
+static void InitMemPools(void) {
+    int i;
+    int size;
+
+    for (i = 0; i < BR_ASIZE(gMem_pool_sizes); i++) {
+        gMem_pools[i].block_size = MEM_HEADER_SIZE + gMem_pool_sizes[i];
+        gMem_pools[i].free_list = NULL;
+    }
+    i = 0;
+    for (size = 0; size < BR_ASIZE(gMem_pool_for_size); size++) {
+        if (size > gMem_pool_sizes[i]) {
+            i++;
+        }
+        gMem_pool_for_size[size] = &gMem_pools[i];
+    }
+    gMem_pools_initialised = 1;
+}
+
+static tMem_header* PoolAllocate(tMem_pool* pPool) {
+    char* chunk;
+    char* block;
+    br_size_t i;
+
+    if (pPool->free_list == NULL) {
+        chunk = malloc(MEM_POOL_CHUNK_SIZE);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        for (i = 0; i + pPool->block_size <= MEM_POOL_CHUNK_SIZE; i += pPool->block_size) {
+            block = chunk + i;
+            *(void**)block = pPool->free_list;
+            pPool->free_list = block;
+        }
+    }
+    block = pPool->free_list;
+    pPool->free_list = *(void**)block;
+    ((tMem_header*)block)->owner = pPool;
+    ((tMem_header*)block)->source = eMem_source_pool;
+    return (tMem_header*)block;
+}
+
+static tMem_header* ArenaAllocate(br_size_t pSize) {
+    tMem_header* block;
+
+    pSize = (pSize + MEM_HEADER_SIZE + 15) & ~(br_size_t)15;
+    if (gMem_arena_chunk != NULL && gMem_arena_chunk->used + pSize > MEM_ARENA_CHUNK_SIZE) {
+        if (gMem_arena_chunk->live_blocks == 0) {
+            gMem_arena_chunk->used = MEM_ARENA_CHUNK_START;
+        } else {
+            // the old chunk goes when its last block is freed
+            gMem_arena_chunk = NULL;
+        }
+    }
+    if (gMem_arena_chunk == NULL) {
+        gMem_arena_chunk = malloc(MEM_ARENA_CHUNK_SIZE);
+        if (gMem_arena_chunk == NULL) {
+            return NULL;
+        }
+        gMem_arena_chunk->used = MEM_ARENA_CHUNK_START;
+        gMem_arena_chunk->live_blocks = 0;
+        gMem_arena_chunks_live++;
+    }
+    block = (tMem_header*)((char*)gMem_arena_chunk + gMem_arena_chunk->used);
+    gMem_arena_chunk->used += pSize;
+    gMem_arena_chunk->live_blocks++;
+    block->owner = gMem_arena_chunk;
+    block->source = eMem_source_arena;
+    return block;
+}
+
+static void ArenaFree(tMem_arena_chunk* pChunk) {
+
+    pChunk->live_blocks--;
+    if (pChunk->live_blocks != 0) {
+        return;
+    }
+    if (pChunk == gMem_arena_chunk) {
+        if (gMem_arena_open) {
+            pChunk->used = MEM_ARENA_CHUNK_START;
+            return;
+        }
+        gMem_arena_chunk = NULL;
+    }
+    free(pChunk);
+    gMem_arena_chunks_live--;
+}
+
+static void CountAllocation(tMem_type_stats* pStats, br_size_t pSize) {
+
+    pStats->bytes += pSize;
+    pStats->count++;
+    pStats->allocations++;
+    if (pStats->bytes > pStats->high_water) {
+        pStats->high_water = pStats->bytes;
+    }
+}
+
+static void CountFree(tMem_type_stats* pStats, br_size_t pSize) {
+
+    pStats->bytes -= pSize;
+    pStats->count--;
+}
+
+// Added by dethrace: allocations made until DRMemEndRaceArena come from arena chunks
+void DRMemBeginRaceArena(void) {
+
+    gMem_arena_open = 1;
+}
+
+// Added by dethrace: stop allocating from the arena. Chunks are freed in one go as their last block is freed
+void DRMemEndRaceArena(void) {
+
+    gMem_arena_open = 0;
+    if (gMem_arena_chunk != NULL && gMem_arena_chunk->live_blocks == 0) {
+        free(gMem_arena_chunk);
+        gMem_arena_chunks_live--;
+    }
+    gMem_arena_chunk = NULL;
+}
+
+// Added by dethrace: live and peak usage of a kMem_* / BR_MEMORY_* type
+void DRMemGetTypeStats(br_uint_8 pType, tMem_type_stats* pStats) {
+
+    *pStats = gMem_type_stats[pType];
+}
+
+// Added by dethrace: live and peak usage of all types together
+void DRMemGetTotalStats(tMem_type_stats* pStats) {
+
+    *pStats = gMem_total_stats;
+}
+
+// Added by dethrace
+int DRMemArenaChunkCount(void) {
+
+    return gMem_arena_chunks_live;
+}
+
 // IDA: void __cdecl SetNonFatalAllocationErrors()
 // FUNCTION: CARM95 0x00463d80
 void SetNonFatalAllocationErrors(void) {
@@ -291,11 +475,34 @@ void MAMSInitMem(void) {
     int i;
     FILE* f;
     tPath_name the_path;
+
+    // added by dethrace: install our allocator before BRender starts. Blocks now carry a header, so
+    // BRender must never free a block which came from its default allocator
+    if (!gMem_pools_initialised) {
+        InitMemPools();
+    }
+    InstallDRMemCalls();
 }
 
 // IDA: void __usercall PrintMemoryDump(int pFlags@<EAX>, char *pTitle@<EDX>)
 // FUNCTION: CARM95 0x00463de4
 void PrintMemoryDump(int pFlags, char* pTitle) {
+    int i;
+
+    // added by dethrace
+    dr_dprintf("MEMORY DUMP: %s", pTitle);
+    dr_dprintf("  total: %d blocks, %u bytes, high water %u bytes, %d arena chunks",
+        gMem_total_stats.count, (unsigned)gMem_total_stats.bytes, (unsigned)gMem_total_stats.high_water, gMem_arena_chunks_live);
+    for (i = 0; i < BR_ASIZE(gMem_type_stats); i++) {
+        if (gMem_type_stats[i].count != 0) {
+            dr_dprintf("  %s (%d): %d blocks, %u bytes, high water %u bytes",
+                i < BR_ASIZE(gMem_names) ? gMem_names[i] : "",
+                i,
+                gMem_type_stats[i].count,
+                (unsigned)gMem_type_stats[i].bytes,
+                (unsigned)gMem_type_stats[i].high_water);
+        }
+    }
 }
 
 // IDA: void* __cdecl DRStdlibAllocate(br_size_t size, br_uint_8 type)
@@ -305,13 +512,38 @@ void* DRStdlibAllocate(br_size_t size, br_uint_8 type) {
     int i;
     char s[256];
 
+    tMem_header* header; // added by dethrace
+
     if (size == 0) {
         return NULL;
     }
-    p = malloc(size);
+    // changed by dethrace: small blocks come from pools, race data from the arena
+    // p = malloc(size);
+    if (!gMem_pools_initialised) {
+        InitMemPools();
+    }
+    if (size <= gMem_pool_sizes[BR_ASIZE(gMem_pool_sizes) - 1]) {
+        header = PoolAllocate(gMem_pool_for_size[size]);
+    } else if (gMem_arena_open && size <= MEM_ARENA_MAX_BLOCK) {
+        header = ArenaAllocate(size);
+    } else {
+        header = malloc(MEM_HEADER_SIZE + size);
+        if (header != NULL) {
+            header->owner = NULL;
+            header->source = eMem_source_malloc;
+        }
+    }
+    p = NULL;
+    if (header != NULL) {
+        header->size = size;
+        header->type = type;
+        CountAllocation(&gMem_type_stats[type], size);
+        CountAllocation(&gMem_total_stats, size);
+        p = (char*)header + MEM_HEADER_SIZE;
+    }
     if (p == NULL && !gNon_fatal_allocation_errors) {
         PrintMemoryDump(0, "AT ERROR TIME");
-        sprintf(s, "%s/%d", gMem_names[type], (int)size);
+        sprintf(s, "%s/%d", type < BR_ASIZE(gMem_names) ? gMem_names[type] : "", (int)size);
         FatalError(kFatalError_OOMCarmageddon_S, s);
     }
     return p;
@@ -321,13 +553,38 @@ void* DRStdlibAllocate(br_size_t size, br_uint_8 type) {
 // FUNCTION: CARM95 0x00463ea1
 void DRStdlibFree(void* mem) {
     int i;
-    free(mem);
+    tMem_header* header; // added by dethrace
+    tMem_pool* pool;     // added by dethrace
+
+    // changed by dethrace
+    // free(mem);
+    if (mem == NULL) {
+        return;
+    }
+    header = (tMem_header*)((char*)mem - MEM_HEADER_SIZE);
+    CountFree(&gMem_type_stats[header->type], header->size);
+    CountFree(&gMem_total_stats, header->size);
+    switch (header->source) {
+    case eMem_source_pool:
+        pool = header->owner;
+        *(void**)header = pool->free_list;
+        pool->free_list = header;
+        break;
+    case eMem_source_arena:
+        ArenaFree(header->owner);
+        break;
+    default:
+        free(header);
+        break;
+    }
 }
 
 // IDA: br_size_t __cdecl DRStdlibInquire(br_uint_8 type)
 // FUNCTION: CARM95 0x00463ebb
 br_size_t DRStdlibInquire(br_uint_8 type) {
-    return 0;
+    // changed by dethrace: report the bytes in use by this type
+    // return 0;
+    return gMem_type_stats[type].bytes;
 }
 
 // IDA: br_uint_32 __cdecl Claim4ByteAlignment(br_uint_8 type)
@@ -3,6 +3,14 @@
 
 #include "dr_types.h"
 
+// Added by dethrace
+typedef struct tMem_type_stats {
+    br_size_t bytes;      // in use now
+    br_size_t high_water; // most bytes in use at once
+    int count;            // blocks in use now
+    int allocations;      // blocks allocated in total
+} tMem_type_stats;
+
 extern br_allocator gAllocator;
 extern int gNon_fatal_allocation_errors;
 extern char* gMem_names[246];
@@ -36,4 +44,14 @@ void CreateStainlessClasses(void);
 
 void CheckMemory(void);
 
+void DRMemBeginRaceArena(void);
+
+void DRMemEndRaceArena(void);
+
+void DRMemGetTypeStats(br_uint_8 pType, tMem_type_stats* pStats);
+
+void DRMemGetTotalStats(tMem_type_stats* pStats);
+
+int DRMemArenaChunkCount(void);
+
 #endif
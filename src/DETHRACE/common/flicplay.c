@@ -5,6 +5,8 @@
 #include "errors.h"
 #include "globvars.h"
 #include "graphics.h"
+#include "harness/config.h"
+#include "harness/os.h"
 #include "harness/trace.h"
 #include "input.h"
 #include "loading.h"
@@ -611,6 +613,42 @@ void* gPalette_pixels;
 // GLOBAL: CARM95 0x0053d0ac
 tFlic_descriptor* gFirst_flic;
 
+// Added by dethrace: decode-ahead playback of PlayFlic.
+// A worker thread decodes frames into its own 8-bit canvas and copies every finished frame, together
+// with the palette changes it made, into a small ring. PlayFlic only applies the palette, copies the
+// frame into the destination and presents it.
+#define FLIC_STREAM_MAX_FRAMES 16
+#define FLIC_STREAM_MAX_PALETTE_CHANGES 8
+
+typedef struct tFlic_stream_frame {
+    tU8* pixels;
+    tU8 palette[0x400];
+    int palette_first_written; // range of palette entries written by the frame
+    int palette_last_written;
+    int palette_change_count; // -1 if there were too many to remember: set all colours
+    int palette_first[FLIC_STREAM_MAX_PALETTE_CHANGES];
+    int palette_count[FLIC_STREAM_MAX_PALETTE_CHANGES];
+    int last_frame;
+} tFlic_stream_frame;
+
+typedef struct tFlic_stream {
+    tFlic_descriptor decoder;
+    br_pixelmap* canvas;
+    tU8 palette[0x400];
+    tFlic_stream_frame decoding; // palette changes of the frame being decoded, pixels unused
+    tFlic_stream_frame frames[FLIC_STREAM_MAX_FRAMES];
+    int frame_count;
+    int read_index;
+    int ready_count;
+    int stop;
+    tOS_thread* thread;
+    tOS_mutex* mutex;
+    tOS_cond* cond;
+} tFlic_stream;
+
+// only set while a stream is running, so decoders can tell the worker's descriptor apart
+static tFlic_stream* gFlic_stream;
+
 // Use this function to avoid unaligned memory access.
 // Added by DethRace
 tU16 mem_read_u16(void* memory) {
@@ -763,7 +801,9 @@ int StartFlic(char* pFile_name, int pIndex, tFlic_descriptor_ptr pFlic_info, tU3
     tPath_name the_path;
     int total_size;
 
-    if (gPlay_from_disk) {
+    // changed by dethrace: LoadFlic leaves flics on disk when streaming is enabled
+    // if (gPlay_from_disk) {
+    if (gPlay_from_disk || pData_ptr == NULL) {
         PathCat(the_path, gApplication_path, "ANIM");
         PathCat(the_path, the_path, pFile_name);
         pFlic_info->f = DRfopen(the_path, "rb");
@@ -875,6 +915,40 @@ int EndFlic(tFlic_descriptor_ptr pFlic_info) {
     return 0;
 }
 
+// Added by dethrace
+static tFlic_stream* FlicStreamDecoding(tFlic_descriptor* pFlic_info) {
+
+    if (gFlic_stream != NULL && pFlic_info == &gFlic_stream->decoder) {
+        return gFlic_stream;
+    }
+    return NULL;
+}
+
+// Added by dethrace: remember a palette change of the frame being decoded ahead, PlayFlic applies it
+static void RecordFlicStreamPalette(tFlic_stream* pStream, int pFirst_colour, int pCount, tU8* pEnd_of_written) {
+    tFlic_stream_frame* frame;
+    int last_written;
+
+    frame = &pStream->decoding;
+    last_written = (pEnd_of_written - pStream->palette) / 4;
+    if (frame->palette_first_written < 0 || last_written - pCount < frame->palette_first_written) {
+        frame->palette_first_written = last_written - pCount;
+    }
+    if (last_written > frame->palette_last_written) {
+        frame->palette_last_written = last_written;
+    }
+    if (frame->palette_change_count < 0) {
+        return;
+    }
+    if (frame->palette_change_count == FLIC_STREAM_MAX_PALETTE_CHANGES) {
+        frame->palette_change_count = -1;
+        return;
+    }
+    frame->palette_first[frame->palette_change_count] = pFirst_colour;
+    frame->palette_count[frame->palette_change_count] = pCount;
+    frame->palette_change_count++;
+}
+
 // IDA: void __usercall DoColourMap(tFlic_descriptor_ptr pFlic_info@<EAX>, tU32 chunk_length@<EDX>)
 // FUNCTION: CARM95 0x0049639a
 void DoColourMap(tFlic_descriptor_ptr pFlic_info, tU32 chunk_length) {
@@ -888,8 +962,14 @@ void DoColourMap(tFlic_descriptor_ptr pFlic_info, tU32 chunk_length) {
     tU8 red;
     tU8 green;
     tU8 blue;
+    tFlic_stream* stream; // added by dethrace
 
     palette_pixels = gPalette_pixels;
+    // added by dethrace
+    stream = FlicStreamDecoding(pFlic_info);
+    if (stream != NULL) {
+        palette_pixels = stream->palette;
+    }
 
     packet_count = MemReadU16(&pFlic_info->data);
     for (i = 0; i < packet_count; i++) {
@@ -918,7 +998,11 @@ void DoColourMap(tFlic_descriptor_ptr pFlic_info, tU32 chunk_length) {
 #endif
             palette_pixels += 4;
         }
-        if (!gPalette_fuck_prevention) {
+        // changed by dethrace: frames decoded ahead leave the palette to PlayFlic
+        // if (!gPalette_fuck_prevention) {
+        if (stream != NULL) {
+            RecordFlicStreamPalette(stream, current_colour, change_count, palette_pixels);
+        } else if (!gPalette_fuck_prevention) {
             DRSetPaletteEntries(gPalette, current_colour, change_count);
         }
     }
@@ -1036,9 +1120,15 @@ void DoColour256(tFlic_descriptor* pFlic_info, tU32 chunk_length) {
     tU8 red;
     tU8 green;
     tU8 blue;
+    tFlic_stream* stream; // added by dethrace
 
     current_colour = 0;
     palette_pixels = gPalette_pixels;
+    // added by dethrace
+    stream = FlicStreamDecoding(pFlic_info);
+    if (stream != NULL) {
+        palette_pixels = stream->palette;
+    }
 
     packet_count = MemReadU16(&pFlic_info->data);
     for (i = 0; i < packet_count; i++) {
@@ -1068,7 +1158,11 @@ void DoColour256(tFlic_descriptor* pFlic_info, tU32 chunk_length) {
             palette_pixels += 4;
             // LOG_DEBUG("color %d", current_colour);
         }
-        if (!gPalette_fuck_prevention) {
+        // changed by dethrace: frames decoded ahead leave the palette to PlayFlic
+        // if (!gPalette_fuck_prevention) {
+        if (stream != NULL) {
+            RecordFlicStreamPalette(stream, current_colour, change_count, palette_pixels);
+        } else if (!gPalette_fuck_prevention) {
             DRSetPaletteEntries(gPalette, current_colour, change_count);
         }
     }
@@ -1418,7 +1512,11 @@ int PlayNextFlicFrame2(tFlic_descriptor* pFlic_info, int pPanel_flic) {
     int read_amount;
 
     // LOG_DEBUG("%d (%p), frames left: %d offset: %d", pFlic_info->the_index, pFlic_info, pFlic_info->frames_left, (pFlic_info->data - pFlic_info->data_start) + 4);
-    PossibleService();
+    // changed by dethrace: the decode-ahead worker must not service sound and network
+    // PossibleService();
+    if (FlicStreamDecoding(pFlic_info) == NULL) {
+        PossibleService();
+    }
     frame_length = MemReadU32(&pFlic_info->data);
     magic_bytes = MemReadU16(&pFlic_info->data);
     chunk_count = MemReadU16(&pFlic_info->data);
@@ -1485,7 +1583,9 @@ int PlayNextFlicFrame2(tFlic_descriptor* pFlic_info, int pPanel_flic) {
     }
     pFlic_info->current_frame++;
     pFlic_info->frames_left--;
-    if (gTrans_enabled && gTranslation_count != 0 && !pPanel_flic) {
+    // changed by dethrace: translations of frames decoded ahead are drawn by PlayFlic
+    // if (gTrans_enabled && gTranslation_count != 0 && !pPanel_flic) {
+    if (gTrans_enabled && gTranslation_count != 0 && !pPanel_flic && FlicStreamDecoding(pFlic_info) == NULL) {
         DrawTranslations(pFlic_info, pFlic_info->frames_left == 0);
     }
     if (pFlic_info->f != NULL && pFlic_info->bytes_still_to_be_read) {
@@ -1515,6 +1615,223 @@ int PlayNextFlicFrame(tFlic_descriptor* pFlic_info) {
     return PlayNextFlicFrame2(pFlic_info, 0);
 }
 
+// Added by dethrace: frames are decoded from a window of the file which must hold a whole frame.
+// Make room for the largest frame a flic of this size can have, without reading the whole file.
+static void FitFlicReadWindow(tFlic_descriptor* pFlic_info) {
+    char* window;
+    int window_size;
+    int data_offset;
+
+    if (pFlic_info->f == NULL || pFlic_info->bytes_still_to_be_read == 0) {
+        return;
+    }
+    window_size = pFlic_info->width * pFlic_info->height;
+    window_size += window_size / 8 + 0x1000;
+    if (window_size > pFlic_info->bytes_in_buffer + pFlic_info->bytes_still_to_be_read) {
+        window_size = pFlic_info->bytes_in_buffer + pFlic_info->bytes_still_to_be_read;
+    }
+    if (window_size <= pFlic_info->bytes_in_buffer) {
+        return;
+    }
+    window = BrMemAllocate(window_size, kMem_flic_data);
+    data_offset = pFlic_info->data - pFlic_info->data_start;
+    memcpy(window, pFlic_info->data_start, pFlic_info->bytes_in_buffer);
+    BrMemFree(pFlic_info->data_start);
+    pFlic_info->data_start = window;
+    pFlic_info->data = window + data_offset;
+    fread(&window[pFlic_info->bytes_in_buffer], 1, window_size - pFlic_info->bytes_in_buffer, pFlic_info->f);
+    pFlic_info->bytes_still_to_be_read -= window_size - pFlic_info->bytes_in_buffer;
+    pFlic_info->bytes_in_buffer = window_size;
+}
+
+// Added by dethrace
+static void FlicStreamWorker(void* pArg) {
+    tFlic_stream* stream;
+    tFlic_stream_frame* frame;
+    int write_index;
+    int last_frame;
+    int i;
+
+    stream = pArg;
+    write_index = 0;
+    last_frame = 0;
+    while (!last_frame) {
+        stream->decoding.palette_first_written = -1;
+        stream->decoding.palette_last_written = -1;
+        stream->decoding.palette_change_count = 0;
+        last_frame = PlayNextFlicFrame2(&stream->decoder, 0);
+
+        OS_LockMutex(stream->mutex);
+        while (!stream->stop && stream->ready_count == stream->frame_count) {
+            OS_WaitCond(stream->cond, stream->mutex);
+        }
+        OS_UnlockMutex(stream->mutex);
+        if (stream->stop) {
+            return;
+        }
+
+        frame = &stream->frames[write_index];
+        for (i = 0; i < stream->decoder.height; i++) {
+            memcpy(&frame->pixels[i * stream->decoder.width],
+                stream->decoder.first_pixel + i * stream->canvas->row_bytes,
+                stream->decoder.width);
+        }
+        frame->palette_first_written = stream->decoding.palette_first_written;
+        frame->palette_last_written = stream->decoding.palette_last_written;
+        frame->palette_change_count = stream->decoding.palette_change_count;
+        if (frame->palette_change_count > 0) {
+            memcpy(frame->palette_first, stream->decoding.palette_first, sizeof(frame->palette_first));
+            memcpy(frame->palette_count, stream->decoding.palette_count, sizeof(frame->palette_count));
+        }
+        if (frame->palette_first_written >= 0) {
+            memcpy(frame->palette, stream->palette, sizeof(frame->palette));
+        }
+        frame->last_frame = last_frame;
+        write_index = (write_index + 1) % stream->frame_count;
+
+        OS_LockMutex(stream->mutex);
+        stream->ready_count++;
+        OS_BroadcastCond(stream->cond);
+        OS_UnlockMutex(stream->mutex);
+    }
+}
+
+// Added by dethrace: stop the worker, if it is still decoding, and release the stream
+static void EndFlicStream(tFlic_stream* pStream) {
+    int i;
+
+    if (pStream->thread != NULL) {
+        OS_LockMutex(pStream->mutex);
+        pStream->stop = 1;
+        OS_BroadcastCond(pStream->cond);
+        OS_UnlockMutex(pStream->mutex);
+        OS_JoinThread(pStream->thread);
+        gFlic_stream = NULL;
+    }
+    EndFlic(&pStream->decoder);
+    for (i = 0; i < pStream->frame_count; i++) {
+        BrMemFree(pStream->frames[i].pixels);
+    }
+    BrPixelmapFree(pStream->canvas);
+    OS_DestroyCond(pStream->cond);
+    OS_DestroyMutex(pStream->mutex);
+    BrMemFree(pStream);
+}
+
+// Added by dethrace: hand a started flic to a decode-ahead worker.
+// Returns NULL if decode-ahead is disabled or unavailable, the flic is then played as before.
+static tFlic_stream* StartFlicStream(tFlic_descriptor* pFlic_info) {
+    tFlic_stream* stream;
+    int frame_count;
+    int i;
+
+    frame_count = harness_game_config.flic_decode_ahead;
+    if (frame_count <= 0 || pFlic_info->the_pixelmap == NULL) {
+        return NULL;
+    }
+    if (frame_count > FLIC_STREAM_MAX_FRAMES) {
+        frame_count = FLIC_STREAM_MAX_FRAMES;
+    }
+    stream = BrMemAllocate(sizeof(tFlic_stream), kMem_flic_data);
+    memset(stream, 0, sizeof(tFlic_stream));
+    stream->frame_count = frame_count;
+    stream->mutex = OS_CreateMutex();
+    stream->cond = OS_CreateCond();
+    if (stream->mutex == NULL || stream->cond == NULL) {
+        if (stream->mutex != NULL) {
+            OS_DestroyMutex(stream->mutex);
+        }
+        if (stream->cond != NULL) {
+            OS_DestroyCond(stream->cond);
+        }
+        BrMemFree(stream);
+        return NULL;
+    }
+
+    // the worker decodes on top of what is on the destination, exactly like the frames played in place
+    stream->canvas = DRPixelmapAllocate(BR_PMT_INDEX_8, pFlic_info->width, pFlic_info->height, NULL, 0);
+    for (i = 0; i < pFlic_info->height; i++) {
+        memcpy((tU8*)stream->canvas->pixels + i * stream->canvas->row_bytes,
+            pFlic_info->first_pixel + i * pFlic_info->the_pixelmap->row_bytes,
+            pFlic_info->width);
+    }
+    for (i = 0; i < frame_count; i++) {
+        stream->frames[i].pixels = BrMemAllocate(pFlic_info->width * pFlic_info->height, kMem_flic_data);
+    }
+    memcpy(stream->palette, gPalette_pixels, sizeof(stream->palette));
+
+    // the worker owns the file and read window from now on
+    stream->decoder = *pFlic_info;
+    stream->decoder.x_offset = 0;
+    stream->decoder.y_offset = 0;
+    AssertFlicPixelmap(&stream->decoder, stream->canvas);
+    pFlic_info->f = NULL;
+    pFlic_info->data_start = NULL;
+    pFlic_info->data = NULL;
+
+    gFlic_stream = stream;
+    stream->thread = OS_CreateThread(FlicStreamWorker, stream);
+    if (stream->thread == NULL) {
+        // no threads: decode on this thread, in place
+        gFlic_stream = NULL;
+        stream->decoder.x_offset = pFlic_info->x_offset;
+        stream->decoder.y_offset = pFlic_info->y_offset;
+        AssertFlicPixelmap(&stream->decoder, pFlic_info->the_pixelmap);
+        *pFlic_info = stream->decoder;
+        stream->decoder.f = NULL;
+        stream->decoder.data_start = NULL;
+        EndFlicStream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// Added by dethrace: show the next frame decoded by the worker. Returns 1 after the last frame
+static int ShowNextFlicStreamFrame(tFlic_stream* pStream, tFlic_descriptor* pFlic_info) {
+    tFlic_stream_frame* frame;
+    int last_frame;
+    int i;
+
+    OS_LockMutex(pStream->mutex);
+    while (pStream->ready_count == 0) {
+        OS_WaitCond(pStream->cond, pStream->mutex);
+    }
+    OS_UnlockMutex(pStream->mutex);
+
+    frame = &pStream->frames[pStream->read_index];
+    if (frame->palette_first_written >= 0) {
+        memcpy((tU8*)gPalette_pixels + 4 * frame->palette_first_written,
+            &frame->palette[4 * frame->palette_first_written],
+            4 * (frame->palette_last_written - frame->palette_first_written));
+        if (!gPalette_fuck_prevention) {
+            if (frame->palette_change_count < 0) {
+                DRSetPaletteEntries(gPalette, 0, 256);
+            }
+            for (i = 0; i < frame->palette_change_count; i++) {
+                DRSetPaletteEntries(gPalette, frame->palette_first[i], frame->palette_count[i]);
+            }
+        }
+    }
+    for (i = 0; i < pFlic_info->height; i++) {
+        memcpy(pFlic_info->first_pixel + i * pFlic_info->the_pixelmap->row_bytes,
+            &frame->pixels[i * pFlic_info->width],
+            pFlic_info->width);
+    }
+    last_frame = frame->last_frame;
+    pFlic_info->current_frame++;
+    pFlic_info->frames_left--;
+    if (gTrans_enabled && gTranslation_count != 0) {
+        DrawTranslations(pFlic_info, last_frame);
+    }
+
+    pStream->read_index = (pStream->read_index + 1) % pStream->frame_count;
+    OS_LockMutex(pStream->mutex);
+    pStream->ready_count--;
+    OS_BroadcastCond(pStream->cond);
+    OS_UnlockMutex(pStream->mutex);
+    return last_frame;
+}
+
 // IDA: int __usercall PlayFlic@<EAX>(int pIndex@<EAX>, tU32 pSize@<EDX>, tS8 *pData_ptr@<EBX>, br_pixelmap *pDest_pixelmap@<ECX>, int pX_offset, int pY_offset, void (*DoPerFrame)(), int pInterruptable, int pFrame_rate)
 // FUNCTION: CARM95 0x00497278
 int PlayFlic(int pIndex, tU32 pSize, tS8* pData_ptr, br_pixelmap* pDest_pixelmap, int pX_offset, int pY_offset, void (*DoPerFrame)(void), int pInterruptable, int pFrame_rate) {
@@ -1523,6 +1840,7 @@ int PlayFlic(int pIndex, tU32 pSize, tS8* pData_ptr, br_pixelmap* pDest_pixelmap
     tU32 last_frame;
     tU32 new_time;
     tU32 frame_period;
+    tFlic_stream* stream; // added by dethrace
 
     finished_playing = 0;
     the_flic.data_start = NULL;
@@ -1531,6 +1849,10 @@ int PlayFlic(int pIndex, tU32 pSize, tS8* pData_ptr, br_pixelmap* pDest_pixelmap
         return -1;
     }
 
+    // added by dethrace
+    FitFlicReadWindow(&the_flic);
+    stream = StartFlicStream(&the_flic);
+
     last_frame = 0;
     while ((!pInterruptable || !AnyKeyDown()) && !finished_playing) {
         new_time = PDGetTotalTime();
@@ -1542,7 +1864,13 @@ int PlayFlic(int pIndex, tU32 pSize, tS8* pData_ptr, br_pixelmap* pDest_pixelmap
         }
         if (frame_period >= the_flic.frame_period) {
             last_frame = new_time;
-            finished_playing = PlayNextFlicFrame(&the_flic);
+            // changed by dethrace
+            // finished_playing = PlayNextFlicFrame(&the_flic);
+            if (stream != NULL) {
+                finished_playing = ShowNextFlicStreamFrame(stream, &the_flic);
+            } else {
+                finished_playing = PlayNextFlicFrame(&the_flic);
+            }
             DoPerFrame();
             if (!gDark_mode) {
                 EnsurePaletteUp();
@@ -1551,6 +1879,10 @@ int PlayFlic(int pIndex, tU32 pSize, tS8* pData_ptr, br_pixelmap* pDest_pixelmap
         }
     }
     ServiceGame();
+    // added by dethrace
+    if (stream != NULL) {
+        EndFlicStream(stream);
+    }
     EndFlic(&the_flic);
     return 0;
 }
@@ -1607,6 +1939,12 @@ int LoadFlic(int pIndex) {
         gMain_flic_list[pIndex].data_ptr = NULL;
         return 1;
     }
+    // added by dethrace: if asked to, PlayFlic streams these from disk with a bounded read window. Queued
+    // flics are also played a frame at a time by ProcessFlicQueue, keep loading those
+    if (harness_game_config.flic_stream && !gMain_flic_list[pIndex].queued) {
+        gMain_flic_list[pIndex].data_ptr = NULL;
+        return 1;
+    }
     PossibleService();
     PathCat(the_path, gApplication_path, "ANIM");
     PathCat(the_path, the_path, gMain_flic_list[pIndex].file_name);
@@ -13,6 +13,7 @@
 #include "globvrbm.h"
 #include "globvrpb.h"
 #include "grafdata.h"
+#include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/os.h"
 #include "harness/trace.h"
@@ -441,6 +442,25 @@ void TurnOffPaletteConversion(void) {
     gCurrent_conversion_table = NULL;
 }
 
+// Added by dethrace: the queue starts out in gLollipops, and moves to twice the room whenever more than fit
+// are added in a frame, instead of leaving the rest unrendered
+static br_actor** gLollipop_queue = gLollipops;
+static int gLollipop_queue_size = COUNT_OF(gLollipops);
+
+// Added by dethrace
+static void GrowLollipopQueue(void) {
+    br_actor** queue;
+
+    queue = BrMemAllocate(sizeof(br_actor*) * gLollipop_queue_size * 2, kMem_misc);
+    memcpy(queue, gLollipop_queue, sizeof(br_actor*) * gLollipop_queue_size);
+    if (gLollipop_queue != gLollipops) {
+        BrMemFree(gLollipop_queue);
+    }
+    gLollipop_queue = queue;
+    gLollipop_queue_size *= 2;
+    dr_dprintf("Lollipop queue grown to %d", gLollipop_queue_size);
+}
+
 // IDA: void __cdecl ResetLollipopQueue()
 // FUNCTION: CARM95 0x004b304a
 void ResetLollipopQueue(void) {
@@ -453,11 +473,17 @@ void ResetLollipopQueue(void) {
 int AddToLollipopQueue(br_actor* pActor, int pIndex) {
 
     if (pIndex >= 0) {
-        gLollipops[pIndex] = pActor;
-    } else if (gNumber_of_lollipops >= 100) {
-        pIndex = -1;
+        // gLollipops[pIndex] = pActor;
+        gLollipop_queue[pIndex] = pActor; // changed by dethrace
+    // } else if (gNumber_of_lollipops >= 100) {
+    //     pIndex = -1;
     } else {
-        gLollipops[gNumber_of_lollipops] = pActor;
+        // Added by dethrace
+        if (gNumber_of_lollipops >= gLollipop_queue_size) {
+            GrowLollipopQueue();
+        }
+        // gLollipops[gNumber_of_lollipops] = pActor;
+        gLollipop_queue[gNumber_of_lollipops] = pActor; // changed by dethrace
         pIndex = gNumber_of_lollipops;
         gNumber_of_lollipops++;
     }
@@ -472,7 +498,8 @@ void RenderLollipops(void) {
     br_actor** the_actor;
     br_actor* old_parent;
 
-    for (i = 0, the_actor = gLollipops; i < gNumber_of_lollipops; i++, the_actor++) {
+    // for (i = 0, the_actor = gLollipops; i < gNumber_of_lollipops; i++, the_actor++) {
+    for (i = 0, the_actor = gLollipop_queue; i < gNumber_of_lollipops; i++, the_actor++) { // changed by dethrace
         if ((*the_actor)->render_style == BR_RSTYLE_NONE) {
             must_relink = (*the_actor)->parent != gDont_render_actor;
             if (must_relink) {
@@ -1399,6 +1426,223 @@ void EnableLights(void) {
     }
 }
 
+// Added by dethrace: a clipped shadow triangle fans out into at most this many vertices
+#define SHADOW_CLIP_MAX_VERTS (3 + BR_MAX_CLIP_PLANES)
+
+// Added by dethrace: gShadow_dim_amount is at most 7, and non-fancy shadows all use level 0
+#define SHADOW_BATCH_LEVELS 8
+
+// Added by dethrace: BRender indexes vertices with 16 bits, and every batched face has its own three
+#define SHADOW_BATCH_MAX_FACES (65535 / 3)
+
+// Added by dethrace: shadow faces of every car that shares a shade level, rendered together
+typedef struct tShadow_batch {
+    br_vertex* verts;
+    br_face* faces;
+    int face_count;
+    int face_capacity;
+    br_scalar hither_fudge;
+} tShadow_batch;
+
+static tShadow_batch gShadow_batches[SHADOW_BATCH_LEVELS];
+
+static void FlushShadowBatch(int pLevel);
+
+// Added by dethrace: Sutherland-Hodgman against one clip plane actor, keeping the side
+// BRender keeps (non-negative plane equation, after the actor's translation)
+static int ClipShadowPolygon(br_vertex* pIn, int pCount, br_vertex* pOut, br_actor* pClip) {
+    int i;
+    int out_count;
+    br_vector4* plane;
+    br_vertex* a;
+    br_vertex* b;
+    br_scalar dist_a;
+    br_scalar dist_b;
+    br_scalar t;
+
+    plane = (br_vector4*)pClip->type_data;
+    out_count = 0;
+    for (i = 0; i < pCount; i++) {
+        a = &pIn[i];
+        b = &pIn[(i + 1) % pCount];
+        dist_a = (a->p.v[0] - pClip->t.t.mat.m[3][0]) * plane->v[0] + (a->p.v[1] - pClip->t.t.mat.m[3][1]) * plane->v[1] + (a->p.v[2] - pClip->t.t.mat.m[3][2]) * plane->v[2] + plane->v[3];
+        dist_b = (b->p.v[0] - pClip->t.t.mat.m[3][0]) * plane->v[0] + (b->p.v[1] - pClip->t.t.mat.m[3][1]) * plane->v[1] + (b->p.v[2] - pClip->t.t.mat.m[3][2]) * plane->v[2] + plane->v[3];
+        if (dist_a >= 0.f) {
+            pOut[out_count++] = *a;
+        }
+        if ((dist_a >= 0.f) != (dist_b >= 0.f)) {
+            t = dist_a / (dist_a - dist_b);
+            pOut[out_count] = *a;
+            BrVector3Sub(&pOut[out_count].p, &b->p, &a->p);
+            BrVector3Scale(&pOut[out_count].p, &pOut[out_count].p, t);
+            BrVector3Accumulate(&pOut[out_count].p, &a->p);
+            pOut[out_count].map.v[0] = a->map.v[0] + (b->map.v[0] - a->map.v[0]) * t;
+            pOut[out_count].map.v[1] = a->map.v[1] + (b->map.v[1] - a->map.v[1]) * t;
+            out_count++;
+        }
+    }
+    return out_count;
+}
+
+// Added by dethrace: clips a car's shadow faces to its shadow clip planes and adds what is
+// left to the batch for its shade level
+static void AddShadowFacesToBatch(int pLevel, br_vertex* pVerts, br_face* pFaces, int pFace_count, br_scalar pHither_fudge) {
+    int i;
+    int j;
+    int count;
+    int new_capacity;
+    br_vertex poly[2][SHADOW_CLIP_MAX_VERTS];
+    br_vertex* new_verts;
+    br_face* new_faces;
+    br_face* face;
+    tShadow_batch* batch;
+
+    batch = &gShadow_batches[pLevel];
+    batch->hither_fudge = MAX(batch->hither_fudge, pHither_fudge);
+    for (i = 0; i < pFace_count; i++) {
+        poly[0][0] = pVerts[pFaces[i].vertices[0]];
+        poly[0][1] = pVerts[pFaces[i].vertices[1]];
+        poly[0][2] = pVerts[pFaces[i].vertices[2]];
+        count = 3;
+        for (j = 0; j < gShadow_clip_plane_count && count != 0; j++) {
+            count = ClipShadowPolygon(poly[j & 1], count, poly[(j + 1) & 1], gShadow_clip_planes[j].clip);
+        }
+        if (count < 3) {
+            continue;
+        }
+        if (batch->face_count + count - 2 > SHADOW_BATCH_MAX_FACES) {
+            // full, draw what is there and carry on with an empty batch
+            FlushShadowBatch(pLevel);
+            batch->hither_fudge = pHither_fudge;
+        }
+        if (batch->face_count + count - 2 > batch->face_capacity) {
+            new_capacity = MAX(2 * batch->face_capacity, batch->face_count + 64);
+            new_capacity = MIN(new_capacity, SHADOW_BATCH_MAX_FACES);
+            new_verts = BrMemAllocate(3 * new_capacity * sizeof(br_vertex), kMem_misc);
+            new_faces = BrMemAllocate(new_capacity * sizeof(br_face), kMem_misc);
+            if (batch->face_count != 0) {
+                memcpy(new_verts, batch->verts, 3 * batch->face_count * sizeof(br_vertex));
+                memcpy(new_faces, batch->faces, batch->face_count * sizeof(br_face));
+            }
+            if (batch->verts != NULL) {
+                BrMemFree(batch->verts);
+                BrMemFree(batch->faces);
+            }
+            batch->verts = new_verts;
+            batch->faces = new_faces;
+            batch->face_capacity = new_capacity;
+        }
+        for (j = 1; j < count - 1; j++) {
+            face = &batch->faces[batch->face_count];
+            memset(face, 0, sizeof(br_face));
+            face->material = pFaces[i].material;
+            face->vertices[0] = 3 * batch->face_count;
+            face->vertices[1] = 3 * batch->face_count + 1;
+            face->vertices[2] = 3 * batch->face_count + 2;
+            batch->verts[face->vertices[0]] = poly[gShadow_clip_plane_count & 1][0];
+            batch->verts[face->vertices[1]] = poly[gShadow_clip_plane_count & 1][j];
+            batch->verts[face->vertices[2]] = poly[gShadow_clip_plane_count & 1][j + 1];
+            batch->face_count++;
+        }
+    }
+}
+
+// Added by dethrace: one scene render for all shadow faces collected at a shade level
+static void FlushShadowBatch(int pLevel) {
+    int i;
+    br_camera* camera_ptr;
+    br_material* material;
+    tShadow_batch* batch;
+
+    camera_ptr = (br_camera*)gCamera->type_data;
+    batch = &gShadow_batches[pLevel];
+    if (batch->face_count == 0) {
+        return;
+    }
+    if (gFancy_shadow) {
+        for (i = 0; i < gSaved_table_count; i++) {
+            gSaved_shade_tables[i].original->height = 1;
+            gSaved_shade_tables[i].original->pixels = (tU8*)gDepth_shade_table->pixels + pLevel * gDepth_shade_table->row_bytes;
+            BrTableUpdate(gSaved_shade_tables[i].original, BR_TABU_ALL);
+        }
+        // another car's shadow may have been drawn since these faces were collected
+        for (i = 0; i < batch->face_count; i++) {
+            material = batch->faces[i].material;
+            if (material == NULL) {
+                continue;
+            }
+#ifdef DETHRACE_3DFX_PATCH
+            if (gShade_tables_do_not_work) {
+                material->ka = 0.75f;
+                BrMaterialUpdate(material, BR_MATU_LIGHTING);
+                continue;
+            }
+#endif
+            if (material->colour_map && (material->flags & BR_MATF_LIGHT) == 0) {
+                material->flags |= BR_MATF_SMOOTH | BR_MATF_LIGHT;
+                BrMaterialUpdate(material, BR_MATU_RENDERING);
+            }
+        }
+    }
+    camera_ptr->hither_z += batch->hither_fudge;
+#ifdef DETHRACE_3DFX_PATCH
+    DisableLights();
+#endif
+    BrZbSceneRenderBegin(gUniverse_actor, gCamera, gRender_screen, gDepth_buffer);
+#ifdef DETHRACE_3DFX_PATCH
+    EnableLights();
+#endif
+    gShadow_model->vertices = batch->verts;
+    gShadow_model->faces = batch->faces;
+    gShadow_model->nfaces = batch->face_count;
+    gShadow_model->nvertices = 3 * batch->face_count;
+    gShadow_actor->render_style = BR_RSTYLE_FACES;
+    BrModelAdd(gShadow_model);
+    BrZbSceneRenderAdd(gShadow_actor);
+    BrModelRemove(gShadow_model);
+    BrZbSceneRenderEnd();
+    gShadow_actor->render_style = BR_RSTYLE_NONE;
+    camera_ptr->hither_z -= batch->hither_fudge;
+    if (gFancy_shadow) {
+        for (i = 0; i < batch->face_count; i++) {
+            material = batch->faces[i].material;
+            if (material) {
+#ifdef DETHRACE_3DFX_PATCH
+                if (gShade_tables_do_not_work) {
+                    material->ka = 1.0f;
+                    BrMaterialUpdate(material, BR_MATU_LIGHTING);
+                    continue;
+                }
+#endif
+                if (material->colour_map && (material->flags & BR_MATF_LIGHT) != 0) {
+                    material->flags &= ~(BR_MATF_LIGHT | BR_MATF_PRELIT | BR_MATF_SMOOTH);
+                    BrMaterialUpdate(material, BR_MATU_RENDERING);
+                }
+            }
+        }
+    }
+    batch->face_count = 0;
+    batch->hither_fudge = 0.f;
+}
+
+// Added by dethrace: one scene render per shade level in use, whatever the number of cars
+static void FlushShadowBatches(void) {
+    int level;
+
+    for (level = 0; level < SHADOW_BATCH_LEVELS; level++) {
+        FlushShadowBatch(level);
+    }
+}
+
+// Added by dethrace: true if the physics step's face query for this car covered pBounds
+static int ShadowBoxInPhysicsBox(tCar_spec* pCar, br_bounds* pBounds) {
+    br_bounds in_box_space;
+
+    GetNewBoundingBox(&in_box_space, pBounds, &pCar->last_box_inv_mat);
+    return pCar->last_box.min.v[0] <= in_box_space.min.v[0] && pCar->last_box.min.v[1] <= in_box_space.min.v[1] && pCar->last_box.min.v[2] <= in_box_space.min.v[2]
+        && pCar->last_box.max.v[0] >= in_box_space.max.v[0] && pCar->last_box.max.v[1] >= in_box_space.max.v[1] && pCar->last_box.max.v[2] >= in_box_space.max.v[2];
+}
+
 // IDA: void __usercall ProcessShadow(tCar_spec *pCar@<EAX>, br_actor *pWorld@<EDX>, tTrack_spec *pTrack_spec@<EBX>, br_actor *pCamera@<ECX>, br_matrix34 *pCamera_to_world_transform, br_scalar pDistance_factor)
 // FUNCTION: CARM95 0x004b405c
 void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec, br_actor* pCamera, br_matrix34* pCamera_to_world_transform, br_scalar pDistance_factor) {
@@ -1454,10 +1698,15 @@ void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec,
     br_material* material;
     br_vertex verts[48];
     br_face faces[16];
+    int batched;      // added by dethrace
+    int* oily_spills; // added by dethrace
 
 #if defined(DETHRACE_FIX_BUGS)
     ray_length = 0.f;
 #endif
+    // Added by dethrace: oil spills under the car are clipped by BRender along with the
+    // shadow, so those cars still get a scene render of their own
+    batched = pCar->shadow_intersection_flags == 0;
     f_num = 0;
     bounds_x_min = pCar->bounds[1].min.v[0] / WORLD_SCALE;
     bounds_x_max = pCar->bounds[1].max.v[0] / WORLD_SCALE;
@@ -1544,8 +1793,13 @@ void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec,
         }
         kev_bounds.original_bounds.min.v[1] = kev_bounds.original_bounds.min.v[1] - 4.4000001;
         kev_bounds.mat = &gIdentity34;
-        face_count = FindFacesInBox(&kev_bounds, the_list, 100);
-        face_ref = the_list;
+        // changed by dethrace: the physics step may already have fetched every face in this box
+        // face_count = FindFacesInBox(&kev_bounds, the_list, 100);
+        // face_ref = the_list;
+        if (gAction_replay_mode || face_count == 0 || !ShadowBoxInPhysicsBox(pCar, &kev_bounds.original_bounds)) {
+            face_count = FindFacesInBox(&kev_bounds, the_list, 100);
+            face_ref = the_list;
+        }
         highest_underneath = 1000.0;
         ray_length = kev_bounds.original_bounds.max.v[1] - kev_bounds.original_bounds.min.v[1];
         ray.v[0] = 0.0;
@@ -1646,7 +1900,9 @@ void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec,
         }
         if (gFancy_shadow) {
             gShadow_dim_amount = ((2.2 - highest_underneath) * 5.0 / 2.2 + 2.5);
-            for (i = 0; i < gSaved_table_count; i++) {
+            // changed by dethrace: batched shadows get their shade tables set when the batch is drawn
+            // for (i = 0; i < gSaved_table_count; i++) {
+            for (i = 0; i < gSaved_table_count && !batched; i++) {
                 gSaved_shade_tables[i].original->height = 1;
                 gSaved_shade_tables[i].original->pixels = (tU8*)gDepth_shade_table->pixels + gShadow_dim_amount * gDepth_shade_table->row_bytes;
 
@@ -1672,7 +1928,16 @@ void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec,
             if (camera_hither_fudge < 0.0002) {
                 camera_hither_fudge = 0.0002;
             }
-            camera_ptr->hither_z += camera_hither_fudge;
+            // changed by dethrace
+            // camera_ptr->hither_z += camera_hither_fudge;
+            if (!batched) {
+                camera_ptr->hither_z += camera_hither_fudge;
+            }
+        }
+        // Added by dethrace
+        if (f_num && batched) {
+            AddShadowFacesToBatch(gFancy_shadow ? MIN(MAX(gShadow_dim_amount, 0), SHADOW_BATCH_LEVELS - 1) : 0, verts, faces, f_num, camera_hither_fudge);
+            f_num = 0;
         }
         if (f_num) {
 #ifdef DETHRACE_3DFX_PATCH
@@ -1691,20 +1956,27 @@ void ProcessShadow(tCar_spec* pCar, br_actor* pWorld, tTrack_spec* pTrack_spec,
             BrZbSceneRenderAdd(gShadow_actor);
             BrModelRemove(gShadow_model);
             if (pCar->shadow_intersection_flags) {
-                oily_count = GetOilSpillCount();
-                for (i = 0; i < oily_count; ++i) {
-                    if (((1 << i) & pCar->shadow_intersection_flags) != 0) {
-                        GetOilSpillDetails(i, &oily_actor, &oily_size);
-                        if (oily_actor) {
-                            MungeIndexedOilsHeightAboveGround(i);
-                            BrZbSceneRenderAdd(oily_actor);
-                        }
+                // changed by dethrace: the spills near the car come from FindOilSpillsNearCar
+                // oily_count = GetOilSpillCount();
+                // for (i = 0; i < oily_count; ++i) {
+                //     if (((1 << i) & pCar->shadow_intersection_flags) != 0) {
+                oily_count = FindOilSpillsNearCar(pCar, pCar->car_master_actor->t.t.translate.t.v[0], pCar->car_master_actor->t.t.translate.t.v[2], &oily_spills);
+                for (j = 0; j < oily_count; j++) {
+                    i = oily_spills[j];
+                    GetOilSpillDetails(i, &oily_actor, &oily_size);
+                    if (oily_actor) {
+                        MungeIndexedOilsHeightAboveGround(i);
+                        BrZbSceneRenderAdd(oily_actor);
                     }
                 }
             }
             BrZbSceneRenderEnd();
         }
-        camera_ptr->hither_z -= camera_hither_fudge;
+        // changed by dethrace
+        // camera_ptr->hither_z -= camera_hither_fudge;
+        if (!batched) {
+            camera_ptr->hither_z -= camera_hither_fudge;
+        }
         for (i = 0; i < f_num; i++) {
             if (gFancy_shadow) {
                 material = gShadow_model->faces[i].material;
@@ -1776,6 +2048,7 @@ void RenderShadows(br_actor* pWorld, tTrack_spec* pTrack_spec, br_actor* pCamera
             }
         }
     }
+    FlushShadowBatches(); // added by dethrace
     if (gFancy_shadow) {
         for (i = 0; i < gSaved_table_count; i++) {
             gSaved_shade_tables[i].original->height = gSaved_shade_tables[i].copy->height;
@@ -1855,6 +2128,142 @@ int ConditionallyFillWithSky(br_pixelmap* pPixelmap) {
     return 1;
 }
 
+// Added by dethrace: rear view mirror refresh rate and cost against the main view, in ms
+static br_pixelmap* gMirror_last_screen;
+static int gMirror_age = -1; // frames since the mirror image was rendered, -1 when there is none to reuse
+static int gMirror_frames;
+static int gMirror_frames_rendered;
+static tU32 gMirror_render_time;
+static int gMain_view_frames;
+static tU32 gMain_view_render_time;
+
+// Added by dethrace: the map view's 3d inset, rendered into buffers of its own and copied over the map
+static br_pixelmap* gMap_inset_screen;
+static br_pixelmap* gMap_inset_depth;
+static br_pixelmap* gMap_inset_real_screen;
+static br_pixelmap* gMap_inset_real_depth;
+static int gMap_inset_mode; // gMap_mode when the inset was last rendered, 0 when there is none to reuse
+static tU32 gMap_inset_time;
+static int gMap_inset_renders;
+static int gMap_view_frames;
+static tU32 gMap_view_render_time;
+
+// Added by dethrace: whether the rear view mirror needs rendering this frame, or its last image will do
+static int MirrorDueForRender(void) {
+
+    gMirror_frames++;
+#ifndef DETHRACE_3DFX_PATCH
+    // the mirror has its own pixels, which are copied under the cockpit every frame
+    if (gRearview_screen == gMirror_last_screen && gMirror_age >= 0 && gMirror_age + 1 < harness_game_config.mirror_refresh_interval) {
+        gMirror_age++;
+        return 0;
+    }
+#endif
+    gMirror_last_screen = gRearview_screen;
+    gMirror_age = 0;
+    gMirror_frames_rendered++;
+    return 1;
+}
+
+// Added by dethrace: the mirror pixelmap is being replaced, and a new one may be given the old one's address
+void ForgetMirrorImage(void) {
+
+    gMirror_last_screen = NULL;
+    gMirror_age = -1;
+}
+
+// Added by dethrace
+void DisposeMapInset(void) {
+
+    if (gMap_inset_screen != NULL) {
+        BrPixelmapFree(gMap_inset_depth);
+        BrPixelmapFree(gMap_inset_screen);
+        gMap_inset_depth = NULL;
+        gMap_inset_screen = NULL;
+    }
+}
+
+#ifndef DETHRACE_3DFX_PATCH
+// Added by dethrace: if the map inset is due another render, points the scene at its buffers and returns 1.
+// Otherwise returns 0, and its last image is copied over the map
+static int BeginMapInset(void) {
+    tU32 now;
+
+    now = PDGetTotalTime();
+    if (gMap_inset_screen != NULL
+        && (gMap_inset_screen->width != gRender_screen->width
+            || gMap_inset_screen->height != gRender_screen->height
+            || gMap_inset_screen->type != gRender_screen->type)) {
+        DisposeMapInset();
+    }
+    if (gMap_inset_screen == NULL) {
+        gMap_inset_screen = BrPixelmapMatch(gRender_screen, BR_PMMATCH_OFFSCREEN);
+        gMap_inset_depth = BrPixelmapMatch(gMap_inset_screen, BR_PMMATCH_DEPTH_16);
+    } else if (gMap_inset_mode == gMap_mode
+        && harness_game_config.map_inset_fps > 0
+        && now - gMap_inset_time < 1000 / harness_game_config.map_inset_fps) {
+        return 0;
+    }
+    gMap_inset_mode = gMap_mode;
+    gMap_inset_time = now;
+    gMap_inset_renders++;
+    gMap_inset_screen->origin_x = gRender_screen->origin_x;
+    gMap_inset_screen->origin_y = gRender_screen->origin_y;
+    gMap_inset_depth->origin_x = gRender_screen->origin_x;
+    gMap_inset_depth->origin_y = gRender_screen->origin_y;
+    BrPixelmapFill(gMap_inset_depth, 0xFFFFFFFF);
+    gMap_inset_real_screen = gRender_screen;
+    gMap_inset_real_depth = gDepth_buffer;
+    gRender_screen = gMap_inset_screen;
+    gDepth_buffer = gMap_inset_depth;
+    return 1;
+}
+
+// Added by dethrace: back to the real buffers, with the inset copied in
+static void EndMapInset(void) {
+
+    if (gMap_inset_real_screen != NULL) {
+        gRender_screen = gMap_inset_real_screen;
+        gDepth_buffer = gMap_inset_real_depth;
+        gMap_inset_real_screen = NULL;
+        gMap_inset_real_depth = NULL;
+    }
+    BrPixelmapRectangleCopy(
+        gRender_screen,
+        -gRender_screen->origin_x,
+        -gRender_screen->origin_y,
+        gMap_inset_screen,
+        -gMap_inset_screen->origin_x,
+        -gMap_inset_screen->origin_y,
+        gMap_inset_screen->width,
+        gMap_inset_screen->height);
+}
+#endif
+
+// Added by dethrace: logs, then clears, what the views cost since the last report
+void ReportRenderStats(void) {
+
+    if (gMain_view_frames != 0) {
+        dr_dprintf("Main view: %d frames, %.2f ms each", gMain_view_frames, gMain_view_render_time / (float)gMain_view_frames);
+    }
+    if (gMirror_frames != 0) {
+        dr_dprintf("Rear view mirror: rendered %d of %d frames, %.2f ms each", gMirror_frames_rendered, gMirror_frames,
+            gMirror_frames_rendered != 0 ? gMirror_render_time / (float)gMirror_frames_rendered : 0.f);
+    }
+    if (gMap_view_frames != 0) {
+        dr_dprintf("Map view: %d frames, %.2f ms each, inset rendered %d times", gMap_view_frames, gMap_view_render_time / (float)gMap_view_frames, gMap_inset_renders);
+    }
+    gMain_view_frames = 0;
+    gMain_view_render_time = 0;
+    gMirror_frames = 0;
+    gMirror_frames_rendered = 0;
+    gMirror_render_time = 0;
+    gMirror_age = -1;
+    gMap_view_frames = 0;
+    gMap_view_render_time = 0;
+    gMap_inset_renders = 0;
+}
+
 // IDA: void __usercall RenderAFrame(int pDepth_mask_on@<EAX>)
 // FUNCTION: CARM95 0x004b59ce
 void RenderAFrame(int pDepth_mask_on) {
@@ -1880,6 +2289,11 @@ void RenderAFrame(int pDepth_mask_on) {
     br_vector3 pos;
     char the_text[256];
     tCar_spec* car;
+    tU32 start_time;      // added by dethrace
+    int mirror_particles; // added by dethrace
+#ifndef DETHRACE_3DFX_PATCH
+    int scene_renders; // added by dethrace
+#endif
 
 #ifdef DETHRACE_3DFX_PATCH
     if (gVoodoo_rush_mode >= 1) {
@@ -1891,6 +2305,14 @@ void RenderAFrame(int pDepth_mask_on) {
     old_pixels = gRender_screen->pixels;
     cockpit_on = gProgram_state.cockpit_on && gProgram_state.cockpit_image_index >= 0 && !gMap_mode;
     gMirror_on__graphics = gProgram_state.mirror_on && cockpit_on && gProgram_state.which_view == eView_forward;
+    // Added by dethrace: an old mirror image is no use once the mirror has been away
+    if (!gMirror_on__graphics) {
+        gMirror_age = -1;
+    }
+    // Added by dethrace: nor is an old map inset once the map has been left, even if it comes back with the same gMap_mode
+    if (!gMap_mode) {
+        gMap_inset_mode = 0;
+    }
     if (gMap_mode) {
         real_origin_x = gBack_screen->origin_x;
         real_origin_y = gBack_screen->origin_y;
@@ -2001,10 +2423,20 @@ void RenderAFrame(int pDepth_mask_on) {
     gRendering_mirror = 0;
     DoSpecialCameraEffect(gCamera, &gCamera_to_world);
 
+    start_time = PDGetTotalTime(); // added by dethrace
+#ifndef DETHRACE_3DFX_PATCH
+    // Added by dethrace: the map inset is rendered once, when it is due, instead of three times every frame
+    scene_renders = 1;
+    if (gMap_mode) {
+        scene_renders = BeginMapInset();
+    }
+#endif
+
 #ifdef DETHRACE_3DFX_PATCH
     if (!ConditionallyFillWithSky(gRender_screen->width == gBack_screen->width ? gBack_screen : gRender_screen)
 #else
-    if (!ConditionallyFillWithSky(gRender_screen)
+    // if (!ConditionallyFillWithSky(gRender_screen)
+    if (scene_renders != 0 && !ConditionallyFillWithSky(gRender_screen) // changed by dethrace
 #endif
         && !gProgram_state.cockpit_on
         && !(gAction_replay_camera_mode && gAction_replay_mode)) {
@@ -2012,7 +2444,8 @@ void RenderAFrame(int pDepth_mask_on) {
         if (!gBlitting_is_slow)
 #endif
         {
-            ExternalSky(gRender_screen, gDepth_buffer, gCamera, &gCamera_to_world);
+            // ExternalSky(gRender_screen, gDepth_buffer, gCamera, &gCamera_to_world);
+            DeferExternalSky(gRender_screen, gDepth_buffer, gCamera, &gCamera_to_world); // changed by dethrace
         }
     }
 
@@ -2022,9 +2455,16 @@ void RenderAFrame(int pDepth_mask_on) {
 
 #if !defined(DETHRACE_FIX_BUGS)
     // in map mode, the scene is rendered 3 times. We have no idea why.
+#ifdef DETHRACE_3DFX_PATCH
     for (i = 0; i < (gMap_mode ? 3 : 1); i++)
+#else
+    // for (i = 0; i < (gMap_mode ? 3 : 1); i++)
+    for (i = 0; i < scene_renders; i++) // changed by dethrace
+#endif
 #elif defined(DETHRACE_3DFX_PATCH)
     for (i = 0; i < (gMap_mode && !gSmall_frames_are_slow ? 3 : 1); i++)
+#else
+    for (i = 0; i < scene_renders; i++) // added by dethrace
 #endif
     {
         RenderShadows(gUniverse_actor, &gProgram_state.track_spec, gCamera, &gCamera_to_world);
@@ -2044,6 +2484,20 @@ void RenderAFrame(int pDepth_mask_on) {
         RenderProximityRays(gRender_screen, gDepth_buffer, gCamera, &gCamera_to_world, gFrame_period);
         BrZbSceneRenderEnd();
     }
+    // Added by dethrace
+#ifndef DETHRACE_3DFX_PATCH
+    if (gMap_mode) {
+        EndMapInset();
+    }
+#endif
+    if (gMap_mode) {
+        gMap_view_render_time += PDGetTotalTime() - start_time;
+        gMap_view_frames++;
+    } else {
+        gMain_view_render_time += PDGetTotalTime() - start_time;
+        gMain_view_frames++;
+    }
+    // ---
 #ifdef DETHRACE_3DFX_PATCH
     PDLockRealBackScreen(1);
 #endif
@@ -2067,7 +2521,12 @@ void RenderAFrame(int pDepth_mask_on) {
     }
 #endif
 
-    if (gMirror_on__graphics) {
+    // if (gMirror_on__graphics) {
+    if (gMirror_on__graphics && MirrorDueForRender()) { // changed by dethrace
+        // Added by dethrace
+        start_time = PDGetTotalTime();
+        mirror_particles = gRearview_screen->height >= harness_game_config.mirror_particle_min_height;
+        // ---
 #ifdef DETHRACE_3DFX_PATCH
         if (gVoodoo_rush_mode >= 1) {
             gRearview_screen->pixels = gBack_screen->pixels;
@@ -2109,17 +2568,21 @@ void RenderAFrame(int pDepth_mask_on) {
         if (!gAusterity_mode) {
             ProcessTrack(gUniverse_actor, &gProgram_state.track_spec, gRearview_camera, &gRearview_camera_to_world, 1);
         }
-        RenderSplashes();
+        // Added by dethrace: particles are specks in a small mirror
+        if (mirror_particles) {
+            RenderSplashes();
 #ifdef DETHRACE_3DFX_PATCH
-        RenderSmoke(gRearview_screen, gRearview_depth_buffer, gRearview_camera, &gRearview_camera_to_world, gFrame_period);
-        RenderSparks(gRearview_screen, gRearview_depth_buffer, gRearview_camera, &gRearview_camera_to_world, gFrame_period);
+            RenderSmoke(gRearview_screen, gRearview_depth_buffer, gRearview_camera, &gRearview_camera_to_world, gFrame_period);
+            RenderSparks(gRearview_screen, gRearview_depth_buffer, gRearview_camera, &gRearview_camera_to_world, gFrame_period);
 #endif
+        }
         BrZbSceneRenderEnd();
 #ifdef DETHRACE_3DFX_PATCH
         PDLockRealBackScreen(1);
 #endif
         BrMatrix34Copy(&gRearview_camera->t.t.mat, &old_mirror_cam_matrix);
         gRendering_mirror = 0;
+        gMirror_render_time += PDGetTotalTime() - start_time; // added by dethrace
     }
     if (gMap_mode) {
         if (gNet_mode == eNet_mode_none) {
@@ -186,6 +186,12 @@ int ConditionallyFillWithSky(br_pixelmap* pPixelmap);
 
 void RenderAFrame(int pDepth_mask_on);
 
+void ReportRenderStats(void);
+
+void DisposeMapInset(void);
+
+void ForgetMirrorImage(void);
+
 void InitPaletteAnimate(void);
 
 void RevertPalette(void);
@@ -188,6 +188,7 @@ void ReinitialiseForwardCamera(void) {
 void AllocateRearviewPixelmap(void) {
     char* rear_screen_pixels;
 
+    ForgetMirrorImage(); // Added by dethrace
 #ifdef DETHRACE_3DFX_PATCH
     if (gRearview_screen != NULL) {
         BrPixelmapFree(gRearview_screen);
@@ -747,6 +748,9 @@ void LoadInTrack(void) {
 // FUNCTION: CARM95 0x004bc493
 void DisposeTrack(void) {
 
+    ReportRenderStats();  // added by dethrace
+    ReportPhysicsStats(); // added by dethrace
+    DisposeMapInset();    // added by dethrace
     FreeTrack(&gProgram_state.track_spec);
 }
 
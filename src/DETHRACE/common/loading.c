@@ -1176,6 +1176,7 @@ void DisposeCar(tCar_spec* pCar_spec, int pOwner) {
             if (pCar_spec->car_model_actors[i].undamaged_vertices != NULL) {
                 BrMemFree(pCar_spec->car_model_actors[i].undamaged_vertices);
             }
+            DisposeCrushLookup(&pCar_spec->car_model_actors[i]); // added by dethrace
         }
     }
 }
@@ -1761,12 +1762,18 @@ void CloneCar(tCar_spec** pOutput_car, tCar_spec* pInput_car) {
     BrActorAdd(gNon_track_actor, (*pOutput_car)->car_master_actor);
     for (i = 0; i < pInput_car->car_actor_count; i++) {
         (*pOutput_car)->car_model_actors[i].actor = DRActorFindRecurse((*pOutput_car)->car_master_actor, pInput_car->car_model_actors[i].actor->identifier);
+        (*pOutput_car)->car_model_actors[i].crush_lookup = NULL; // added by dethrace
     }
 }
 
 // IDA: void __usercall DisposeClonedCar(tCar_spec *pCar@<EAX>)
 void DisposeClonedCar(tCar_spec* pCar) {
+    int i; // added by dethrace
 
+    // Added by dethrace
+    for (i = 0; i < pCar->car_actor_count; i++) {
+        DisposeCrushLookup(&pCar->car_model_actors[i]);
+    }
     BrActorRemove(pCar->car_master_actor);
     BrActorFree(pCar->car_master_actor);
 }
@@ -2432,6 +2439,7 @@ void LoadCar(char* pCar_name, tDriver pDriver, tCar_spec* pCar_spec, int pOwner,
         } else {
             pCar_spec->car_model_actors[i].undamaged_vertices = NULL;
         }
+        pCar_spec->car_model_actors[i].crush_lookup = NULL; // added by dethrace
     }
     if (pDriver != eDriver_local_human) {
         SkipCrushData(f);
@@ -12,6 +12,7 @@
 #include "globvrpb.h"
 #include "grafdata.h"
 #include "graphics.h"
+#include "harness/config.h"
 #include "harness/trace.h"
 #include "loading.h"
 #include "network.h"
@@ -26,6 +27,7 @@
 #include "structur.h"
 #include "utility.h"
 #include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -83,13 +85,16 @@ void SendCarData(tU32 pNext_frame_time) {
     contents->data.time_sync.race_start_time = gRace_start;
 
     if (gNet_mode == eNet_mode_host) {
+        SendMechanicsAcks(0); // added by dethrace
         for (i = 0; i < gNumber_of_net_players; i++) {
             car = gNet_players[i].car;
             if (car->disabled) {
                 continue;
             }
             damaged_wheels = car->damage_units[eDamage_lf_wheel].damage_level > 30 || car->damage_units[eDamage_rf_wheel].damage_level > 30 || car->damage_units[eDamage_lr_wheel].damage_level > 30 || car->damage_units[eDamage_rr_wheel].damage_level > 30;
-            contents = NetGetBroadcastContents(NETMSGID_MECHANICS, damaged_wheels);
+            // changed by dethrace
+            // contents = NetGetBroadcastContents(NETMSGID_MECHANICS, damaged_wheels);
+            contents = GetMechanicsContents(damaged_wheels, 0);
             GetReducedMatrix(&contents->data.mech.mat, &car->car_master_actor->t.t.mat);
             contents->data.mech.ID = gNet_players[i].ID;
             contents->data.mech.time = pNext_frame_time;
@@ -116,6 +121,7 @@ void SendCarData(tU32 pNext_frame_time) {
                     contents->data.mech.wheel_dam_offset[j] = car->wheel_dam_offset[j];
                 }
             }
+            SendMechanicsContents(contents, damaged_wheels, 0); // added by dethrace
             if (car->time_to_recover != 0) {
                 if (car->time_to_recover - 500 < pNext_frame_time) {
                     contents = NetGetBroadcastContents(NETMSGID_RECOVER, 0);
@@ -152,12 +158,15 @@ void SendCarData(tU32 pNext_frame_time) {
             }
         }
     } else if (gNet_mode == eNet_mode_client) {
+        SendMechanicsAcks(1); // added by dethrace
         car = &gProgram_state.current_car;
         if (car->disabled) {
             return;
         }
         damaged_wheels = car->damage_units[eDamage_lf_wheel].damage_level > 30 || car->damage_units[eDamage_rf_wheel].damage_level > 30 || car->damage_units[eDamage_lr_wheel].damage_level > 30 || car->damage_units[eDamage_rr_wheel].damage_level > 30;
-        contents = NetGetToHostContents(NETMSGID_MECHANICS, damaged_wheels);
+        // changed by dethrace
+        // contents = NetGetToHostContents(NETMSGID_MECHANICS, damaged_wheels);
+        contents = GetMechanicsContents(damaged_wheels, 1);
         GetReducedMatrix(&contents->data.mech.mat, &car->car_master_actor->t.t.mat);
         contents->data.mech.ID = gNet_players[gThis_net_player_index].ID;
         contents->data.mech.time = pNext_frame_time;
@@ -185,6 +194,7 @@ void SendCarData(tU32 pNext_frame_time) {
                 contents->data.mech.wheel_dam_offset[j] = car->wheel_dam_offset[j];
             }
         }
+        SendMechanicsContents(contents, damaged_wheels, 1); // added by dethrace
         if (car->time_to_recover != 0 && car->time_to_recover - 500 < pNext_frame_time) {
             contents = NetGetToHostContents(NETMSGID_RECOVER, 0);
             contents->data.recover.ID = gNet_players[gThis_net_player_index].ID;
@@ -235,7 +245,12 @@ void ReceivedMechanics(tNet_contents* pContents) {
             break;
         }
     }
-    if (car == NULL || car->message.time > pContents->data.mech.time) {
+    // Added by dethrace: buffered cars keep every update the jitter buffer can use, it decides what is stale
+    if (car != NULL && IsNetSnapshotCar(car)) {
+        if (!PushNetSnapshot(pContents)) {
+            return;
+        }
+    } else if (car == NULL || car->message.time > pContents->data.mech.time) {
         return;
     }
     if (car->disabled) {
@@ -1689,10 +1704,18 @@ void SendGameplayToHost(tNet_gameplay_mess pMess, int pParam_1, int pParam_2, in
 // IDA: void __cdecl InitNetGameplayStuff()
 // FUNCTION: CARM95 0x004342a4
 void InitNetGameplayStuff(void) {
+    br_bounds bounds; // added by dethrace
 
     switch (gCurrent_net_game->type) {
         DETHRACE_DEFAULT_BREAK;
     }
+
+    // Added by dethrace: mechanics messages carry positions at physics scale
+    BrActorToBounds(&bounds, gProgram_state.track_spec.the_actor);
+    BrVector3Scale(&bounds.min, &bounds.min, WORLD_SCALE);
+    BrVector3Scale(&bounds.max, &bounds.max, WORLD_SCALE);
+    ResetMechanicsStreams(&bounds);
+    ResetNetSnapshots();
 }
 
 // IDA: void __cdecl DefaultNetName()
@@ -1781,3 +1804,1119 @@ void NetEarnCredits(tNet_game_player_info* pPlayer, tS32 pCredits) {
 
     // empty function
 }
+
+// Added by dethrace: delta/quantised mechanics (NETMSGID_MECHANICS_DELTA).
+//
+// Every sender numbers the snapshots of each car it sends with an 8-bit sequence. Receivers acknowledge
+// what arrived with NETMSGID_MECHANICS_ACK (latest sequence plus a bitmask of the 32 before it) and the
+// sender encodes the next snapshot against the newest one that every receiver of the stream has got. A
+// broadcast stack carries the same bytes to all clients, so the per-receiver acks resolve to one common
+// baseline. Without one (race start, lost acks, baseline older than the history) the snapshot is encoded
+// against an all-zero baseline, which is the full state.
+
+#define MECHANICS_HISTORY 32
+#define MECHANICS_POSITION_BITS 22
+#define MECHANICS_ROTATION_BITS 15
+#define MECHANICS_DELTA_HAS_BASELINE 0x1
+#define MECHANICS_SQRT2 1.41421356f
+
+enum {
+    eMech_changed_position = 1 << 0,
+    eMech_changed_rotation = 1 << 1,
+    eMech_changed_v = 1 << 2,
+    eMech_changed_omega = 1 << 3,
+    eMech_changed_d = 1 << 4,
+    eMech_changed_keys = 1 << 5,
+    eMech_changed_cc_coll_time = 1 << 6,
+    eMech_changed_curvature = 1 << 7,
+    eMech_changed_revs = 1 << 8,
+    eMech_changed_bounds = 1 << 9,
+    eMech_changed_repair_time = 1 << 10,
+    eMech_changed_damage = 1 << 11,
+    eMech_changed_powerups = 1 << 12,
+    eMech_changed_wheel_dam = 1 << 13,
+    eMech_changed_bit_count = 14
+};
+
+typedef struct tMechanics_bits {
+    tU8* data;
+    int size;
+    int pos; // in bits
+    int overflow;
+} tMechanics_bits;
+
+typedef struct tMechanics_history {
+    tMechanics_snapshot snapshot;
+    tU8 seq;
+    int valid;
+} tMechanics_history;
+
+typedef struct tMechanics_receiver {
+    tPlayer_ID ID;
+    tU32 received;
+    tU8 latest;
+    int valid;
+} tMechanics_receiver;
+
+typedef struct tMechanics_stream {
+    tPlayer_ID ID;
+    int in_use;
+    tU8 epoch;
+    tU8 seq;       // sending: next sequence, receiving: latest sequence
+    tU32 received; // receiving: bit n set if seq-1-n arrived as well
+    int ack_pending;
+    tMechanics_receiver receivers[6];
+    tMechanics_history history[MECHANICS_HISTORY];
+} tMechanics_stream;
+
+static tMechanics_stream gMechanics_sent[6];
+static tMechanics_stream gMechanics_received[6];
+static tMechanics_snapshot gMechanics_zero;
+static tNet_contents gMechanics_contents;
+static tU8 gMechanics_epoch;
+static br_bounds gMechanics_bounds = { { { -8192.f, -8192.f, -8192.f } }, { { 8192.f, 8192.f, 8192.f } } };
+
+static void PutMechanicsBits(tMechanics_bits* pBits, tU32 pValue, int pCount) {
+    int i;
+
+    for (i = 0; i < pCount; i++) {
+        if ((pBits->pos >> 3) >= pBits->size) {
+            pBits->overflow = 1;
+            return;
+        }
+        if ((pValue >> i) & 1) {
+            pBits->data[pBits->pos >> 3] |= 1 << (pBits->pos & 7);
+        }
+        pBits->pos++;
+    }
+}
+
+static tU32 GetMechanicsBits(tMechanics_bits* pBits, int pCount) {
+    int i;
+    tU32 value;
+
+    value = 0;
+    for (i = 0; i < pCount; i++) {
+        if ((pBits->pos >> 3) >= pBits->size) {
+            pBits->overflow = 1;
+            return 0;
+        }
+        value |= (tU32)((pBits->data[pBits->pos >> 3] >> (pBits->pos & 7)) & 1) << i;
+        pBits->pos++;
+    }
+    return value;
+}
+
+// Zigzagged difference, prefixed by its length in bits
+static void PutMechanicsDelta(tMechanics_bits* pBits, tU32 pOld, tU32 pNew) {
+    tS32 delta;
+    tU32 zigzag;
+    int length;
+
+    delta = (tS32)(pNew - pOld);
+    zigzag = delta < 0 ? ~((tU32)delta << 1) : (tU32)delta << 1;
+    for (length = 0; length < 32 && (zigzag >> length) != 0; length++) {
+    }
+    PutMechanicsBits(pBits, length, 6);
+    PutMechanicsBits(pBits, zigzag, length);
+}
+
+static tU32 GetMechanicsDelta(tMechanics_bits* pBits, tU32 pOld) {
+    tU32 zigzag;
+    int length;
+
+    length = GetMechanicsBits(pBits, 6);
+    if (length > 32) {
+        pBits->overflow = 1;
+        return pOld;
+    }
+    zigzag = GetMechanicsBits(pBits, length);
+    return pOld + ((zigzag & 1) ? ~(zigzag >> 1) : zigzag >> 1);
+}
+
+// Round to nearest even; out of range values saturate instead of becoming infinities
+static tU16 FloatToHalf(float pValue) {
+    union {
+        float f;
+        tU32 u;
+    } f, denorm_magic;
+    tU32 sign;
+    tU32 mant_odd;
+    tU16 h;
+
+    denorm_magic.u = ((127 - 15) + (23 - 10) + 1) << 23;
+    f.f = pValue;
+    sign = f.u & 0x80000000;
+    f.u ^= sign;
+    if (f.u > (255 << 23)) {
+        return 0;
+    }
+    if (f.u >= (143 << 23) - (1 << 12)) {
+        h = 0x7bff;
+    } else if (f.u < (113 << 23)) {
+        f.f += denorm_magic.f;
+        h = f.u - denorm_magic.u;
+    } else {
+        mant_odd = (f.u >> 13) & 1;
+        f.u -= (127 - 15) << 23;
+        f.u += 0xfff + mant_odd;
+        h = f.u >> 13;
+    }
+    return h | (sign >> 16);
+}
+
+static float HalfToFloat(tU16 pValue) {
+    union {
+        float f;
+        tU32 u;
+    } f, magic;
+
+    magic.u = 113 << 23;
+    f.u = (pValue & 0x7fff) << 13;
+    if ((f.u & (0x7c00 << 13)) == 0) {
+        f.u += 1 << 23;
+        f.u += (127 - 15) << 23;
+        f.f -= magic.f;
+    } else {
+        f.u += (127 - 15) << 23;
+    }
+    f.u |= (tU32)(pValue & 0x8000) << 16;
+    return f.f;
+}
+
+static tU32 QuantiseMechanicsPosition(br_scalar pValue, int pAxis) {
+    double f;
+    tU32 steps;
+
+    steps = (1 << MECHANICS_POSITION_BITS) - 1;
+    f = (pValue - gMechanics_bounds.min.v[pAxis]) / (gMechanics_bounds.max.v[pAxis] - gMechanics_bounds.min.v[pAxis]) * steps;
+    if (!(f > 0.)) {
+        return 0;
+    }
+    if (f >= steps) {
+        return steps;
+    }
+    return (tU32)(f + .5);
+}
+
+static br_scalar ExpandMechanicsPosition(tU32 pValue, int pAxis) {
+
+    return gMechanics_bounds.min.v[pAxis] + (double)pValue * (gMechanics_bounds.max.v[pAxis] - gMechanics_bounds.min.v[pAxis]) / ((1 << MECHANICS_POSITION_BITS) - 1);
+}
+
+// Smallest three: the largest quaternion component is implied by the other three, which lie within +/-1/sqrt(2)
+static void QuantiseMechanicsRotation(tMechanics_snapshot* pSnapshot, tReduced_matrix* pMat) {
+    br_scalar m[3][3];
+    br_scalar q[4];
+    br_scalar s;
+    br_scalar f;
+    int largest;
+    int i;
+    int j;
+
+    for (i = 0; i < 3; i++) {
+        m[0][i] = pMat->row1.v[i];
+        m[1][i] = pMat->row2.v[i];
+    }
+    m[2][0] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    m[2][1] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    s = m[0][0] + m[1][1] + m[2][2];
+    if (s > 0.f) {
+        s = sqrtf(s + 1.f) * 2.f;
+        q[0] = (m[2][1] - m[1][2]) / s;
+        q[1] = (m[0][2] - m[2][0]) / s;
+        q[2] = (m[1][0] - m[0][1]) / s;
+        q[3] = s / 4.f;
+    } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+        s = sqrtf(MAX(1.f + m[0][0] - m[1][1] - m[2][2], 1e-6f)) * 2.f;
+        q[0] = s / 4.f;
+        q[1] = (m[0][1] + m[1][0]) / s;
+        q[2] = (m[0][2] + m[2][0]) / s;
+        q[3] = (m[2][1] - m[1][2]) / s;
+    } else if (m[1][1] > m[2][2]) {
+        s = sqrtf(MAX(1.f + m[1][1] - m[0][0] - m[2][2], 1e-6f)) * 2.f;
+        q[0] = (m[0][1] + m[1][0]) / s;
+        q[1] = s / 4.f;
+        q[2] = (m[1][2] + m[2][1]) / s;
+        q[3] = (m[0][2] - m[2][0]) / s;
+    } else {
+        s = sqrtf(MAX(1.f + m[2][2] - m[0][0] - m[1][1], 1e-6f)) * 2.f;
+        q[0] = (m[0][2] + m[2][0]) / s;
+        q[1] = (m[1][2] + m[2][1]) / s;
+        q[2] = s / 4.f;
+        q[3] = (m[1][0] - m[0][1]) / s;
+    }
+    largest = 0;
+    for (i = 1; i < 4; i++) {
+        if (fabsf(q[i]) > fabsf(q[largest])) {
+            largest = i;
+        }
+    }
+    s = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (q[largest] < 0.f) {
+        s = -s;
+    }
+    pSnapshot->rotation_largest = largest;
+    for (i = 0, j = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        f = (q[i] / s * MECHANICS_SQRT2 + 1.f) / 2.f * ((1 << MECHANICS_ROTATION_BITS) - 1) + .5f;
+        pSnapshot->rotation[j++] = (tU16)CONSTRAIN_BETWEEN(0.f, (br_scalar)((1 << MECHANICS_ROTATION_BITS) - 1), f);
+    }
+}
+
+static void ExpandMechanicsRotation(tReduced_matrix* pMat, tMechanics_snapshot* pSnapshot) {
+    br_scalar q[4];
+    br_scalar sum;
+    int i;
+    int j;
+
+    sum = 0.f;
+    for (i = 0, j = 0; i < 4; i++) {
+        if (i == pSnapshot->rotation_largest) {
+            continue;
+        }
+        q[i] = (pSnapshot->rotation[j++] * 2.f / ((1 << MECHANICS_ROTATION_BITS) - 1) - 1.f) / MECHANICS_SQRT2;
+        sum += q[i] * q[i];
+    }
+    q[pSnapshot->rotation_largest] = sqrtf(MAX(1.f - sum, 0.f));
+    pMat->row1.v[0] = 1.f - 2.f * (q[1] * q[1] + q[2] * q[2]);
+    pMat->row1.v[1] = 2.f * (q[0] * q[1] - q[2] * q[3]);
+    pMat->row1.v[2] = 2.f * (q[0] * q[2] + q[1] * q[3]);
+    pMat->row2.v[0] = 2.f * (q[0] * q[1] + q[2] * q[3]);
+    pMat->row2.v[1] = 1.f - 2.f * (q[0] * q[0] + q[2] * q[2]);
+    pMat->row2.v[2] = 2.f * (q[1] * q[2] - q[0] * q[3]);
+}
+
+void QuantiseMechanics(tMechanics_snapshot* pSnapshot, tNet_message_mechanics_info* pMech, int pDamaged_wheels) {
+    int i;
+
+    memset(pSnapshot, 0, sizeof(*pSnapshot));
+    pSnapshot->time = pMech->time;
+    for (i = 0; i < 3; i++) {
+        pSnapshot->position[i] = QuantiseMechanicsPosition(pMech->mat.translation.v[i], i);
+        pSnapshot->v[i] = FloatToHalf(pMech->v.v[i]);
+        pSnapshot->omega[i] = FloatToHalf(pMech->omega.v[i]);
+    }
+    QuantiseMechanicsRotation(pSnapshot, &pMech->mat);
+    memcpy(pSnapshot->d, pMech->d, sizeof(pSnapshot->d));
+    memcpy(&pSnapshot->keys, &pMech->keys, sizeof(pSnapshot->keys));
+    pSnapshot->cc_coll_time = pMech->cc_coll_time;
+    pSnapshot->curvature = pMech->curvature;
+    pSnapshot->revs = pMech->revs;
+    pSnapshot->front = pMech->front;
+    pSnapshot->back = pMech->back;
+    pSnapshot->repair_time = pMech->repair_time;
+    memcpy(pSnapshot->damage, pMech->damage, sizeof(pSnapshot->damage));
+    pSnapshot->powerups = pMech->powerups;
+    pSnapshot->damaged_wheels = pDamaged_wheels != 0;
+    if (pSnapshot->damaged_wheels) {
+        memcpy(pSnapshot->wheel_dam_offset, pMech->wheel_dam_offset, sizeof(pSnapshot->wheel_dam_offset));
+    }
+}
+
+int ExpandMechanics(tNet_message_mechanics_info* pMech, tMechanics_snapshot* pSnapshot) {
+    int i;
+
+    pMech->time = pSnapshot->time;
+    for (i = 0; i < 3; i++) {
+        pMech->mat.translation.v[i] = ExpandMechanicsPosition(pSnapshot->position[i], i);
+        pMech->v.v[i] = HalfToFloat(pSnapshot->v[i]);
+        pMech->omega.v[i] = HalfToFloat(pSnapshot->omega[i]);
+    }
+    ExpandMechanicsRotation(&pMech->mat, pSnapshot);
+    memcpy(pMech->d, pSnapshot->d, sizeof(pMech->d));
+    memcpy(&pMech->keys, &pSnapshot->keys, sizeof(pSnapshot->keys));
+    pMech->cc_coll_time = pSnapshot->cc_coll_time;
+    pMech->curvature = pSnapshot->curvature;
+    pMech->revs = pSnapshot->revs;
+    pMech->front = pSnapshot->front;
+    pMech->back = pSnapshot->back;
+    pMech->repair_time = pSnapshot->repair_time;
+    memcpy(pMech->damage, pSnapshot->damage, sizeof(pMech->damage));
+    pMech->powerups = pSnapshot->powerups;
+    memcpy(pMech->wheel_dam_offset, pSnapshot->wheel_dam_offset, sizeof(pMech->wheel_dam_offset));
+    return pSnapshot->damaged_wheels;
+}
+
+int EncodeMechanicsDelta(tU8* pData, int pSize, tMechanics_snapshot* pSnapshot, tMechanics_snapshot* pBaseline) {
+    tMechanics_bits bits;
+    tU32 changed;
+    tU32 damage_changed;
+    tU32 u;
+    int i;
+
+    if (pBaseline == NULL) {
+        pBaseline = &gMechanics_zero;
+    }
+    memset(pData, 0, pSize);
+    bits.data = pData;
+    bits.size = pSize;
+    bits.pos = 0;
+    bits.overflow = 0;
+
+    changed = 0;
+    if (memcmp(pSnapshot->position, pBaseline->position, sizeof(pSnapshot->position)) != 0) {
+        changed |= eMech_changed_position;
+    }
+    if (pSnapshot->rotation_largest != pBaseline->rotation_largest || memcmp(pSnapshot->rotation, pBaseline->rotation, sizeof(pSnapshot->rotation)) != 0) {
+        changed |= eMech_changed_rotation;
+    }
+    if (memcmp(pSnapshot->v, pBaseline->v, sizeof(pSnapshot->v)) != 0) {
+        changed |= eMech_changed_v;
+    }
+    if (memcmp(pSnapshot->omega, pBaseline->omega, sizeof(pSnapshot->omega)) != 0) {
+        changed |= eMech_changed_omega;
+    }
+    if (memcmp(pSnapshot->d, pBaseline->d, sizeof(pSnapshot->d)) != 0) {
+        changed |= eMech_changed_d;
+    }
+    if (pSnapshot->keys != pBaseline->keys) {
+        changed |= eMech_changed_keys;
+    }
+    if (pSnapshot->cc_coll_time != pBaseline->cc_coll_time) {
+        changed |= eMech_changed_cc_coll_time;
+    }
+    if (pSnapshot->curvature != pBaseline->curvature) {
+        changed |= eMech_changed_curvature;
+    }
+    if (pSnapshot->revs != pBaseline->revs) {
+        changed |= eMech_changed_revs;
+    }
+    if (memcmp(&pSnapshot->front, &pBaseline->front, sizeof(pSnapshot->front)) != 0 || memcmp(&pSnapshot->back, &pBaseline->back, sizeof(pSnapshot->back)) != 0) {
+        changed |= eMech_changed_bounds;
+    }
+    if (pSnapshot->repair_time != pBaseline->repair_time) {
+        changed |= eMech_changed_repair_time;
+    }
+    damage_changed = 0;
+    for (i = 0; i < COUNT_OF(pSnapshot->damage); i++) {
+        if (pSnapshot->damage[i] != pBaseline->damage[i]) {
+            damage_changed |= 1 << i;
+        }
+    }
+    if (damage_changed != 0) {
+        changed |= eMech_changed_damage;
+    }
+    if (pSnapshot->powerups != pBaseline->powerups) {
+        changed |= eMech_changed_powerups;
+    }
+    if (pSnapshot->damaged_wheels && (!pBaseline->damaged_wheels || memcmp(pSnapshot->wheel_dam_offset, pBaseline->wheel_dam_offset, sizeof(pSnapshot->wheel_dam_offset)) != 0)) {
+        changed |= eMech_changed_wheel_dam;
+    }
+
+    PutMechanicsBits(&bits, pSnapshot->damaged_wheels, 1);
+    PutMechanicsBits(&bits, changed, eMech_changed_bit_count);
+    PutMechanicsDelta(&bits, pBaseline->time, pSnapshot->time);
+    if (changed & eMech_changed_position) {
+        for (i = 0; i < COUNT_OF(pSnapshot->position); i++) {
+            PutMechanicsDelta(&bits, pBaseline->position[i], pSnapshot->position[i]);
+        }
+    }
+    if (changed & eMech_changed_rotation) {
+        PutMechanicsBits(&bits, pSnapshot->rotation_largest, 2);
+        for (i = 0; i < COUNT_OF(pSnapshot->rotation); i++) {
+            PutMechanicsBits(&bits, pSnapshot->rotation[i], MECHANICS_ROTATION_BITS);
+        }
+    }
+    if (changed & eMech_changed_v) {
+        for (i = 0; i < COUNT_OF(pSnapshot->v); i++) {
+            PutMechanicsBits(&bits, pSnapshot->v[i], 16);
+        }
+    }
+    if (changed & eMech_changed_omega) {
+        for (i = 0; i < COUNT_OF(pSnapshot->omega); i++) {
+            PutMechanicsBits(&bits, pSnapshot->omega[i], 16);
+        }
+    }
+    if (changed & eMech_changed_d) {
+        for (i = 0; i < COUNT_OF(pSnapshot->d); i++) {
+            PutMechanicsBits(&bits, pSnapshot->d[i], 8);
+        }
+    }
+    if (changed & eMech_changed_keys) {
+        PutMechanicsBits(&bits, pSnapshot->keys, 32);
+    }
+    if (changed & eMech_changed_cc_coll_time) {
+        PutMechanicsDelta(&bits, pBaseline->cc_coll_time, pSnapshot->cc_coll_time);
+    }
+    if (changed & eMech_changed_curvature) {
+        PutMechanicsBits(&bits, (tU16)pSnapshot->curvature, 16);
+    }
+    if (changed & eMech_changed_revs) {
+        PutMechanicsDelta(&bits, pBaseline->revs, pSnapshot->revs);
+    }
+    if (changed & eMech_changed_bounds) {
+        memcpy(&u, &pSnapshot->front, sizeof(u));
+        PutMechanicsBits(&bits, u, 32);
+        memcpy(&u, &pSnapshot->back, sizeof(u));
+        PutMechanicsBits(&bits, u, 32);
+    }
+    if (changed & eMech_changed_repair_time) {
+        PutMechanicsDelta(&bits, pBaseline->repair_time, pSnapshot->repair_time);
+    }
+    if (changed & eMech_changed_damage) {
+        PutMechanicsBits(&bits, damage_changed, COUNT_OF(pSnapshot->damage));
+        for (i = 0; i < COUNT_OF(pSnapshot->damage); i++) {
+            if (damage_changed & (1 << i)) {
+                PutMechanicsBits(&bits, pSnapshot->damage[i], 8);
+            }
+        }
+    }
+    if (changed & eMech_changed_powerups) {
+        PutMechanicsBits(&bits, pSnapshot->powerups, 16);
+    }
+    if (changed & eMech_changed_wheel_dam) {
+        for (i = 0; i < COUNT_OF(pSnapshot->wheel_dam_offset); i++) {
+            memcpy(&u, &pSnapshot->wheel_dam_offset[i], sizeof(u));
+            PutMechanicsBits(&bits, u, 32);
+        }
+    }
+    if (bits.overflow) {
+        return -1;
+    }
+    return (bits.pos + 7) >> 3;
+}
+
+int DecodeMechanicsDelta(tMechanics_snapshot* pSnapshot, tU8* pData, int pSize, tMechanics_snapshot* pBaseline) {
+    tMechanics_bits bits;
+    tU32 changed;
+    tU32 damage_changed;
+    tU32 u;
+    int i;
+
+    if (pBaseline == NULL) {
+        pBaseline = &gMechanics_zero;
+    }
+    *pSnapshot = *pBaseline;
+    bits.data = pData;
+    bits.size = pSize;
+    bits.pos = 0;
+    bits.overflow = 0;
+
+    pSnapshot->damaged_wheels = GetMechanicsBits(&bits, 1);
+    changed = GetMechanicsBits(&bits, eMech_changed_bit_count);
+    pSnapshot->time = GetMechanicsDelta(&bits, pBaseline->time);
+    if (changed & eMech_changed_position) {
+        for (i = 0; i < COUNT_OF(pSnapshot->position); i++) {
+            pSnapshot->position[i] = GetMechanicsDelta(&bits, pBaseline->position[i]) & ((1 << MECHANICS_POSITION_BITS) - 1);
+        }
+    }
+    if (changed & eMech_changed_rotation) {
+        pSnapshot->rotation_largest = GetMechanicsBits(&bits, 2);
+        for (i = 0; i < COUNT_OF(pSnapshot->rotation); i++) {
+            pSnapshot->rotation[i] = GetMechanicsBits(&bits, MECHANICS_ROTATION_BITS);
+        }
+    }
+    if (changed & eMech_changed_v) {
+        for (i = 0; i < COUNT_OF(pSnapshot->v); i++) {
+            pSnapshot->v[i] = GetMechanicsBits(&bits, 16);
+        }
+    }
+    if (changed & eMech_changed_omega) {
+        for (i = 0; i < COUNT_OF(pSnapshot->omega); i++) {
+            pSnapshot->omega[i] = GetMechanicsBits(&bits, 16);
+        }
+    }
+    if (changed & eMech_changed_d) {
+        for (i = 0; i < COUNT_OF(pSnapshot->d); i++) {
+            pSnapshot->d[i] = GetMechanicsBits(&bits, 8);
+        }
+    }
+    if (changed & eMech_changed_keys) {
+        pSnapshot->keys = GetMechanicsBits(&bits, 32);
+    }
+    if (changed & eMech_changed_cc_coll_time) {
+        pSnapshot->cc_coll_time = GetMechanicsDelta(&bits, pBaseline->cc_coll_time);
+    }
+    if (changed & eMech_changed_curvature) {
+        pSnapshot->curvature = (tS16)GetMechanicsBits(&bits, 16);
+    }
+    if (changed & eMech_changed_revs) {
+        pSnapshot->revs = GetMechanicsDelta(&bits, pBaseline->revs);
+    }
+    if (changed & eMech_changed_bounds) {
+        u = GetMechanicsBits(&bits, 32);
+        memcpy(&pSnapshot->front, &u, sizeof(u));
+        u = GetMechanicsBits(&bits, 32);
+        memcpy(&pSnapshot->back, &u, sizeof(u));
+    }
+    if (changed & eMech_changed_repair_time) {
+        pSnapshot->repair_time = GetMechanicsDelta(&bits, pBaseline->repair_time);
+    }
+    if (changed & eMech_changed_damage) {
+        damage_changed = GetMechanicsBits(&bits, COUNT_OF(pSnapshot->damage));
+        for (i = 0; i < COUNT_OF(pSnapshot->damage); i++) {
+            if (damage_changed & (1 << i)) {
+                pSnapshot->damage[i] = GetMechanicsBits(&bits, 8);
+            }
+        }
+    }
+    if (changed & eMech_changed_powerups) {
+        pSnapshot->powerups = GetMechanicsBits(&bits, 16);
+    }
+    if (changed & eMech_changed_wheel_dam) {
+        for (i = 0; i < COUNT_OF(pSnapshot->wheel_dam_offset); i++) {
+            u = GetMechanicsBits(&bits, 32);
+            memcpy(&pSnapshot->wheel_dam_offset[i], &u, sizeof(u));
+        }
+    }
+    if (!pSnapshot->damaged_wheels) {
+        memset(pSnapshot->wheel_dam_offset, 0, sizeof(pSnapshot->wheel_dam_offset));
+    }
+    return !bits.overflow;
+}
+
+static tMechanics_stream* GetMechanicsStream(tMechanics_stream* pStreams, tPlayer_ID pID, int pCreate) {
+    tMechanics_stream* stream;
+    int i;
+
+    for (i = 0; i < COUNT_OF(gMechanics_sent); i++) {
+        if (pStreams[i].in_use && pStreams[i].ID == pID) {
+            return &pStreams[i];
+        }
+    }
+    if (!pCreate) {
+        return NULL;
+    }
+    stream = NULL;
+    for (i = 0; i < COUNT_OF(gMechanics_sent) && stream == NULL; i++) {
+        if (!pStreams[i].in_use) {
+            stream = &pStreams[i];
+        }
+    }
+    // take over the stream of a player who left
+    for (i = 0; i < COUNT_OF(gMechanics_sent) && stream == NULL; i++) {
+        if (!PlayerIsInList(pStreams[i].ID)) {
+            stream = &pStreams[i];
+        }
+    }
+    if (stream == NULL) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->in_use = 1;
+    stream->ID = pID;
+    stream->epoch = gMechanics_epoch;
+    return stream;
+}
+
+static tMechanics_receiver* GetMechanicsReceiver(tMechanics_stream* pStream, tPlayer_ID pID, int pCreate) {
+    int i;
+
+    for (i = 0; i < COUNT_OF(pStream->receivers); i++) {
+        if (pStream->receivers[i].valid && pStream->receivers[i].ID == pID) {
+            return &pStream->receivers[i];
+        }
+    }
+    if (!pCreate) {
+        return NULL;
+    }
+    for (i = 0; i < COUNT_OF(pStream->receivers); i++) {
+        if (!pStream->receivers[i].valid || !PlayerIsInList(pStream->receivers[i].ID)) {
+            pStream->receivers[i].valid = 0;
+            pStream->receivers[i].ID = pID;
+            return &pStream->receivers[i];
+        }
+    }
+    return NULL;
+}
+
+static int MechanicsSnapshotAcked(tMechanics_stream* pStream, tU8 pSeq, int pTo_host) {
+    tMechanics_receiver* receiver;
+    int receivers;
+    int i;
+    tU8 age;
+
+    receivers = 0;
+    for (i = 0; i < gNumber_of_net_players; i++) {
+        if (i == gThis_net_player_index || (pTo_host && !gNet_players[i].host)) {
+            continue;
+        }
+        receiver = GetMechanicsReceiver(pStream, gNet_players[i].ID, 0);
+        if (receiver == NULL) {
+            return 0;
+        }
+        age = receiver->latest - pSeq;
+        if (age != 0 && (age > 32 || ((receiver->received >> (age - 1)) & 1) == 0)) {
+            return 0;
+        }
+        receivers++;
+    }
+    return receivers != 0;
+}
+
+static tMechanics_history* ChooseMechanicsBaseline(tMechanics_stream* pStream, int pTo_host) {
+    tMechanics_history* history;
+    int age;
+    tU8 seq;
+
+    for (age = 1; age <= MECHANICS_HISTORY; age++) {
+        seq = pStream->seq - age;
+        history = &pStream->history[seq % MECHANICS_HISTORY];
+        if (!history->valid || history->seq != seq) {
+            return NULL;
+        }
+        if (MechanicsSnapshotAcked(pStream, seq, pTo_host)) {
+            return history;
+        }
+    }
+    return NULL;
+}
+
+void ResetMechanicsStreams(br_bounds* pTrack_bounds) {
+    br_scalar margin;
+    int i;
+
+    memset(gMechanics_sent, 0, sizeof(gMechanics_sent));
+    memset(gMechanics_received, 0, sizeof(gMechanics_received));
+    gMechanics_epoch++;
+    // cars can leave the track bounds a bit, by jumping or being shunted
+    margin = MAX(pTrack_bounds->max.v[0] - pTrack_bounds->min.v[0], pTrack_bounds->max.v[2] - pTrack_bounds->min.v[2]) / 2.f;
+    margin = MAX(margin, 1.f);
+    for (i = 0; i < 3; i++) {
+        gMechanics_bounds.min.v[i] = pTrack_bounds->min.v[i] - margin;
+        gMechanics_bounds.max.v[i] = pTrack_bounds->max.v[i] + margin;
+    }
+}
+
+tNet_contents* GetMechanicsContents(int pDamaged_wheels, int pTo_host) {
+
+    if (!harness_game_config.net_delta_mechanics) {
+        if (pTo_host) {
+            return NetGetToHostContents(NETMSGID_MECHANICS, pDamaged_wheels);
+        }
+        return NetGetBroadcastContents(NETMSGID_MECHANICS, pDamaged_wheels);
+    }
+    memset(&gMechanics_contents, 0, sizeof(gMechanics_contents));
+    gMechanics_contents.header.type = NETMSGID_MECHANICS;
+    gMechanics_contents.header.contents_size = NetGetContentsSize(NETMSGID_MECHANICS, pDamaged_wheels);
+    return &gMechanics_contents;
+}
+
+void SendMechanicsContents(tNet_contents* pContents, int pDamaged_wheels, int pTo_host) {
+    tMechanics_stream* stream;
+    tMechanics_history* baseline;
+    tMechanics_history* history;
+    tMechanics_snapshot snapshot;
+    tNet_contents* contents;
+    tU8 data[MECHANICS_DELTA_DATA_SIZE];
+    int size;
+
+    if (pContents != &gMechanics_contents) {
+        // already on the message stack
+        return;
+    }
+    stream = GetMechanicsStream(gMechanics_sent, pContents->data.mech.ID, 1);
+    QuantiseMechanics(&snapshot, &pContents->data.mech, pDamaged_wheels);
+    baseline = stream != NULL ? ChooseMechanicsBaseline(stream, pTo_host) : NULL;
+    size = EncodeMechanicsDelta(data, sizeof(data), &snapshot, baseline != NULL ? &baseline->snapshot : NULL);
+    if (stream == NULL || size < 0) {
+        contents = pTo_host ? NetGetToHostContents(NETMSGID_MECHANICS, pDamaged_wheels) : NetGetBroadcastContents(NETMSGID_MECHANICS, pDamaged_wheels);
+        memcpy(contents, pContents, pContents->header.contents_size);
+        return;
+    }
+    contents = pTo_host ? NetGetToHostContents(NETMSGID_MECHANICS_DELTA, size) : NetGetBroadcastContents(NETMSGID_MECHANICS_DELTA, size);
+    contents->data.mech_delta.seq = stream->seq;
+    contents->data.mech_delta.baseline = baseline != NULL ? baseline->seq : 0;
+    contents->data.mech_delta.ID = pContents->data.mech.ID;
+    contents->data.mech_delta.epoch = stream->epoch;
+    contents->data.mech_delta.flags = baseline != NULL ? MECHANICS_DELTA_HAS_BASELINE : 0;
+    memcpy(contents->data.mech_delta.data, data, size);
+
+    history = &stream->history[stream->seq % MECHANICS_HISTORY];
+    history->snapshot = snapshot;
+    history->seq = stream->seq;
+    history->valid = 1;
+    stream->seq++;
+}
+
+void SendMechanicsAcks(int pTo_host) {
+    tNet_contents* contents;
+    tMechanics_stream* stream;
+    int pending;
+    int i;
+
+    pending = 0;
+    for (i = 0; i < COUNT_OF(gMechanics_received); i++) {
+        pending |= gMechanics_received[i].in_use && gMechanics_received[i].ack_pending;
+    }
+    if (!pending) {
+        return;
+    }
+    contents = pTo_host ? NetGetToHostContents(NETMSGID_MECHANICS_ACK, 0) : NetGetBroadcastContents(NETMSGID_MECHANICS_ACK, 0);
+    contents->data.mech_ack.count = 0;
+    for (i = 0; i < COUNT_OF(gMechanics_received); i++) {
+        stream = &gMechanics_received[i];
+        if (!stream->in_use) {
+            continue;
+        }
+        contents->data.mech_ack.acks[contents->data.mech_ack.count].ID = stream->ID;
+        contents->data.mech_ack.acks[contents->data.mech_ack.count].received = stream->received;
+        contents->data.mech_ack.acks[contents->data.mech_ack.count].latest = stream->seq;
+        contents->data.mech_ack.acks[contents->data.mech_ack.count].epoch = stream->epoch;
+        contents->data.mech_ack.count++;
+        stream->ack_pending = 0;
+    }
+}
+
+void ReceivedMechanicsDelta(tNet_contents* pContents) {
+    tNet_message_mechanics_delta* delta;
+    tMechanics_stream* stream;
+    tMechanics_history* baseline;
+    tMechanics_history* history;
+    tMechanics_snapshot snapshot;
+    tNet_contents contents;
+    int received_any;
+    int age;
+
+    delta = &pContents->data.mech_delta;
+    stream = GetMechanicsStream(gMechanics_received, delta->ID, 1);
+    if (stream == NULL) {
+        return;
+    }
+    if (stream->epoch != delta->epoch) {
+        memset(stream->history, 0, sizeof(stream->history));
+        stream->epoch = delta->epoch;
+        stream->ack_pending = 0;
+        stream->received = 0;
+    }
+    received_any = stream->history[stream->seq % MECHANICS_HISTORY].valid;
+    age = (tS8)(tU8)(delta->seq - stream->seq);
+    if (received_any && age <= -MECHANICS_HISTORY) {
+        // would overwrite a newer snapshot in the history
+        return;
+    }
+    baseline = NULL;
+    if (delta->flags & MECHANICS_DELTA_HAS_BASELINE) {
+        baseline = &stream->history[delta->baseline % MECHANICS_HISTORY];
+        if (!baseline->valid || baseline->seq != delta->baseline) {
+            return;
+        }
+    }
+    if (!DecodeMechanicsDelta(&snapshot, delta->data, pContents->header.contents_size - offsetof(tNet_message_mechanics_delta, data), baseline != NULL ? &baseline->snapshot : NULL)) {
+        return;
+    }
+    if (!received_any) {
+        stream->seq = delta->seq;
+        stream->received = 0;
+    } else if (age > 0) {
+        stream->received = age >= 32 ? 0 : stream->received << age;
+        if (age <= 32) {
+            stream->received |= 1u << (age - 1);
+        }
+        stream->seq = delta->seq;
+    } else if (age < 0) {
+        stream->received |= 1u << (-age - 1);
+    }
+    history = &stream->history[delta->seq % MECHANICS_HISTORY];
+    history->snapshot = snapshot;
+    history->seq = delta->seq;
+    history->valid = 1;
+    stream->ack_pending = 1;
+
+    memset(&contents, 0, sizeof(contents));
+    contents.header.type = NETMSGID_MECHANICS;
+    contents.header.contents_size = NetGetContentsSize(NETMSGID_MECHANICS, ExpandMechanics(&contents.data.mech, &snapshot));
+    contents.data.mech.ID = delta->ID;
+    ReceivedMechanics(&contents);
+}
+
+void ReceivedMechanicsAck(tNet_contents* pContents, tNet_message* pMessage) {
+    tNet_mechanics_ack* ack;
+    tMechanics_stream* stream;
+    tMechanics_receiver* receiver;
+    int i;
+    tU8 age;
+
+    for (i = 0; i < pContents->data.mech_ack.count && i < COUNT_OF(pContents->data.mech_ack.acks); i++) {
+        ack = &pContents->data.mech_ack.acks[i];
+        stream = GetMechanicsStream(gMechanics_sent, ack->ID, 0);
+        if (stream == NULL || stream->epoch != ack->epoch) {
+            continue;
+        }
+        // must be a sequence we sent
+        age = stream->seq - ack->latest;
+        if (age == 0 || age > 128) {
+            continue;
+        }
+        receiver = GetMechanicsReceiver(stream, pMessage->sender, 1);
+        if (receiver == NULL || (receiver->valid && (tS8)(tU8)(ack->latest - receiver->latest) < 0)) {
+            continue;
+        }
+        receiver->latest = ack->latest;
+        receiver->received = ack->received;
+        receiver->valid = 1;
+    }
+}
+
+// Added by dethrace: jitter buffer for remote cars (client, --net-interpolation).
+//
+// The original client snaps a remote car to each mechanics message in the physics step that contains its
+// time and dead reckons it in between, so a late message is a jump and a lost one is a longer guess. With
+// the buffer every message is queued by its race time and the car is played out a little behind the clock,
+// interpolating between the two snapshots around the render time. The playout delay follows the measured
+// transit time, send interval and jitter, and slides by at most 10% of real time so nothing visibly speeds
+// up or slows down. Past the newest snapshot the car is extrapolated along its velocity for a short while.
+
+static tNet_snapshot_buffer gNet_snapshot_buffers[6];
+
+static void LogNetSnapshotStats(tNet_snapshot_buffer* pBuffer) {
+
+    if (pBuffer->received != 0) {
+        dr_dprintf("Snapshots for player %u: %d received, %d late, %d duplicates, %d extrapolated, %d corrections",
+            pBuffer->ID, pBuffer->received, pBuffer->late, pBuffer->duplicates, pBuffer->extrapolated, pBuffer->corrections);
+    }
+}
+
+void NetSnapshotReset(tNet_snapshot_buffer* pBuffer) {
+
+    memset(pBuffer, 0, sizeof(*pBuffer));
+}
+
+// Returns 1 when pMech is the newest snapshot of the buffer
+int NetSnapshotPush(tNet_snapshot_buffer* pBuffer, tNet_message_mechanics_info* pMech, tU32 pArrival_time) {
+    float transit;
+    float gap;
+    int newest;
+    int i;
+
+    pBuffer->received++;
+    transit = (float)(tS32)(pArrival_time - pMech->time);
+    if (!pBuffer->have_timing) {
+        pBuffer->transit = transit;
+        pBuffer->jitter = 0.f;
+        pBuffer->have_timing = 1;
+    } else {
+        pBuffer->jitter += ((float)fabs(transit - pBuffer->last_transit) - pBuffer->jitter) / 16.f;
+        pBuffer->transit += (transit - pBuffer->transit) / 16.f;
+    }
+    pBuffer->last_transit = transit;
+
+    for (i = pBuffer->count; i > 0 && (tS32)(pBuffer->snapshots[i - 1].time - pMech->time) > 0; i--) {
+    }
+    if (i > 0 && pBuffer->snapshots[i - 1].time == pMech->time) {
+        pBuffer->duplicates++;
+        return 0;
+    }
+    // only the newest snapshot is any use once it is behind the playout clock
+    if ((i == 0 && pBuffer->count == COUNT_OF(pBuffer->snapshots))
+        || (i < pBuffer->count && pBuffer->have_sample && (tS32)(pMech->time - pBuffer->last_render_time) <= 0)) {
+        pBuffer->late++;
+        return 0;
+    }
+    newest = i == pBuffer->count;
+    if (newest && pBuffer->count != 0) {
+        gap = (float)(tS32)(pMech->time - pBuffer->snapshots[pBuffer->count - 1].time);
+        if (pBuffer->interval == 0.f) {
+            pBuffer->interval = gap;
+        } else {
+            pBuffer->interval += (gap - pBuffer->interval) / 8.f;
+        }
+    }
+    if (pBuffer->count == COUNT_OF(pBuffer->snapshots)) {
+        memmove(&pBuffer->snapshots[0], &pBuffer->snapshots[1], (pBuffer->count - 1) * sizeof(pBuffer->snapshots[0]));
+        pBuffer->count--;
+        i--;
+    }
+    memmove(&pBuffer->snapshots[i + 1], &pBuffer->snapshots[i], (pBuffer->count - i) * sizeof(pBuffer->snapshots[0]));
+    pBuffer->snapshots[i] = *pMech;
+    pBuffer->count++;
+    return newest;
+}
+
+static void LerpNetSnapshotVector(br_vector3* pResult, br_vector3* pFrom, br_vector3* pTo, float pAlpha) {
+
+    pResult->v[0] = pFrom->v[0] + (pTo->v[0] - pFrom->v[0]) * pAlpha;
+    pResult->v[1] = pFrom->v[1] + (pTo->v[1] - pFrom->v[1]) * pAlpha;
+    pResult->v[2] = pFrom->v[2] + (pTo->v[2] - pFrom->v[2]) * pAlpha;
+}
+
+static void InterpolateNetSnapshots(tNet_message_mechanics_info* pMech, tNet_message_mechanics_info* pFrom, tNet_message_mechanics_info* pTo, float pAlpha) {
+    br_vector3 tv;
+    int j;
+
+    *pMech = *pFrom;
+    LerpNetSnapshotVector(&pMech->mat.translation, &pFrom->mat.translation, &pTo->mat.translation, pAlpha);
+    LerpNetSnapshotVector(&pMech->v, &pFrom->v, &pTo->v, pAlpha);
+    LerpNetSnapshotVector(&pMech->omega, &pFrom->omega, &pTo->omega, pAlpha);
+
+    // blend the rows and make them orthonormal again, GetExpandedMatrix derives the third
+    LerpNetSnapshotVector(&pMech->mat.row1, &pFrom->mat.row1, &pTo->mat.row1, pAlpha);
+    LerpNetSnapshotVector(&pMech->mat.row2, &pFrom->mat.row2, &pTo->mat.row2, pAlpha);
+    if (BrVector3Length(&pMech->mat.row1) < 0.001f) {
+        BrVector3Copy(&pMech->mat.row1, &pFrom->mat.row1);
+        BrVector3Copy(&pMech->mat.row2, &pFrom->mat.row2);
+    }
+    BrVector3Normalise(&pMech->mat.row1, &pMech->mat.row1);
+    BrVector3Scale(&tv, &pMech->mat.row1, BrVector3Dot(&pMech->mat.row1, &pMech->mat.row2));
+    BrVector3Sub(&pMech->mat.row2, &pMech->mat.row2, &tv);
+    if (BrVector3Length(&pMech->mat.row2) < 0.001f) {
+        BrVector3Copy(&pMech->mat.row1, &pFrom->mat.row1);
+        BrVector3Copy(&pMech->mat.row2, &pFrom->mat.row2);
+    }
+    BrVector3Normalise(&pMech->mat.row2, &pMech->mat.row2);
+
+    for (j = 0; j < COUNT_OF(pMech->d); j++) {
+        pMech->d[j] = (tU8)(pFrom->d[j] + (pTo->d[j] - pFrom->d[j]) * pAlpha + .5f);
+    }
+    pMech->curvature = (tS16)(pFrom->curvature + (pTo->curvature - pFrom->curvature) * pAlpha);
+    pMech->revs = (tU16)(pFrom->revs + (pTo->revs - pFrom->revs) * pAlpha);
+}
+
+// Fills pMech with the state of the car at pNow minus the playout delay. Returns 0 while the buffer is empty
+int NetSnapshotSample(tNet_snapshot_buffer* pBuffer, tU32 pNow, tNet_message_mechanics_info* pMech) {
+    tNet_message_mechanics_info* from;
+    tNet_message_mechanics_info* to;
+    tU32 render_time;
+    float target;
+    float slew;
+    float gap;
+    float dt;
+    float reach;
+    br_vector3 tv;
+    int i;
+
+    if (pBuffer->count == 0) {
+        return 0;
+    }
+    target = pBuffer->transit + pBuffer->interval + 3.f * pBuffer->jitter;
+    target = CONSTRAIN_BETWEEN(0.f, NET_SNAPSHOT_MAX_DELAY, target);
+    if (!pBuffer->have_sample) {
+        pBuffer->playout_delay = target;
+    } else {
+        slew = MAX(0, (tS32)(pNow - pBuffer->last_sample_time)) / 10.f;
+        pBuffer->playout_delay += CONSTRAIN_BETWEEN(-slew, slew, target - pBuffer->playout_delay);
+    }
+    render_time = pNow - (tU32)(pBuffer->playout_delay + .5f);
+    if (pBuffer->have_sample && (tS32)(render_time - pBuffer->last_render_time) < 0) {
+        render_time = pBuffer->last_render_time;
+    }
+
+    for (i = pBuffer->count - 1; i >= 0 && (tS32)(pBuffer->snapshots[i].time - render_time) > 0; i--) {
+    }
+    if (i < 0) {
+        // before anything we have, hold the oldest
+        render_time = pBuffer->snapshots[0].time;
+        *pMech = pBuffer->snapshots[0];
+    } else if (i == pBuffer->count - 1) {
+        from = &pBuffer->snapshots[i];
+        *pMech = *from;
+        dt = (float)MIN((tS32)(render_time - from->time), NET_SNAPSHOT_MAX_EXTRAPOLATION) / 1000.f;
+        if (dt > 0.f) {
+            BrVector3Scale(&tv, &from->v, dt);
+            BrVector3Accumulate(&pMech->mat.translation, &tv);
+            pBuffer->extrapolated++;
+        }
+    } else {
+        from = &pBuffer->snapshots[i];
+        to = &pBuffer->snapshots[i + 1];
+        gap = (float)(tS32)(to->time - from->time);
+        // a car that moved further than its speed allows was recovered or respawned: don't sweep it across the map
+        reach = (BrVector3Length(&from->v) + BrVector3Length(&to->v)) * gap / 1000.f + NET_SNAPSHOT_CORRECTION_DISTANCE;
+        BrVector3Sub(&tv, &to->mat.translation, &from->mat.translation);
+        if (BrVector3Length(&tv) > reach) {
+            *pMech = *from;
+        } else {
+            InterpolateNetSnapshots(pMech, from, to, (float)(tS32)(render_time - from->time) / gap);
+        }
+    }
+    pMech->time = render_time;
+
+    if (pBuffer->have_sample) {
+        BrVector3Scale(&tv, &pBuffer->last_v, (float)(tS32)(render_time - pBuffer->last_render_time) / 1000.f);
+        BrVector3Accumulate(&tv, &pBuffer->last_position);
+        BrVector3Sub(&tv, &pMech->mat.translation, &tv);
+        if (BrVector3Length(&tv) > NET_SNAPSHOT_CORRECTION_DISTANCE) {
+            pBuffer->corrections++;
+        }
+    }
+    BrVector3Copy(&pBuffer->last_position, &pMech->mat.translation);
+    BrVector3Copy(&pBuffer->last_v, &pMech->v);
+    pBuffer->last_sample_time = pNow;
+    pBuffer->last_render_time = render_time;
+    pBuffer->have_sample = 1;
+    return 1;
+}
+
+static tNet_snapshot_buffer* GetNetSnapshotBuffer(tU32 pID, int pCreate) {
+    int i;
+
+    for (i = 0; i < COUNT_OF(gNet_snapshot_buffers); i++) {
+        if (gNet_snapshot_buffers[i].count != 0 && gNet_snapshot_buffers[i].ID == pID) {
+            return &gNet_snapshot_buffers[i];
+        }
+    }
+    if (!pCreate) {
+        return NULL;
+    }
+    for (i = 0; i < COUNT_OF(gNet_snapshot_buffers); i++) {
+        if (gNet_snapshot_buffers[i].count == 0 || !PlayerIsInList(gNet_snapshot_buffers[i].ID)) {
+            LogNetSnapshotStats(&gNet_snapshot_buffers[i]);
+            NetSnapshotReset(&gNet_snapshot_buffers[i]);
+            gNet_snapshot_buffers[i].ID = pID;
+            return &gNet_snapshot_buffers[i];
+        }
+    }
+    return NULL;
+}
+
+void ResetNetSnapshots(void) {
+    int i;
+
+    for (i = 0; i < COUNT_OF(gNet_snapshot_buffers); i++) {
+        LogNetSnapshotStats(&gNet_snapshot_buffers[i]);
+        NetSnapshotReset(&gNet_snapshot_buffers[i]);
+    }
+}
+
+int IsNetSnapshotCar(tCar_spec* pCar) {
+
+    return harness_game_config.net_interpolation
+        && gNet_mode == eNet_mode_client
+        && pCar->driver == eDriver_net_human
+        && pCar != &gProgram_state.current_car;
+}
+
+// Returns 1 when the mechanics are the newest we have for the car
+int PushNetSnapshot(tNet_contents* pContents) {
+    tNet_message_mechanics_info mech;
+    tNet_snapshot_buffer* buffer;
+    int j;
+
+    buffer = GetNetSnapshotBuffer(pContents->data.mech.ID, 1);
+    if (buffer == NULL) {
+        return 1;
+    }
+    // as CopyMechanics
+    memcpy(&mech, pContents, MIN(pContents->header.contents_size, sizeof(mech)));
+    if (pContents->header.contents_size != sizeof(tNet_message_mechanics_info)) {
+        for (j = 0; j < COUNT_OF(mech.wheel_dam_offset); j++) {
+            mech.wheel_dam_offset[j] = 0.0f;
+        }
+    }
+    return NetSnapshotPush(buffer, &mech, GetRaceTime());
+}
+
+// Feeds the physics step ending at pTime with the played out state of the car
+void SampleNetSnapshots(tCar_spec* pCar, tU32 pTime) {
+    tNet_snapshot_buffer* buffer;
+    int i;
+
+    for (i = 0; i < gNumber_of_net_players; i++) {
+        if (gNet_players[i].car == pCar) {
+            break;
+        }
+    }
+    if (i == gNumber_of_net_players) {
+        return;
+    }
+    buffer = GetNetSnapshotBuffer(gNet_players[i].ID, 0);
+    if (buffer == NULL || !NetSnapshotSample(buffer, pTime, &pCar->message)) {
+        return;
+    }
+    pCar->message.type = NETMSGID_MECHANICS;
+    pCar->message.time = pTime;
+}
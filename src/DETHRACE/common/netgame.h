@@ -117,4 +117,38 @@ void GetExpandedMatrix(br_matrix34* m1, tReduced_matrix* m2);
 
 void NetEarnCredits(tNet_game_player_info* pPlayer, tS32 pCredits);
 
+void QuantiseMechanics(tMechanics_snapshot* pSnapshot, tNet_message_mechanics_info* pMech, int pDamaged_wheels);
+
+int ExpandMechanics(tNet_message_mechanics_info* pMech, tMechanics_snapshot* pSnapshot);
+
+int EncodeMechanicsDelta(tU8* pData, int pSize, tMechanics_snapshot* pSnapshot, tMechanics_snapshot* pBaseline);
+
+int DecodeMechanicsDelta(tMechanics_snapshot* pSnapshot, tU8* pData, int pSize, tMechanics_snapshot* pBaseline);
+
+void ResetMechanicsStreams(br_bounds* pTrack_bounds);
+
+tNet_contents* GetMechanicsContents(int pDamaged_wheels, int pTo_host);
+
+void SendMechanicsContents(tNet_contents* pContents, int pDamaged_wheels, int pTo_host);
+
+void SendMechanicsAcks(int pTo_host);
+
+void ReceivedMechanicsDelta(tNet_contents* pContents);
+
+void ReceivedMechanicsAck(tNet_contents* pContents, tNet_message* pMessage);
+
+void NetSnapshotReset(tNet_snapshot_buffer* pBuffer);
+
+int NetSnapshotPush(tNet_snapshot_buffer* pBuffer, tNet_message_mechanics_info* pMech, tU32 pArrival_time);
+
+int NetSnapshotSample(tNet_snapshot_buffer* pBuffer, tU32 pNow, tNet_message_mechanics_info* pMech);
+
+void ResetNetSnapshots(void);
+
+int IsNetSnapshotCar(tCar_spec* pCar);
+
+int PushNetSnapshot(tNet_contents* pContents);
+
+void SampleNetSnapshots(tCar_spec* pCar, tU32 pTime);
+
 #endif
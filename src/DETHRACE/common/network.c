@@ -60,10 +60,12 @@ tNet_message* gTo_host_stack;
 tU32 gLast_flush_message = 0;
 
 // GLOBAL: CARM95 0x0050d248
-int gRace_only_flags[33] = {
+// changed by dethrace: room for NETMSGID_MECHANICS_DELTA and NETMSGID_MECHANICS_ACK
+// int gRace_only_flags[33] = {
+int gRace_only_flags[35] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
     1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1,
-    0
+    0, 1, 1
 };
 
 // GLOBAL: CARM95 0x0050d2cc
@@ -73,7 +75,8 @@ int gJoin_list_mode;
 tNet_game_player_info gNew_net_players[6];
 
 // GLOBAL: CARM95 0x00534c90
-tGuaranteed_message gGuarantee_list[100]; // DOS debug symbols has this as [150]
+// tGuaranteed_message gGuarantee_list[100]; // DOS debug symbols has this as [150]
+tGuaranteed_message* gGuarantee_list; // changed by dethrace
 
 // GLOBAL: CARM95 0x00534c70
 tMid_message* gMid_messages;
@@ -141,6 +144,468 @@ int gReceived_game_scores;
 
 #define MAX_MESAGE_STACK_SIZE 512
 
+// Added by dethrace
+// Guaranteed messages live in slots of gGuarantee_list, which grows instead of filling up. A reply finds its slot
+// through a hash on the guarantee number, and ResendGuaranteedMessages only visits the slots a timer wheel says are
+// due. The slots of one message sent to several players are kept in a ring, and the message is disposed of with the
+// last of them.
+#define GUARANTEE_INITIAL_CAPACITY 100
+#define GUARANTEE_CAPACITY_LIMIT 0x10000
+#define GUARANTEE_WHEEL_SLOTS 256
+#define GUARANTEE_WHEEL_TICK 10 // ms
+#define GUARANTEE_EXPIRY 10000  // age a message without a fail notifier is given up at
+
+typedef struct tGuarantee_link {
+    int in_use;
+    int hash_next; // next free slot while not in use
+    int wheel_prev;
+    int wheel_next;
+    int wheel_slot;
+    int sibling_prev;
+    int sibling_next;
+    int peer;
+    tU32 wake_time;
+} tGuarantee_link;
+
+typedef struct tGuarantee_peer {
+    tPD_net_player_info address;
+    int outstanding;
+} tGuarantee_peer;
+
+int gGuarantee_capacity;                   // added by dethrace
+static tGuarantee_link* gGuarantee_links;  // added by dethrace
+static int* gGuarantee_hash;               // added by dethrace
+static int gGuarantee_hash_mask;           // added by dethrace
+static int gGuarantee_free = -1;           // added by dethrace
+static int gGuarantee_last = -1;           // added by dethrace
+static int gGuarantee_wheel[GUARANTEE_WHEEL_SLOTS]; // added by dethrace
+static tU32 gGuarantee_wheel_tick;         // added by dethrace
+static tU32 gGuarantee_wheel_horizon;      // added by dethrace
+static tGuarantee_peer* gGuarantee_peers;  // added by dethrace
+static int gGuarantee_peer_count;          // added by dethrace
+static int gGuarantee_peer_capacity;       // added by dethrace
+
+// Added by dethrace
+static void HashGuarantee(int pSlot) {
+    int bucket;
+
+    bucket = gGuarantee_list[pSlot].guarantee_number & gGuarantee_hash_mask;
+    gGuarantee_links[pSlot].hash_next = gGuarantee_hash[bucket];
+    gGuarantee_hash[bucket] = pSlot;
+}
+
+// Added by dethrace
+static void UnhashGuarantee(int pSlot) {
+    int* link;
+
+    link = &gGuarantee_hash[gGuarantee_list[pSlot].guarantee_number & gGuarantee_hash_mask];
+    while (*link != pSlot) {
+        link = &gGuarantee_links[*link].hash_next;
+    }
+    *link = gGuarantee_links[pSlot].hash_next;
+}
+
+// Added by dethrace
+static int FindGuarantee(tU32 pGuarantee_number) {
+    int slot;
+
+    if (gGuarantee_capacity == 0) {
+        return -1;
+    }
+    for (slot = gGuarantee_hash[pGuarantee_number & gGuarantee_hash_mask]; slot >= 0; slot = gGuarantee_links[slot].hash_next) {
+        if (gGuarantee_list[slot].guarantee_number == pGuarantee_number) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Added by dethrace
+static void ScheduleGuarantee(int pSlot, tU32 pWake_time) {
+    tU32 tick;
+    int wheel_slot;
+
+    // the first tick that starts at or after the wake time, but never one the wheel is about to pass
+    tick = MAX((pWake_time + GUARANTEE_WHEEL_TICK - 1) / GUARANTEE_WHEEL_TICK, gGuarantee_wheel_horizon + 1);
+    wheel_slot = tick % GUARANTEE_WHEEL_SLOTS;
+    // later rounds of the wheel pass the slot by until this time
+    gGuarantee_links[pSlot].wake_time = tick * GUARANTEE_WHEEL_TICK;
+    gGuarantee_links[pSlot].wheel_slot = wheel_slot;
+    gGuarantee_links[pSlot].wheel_prev = -1;
+    gGuarantee_links[pSlot].wheel_next = gGuarantee_wheel[wheel_slot];
+    if (gGuarantee_wheel[wheel_slot] >= 0) {
+        gGuarantee_links[gGuarantee_wheel[wheel_slot]].wheel_prev = pSlot;
+    }
+    gGuarantee_wheel[wheel_slot] = pSlot;
+}
+
+// Added by dethrace
+static void UnscheduleGuarantee(int pSlot) {
+    tGuarantee_link* link;
+
+    link = &gGuarantee_links[pSlot];
+    if (link->wheel_prev >= 0) {
+        gGuarantee_links[link->wheel_prev].wheel_next = link->wheel_next;
+    } else {
+        gGuarantee_wheel[link->wheel_slot] = link->wheel_next;
+    }
+    if (link->wheel_next >= 0) {
+        gGuarantee_links[link->wheel_next].wheel_prev = link->wheel_prev;
+    }
+}
+
+// Added by dethrace
+// The next time the slot has to be looked at: its next resend, or when it is given up
+static tU32 GuaranteeWakeTime(int pSlot, tU32 pTime) {
+    tGuaranteed_message* guarantee;
+
+    guarantee = &gGuarantee_list[pSlot];
+    if (guarantee->NotifyFail != NULL) {
+        // only the notifier knows when it fails, ask it every tick like the original asked every service
+        return pTime + GUARANTEE_WHEEL_TICK;
+    }
+    // both tests are strictly greater than
+    return MIN(guarantee->next_resend_time, guarantee->send_time + GUARANTEE_EXPIRY) + 1;
+}
+
+// Added by dethrace
+// Starts the wheel again from pTime, for when the clock has gone back past it or nothing is waiting on it. The
+// messages waiting keep their age
+static void ResyncGuaranteeWheel(tU32 pTime) {
+    int i;
+    tU32 shift;
+
+    shift = pTime - gGuarantee_wheel_tick * GUARANTEE_WHEEL_TICK;
+    for (i = 0; i < GUARANTEE_WHEEL_SLOTS; i++) {
+        gGuarantee_wheel[i] = -1;
+    }
+    gGuarantee_wheel_tick = pTime / GUARANTEE_WHEEL_TICK;
+    gGuarantee_wheel_horizon = gGuarantee_wheel_tick;
+    for (i = 0; i < gGuarantee_capacity; i++) {
+        if (gGuarantee_links[i].in_use) {
+            gGuarantee_list[i].send_time += shift;
+            gGuarantee_list[i].next_resend_time += shift;
+            ScheduleGuarantee(i, GuaranteeWakeTime(i, pTime));
+        }
+    }
+}
+
+// Added by dethrace
+static int FindGuaranteePeer(void* pAddress) {
+    int i;
+
+    for (i = 0; i < gGuarantee_peer_count; i++) {
+        if (memcmp(&gGuarantee_peers[i].address, pAddress, sizeof(tPD_net_player_info)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Added by dethrace
+static int AddGuaranteePeer(void* pAddress) {
+    int peer;
+    tGuarantee_peer* peers;
+
+    peer = FindGuaranteePeer(pAddress);
+    if (peer >= 0) {
+        return peer;
+    }
+    if (gGuarantee_peer_count == gGuarantee_peer_capacity) {
+        gGuarantee_peer_capacity = MAX(8, gGuarantee_peer_capacity * 2);
+        peers = BrMemAllocate(gGuarantee_peer_capacity * sizeof(tGuarantee_peer), kMem_misc);
+        if (gGuarantee_peer_count != 0) {
+            memcpy(peers, gGuarantee_peers, gGuarantee_peer_count * sizeof(tGuarantee_peer));
+            BrMemFree(gGuarantee_peers);
+        }
+        gGuarantee_peers = peers;
+    }
+    memcpy(&gGuarantee_peers[gGuarantee_peer_count].address, pAddress, sizeof(tPD_net_player_info));
+    gGuarantee_peers[gGuarantee_peer_count].outstanding = 0;
+    gGuarantee_peer_count++;
+    return gGuarantee_peer_count - 1;
+}
+
+// Added by dethrace
+// Returns 0 if the list is already as big as it may get, or there is no memory to grow it
+static int GrowGuarantees(void) {
+    int i;
+    int new_capacity;
+    int hash_size;
+    tGuaranteed_message* list;
+    tGuarantee_link* links;
+    int* hash;
+
+    if (gGuarantee_capacity >= GUARANTEE_CAPACITY_LIMIT) {
+        return 0;
+    }
+    new_capacity = gGuarantee_capacity == 0 ? GUARANTEE_INITIAL_CAPACITY : MIN(gGuarantee_capacity * 2, GUARANTEE_CAPACITY_LIMIT);
+    // twice as many buckets as slots, a power of two as guarantee numbers are consecutive
+    for (hash_size = 1; hash_size < new_capacity * 2; hash_size *= 2) {
+    }
+    list = BrMemAllocate(new_capacity * sizeof(tGuaranteed_message), kMem_misc);
+    links = BrMemAllocate(new_capacity * sizeof(tGuarantee_link), kMem_misc);
+    hash = BrMemAllocate(hash_size * sizeof(int), kMem_misc);
+    if (list == NULL || links == NULL || hash == NULL) {
+        // the list stays as it was, and is as full as if it had reached its limit
+        if (list != NULL) {
+            BrMemFree(list);
+        }
+        if (links != NULL) {
+            BrMemFree(links);
+        }
+        if (hash != NULL) {
+            BrMemFree(hash);
+        }
+        return 0;
+    }
+    memset(list, 0, new_capacity * sizeof(tGuaranteed_message));
+    memset(links, 0, new_capacity * sizeof(tGuarantee_link));
+    if (gGuarantee_capacity == 0) {
+        for (i = 0; i < GUARANTEE_WHEEL_SLOTS; i++) {
+            gGuarantee_wheel[i] = -1;
+        }
+        gGuarantee_wheel_tick = PDGetTotalTime() / GUARANTEE_WHEEL_TICK;
+        gGuarantee_wheel_horizon = gGuarantee_wheel_tick;
+    } else {
+        memcpy(list, gGuarantee_list, gGuarantee_capacity * sizeof(tGuaranteed_message));
+        memcpy(links, gGuarantee_links, gGuarantee_capacity * sizeof(tGuarantee_link));
+        BrMemFree(gGuarantee_list);
+        BrMemFree(gGuarantee_links);
+        BrMemFree(gGuarantee_hash);
+        dr_dprintf("Guarantee list grown to %d", new_capacity);
+    }
+    gGuarantee_list = list;
+    gGuarantee_links = links;
+    for (i = new_capacity - 1; i >= gGuarantee_capacity; i--) {
+        gGuarantee_links[i].hash_next = gGuarantee_free;
+        gGuarantee_free = i;
+    }
+
+    gGuarantee_hash = hash;
+    for (i = 0; i < hash_size; i++) {
+        gGuarantee_hash[i] = -1;
+    }
+    gGuarantee_hash_mask = hash_size - 1;
+    for (i = 0; i < gGuarantee_capacity; i++) {
+        if (gGuarantee_links[i].in_use) {
+            HashGuarantee(i);
+        }
+    }
+    gGuarantee_capacity = new_capacity;
+    return 1;
+}
+
+// Added by dethrace
+// Forgets the slot, disposing of the message if no other slot still has it
+static void ReleaseGuarantee(int pSlot) {
+    tGuarantee_link* link;
+
+    link = &gGuarantee_links[pSlot];
+    UnhashGuarantee(pSlot);
+    UnscheduleGuarantee(pSlot);
+    if (link->sibling_next == pSlot) {
+        gGuarantee_list[pSlot].message->guarantee_number = 0;
+        NetDisposeMessage(gCurrent_net_game, gGuarantee_list[pSlot].message);
+    } else {
+        gGuarantee_links[link->sibling_prev].sibling_next = link->sibling_next;
+        gGuarantee_links[link->sibling_next].sibling_prev = link->sibling_prev;
+    }
+    if (gGuarantee_last == pSlot) {
+        gGuarantee_last = -1;
+    }
+    gGuarantee_peers[link->peer].outstanding--;
+    link->in_use = 0;
+    link->hash_next = gGuarantee_free;
+    gGuarantee_free = pSlot;
+    gNext_guarantee--;
+}
+
+// Added by dethrace
+// Returns 0 if there is no room left
+static int AddGuarantee(tNet_message* pMessage, void* pAddress, int (*pNotifyFail)(tU32, tNet_message*)) {
+    int slot;
+    tGuaranteed_message* guarantee;
+    tGuarantee_link* link;
+
+    if (gGuarantee_free < 0 && !GrowGuarantees()) {
+        return 0;
+    }
+    slot = gGuarantee_free;
+    guarantee = &gGuarantee_list[slot];
+    link = &gGuarantee_links[slot];
+    gGuarantee_free = link->hash_next;
+
+    guarantee->guarantee_number = gGuarantee_number;
+    guarantee->message = pMessage;
+    guarantee->send_time = PDGetTotalTime();
+    guarantee->next_resend_time = guarantee->send_time + 100;
+    guarantee->resend_period = 100;
+    memcpy(&guarantee->pd_address, pAddress, sizeof(tPD_net_player_info));
+    guarantee->NotifyFail = pNotifyFail;
+    guarantee->recieved = 0;
+    link->in_use = 1;
+    HashGuarantee(slot);
+    ScheduleGuarantee(slot, GuaranteeWakeTime(slot, guarantee->send_time));
+
+    // a message sent to every player is sent to one after the other
+    if (gGuarantee_last >= 0 && gGuarantee_list[gGuarantee_last].message == pMessage) {
+        link->sibling_prev = gGuarantee_last;
+        link->sibling_next = gGuarantee_links[gGuarantee_last].sibling_next;
+        gGuarantee_links[link->sibling_next].sibling_prev = slot;
+        gGuarantee_links[gGuarantee_last].sibling_next = slot;
+    } else {
+        link->sibling_prev = slot;
+        link->sibling_next = slot;
+    }
+    gGuarantee_last = slot;
+
+    link->peer = AddGuaranteePeer(pAddress);
+    gGuarantee_peers[link->peer].outstanding++;
+    gNext_guarantee++;
+    return 1;
+}
+
+// Added by dethrace
+// What the original did with each entry on every service, now only for the slots that are due
+static void ServiceGuarantee(int pSlot, tU32 pTime) {
+    tGuaranteed_message* guarantee;
+
+    guarantee = &gGuarantee_list[pSlot];
+    if (guarantee->NotifyFail != NULL) {
+        guarantee->recieved |= guarantee->NotifyFail(pTime - guarantee->send_time, guarantee->message);
+    } else if (pTime - guarantee->send_time > GUARANTEE_EXPIRY) {
+        guarantee->recieved = 1;
+    }
+    if (guarantee->recieved) {
+        ReleaseGuarantee(pSlot);
+        return;
+    }
+    if (pTime > guarantee->next_resend_time) {
+        guarantee->message->guarantee_number = guarantee->guarantee_number;
+        GetCheckSum(guarantee->message);
+        PDNetSendMessageToAddress(gCurrent_net_game, guarantee->message, &guarantee->pd_address);
+        guarantee->resend_period = (tU32)(guarantee->resend_period * 1.2f);
+        guarantee->next_resend_time += guarantee->resend_period;
+    }
+    UnscheduleGuarantee(pSlot);
+    ScheduleGuarantee(pSlot, GuaranteeWakeTime(pSlot, pTime));
+}
+
+// Added by dethrace
+// How many guaranteed messages to this address are still waiting for a reply
+int NetGuaranteesOutstanding(void* pAddress) {
+    int peer;
+
+    peer = FindGuaranteePeer(pAddress);
+    return peer < 0 ? 0 : gGuarantee_peers[peer].outstanding;
+}
+
+// Added by dethrace
+// Gives up every guaranteed message, disposing of them, and frees the tables
+void NetDisposeGuarantees(void) {
+    int i;
+
+    for (i = 0; i < gGuarantee_capacity; i++) {
+        if (gGuarantee_links[i].in_use) {
+            ReleaseGuarantee(i);
+        }
+    }
+    if (gGuarantee_capacity != 0) {
+        BrMemFree(gGuarantee_list);
+        BrMemFree(gGuarantee_links);
+        BrMemFree(gGuarantee_hash);
+    }
+    if (gGuarantee_peer_capacity != 0) {
+        BrMemFree(gGuarantee_peers);
+    }
+    gGuarantee_list = NULL;
+    gGuarantee_links = NULL;
+    gGuarantee_hash = NULL;
+    gGuarantee_capacity = 0;
+    gGuarantee_free = -1;
+    gGuarantee_last = -1;
+    gGuarantee_peers = NULL;
+    gGuarantee_peer_count = 0;
+    gGuarantee_peer_capacity = 0;
+    gNext_guarantee = 0;
+}
+
+// Added by dethrace
+// What has been received from each player, to tell messages that have been overtaken or received twice
+typedef struct tNet_receive_history {
+    tPlayer_ID ID;
+    tU32 latest_time_stamp;
+    int have_guarantee;
+    tU32 latest_guarantee;
+    tU32 guarantees; // bit n set: latest_guarantee-1-n was received too
+} tNet_receive_history;
+
+static tNet_receive_stats gNet_receive_stats;                             // added by dethrace
+static tNet_receive_history gNet_receive_history[COUNT_OF(gNet_players)]; // added by dethrace
+
+// Added by dethrace
+// Before ReceivedMessage, which clears the guarantee number when it replies
+static void CountReceivedMessage(tNet_message* pMessage) {
+    tNet_receive_history* history;
+    tU32 age;
+    int i;
+
+    gNet_receive_stats.messages++;
+    gNet_receive_stats.bytes += pMessage->overall_size;
+    for (i = 0; i < gNumber_of_net_players; i++) {
+        if (gNet_players[i].ID == pMessage->sender) {
+            break;
+        }
+    }
+    if (i == gNumber_of_net_players) {
+        return;
+    }
+    history = &gNet_receive_history[i];
+    if (history->ID != pMessage->sender) {
+        memset(history, 0, sizeof(*history));
+        history->ID = pMessage->sender;
+        history->latest_time_stamp = pMessage->senders_time_stamp;
+    } else if ((int)(pMessage->senders_time_stamp - history->latest_time_stamp) < 0) {
+        gNet_receive_stats.out_of_order++;
+    } else {
+        history->latest_time_stamp = pMessage->senders_time_stamp;
+    }
+    if (pMessage->guarantee_number == 0) {
+        return;
+    }
+    if (!history->have_guarantee) {
+        history->have_guarantee = 1;
+        history->latest_guarantee = pMessage->guarantee_number;
+        history->guarantees = 0;
+    } else if ((int)(pMessage->guarantee_number - history->latest_guarantee) > 0) {
+        age = pMessage->guarantee_number - history->latest_guarantee;
+        history->guarantees = age >= 32 ? 0 : history->guarantees << age;
+        if (age <= 32) {
+            history->guarantees |= 1u << (age - 1);
+        }
+        history->latest_guarantee = pMessage->guarantee_number;
+    } else {
+        age = history->latest_guarantee - pMessage->guarantee_number;
+        if (age == 0 || (age <= 32 && (history->guarantees >> (age - 1)) & 1)) {
+            gNet_receive_stats.duplicates++;
+        } else if (age <= 32) {
+            history->guarantees |= 1u << (age - 1);
+        }
+    }
+}
+
+// Added by dethrace
+void NetResetReceiveStats(void) {
+    memset(&gNet_receive_stats, 0, sizeof(gNet_receive_stats));
+    memset(gNet_receive_history, 0, sizeof(gNet_receive_history));
+}
+
+// Added by dethrace
+void NetGetReceiveStats(tNet_receive_stats* pStats) {
+    *pStats = gNet_receive_stats;
+}
+
 // IDA: int __cdecl NetInitialise()
 // FUNCTION: CARM95 0x004463c0
 int NetInitialise(void) {
@@ -182,6 +647,7 @@ int NetShutdown(void) {
 
     err = PDNetShutdown();
     DisposeAbuseomatic();
+    NetDisposeGuarantees(); // Added by dethrace: before the messages it disposes of are freed
     BrMemFree(gMin_messages);
     BrMemFree(gMid_messages);
     BrMemFree(gMax_messages);
@@ -954,6 +1420,11 @@ tU32 NetGetContentsSize(tNet_message_type pType, tS32 pSize_decider) {
         return sizeof(tNet_message_oil_spill);
     case NETMSGID_CRUSHPOINT:
         return sizeof(tNet_message_crush_point);
+    // Added by dethrace: pSize_decider is the number of encoded bytes
+    case NETMSGID_MECHANICS_DELTA:
+        return (offsetof(tNet_message_mechanics_delta, data) + pSize_decider + 3) & ~3;
+    case NETMSGID_MECHANICS_ACK:
+        return sizeof(tNet_message_mechanics_ack);
     default:
         TELL_ME_IF_WE_PASS_THIS_WAY();
         return 4;
@@ -1540,10 +2011,15 @@ void ReceivedStartRace(tNet_contents* pContents) {
 void ReceivedGuaranteeReply(tNet_contents* pContents) {
     int i;
 
-    for (i = 0; i < gNext_guarantee; i++) {
-        if (gGuarantee_list[i].guarantee_number == pContents->data.reply.guarantee_number) {
-            gGuarantee_list[i].recieved = 1;
-        }
+    // for (i = 0; i < gNext_guarantee; i++) {
+    //     if (gGuarantee_list[i].guarantee_number == pContents->data.reply.guarantee_number) {
+    //         gGuarantee_list[i].recieved = 1;
+    //     }
+    // }
+    // changed by dethrace: look the reply up in the hash, and forget it there and then
+    i = FindGuarantee(pContents->data.reply.guarantee_number);
+    if (i >= 0) {
+        ReleaseGuarantee(i);
     }
 }
 
@@ -1899,6 +2375,13 @@ void ReceivedMessage(tNet_message* pMessage, void* pSender_address, tU32 pReceiv
             case NETMSGID_CRUSHPOINT: // 0x1f,
                 RecievedCrushPoint(contents);
                 break;
+            // Added by dethrace
+            case NETMSGID_MECHANICS_DELTA: // 0x21,
+                ReceivedMechanicsDelta(contents);
+                break;
+            case NETMSGID_MECHANICS_ACK: // 0x22,
+                ReceivedMechanicsAck(contents, pMessage);
+                break;
             }
         }
         contents = (tNet_contents*)((tU8*)contents + contents->header.contents_size);
@@ -1912,20 +2395,29 @@ void NetReceiveAndProcessMessages(void) {
     void* sender_address;
     tU32 receive_time;
     int old_net_service;
+    tU32 start_time; // added by dethrace
 
     old_net_service = gIn_net_service;
     if (gNet_mode != eNet_mode_none || gJoin_list_mode) {
+        start_time = PDGetMicroseconds(); // added by dethrace
+        PDNetNextFrame();                 // added by dethrace
         gIn_net_service = 1;
         while ((message = NetGetNextMessage(gCurrent_net_game, &sender_address)) != NULL) {
             receive_time = GetRaceTime();
             if (message->magic_number == 0x763a5058) {
                 CheckCheckSum(message);
+                CountReceivedMessage(message); // added by dethrace
                 ReceivedMessage(message, sender_address, receive_time);
             } else {
                 message->guarantee_number = 0;
             }
             NetDisposeMessage(gCurrent_net_game, message);
         }
+        // Added by dethrace
+        start_time = PDGetMicroseconds() - start_time;
+        gNet_receive_stats.calls++;
+        gNet_receive_stats.total_us += start_time;
+        gNet_receive_stats.max_us = MAX(gNet_receive_stats.max_us, start_time);
     }
     gIn_net_service = old_net_service;
 }
@@ -1953,6 +2445,8 @@ void CheckForDisappearees(void) {
     if (gNet_mode == eNet_mode_host) {
         for (i = 0; i < gNumber_of_net_players; i++) {
             if (!gNet_players[i].host && gNet_players[i].last_heard_from_him != 0 && the_time - gNet_players[i].last_heard_from_him >= 20000) {
+                // Added by dethrace
+                dr_dprintf("%s stopped responding with %d guaranteed messages outstanding", gNet_players[i].player_name, NetGuaranteesOutstanding(&gNet_players[i].pd_net_info));
                 strcpy(s, gNet_players[i].player_name);
                 strcat(s, " ");
                 strcat(s, GetMiscString(kMiscString_IS_NO_LONGER_RESPONDING));
@@ -1964,6 +2458,8 @@ void CheckForDisappearees(void) {
             }
         }
     } else if (!gHost_died && gNumber_of_net_players != 0 && gNet_players[0].last_heard_from_him != 0 && the_time - gNet_players[0].last_heard_from_him >= 20000) {
+        // Added by dethrace
+        dr_dprintf("Host stopped responding with %d guaranteed messages outstanding", NetGuaranteesOutstanding(&gNet_players[0].pd_net_info));
         HostHasBittenTheDust(kMiscString_PANIC_HOST_HAS_DISAPPEARED);
     }
 }
@@ -2128,23 +2624,25 @@ int NetGuaranteedSendMessageToAddress(tNet_game_details* pDetails, tNet_message*
     }
     pMessage->sender = gLocal_net_ID;
     pMessage->senders_time_stamp = PDGetTotalTime();
-    if (gNext_guarantee >= COUNT_OF(gGuarantee_list)) {
+    // if (gNext_guarantee >= COUNT_OF(gGuarantee_list)) {
+    // changed by dethrace: the list grows, it is only full at GUARANTEE_CAPACITY_LIMIT
+    if (!AddGuarantee(pMessage, pAddress, pNotifyFail)) {
         sprintf(buffer, "Guarantee list full %d", pMessage->contents.header.type);
         NewTextHeadupSlot(eHeadupSlot_misc, 0, 500, -kFont_ORANGHED, buffer);
         pMessage->guarantee_number = 0;
         return 0;
     }
     pMessage->guarantee_number = gGuarantee_number;
-    gGuarantee_list[gNext_guarantee].guarantee_number = gGuarantee_number;
+    // gGuarantee_list[gNext_guarantee].guarantee_number = gGuarantee_number;
     gGuarantee_number++;
-    gGuarantee_list[gNext_guarantee].message = pMessage;
-    gGuarantee_list[gNext_guarantee].send_time = PDGetTotalTime();
-    gGuarantee_list[gNext_guarantee].next_resend_time = gGuarantee_list[gNext_guarantee].send_time + 100;
-    gGuarantee_list[gNext_guarantee].resend_period = 100;
-    memcpy(&gGuarantee_list[gNext_guarantee].pd_address, pAddress, sizeof(tPD_net_player_info));
-    gGuarantee_list[gNext_guarantee].NotifyFail = pNotifyFail;
-    gGuarantee_list[gNext_guarantee].recieved = 0;
-    gNext_guarantee++;
+    // gGuarantee_list[gNext_guarantee].message = pMessage;
+    // gGuarantee_list[gNext_guarantee].send_time = PDGetTotalTime();
+    // gGuarantee_list[gNext_guarantee].next_resend_time = gGuarantee_list[gNext_guarantee].send_time + 100;
+    // gGuarantee_list[gNext_guarantee].resend_period = 100;
+    // memcpy(&gGuarantee_list[gNext_guarantee].pd_address, pAddress, sizeof(tPD_net_player_info));
+    // gGuarantee_list[gNext_guarantee].NotifyFail = pNotifyFail;
+    // gGuarantee_list[gNext_guarantee].recieved = 0;
+    // gNext_guarantee++;
     DoCheckSum(pMessage);
     return PDNetSendMessageToAddress(pDetails, pMessage, pAddress);
 }
@@ -2155,38 +2653,69 @@ void ResendGuaranteedMessages(void) {
     int i;
     int j;
     tU32 time;
-
-    i = 0;
+    tU32 tick; // added by dethrace
+
+    // i = 0;
+    // time = PDGetTotalTime();
+    // for (j = 0; j < gNext_guarantee; j++) {
+    //     if (i != j) {
+    //         memcpy(&gGuarantee_list[i], &gGuarantee_list[j], sizeof(tGuaranteed_message));
+    //     }
+    //     if (!gGuarantee_list[i].recieved) {
+    //         if (gGuarantee_list[i].NotifyFail != NULL) {
+    //             gGuarantee_list[i].recieved |= gGuarantee_list[i].NotifyFail(time - gGuarantee_list[i].send_time, gGuarantee_list[i].message);
+    //         } else {
+    //             if (time - gGuarantee_list[i].send_time > 10000) {
+    //                 gGuarantee_list[i].recieved = 1;
+    //             }
+    //         }
+    //     }
+    //     if (!gGuarantee_list[i].recieved) {
+    //         if (time > gGuarantee_list[i].next_resend_time) {
+    //             gGuarantee_list[i].message->guarantee_number = gGuarantee_list[i].guarantee_number;
+    //             GetCheckSum(gGuarantee_list[i].message);
+    //             PDNetSendMessageToAddress(gCurrent_net_game, gGuarantee_list[i].message, &gGuarantee_list[i].pd_address);
+    //             gGuarantee_list[i].resend_period = (tU32)(gGuarantee_list[i].resend_period * 1.2f);
+    //             gGuarantee_list[i].next_resend_time += gGuarantee_list[i].resend_period;
+    //         }
+    //         i++;
+    //     } else if ((i <= 0 || gGuarantee_list[i - 1].message != gGuarantee_list[i].message)
+    //         && (gNext_guarantee <= j + 1 || gGuarantee_list[j + 1].message != gGuarantee_list[i].message)) {
+    //         gGuarantee_list[i].message->guarantee_number = 0;
+    //         NetDisposeMessage(gCurrent_net_game, gGuarantee_list[i].message);
+    //     }
+    // }
+    // gNext_guarantee = i;
+
+    // changed by dethrace: only visit the wheel slots of the ticks since the last call
     time = PDGetTotalTime();
-    for (j = 0; j < gNext_guarantee; j++) {
-        if (i != j) {
-            memcpy(&gGuarantee_list[i], &gGuarantee_list[j], sizeof(tGuaranteed_message));
-        }
-        if (!gGuarantee_list[i].recieved) {
-            if (gGuarantee_list[i].NotifyFail != NULL) {
-                gGuarantee_list[i].recieved |= gGuarantee_list[i].NotifyFail(time - gGuarantee_list[i].send_time, gGuarantee_list[i].message);
-            } else {
-                if (time - gGuarantee_list[i].send_time > 10000) {
-                    gGuarantee_list[i].recieved = 1;
-                }
-            }
-        }
-        if (!gGuarantee_list[i].recieved) {
-            if (time > gGuarantee_list[i].next_resend_time) {
-                gGuarantee_list[i].message->guarantee_number = gGuarantee_list[i].guarantee_number;
-                GetCheckSum(gGuarantee_list[i].message);
-                PDNetSendMessageToAddress(gCurrent_net_game, gGuarantee_list[i].message, &gGuarantee_list[i].pd_address);
-                gGuarantee_list[i].resend_period = (tU32)(gGuarantee_list[i].resend_period * 1.2f);
-                gGuarantee_list[i].next_resend_time += gGuarantee_list[i].resend_period;
+    if (gGuarantee_capacity == 0) {
+        return;
+    }
+    tick = time / GUARANTEE_WHEEL_TICK;
+    if ((int)(tick - gGuarantee_wheel_tick) < 0 || gNext_guarantee == 0) {
+        // the clock is behind the wheel, or there is nothing on it to catch up with
+        ResyncGuaranteeWheel(time);
+        return;
+    }
+    if (tick == gGuarantee_wheel_tick) {
+        return;
+    }
+    if (tick - gGuarantee_wheel_tick > GUARANTEE_WHEEL_SLOTS) {
+        // after a long wait every slot is visited once
+        gGuarantee_wheel_tick = tick - GUARANTEE_WHEEL_SLOTS;
+    }
+    gGuarantee_wheel_horizon = tick;
+    while (gGuarantee_wheel_tick != tick) {
+        gGuarantee_wheel_tick++;
+        for (i = gGuarantee_wheel[gGuarantee_wheel_tick % GUARANTEE_WHEEL_SLOTS]; i >= 0; i = j) {
+            j = gGuarantee_links[i].wheel_next;
+            // slots further ahead than the wheel goes round are left for a later round
+            if (time >= gGuarantee_links[i].wake_time) {
+                ServiceGuarantee(i, time);
             }
-            i++;
-        } else if ((i <= 0 || gGuarantee_list[i - 1].message != gGuarantee_list[i].message)
-            && (gNext_guarantee <= j + 1 || gGuarantee_list[j + 1].message != gGuarantee_list[i].message)) {
-            gGuarantee_list[i].message->guarantee_number = 0;
-            NetDisposeMessage(gCurrent_net_game, gGuarantee_list[i].message);
         }
     }
-    gNext_guarantee = i;
 }
 
 // IDA: int __usercall SampleFailNotifier@<EAX>(tU32 pAge@<EAX>, tNet_message *pMessage@<EDX>)
@@ -14,10 +14,11 @@ extern void* gMessage_to_free;
 extern tNet_message* gBroadcast_stack;
 extern tNet_message* gTo_host_stack;
 extern tU32 gLast_flush_message;
-extern int gRace_only_flags[33];
+extern int gRace_only_flags[35];
 extern int gJoin_list_mode;
 extern tNet_game_player_info gNew_net_players[6];
-extern tGuaranteed_message gGuarantee_list[100];
+extern tGuaranteed_message* gGuarantee_list;
+extern int gGuarantee_capacity;
 extern tMid_message* gMid_messages;
 extern tU32 gLast_player_list_received;
 extern tMin_message* gMin_messages;
@@ -229,6 +230,14 @@ int NetGuaranteedSendMessageToAddress(tNet_game_details* pDetails, tNet_message*
 
 void ResendGuaranteedMessages(void);
 
+int NetGuaranteesOutstanding(void* pAddress);
+
+void NetDisposeGuarantees(void);
+
+void NetResetReceiveStats(void);
+
+void NetGetReceiveStats(tNet_receive_stats* pStats);
+
 int SampleFailNotifier(tU32 pAge, tNet_message* pMessage);
 
 void NetWaitForGuaranteeReplies(void);
@@ -10,6 +10,7 @@
 #include "utility.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 // GLOBAL: CARM95 0x00509a38
 char* gOil_pixie_names[1] = { "OIL.PIX" };
@@ -27,66 +28,248 @@ br_scalar gMin_z_diff;
 br_pixelmap* gOil_pixies[1];
 
 // GLOBAL: CARM95 0x00551dd0
-tOil_spill_info gOily_spills[15];
+// tOil_spill_info gOily_spills[15];
+tOil_spill_info* gOily_spills; // changed by dethrace
+int gOily_spill_capacity;      // added by dethrace
+
+// Added by dethrace
+// The spills live in an array that grows instead of recycling the oldest spill. The spills that have a car
+// are kept in a list in slot order (so random numbers are drawn in the original order) and in a hash grid
+// on their x/z position. Both are rebuilt only after a spill is added, removed or moves to another cell.
+#define OIL_SPILL_INITIAL 15
+#define OIL_SPILL_LIMIT 0x10000 // pipe chunks store the slot in a tU16
+#define OIL_GRID_CELL 4.f
+#define OIL_GRID_BUCKETS 256
+
+typedef struct tOil_grid_slot {
+    int next;
+    int cell_x;
+    int cell_z;
+} tOil_grid_slot;
+
+static tOil_grid_slot* gOil_grid_slots;
+static int gOil_grid_head[OIL_GRID_BUCKETS];
+static br_scalar gOil_max_size;
+static int* gOil_live;
+static int gOil_live_count;
+static int* gOil_query;
+static int gOil_index_dirty;
+
+// Added by dethrace
+static void OilGridCell(br_vector3* pPos, int* pCell_x, int* pCell_z) {
+
+    *pCell_x = (int)floorf(pPos->v[0] / OIL_GRID_CELL);
+    *pCell_z = (int)floorf(pPos->v[2] / OIL_GRID_CELL);
+}
+
+// Added by dethrace
+static int OilGridBucket(int pCell_x, int pCell_z) {
+
+    return ((unsigned int)pCell_x * 73856093u ^ (unsigned int)pCell_z * 19349663u) & (OIL_GRID_BUCKETS - 1);
+}
+
+// Added by dethrace
+static void RebuildOilSpillIndex(void) {
+    int i;
+    int bucket;
+    tOil_grid_slot* slot;
+
+    for (i = 0; i < OIL_GRID_BUCKETS; i++) {
+        gOil_grid_head[i] = -1;
+    }
+    gOil_live_count = 0;
+    gOil_max_size = 0.f;
+    for (i = 0; i < gOily_spill_capacity; i++) {
+        if (gOily_spills[i].car == NULL) {
+            continue;
+        }
+        gOil_live[gOil_live_count] = i;
+        gOil_live_count++;
+        slot = &gOil_grid_slots[i];
+        OilGridCell(&gOily_spills[i].actor->t.t.translate.t, &slot->cell_x, &slot->cell_z);
+        bucket = OilGridBucket(slot->cell_x, slot->cell_z);
+        slot->next = gOil_grid_head[bucket];
+        gOil_grid_head[bucket] = i;
+        gOil_max_size = MAX(gOil_max_size, gOily_spills[i].full_size);
+    }
+    gOil_index_dirty = 0;
+}
+
+// Added by dethrace
+static void CreateOilSpillActor(int pIndex) {
+    br_model* the_model;
+    br_material* the_material;
+
+    the_material = BrMaterialAllocate(NULL);
+    BrMaterialAdd(the_material);
+    the_material->flags |= BR_MATF_LIGHT;
+    the_material->flags |= BR_MATF_PERSPECTIVE;
+    the_material->flags |= BR_MATF_SMOOTH;
+    the_material->ka = 0.99f;
+    the_material->kd = 0.0f;
+    the_material->ks = 0.0f;
+    the_material->power = 0.0f;
+    the_material->index_base = 0;
+    the_material->index_range = 0;
+    the_material->colour_map = NULL;
+    BrMatrix23Identity(&the_material->map_transform);
+    the_material->index_shade = BrTableFind("IDENTITY.TAB");
+#ifdef DETHRACE_3DFX_PATCH
+    GlorifyMaterial(&the_material, 1);
+#endif
+    BrMaterialUpdate(the_material, BR_MATU_ALL);
+    the_model = BrModelAllocate(NULL, 4, 2);
+    the_model->flags |= BR_MODF_KEEP_ORIGINAL;
+
+    the_model->faces[0].vertices[0] = 2;
+    the_model->faces[0].vertices[1] = 1;
+    the_model->faces[0].vertices[2] = 0;
+    the_model->faces[0].material = NULL;
+    the_model->faces[0].smoothing = 1;
+    the_model->faces[1].vertices[0] = 3;
+    the_model->faces[1].vertices[1] = 2;
+    the_model->faces[1].vertices[2] = 0;
+    the_model->faces[1].material = NULL;
+    the_model->faces[1].smoothing = 1;
+    BrVector3Set(&the_model->vertices[0].p, -1.f, 0.f, -1.f);
+    BrVector2Set(&the_model->vertices[0].map, 0.f, 1.f);
+    BrVector3Set(&the_model->vertices[1].p, 1.f, 0.f, 1.f);
+    BrVector2Set(&the_model->vertices[1].map, 0.f, 0.f);
+    BrVector3Set(&the_model->vertices[2].p, 1.f, 0.f, -1.f);
+    BrVector2Set(&the_model->vertices[2].map, 1.f, 0.f);
+    BrVector3Set(&the_model->vertices[3].p, -1.f, 0.f, 1.f);
+    BrVector2Set(&the_model->vertices[3].map, 1.f, 1.f);
+    gOily_spills[pIndex].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
+    gOily_spills[pIndex].actor->model = the_model;
+    gOily_spills[pIndex].actor->render_style = BR_RSTYLE_NONE;
+    gOily_spills[pIndex].actor->material = the_material;
+    BrActorAdd(gNon_track_actor, gOily_spills[pIndex].actor);
+}
+
+// Added by dethrace
+// Returns 0 if pCapacity is over the limit
+static int GrowOilSpills(int pCapacity) {
+    int i;
+    int new_capacity;
+    tOil_spill_info* spills;
+
+    if (pCapacity <= gOily_spill_capacity) {
+        return 1;
+    }
+    if (pCapacity > OIL_SPILL_LIMIT) {
+        return 0;
+    }
+    new_capacity = MAX(pCapacity, gOily_spill_capacity * 2);
+    new_capacity = MIN(new_capacity, OIL_SPILL_LIMIT);
+
+    spills = BrMemAllocate(new_capacity * sizeof(tOil_spill_info), kMem_misc);
+    memset(spills, 0, new_capacity * sizeof(tOil_spill_info));
+    if (gOily_spill_capacity != 0) {
+        memcpy(spills, gOily_spills, gOily_spill_capacity * sizeof(tOil_spill_info));
+        BrMemFree(gOily_spills);
+        BrMemFree(gOil_grid_slots);
+        BrMemFree(gOil_live);
+        BrMemFree(gOil_query);
+    }
+    gOily_spills = spills;
+    gOil_grid_slots = BrMemAllocate(new_capacity * sizeof(tOil_grid_slot), kMem_misc);
+    memset(gOil_grid_slots, 0, new_capacity * sizeof(tOil_grid_slot));
+    gOil_live = BrMemAllocate(new_capacity * sizeof(int), kMem_misc);
+    gOil_query = BrMemAllocate(new_capacity * sizeof(int), kMem_misc);
+    for (i = gOily_spill_capacity; i < new_capacity; i++) {
+        CreateOilSpillActor(i);
+    }
+    gOily_spill_capacity = new_capacity;
+    gOil_index_dirty = 1;
+    return 1;
+}
+
+// Added by dethrace
+// The test the original made when flagging the spills under a car's shadow
+static int OilSpillOverlapsCar(int pIndex, br_scalar pCar_x, br_scalar pCar_z, br_scalar pCar_radius) {
+    br_actor* oily_actor;
+    br_scalar oily_size;
+
+    oily_actor = gOily_spills[pIndex].actor;
+    oily_size = gOily_spills[pIndex].full_size;
+    return oily_actor->t.t.translate.t.v[0] - oily_size < pCar_x + pCar_radius
+        && oily_actor->t.t.translate.t.v[0] + oily_size > pCar_x - pCar_radius
+        && oily_actor->t.t.translate.t.v[2] - oily_size < pCar_z + pCar_radius
+        && oily_actor->t.t.translate.t.v[2] + oily_size > pCar_z - pCar_radius;
+}
+
+// Added by dethrace
+// The spills whose bounds overlap the car at pCar_x, pCar_z (world scale, so physics code has to scale
+// the car's position back first), in slot order. The list stays valid until the next call.
+int FindOilSpillsNearCar(tCar_spec* pCar, br_scalar pCar_x, br_scalar pCar_z, int** pSpills) {
+    int i;
+    int j;
+    int n;
+    int count;
+    int cell_x;
+    int cell_z;
+    int min_x;
+    int max_x;
+    int min_z;
+    int max_z;
+    br_scalar car_radius;
+    br_scalar reach;
+    br_vector3 corner;
+
+    if (gOil_index_dirty) {
+        RebuildOilSpillIndex();
+    }
+    *pSpills = gOil_query;
+    count = 0;
+    if (gOil_live_count == 0) {
+        return count;
+    }
+    car_radius = pCar->bounds[1].max.v[2] / WORLD_SCALE * 1.5f;
+    reach = car_radius + gOil_max_size;
+    BrVector3Set(&corner, pCar_x - reach, 0.f, pCar_z - reach);
+    OilGridCell(&corner, &min_x, &min_z);
+    BrVector3Set(&corner, pCar_x + reach, 0.f, pCar_z + reach);
+    OilGridCell(&corner, &max_x, &max_z);
+
+    if ((max_x - min_x + 1) * (max_z - min_z + 1) > gOil_live_count) {
+        // More cells than spills, testing every spill is cheaper
+        for (n = 0; n < gOil_live_count; n++) {
+            if (OilSpillOverlapsCar(gOil_live[n], pCar_x, pCar_z, car_radius)) {
+                gOil_query[count] = gOil_live[n];
+                count++;
+            }
+        }
+        return count;
+    }
+    for (cell_x = min_x; cell_x <= max_x; cell_x++) {
+        for (cell_z = min_z; cell_z <= max_z; cell_z++) {
+            for (i = gOil_grid_head[OilGridBucket(cell_x, cell_z)]; i >= 0; i = gOil_grid_slots[i].next) {
+                if (gOil_grid_slots[i].cell_x != cell_x || gOil_grid_slots[i].cell_z != cell_z || !OilSpillOverlapsCar(i, pCar_x, pCar_z, car_radius)) {
+                    continue;
+                }
+                for (j = count; j > 0 && gOil_query[j - 1] > i; j--) {
+                    gOil_query[j] = gOil_query[j - 1];
+                }
+                gOil_query[j] = i;
+                count++;
+            }
+        }
+    }
+    return count;
+}
 
 // IDA: void __cdecl InitOilSpills()
 // FUNCTION: CARM95 0x00412510
 void InitOilSpills(void) {
     int i;
-    br_model* the_model;
-    br_material* the_material;
 
     for (i = 0; i < COUNT_OF(gOil_pixie_names); i++) {
         gOil_pixies[i] = LoadPixelmap(gOil_pixie_names[i]);
         BrMapAdd(gOil_pixies[i]);
     }
 
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
-        the_material = BrMaterialAllocate(NULL);
-        BrMaterialAdd(the_material);
-        the_material->flags |= BR_MATF_LIGHT;
-        the_material->flags |= BR_MATF_PERSPECTIVE;
-        the_material->flags |= BR_MATF_SMOOTH;
-        the_material->ka = 0.99f;
-        the_material->kd = 0.0f;
-        the_material->ks = 0.0f;
-        the_material->power = 0.0f;
-        the_material->index_base = 0;
-        the_material->index_range = 0;
-        the_material->colour_map = NULL;
-        BrMatrix23Identity(&the_material->map_transform);
-        the_material->index_shade = BrTableFind("IDENTITY.TAB");
-#ifdef DETHRACE_3DFX_PATCH
-        GlorifyMaterial(&the_material, 1);
-#endif
-        BrMaterialUpdate(the_material, BR_MATU_ALL);
-        the_model = BrModelAllocate(NULL, 4, 2);
-        the_model->flags |= BR_MODF_KEEP_ORIGINAL;
-
-        the_model->faces[0].vertices[0] = 2;
-        the_model->faces[0].vertices[1] = 1;
-        the_model->faces[0].vertices[2] = 0;
-        the_model->faces[0].material = NULL;
-        the_model->faces[0].smoothing = 1;
-        the_model->faces[1].vertices[0] = 3;
-        the_model->faces[1].vertices[1] = 2;
-        the_model->faces[1].vertices[2] = 0;
-        the_model->faces[1].material = NULL;
-        the_model->faces[1].smoothing = 1;
-        BrVector3Set(&the_model->vertices[0].p, -1.f, 0.f, -1.f);
-        BrVector2Set(&the_model->vertices[0].map, 0.f, 1.f);
-        BrVector3Set(&the_model->vertices[1].p, 1.f, 0.f, 1.f);
-        BrVector2Set(&the_model->vertices[1].map, 0.f, 0.f);
-        BrVector3Set(&the_model->vertices[2].p, 1.f, 0.f, -1.f);
-        BrVector2Set(&the_model->vertices[2].map, 1.f, 0.f);
-        BrVector3Set(&the_model->vertices[3].p, -1.f, 0.f, 1.f);
-        BrVector2Set(&the_model->vertices[3].map, 1.f, 1.f);
-        gOily_spills[i].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
-        gOily_spills[i].actor->model = the_model;
-        gOily_spills[i].actor->render_style = BR_RSTYLE_NONE;
-        gOily_spills[i].actor->material = the_material;
-        BrActorAdd(gNon_track_actor, gOily_spills[i].actor);
-    }
+    // changed by dethrace: the slots are created by GrowOilSpills, see CreateOilSpillActor
+    GrowOilSpills(OIL_SPILL_INITIAL);
 }
 
 // IDA: void __cdecl ResetOilSpills()
@@ -94,11 +277,13 @@ void InitOilSpills(void) {
 void ResetOilSpills(void) {
     int i;
 
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (i = 0; i < gOily_spill_capacity; i++) { // changed by dethrace
         gOily_spills[i].actor->render_style = BR_RSTYLE_NONE;
         gOily_spills[i].car = NULL;
         gOily_spills[i].stop_time = 0;
     }
+    gOil_index_dirty = 1; // added by dethrace
 }
 
 // IDA: void __usercall QueueOilSpill(tCar_spec *pCar@<EAX>)
@@ -115,13 +300,15 @@ void QueueOilSpill(tCar_spec* pCar) {
     the_time = GetTotalTime();
     oldest_time = GetTotalTime();
 
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (i = 0; i < gOily_spill_capacity; i++) { // changed by dethrace
         if (gOily_spills[i].car == pCar && the_time < gOily_spills[i].spill_time + 5000) {
             return;
         }
     }
 
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (i = 0; i < gOily_spill_capacity; i++) { // changed by dethrace
         if (gOily_spills[i].car == NULL) {
             oily_index = i;
             break;
@@ -133,9 +320,14 @@ void QueueOilSpill(tCar_spec* pCar) {
         }
     }
 
+    // Added by dethrace: grow rather than take over the oldest spill
+    if (oily_index < 0 && GrowOilSpills(gOily_spill_capacity + 1)) {
+        oily_index = i;
+    }
     if (oily_index < 0) {
         oily_index = oldest_one;
     }
+    gOil_index_dirty = 1; // added by dethrace
     gOily_spills[oily_index].car = pCar;
     gOily_spills[oily_index].spill_time = the_time + 500;
     gOily_spills[oily_index].full_size = SRandomBetween(.35f, .6f);
@@ -252,11 +444,43 @@ void EnsureGroundDetailVisible(br_vector3* pNew_pos, br_vector3* pGround_normal,
     Vector3Interpolate(pNew_pos, pOld_pos, (br_vector3*)gCamera_to_world.m[3], factor);
 }
 
+// Added by dethrace
+// The fraction of the way towards the camera EnsureGroundDetailVisible would pull a point,
+// for marks that are written straight into a shared mesh rather than placed with an actor.
+br_scalar GroundDetailCameraFactor(br_vector3* pGround_normal, br_vector3* pOld_pos) {
+    br_scalar s;
+    br_scalar dist;
+    br_vector3 to_camera;
+
+    to_camera.v[0] = gCamera_to_world.m[3][0] - pOld_pos->v[0];
+    to_camera.v[1] = gCamera_to_world.m[3][1] - pOld_pos->v[1];
+    to_camera.v[2] = gCamera_to_world.m[3][2] - pOld_pos->v[2];
+    dist = BrVector3Length(&to_camera);
+    if (dist <= BR_SCALAR_EPSILON) {
+        return 0.0f;
+    }
+    s = BrVector3Dot(pGround_normal, &to_camera) / dist;
+    if (BR_ABS(s) > 0.01f) {
+        return MIN(0.01f / s, 0.1f);
+    }
+    return 0.01f;
+}
+
 // IDA: void __usercall MungeOilsHeightAboveGround(tOil_spill_info *pOil@<EAX>)
 // FUNCTION: CARM95 0x00412bf4
 void MungeOilsHeightAboveGround(tOil_spill_info* pOil) {
+    tOil_grid_slot* slot; // added by dethrace
+    int cell_x;           // added by dethrace
+    int cell_z;           // added by dethrace
 
     EnsureGroundDetailVisible(&pOil->actor->t.t.look_up.t, &pOil->actor->t.t.look_up.up, &pOil->pos);
+
+    // Added by dethrace
+    slot = &gOil_grid_slots[pOil - gOily_spills];
+    OilGridCell(&pOil->actor->t.t.translate.t, &cell_x, &cell_z);
+    if (cell_x != slot->cell_x || cell_z != slot->cell_z) {
+        gOil_index_dirty = 1;
+    }
 }
 
 // IDA: void __usercall MungeIndexedOilsHeightAboveGround(int pIndex@<EAX>)
@@ -294,9 +518,16 @@ void ProcessOilSpills(tU32 pFrame_period) {
     br_scalar this_size;
     br_vector3 v;
     tNet_message* message;
+    int n; // added by dethrace
 
     time = GetTotalTime();
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // Added by dethrace: slots without a car are always hidden, only visit the live ones
+    if (gOil_index_dirty) {
+        RebuildOilSpillIndex();
+    }
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (n = 0; n < gOil_live_count; n++) { // changed by dethrace
+        i = gOil_live[n];
         if (gOily_spills[i].car != NULL) {
             the_model = gOily_spills[i].actor->model;
             if (gOily_spills[i].actor->render_style == BR_RSTYLE_NONE && gOily_spills[i].spill_time <= time && BR_ABS(gOily_spills[i].car->v.v[0]) < .01f && BR_ABS(gOily_spills[i].car->v.v[1]) < .01f && BR_ABS(gOily_spills[i].car->v.v[2]) < .01f) {
@@ -332,6 +563,7 @@ void ProcessOilSpills(tU32 pFrame_period) {
                         }
                     } else {
                         gOily_spills[i].car = NULL;
+                        gOil_index_dirty = 1; // added by dethrace
                     }
                 }
             } else {
@@ -387,7 +619,8 @@ void ProcessOilSpills(tU32 pFrame_period) {
 // FUNCTION: CARM95 0x00413852
 int GetOilSpillCount(void) {
     //
-    return COUNT_OF(gOily_spills);
+    // return COUNT_OF(gOily_spills);
+    return gOily_spill_capacity; // changed by dethrace
 }
 
 // IDA: void __usercall GetOilSpillDetails(int pIndex@<EAX>, br_actor **pActor@<EDX>, br_scalar *pSize@<EBX>)
@@ -417,7 +650,11 @@ int PointInSpill(br_vector3* pV, int pSpill) {
 // FUNCTION: CARM95 0x004138c7
 void GetOilFrictionFactors(tCar_spec* pCar, br_scalar* pFl_factor, br_scalar* pFr_factor, br_scalar* pRl_factor, br_scalar* pRr_factor) {
     int i;
-    br_vector3 wheel_world;
+    // br_vector3 wheel_world;
+    int n;              // added by dethrace
+    int count;          // added by dethrace
+    int* spills;        // added by dethrace
+    br_vector3 car_pos; // added by dethrace
 
     *pFl_factor = 1.0f;
     *pFr_factor = 1.0f;
@@ -426,24 +663,27 @@ void GetOilFrictionFactors(tCar_spec* pCar, br_scalar* pFl_factor, br_scalar* pF
 
     if (pCar->driver > eDriver_non_car) {
         if (pCar->shadow_intersection_flags != 0) {
-            for (i = 0; i < COUNT_OF(gOily_spills); i++) {
-                if (((1 << i) & pCar->shadow_intersection_flags) != 0 && gOily_spills[i].car != NULL) {
-                    BrMatrix34ApplyP(&wheel_world, &pCar->wpos[2], &pCar->car_master_actor->t.t.mat);
-                    if (PointInSpill(&wheel_world, i)) {
-                        pCar->oil_remaining[2] = SRandomBetween(1.5f, 2.5f);
-                    }
-                    BrMatrix34ApplyP(&wheel_world, &pCar->wpos[3], &pCar->car_master_actor->t.t.mat);
-                    if (PointInSpill(&wheel_world, i)) {
-                        pCar->oil_remaining[3] = SRandomBetween(1.5f, 2.5f);
-                    }
-                    BrMatrix34ApplyP(&wheel_world, &pCar->wpos[0], &pCar->car_master_actor->t.t.mat);
-                    if (PointInSpill(&wheel_world, i)) {
-                        pCar->oil_remaining[0] = SRandomBetween(1.5f, 2.5f);
-                    }
-                    BrMatrix34ApplyP(&wheel_world, &pCar->wpos[1], &pCar->car_master_actor->t.t.mat);
-                    if (PointInSpill(&wheel_world, i)) {
-                        pCar->oil_remaining[1] = SRandomBetween(1.5f, 2.5f);
-                    }
+            // changed by dethrace: the nearby spills come from the grid and the wheel positions
+            // from CalcForce, which transformed them with the same matrix a moment ago
+            // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+            //     if (((1 << i) & pCar->shadow_intersection_flags) != 0 && gOily_spills[i].car != NULL) {
+            //         BrMatrix34ApplyP(&wheel_world, &pCar->wpos[2], &pCar->car_master_actor->t.t.mat);
+            // called from CalcForce, while the car's actor is at physics scale
+            BrVector3InvScale(&car_pos, &pCar->car_master_actor->t.t.translate.t, WORLD_SCALE);
+            count = FindOilSpillsNearCar(pCar, car_pos.v[0], car_pos.v[2], &spills);
+            for (n = 0; n < count; n++) {
+                i = spills[n];
+                if (PointInSpill(&pCar->wheel_world[2], i)) {
+                    pCar->oil_remaining[2] = SRandomBetween(1.5f, 2.5f);
+                }
+                if (PointInSpill(&pCar->wheel_world[3], i)) {
+                    pCar->oil_remaining[3] = SRandomBetween(1.5f, 2.5f);
+                }
+                if (PointInSpill(&pCar->wheel_world[0], i)) {
+                    pCar->oil_remaining[0] = SRandomBetween(1.5f, 2.5f);
+                }
+                if (PointInSpill(&pCar->wheel_world[1], i)) {
+                    pCar->oil_remaining[1] = SRandomBetween(1.5f, 2.5f);
                 }
             }
         }
@@ -466,6 +706,11 @@ void GetOilFrictionFactors(tCar_spec* pCar, br_scalar* pFl_factor, br_scalar* pF
 // FUNCTION: CARM95 0x00413cb6
 void AdjustOilSpill(int pIndex, br_matrix34* pMat, br_scalar pFull_size, br_scalar pGrow_rate, tU32 pSpill_time, tU32 pStop_time, tCar_spec* pCar, br_vector3* pOriginal_pos, br_pixelmap* pPixelmap) {
 
+    // Added by dethrace: the replay may hold spills from before the array last grew
+    if (!GrowOilSpills(pIndex + 1)) {
+        return;
+    }
+    gOil_index_dirty = 1;
     BrMatrix34Copy(&gOily_spills[pIndex].actor->t.t.mat, pMat);
     gOily_spills[pIndex].full_size = pFull_size;
     gOily_spills[pIndex].grow_rate = pGrow_rate;
@@ -495,12 +740,14 @@ void ReceivedOilSpill(tNet_contents* pContents) {
     oily_index = -1;
     the_time = GetTotalTime();
     oldest_time = GetTotalTime();
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (i = 0; i < gOily_spill_capacity; i++) { // changed by dethrace
         if (gOily_spills[i].car == car && the_time < gOily_spills[i].spill_time + 5000) {
             return;
         }
     }
-    for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    // for (i = 0; i < COUNT_OF(gOily_spills); i++) {
+    for (i = 0; i < gOily_spill_capacity; i++) { // changed by dethrace
         if (gOily_spills[i].car == NULL) {
             oily_index = i;
             break;
@@ -509,9 +756,14 @@ void ReceivedOilSpill(tNet_contents* pContents) {
             oldest_one = i;
         }
     }
+    // Added by dethrace: grow rather than take over the oldest spill
+    if (oily_index < 0 && GrowOilSpills(gOily_spill_capacity + 1)) {
+        oily_index = i;
+    }
     if (oily_index < 0) {
         oily_index = oldest_one;
     }
+    gOil_index_dirty = 1; // added by dethrace
     gOily_spills[oily_index].car = car;
     gOily_spills[oily_index].spill_time = the_time;
     gOily_spills[oily_index].full_size = pContents->data.oil_spill.full_size;
@@ -8,7 +8,9 @@ extern int gNext_oil_pixie;
 extern br_scalar gZ_buffer_diff;
 extern br_scalar gMin_z_diff;
 extern br_pixelmap* gOil_pixies[1];
-extern tOil_spill_info gOily_spills[15];
+// extern tOil_spill_info gOily_spills[15];
+extern tOil_spill_info* gOily_spills; // changed by dethrace
+extern int gOily_spill_capacity;      // added by dethrace
 
 void InitOilSpills(void);
 
@@ -22,6 +24,8 @@ void Vector3Interpolate(br_vector3* pDst, br_vector3* pFrom, br_vector3* pTo, br
 
 void EnsureGroundDetailVisible(br_vector3* pNew_pos, br_vector3* pGround_normal, br_vector3* pOld_pos);
 
+br_scalar GroundDetailCameraFactor(br_vector3* pGround_normal, br_vector3* pOld_pos);
+
 void MungeOilsHeightAboveGround(tOil_spill_info* pOil);
 
 void MungeIndexedOilsHeightAboveGround(int pIndex);
@@ -42,4 +46,7 @@ void AdjustOilSpill(int pIndex, br_matrix34* pMat, br_scalar pFull_size, br_scal
 
 void ReceivedOilSpill(tNet_contents* pContents);
 
+// Added by dethrace
+int FindOilSpillsNearCar(tCar_spec* pCar, br_scalar pCar_x, br_scalar pCar_z, int** pSpills);
+
 #endif
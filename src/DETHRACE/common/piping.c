@@ -475,8 +475,16 @@ void EndPipingSession(void) {
 void AddDataToSession(int pSubject_index, void* pData, tU32 pData_length) {
     tU32 temp_buffer_size;
     int variable_for_breaking_on;
+    tPipe_chunk_type chunk_type; // added by dethrace
 
     if (gPipe_buffer_start != NULL && !gAction_replay_mode && gProgram_state.racing) {
+        // Added by dethrace: number_of_chunks is a tU8, so carry on in a new session of the same type rather than
+        // let it wrap. The grown spark, smoke and shrapnel pools pipe more than 255 chunks in one session
+        if (((tPipe_session*)gLocal_buffer)->number_of_chunks == 255) {
+            chunk_type = ((tPipe_session*)gLocal_buffer)->chunk_type;
+            EndPipingSession2(0);
+            StartPipingSession2(chunk_type, 0);
+        }
         temp_buffer_size = pData_length + (gLocal_buffer_size + offsetof(tPipe_chunk, chunk_data));
         if (temp_buffer_size < LOCAL_BUFFER_SIZE) {
             REPLAY_DEBUG_ASSERT(((tPipe_session*)gLocal_buffer)->pipe_magic1 == REPLAY_DEBUG_SESSION_MAGIC1);
@@ -13,7 +13,107 @@
 #include <string.h>
 
 // GLOBAL: CARM95 0x00530190
-tSkid gSkids[100];
+// tSkid gSkids[100];
+tSkid gSkids[SKID_RING_SIZE]; // changed by dethrace
+
+// Added by dethrace
+// Instead of one actor and 4-vertex model per mark, the ring of marks is split into chunks
+// that each own one model. A mark is written in place into its chunk's vertices, and each
+// dirty chunk is updated once per frame. Faces carry their own material, so a chunk renders
+// one group per skid material.
+#define SKID_CHUNK_SIZE 128
+#define SKID_CHUNK_COUNT (SKID_RING_SIZE / SKID_CHUNK_SIZE)
+// A chunk's marks are nudged towards the camera again once it has moved this fraction of the way to
+// the nearest of them, so distant chunks are rewritten and prepared far less often than every frame
+#define SKID_RENUDGE_FRACTION 0.05f
+
+typedef struct tSkid_chunk {
+    br_actor* actor;
+    br_model* model;
+    int visible_count;
+    br_uint_16 update_flags;
+    br_vector3 nudge_camera;  // where the camera was when the marks were last nudged
+    br_scalar nudge_distance; // from there to the nearest visible mark, 0 to nudge next frame
+} tSkid_chunk;
+
+static tSkid_chunk gSkid_chunks[SKID_CHUNK_COUNT];
+
+// Added by dethrace
+static tSkid_chunk* SkidChunk(int pSkid_num) {
+    return &gSkid_chunks[pSkid_num / SKID_CHUNK_SIZE];
+}
+
+// Added by dethrace: pCamera_factor moves the whole mark that fraction of the way towards the camera,
+// as EnsureGroundDetailVisible did with the mark's own actor
+static void WriteSkidVertices(int pSkid_num, br_scalar pCamera_factor) {
+    static br_vector3 corners[4] = {
+        { { -0.5f, 1.0f, -0.5f } },
+        { { -0.5f, 1.0f, 0.5f } },
+        { { 0.5f, 1.0f, 0.5f } },
+        { { 0.5f, 1.0f, -0.5f } },
+    };
+    br_vertex* vertices;
+    br_vector3 offset;
+    int i;
+
+    BrVector3Sub(&offset, (br_vector3*)gCamera_to_world.m[3], &gSkids[pSkid_num].pos);
+    BrVector3Scale(&offset, &offset, pCamera_factor);
+    vertices = &SkidChunk(pSkid_num)->model->vertices[(pSkid_num % SKID_CHUNK_SIZE) * 4];
+    for (i = 0; i < 4; i++) {
+        BrMatrix34ApplyP(&vertices[i].p, &corners[i], &gSkids[pSkid_num].mat);
+        BrVector3Accumulate(&vertices[i].p, &offset);
+    }
+}
+
+// Added by dethrace
+static void SetSkidVisible(int pSkid_num, int pVisible) {
+    tSkid_chunk* chunk;
+    br_face* faces;
+
+    chunk = SkidChunk(pSkid_num);
+    if (gSkids[pSkid_num].visible != pVisible) {
+        gSkids[pSkid_num].visible = pVisible;
+        chunk->visible_count += pVisible ? 1 : -1;
+    }
+    faces = &chunk->model->faces[(pSkid_num % SKID_CHUNK_SIZE) * 2];
+    if (faces[0].material != gSkids[pSkid_num].material) {
+        faces[0].material = gSkids[pSkid_num].material;
+        faces[1].material = gSkids[pSkid_num].material;
+    }
+    if (pVisible) {
+        WriteSkidVertices(pSkid_num, GroundDetailCameraFactor(&gSkids[pSkid_num].normal, &gSkids[pSkid_num].pos));
+    }
+    // Hidden marks are collapsed when the chunk is flushed
+    chunk->update_flags |= BR_MODU_ALL;
+}
+
+// Added by dethrace
+// Collapse every hidden mark of the chunk onto a visible one, so they neither draw nor
+// stretch the model bounds.
+static void CollapseHiddenSkids(int pChunk) {
+    int first;
+    int skid;
+    int i;
+    br_vector3 anchor;
+    br_vertex* vertices;
+
+    first = pChunk * SKID_CHUNK_SIZE;
+    BrVector3SetFloat(&anchor, 0.0f, 0.0f, 0.0f);
+    for (skid = first; skid < first + SKID_CHUNK_SIZE; skid++) {
+        if (gSkids[skid].visible) {
+            anchor = gSkids[skid].pos;
+            break;
+        }
+    }
+    for (skid = first; skid < first + SKID_CHUNK_SIZE; skid++) {
+        if (!gSkids[skid].visible) {
+            vertices = &gSkid_chunks[pChunk].model->vertices[(skid - first) * 4];
+            for (i = 0; i < 4; i++) {
+                vertices[i].p = anchor;
+            }
+        }
+    }
+}
 
 // GLOBAL: CARM95 0x00507030
 char* gBoring_material_names[2] = { "OILSMEAR.MAT", "ROBSMEAR.MAT" };
@@ -24,10 +124,11 @@ char* gMaterial_names[2] = { "OILSMEAR.MAT", "GIBSMEAR.MAT" };
 // IDA: void __usercall AdjustSkid(int pSkid_num@<EAX>, br_matrix34 *pMatrix@<EDX>, int pMaterial_index@<EBX>)
 // FUNCTION: CARM95 0x00401000
 void AdjustSkid(int pSkid_num, br_matrix34* pMatrix, int pMaterial_index) {
-    memcpy(&gSkids[pSkid_num].actor->t.t.mat, pMatrix, sizeof(br_matrix34));
+    // changed by dethrace: marks live in a shared mesh instead of having an actor each
+    memcpy(&gSkids[pSkid_num].mat, pMatrix, sizeof(br_matrix34));
     memcpy(&gSkids[pSkid_num].pos, &pMatrix->m[3][0], sizeof(br_vector3));
-    gSkids[pSkid_num].actor->material = MaterialFromIndex(pMaterial_index);
-    gSkids[pSkid_num].actor->render_style = BR_RSTYLE_DEFAULT;
+    gSkids[pSkid_num].material = MaterialFromIndex(pMaterial_index);
+    SetSkidVisible(pSkid_num, 1);
 }
 
 // IDA: br_material* __usercall MaterialFromIndex@<EAX>(int pIndex@<EAX>)
@@ -48,6 +149,8 @@ void InitSkids(void) {
     int sl;
     br_model* square;
     char* str;
+    int chunk; // added by dethrace
+    int i;     // added by dethrace
 #if defined(DETHRACE_FIX_BUGS)
     char mat_name[32];
 #endif
@@ -92,31 +195,39 @@ void InitSkids(void) {
 #endif
     }
 
-    for (skid = 0; skid < COUNT_OF(gSkids); skid++) {
-        gSkids[skid].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
-        BrActorAdd(gNon_track_actor, gSkids[skid].actor);
-        gSkids[skid].actor->t.t.mat.m[1][1] = 0.01f;
-        gSkids[skid].actor->render_style = BR_RSTYLE_NONE;
-        square = BrModelAllocate(NULL, 4, 2);
-        BrVector3Set(&square->vertices[0].p, -0.5f, 1.0f, -0.5f);
-        BrVector3Set(&square->vertices[1].p, -0.5f, 1.0f, 0.5f);
-        BrVector3Set(&square->vertices[2].p, 0.5f, 1.0f, 0.5f);
-        BrVector3Set(&square->vertices[3].p, 0.5f, 1.0f, -0.5f);
-        BrVector2Set(&square->vertices[0].map, 0.0f, 0.0f);
-        BrVector2Set(&square->vertices[1].map, 0.0f, 1.0f);
-        BrVector2Set(&square->vertices[2].map, 1.0f, 1.0f);
-        BrVector2Set(&square->vertices[3].map, 1.0f, 0.0f);
-        square->faces[0].vertices[0] = 0;
-        square->faces[0].vertices[1] = 1;
-        square->faces[0].vertices[2] = 2;
-        square->faces[0].smoothing = 1;
-        square->faces[1].vertices[0] = 0;
-        square->faces[1].vertices[1] = 2;
-        square->faces[1].vertices[2] = 3;
-        square->faces[1].smoothing = 1;
-        square->flags |= BR_MODF_KEEP_ORIGINAL;
+    // changed by dethrace: one actor and model per chunk of marks, rather than per mark
+    for (chunk = 0; chunk < SKID_CHUNK_COUNT; chunk++) {
+        gSkid_chunks[chunk].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
+        BrActorAdd(gNon_track_actor, gSkid_chunks[chunk].actor);
+        gSkid_chunks[chunk].actor->render_style = BR_RSTYLE_NONE;
+        square = BrModelAllocate(NULL, SKID_CHUNK_SIZE * 4, SKID_CHUNK_SIZE * 2);
+        for (i = 0; i < SKID_CHUNK_SIZE; i++) {
+            BrVector2Set(&square->vertices[i * 4 + 0].map, 0.0f, 0.0f);
+            BrVector2Set(&square->vertices[i * 4 + 1].map, 0.0f, 1.0f);
+            BrVector2Set(&square->vertices[i * 4 + 2].map, 1.0f, 1.0f);
+            BrVector2Set(&square->vertices[i * 4 + 3].map, 1.0f, 0.0f);
+            square->faces[i * 2 + 0].vertices[0] = i * 4 + 0;
+            square->faces[i * 2 + 0].vertices[1] = i * 4 + 1;
+            square->faces[i * 2 + 0].vertices[2] = i * 4 + 2;
+            square->faces[i * 2 + 0].smoothing = 1;
+            square->faces[i * 2 + 1].vertices[0] = i * 4 + 0;
+            square->faces[i * 2 + 1].vertices[1] = i * 4 + 2;
+            square->faces[i * 2 + 1].vertices[2] = i * 4 + 3;
+            square->faces[i * 2 + 1].smoothing = 1;
+        }
+        square->flags |= BR_MODF_KEEP_ORIGINAL | BR_MODF_UPDATEABLE | BR_MODF_DONT_WELD;
         BrModelAdd(square);
-        gSkids[skid].actor->model = square;
+        gSkid_chunks[chunk].actor->model = square;
+        gSkid_chunks[chunk].model = square;
+        gSkid_chunks[chunk].visible_count = 0;
+        gSkid_chunks[chunk].update_flags = 0;
+        gSkid_chunks[chunk].nudge_distance = 0.0f;
+    }
+    for (skid = 0; skid < COUNT_OF(gSkids); skid++) {
+        BrMatrix34Identity(&gSkids[skid].mat);
+        gSkids[skid].mat.m[1][1] = 0.01f;
+        gSkids[skid].material = NULL;
+        gSkids[skid].visible = 0;
     }
 }
 
@@ -124,7 +235,8 @@ void InitSkids(void) {
 // FUNCTION: CARM95 0x0040148d
 void HideSkid(int pSkid_num) {
 
-    gSkids[pSkid_num].actor->render_style = BR_RSTYLE_NONE;
+    // gSkids[pSkid_num].actor->render_style = BR_RSTYLE_NONE;
+    SetSkidVisible(pSkid_num, 0); // changed by dethrace
 }
 
 // IDA: void __cdecl HideSkids()
@@ -235,23 +347,24 @@ void SkidSection(tCar_spec* pCar, int pWheel_num, br_vector3* pPos, int pMateria
 
     material = MaterialFromIndex(pMaterial_index);
     if (pCar->old_skid[pWheel_num] >= COUNT_OF(gSkids)
-        || gSkids[pCar->old_skid[pWheel_num]].actor->material != material
+        || gSkids[pCar->old_skid[pWheel_num]].material != material // changed by dethrace
         || SkidLen(pCar->old_skid[pWheel_num]) > 0.5f
         || FarFromLine2D(pPos, &pCar->skid_line_start[pWheel_num], &pCar->skid_line_end[pWheel_num])
         || Reflex2D(pPos, &pCar->skid_line_start[pWheel_num], &pCar->prev_skid_pos[pWheel_num])) {
 
         pCar->skid_line_start[pWheel_num] = pCar->prev_skid_pos[pWheel_num];
         pCar->skid_line_end[pWheel_num] = *pPos;
-        gSkids[skid].actor->render_style = BR_RSTYLE_DEFAULT;
-        gSkids[skid].actor->material = material;
+        // changed by dethrace: the mark is shown once StretchMark has placed it
+        gSkids[skid].material = material;
         gSkids[skid].normal = pCar->nor[pWheel_num];
         StretchMark(&gSkids[skid], &pCar->prev_skid_pos[pWheel_num], pPos, pCar->total_length[pWheel_num]);
-        PipeSingleSkidAdjustment(skid, &gSkids[skid].actor->t.t.mat, pMaterial_index);
+        SetSkidVisible(skid, 1);
+        PipeSingleSkidAdjustment(skid, &gSkids[skid].mat, pMaterial_index);
         pCar->old_skid[pWheel_num] = skid;
         skid = (skid + 1) % COUNT_OF(gSkids);
     } else {
         StretchMark(&gSkids[pCar->old_skid[pWheel_num]], &pCar->skid_line_start[pWheel_num], pPos, pCar->total_length[pWheel_num]);
-        PipeSingleSkidAdjustment(pCar->old_skid[pWheel_num], &gSkids[pCar->old_skid[pWheel_num]].actor->t.t.mat, pMaterial_index);
+        PipeSingleSkidAdjustment(pCar->old_skid[pWheel_num], &gSkids[pCar->old_skid[pWheel_num]].mat, pMaterial_index);
     }
 }
 
@@ -262,8 +375,10 @@ void StretchMark(tSkid* pMark, br_vector3* pFrom, br_vector3* pTo, br_scalar pTe
     br_vector3* rows;
     br_scalar len;
     br_model* model;
+    int skid;        // added by dethrace
+    br_vertex* quad; // added by dethrace
 
-    rows = (br_vector3*)&pMark->actor->t.t.mat;
+    rows = (br_vector3*)&pMark->mat;
     BrVector3Sub(&temp, pTo, pFrom);
     len = BrVector3Length(&temp);
 
@@ -284,12 +399,19 @@ void StretchMark(tSkid* pMark, br_vector3* pFrom, br_vector3* pTo, br_scalar pTe
         BrVector3Add(&temp, pTo, pFrom);
         BrVector3Scale(&pMark->pos, &temp, 0.5f);
         rows[3] = pMark->pos;
-        model = pMark->actor->model;
-        model->vertices[1].map.v[0] = pTexture_start / 0.05f;
-        model->vertices[0].map.v[0] = model->vertices[1].map.v[0];
-        model->vertices[3].map.v[0] = (pTexture_start + len) / 0.05f;
-        model->vertices[2].map.v[0] = model->vertices[3].map.v[0];
-        BrModelUpdate(model, BR_MODU_ALL);
+        // changed by dethrace: write the mark into its chunk, which is updated once per frame
+        skid = pMark - gSkids;
+        model = SkidChunk(skid)->model;
+        quad = &model->vertices[(skid % SKID_CHUNK_SIZE) * 4];
+        quad[1].map.v[0] = pTexture_start / 0.05f;
+        quad[0].map.v[0] = quad[1].map.v[0];
+        quad[3].map.v[0] = (pTexture_start + len) / 0.05f;
+        quad[2].map.v[0] = quad[3].map.v[0];
+        if (pMark->visible) {
+            WriteSkidVertices(skid, GroundDetailCameraFactor(&pMark->normal, &pMark->pos));
+        }
+        SkidChunk(skid)->update_flags |= BR_MODU_VERTEX_POSITIONS | BR_MODU_VERTEX_MAPPING;
+        // BrModelUpdate(model, BR_MODU_ALL);
     }
 }
 
@@ -336,9 +458,9 @@ int Reflex2D(br_vector3* pPt, br_vector3* pL1, br_vector3* pL2) {
 // FUNCTION: CARM95 0x004021f1
 br_scalar SkidLen(int pSkid) {
     return sqrt(
-        gSkids[pSkid].actor->t.t.mat.m[0][2] * gSkids[pSkid].actor->t.t.mat.m[0][2]
-        + gSkids[pSkid].actor->t.t.mat.m[0][1] * gSkids[pSkid].actor->t.t.mat.m[0][1]
-        + gSkids[pSkid].actor->t.t.mat.m[0][0] * gSkids[pSkid].actor->t.t.mat.m[0][0]);
+        gSkids[pSkid].mat.m[0][2] * gSkids[pSkid].mat.m[0][2]
+        + gSkids[pSkid].mat.m[0][1] * gSkids[pSkid].mat.m[0][1]
+        + gSkids[pSkid].mat.m[0][0] * gSkids[pSkid].mat.m[0][0]);
 }
 
 // IDA: void __usercall InitCarSkidStuff(tCar_spec *pCar@<EAX>)
@@ -354,23 +476,74 @@ void InitCarSkidStuff(tCar_spec* pCar) {
     }
 }
 
+// Added by dethrace
+// Nudges every visible mark of the chunk towards the camera by its own factor, as EnsureGroundDetailVisible
+// did with each mark's actor
+static void NudgeSkidChunk(int pChunk) {
+    tSkid_chunk* chunk;
+    br_vector3 to_camera;
+    br_scalar dist;
+    int skid;
+
+    chunk = &gSkid_chunks[pChunk];
+    chunk->nudge_camera = *(br_vector3*)gCamera_to_world.m[3];
+    chunk->nudge_distance = FLT_MAX;
+    for (skid = pChunk * SKID_CHUNK_SIZE; skid < (pChunk + 1) * SKID_CHUNK_SIZE; skid++) {
+        if (gSkids[skid].visible) {
+            WriteSkidVertices(skid, GroundDetailCameraFactor(&gSkids[skid].normal, &gSkids[skid].pos));
+            BrVector3Sub(&to_camera, &chunk->nudge_camera, &gSkids[skid].pos);
+            dist = BrVector3Length(&to_camera);
+            chunk->nudge_distance = MIN(chunk->nudge_distance, dist);
+        }
+    }
+    chunk->update_flags |= BR_MODU_VERTEX_POSITIONS;
+}
+
 // IDA: void __cdecl SkidsPerFrame()
 // FUNCTION: CARM95 0x004022f1
 void SkidsPerFrame(void) {
     int skid;
-
-    for (skid = 0; skid < COUNT_OF(gSkids); skid++) {
-        if (gSkids[skid].actor->render_style != BR_RSTYLE_NONE) {
-            EnsureGroundDetailVisible(&gSkids[skid].actor->t.t.translate.t, &gSkids[skid].normal, &gSkids[skid].pos);
+    int chunk;        // added by dethrace
+    br_vector3 moved; // added by dethrace
+
+    // changed by dethrace: marks are nudged towards the camera as they are written, and a chunk's marks
+    // again only once the camera has moved far enough for that to show. Only chunks that changed are updated
+    for (chunk = 0; chunk < SKID_CHUNK_COUNT; chunk++) {
+        if (gSkid_chunks[chunk].visible_count != 0) {
+            BrVector3Sub(&moved, (br_vector3*)gCamera_to_world.m[3], &gSkid_chunks[chunk].nudge_camera);
+            if (BrVector3Length(&moved) >= gSkid_chunks[chunk].nudge_distance * SKID_RENUDGE_FRACTION) {
+                NudgeSkidChunk(chunk);
+            }
+        }
+        if (gSkid_chunks[chunk].update_flags != 0) {
+            if ((gSkid_chunks[chunk].update_flags & ~(BR_MODU_VERTEX_POSITIONS | BR_MODU_VERTEX_MAPPING)) != 0) {
+                CollapseHiddenSkids(chunk);
+            }
+            BrModelUpdate(gSkid_chunks[chunk].model, gSkid_chunks[chunk].update_flags);
+            gSkid_chunks[chunk].update_flags = 0;
         }
+        if (gSkid_chunks[chunk].visible_count == 0) {
+            gSkid_chunks[chunk].actor->render_style = BR_RSTYLE_NONE;
+            continue;
+        }
+        gSkid_chunks[chunk].actor->render_style = BR_RSTYLE_DEFAULT;
     }
 }
 
 // IDA: void __cdecl RemoveMaterialsFromSkidmarks()
 void RemoveMaterialsFromSkidmarks(void) {
     int skid;
+    int chunk; // added by dethrace
 
     for (skid = 0; skid < COUNT_OF(gSkids); skid++) {
-        gSkids[skid].actor->material = NULL;
+        // gSkids[skid].actor->material = NULL;
+        gSkids[skid].material = NULL; // changed by dethrace
+        gSkid_chunks[skid / SKID_CHUNK_SIZE].model->faces[(skid % SKID_CHUNK_SIZE) * 2 + 0].material = NULL;
+        gSkid_chunks[skid / SKID_CHUNK_SIZE].model->faces[(skid % SKID_CHUNK_SIZE) * 2 + 1].material = NULL;
+    }
+    // Added by dethrace: the prepared groups must not keep pointing at the materials
+    for (chunk = 0; chunk < SKID_CHUNK_COUNT; chunk++) {
+        BrModelUpdate(gSkid_chunks[chunk].model, BR_MODU_ALL);
+        gSkid_chunks[chunk].update_flags = 0;
     }
 }
@@ -3,7 +3,10 @@
 
 #include "dr_types.h"
 
-extern tSkid gSkids[100];
+// Added by dethrace: the original game had room for 100 marks
+#define SKID_RING_SIZE 4096
+
+extern tSkid gSkids[SKID_RING_SIZE];
 extern char* gBoring_material_names[2];
 extern char* gMaterial_names[2];
 
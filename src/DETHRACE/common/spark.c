@@ -11,6 +11,7 @@
 #include "globvrkm.h"
 #include "globvrpb.h"
 #include "graphics.h"
+#include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/trace.h"
 #include "loading.h"
@@ -22,24 +23,44 @@
 #include "world.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Added by dethrace
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DETHRACE_SMOKE_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define DETHRACE_SMOKE_AVX2
+#define DETHRACE_SMOKE_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && !defined(__clang__) && _MSC_VER >= 1900
+#define DETHRACE_SMOKE_AVX2
+#define DETHRACE_SMOKE_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DETHRACE_SMOKE_NEON
+#include <arm_neon.h>
+#endif
 
 // GLOBAL: CARM95 0x005149e8
 int gNext_spark;
 
 // GLOBAL: CARM95 0x005149ec
-int gSpark_flags;
+int gSpark_flags; // no longer used by dethrace: liveness is kept by gSpark_pool
 
 // GLOBAL: CARM95 0x005149f0
 int gNext_shrapnel;
 
 // GLOBAL: CARM95 0x005149f4
-int gShrapnel_flags;
+int gShrapnel_flags; // no longer used by dethrace: liveness is kept by gShrapnel_pool
 
 // GLOBAL: CARM95 0x005149f8
 br_model* gShrapnel_model[2];
 
 // GLOBAL: CARM95 0x00514a00
-int gSmoke_flags;
+int gSmoke_flags; // no longer used by dethrace: liveness is kept by gSmoke_pool
 
 // GLOBAL: CARM95 0x00514a04
 int gSmoke_num;
@@ -48,7 +69,7 @@ int gSmoke_num;
 int gOffset = 0;
 
 // GLOBAL: CARM95 0x00514a0c
-int gColumn_flags;
+int gColumn_flags; // no longer used by dethrace: liveness is kept by gColumn_pool
 
 // GLOBAL: CARM95 0x00514a10
 int gNext_column;
@@ -77,30 +98,35 @@ br_pixelmap** gDust_table = &gShade_list[8];
 
 // GLOBAL: CARM95 0x00538618
 br_pixelmap* gFlame_map[20];
-tBRender_smoke* gBR_smoke_pointers[30];
+// tBRender_smoke* gBR_smoke_pointers[30];
+tBRender_smoke** gBR_smoke_pointers; // changed by dethrace: grows with the number of recorded circles
 
 // GLOBAL: CARM95 0x00538298
 tSplash gSplash[32];
 
 // GLOBAL: CARM95 0x00538b00
 br_material* gSplash_material[20];
-tBRender_smoke gBR_smoke_structs[30];
+// tBRender_smoke gBR_smoke_structs[30];
+tBRender_smoke* gBR_smoke_structs; // changed by dethrace
 
 // GLOBAL: CARM95 0x00538de8
-tSmoke_column gSmoke_column[25];
+// tSmoke_column gSmoke_column[25];
+tSmoke_column* gSmoke_column; // changed by dethrace: owned by gColumn_pool
 
 // GLOBAL: CARM95 0x00538668
 br_matrix4 gCameraToScreen;
 
 // GLOBAL: CARM95 0x005398d8
-tSpark gSparks[32];
+// tSpark gSparks[32];
+tSpark* gSparks; // changed by dethrace: owned by gSpark_pool
 
 // GLOBAL: CARM95 0x005509c0
 br_pixelmap* gShade_list[16];
 int gN_BR_smoke_structs;
 
 // GLOBAL: CARM95 0x005386b0
-tSmoke gSmoke[25];
+// tSmoke gSmoke[25];
+tSmoke* gSmoke; // changed by dethrace: owned by gSmoke_pool
 
 // GLOBAL: CARM95 0x0053a0e0
 tU32 gSplash_flags;
@@ -127,7 +153,8 @@ br_camera* gSpark_cam;
 br_material* gBlack_material;
 
 // GLOBAL: CARM95 0x00538b50
-tShrapnel gShrapnel[15];
+// tShrapnel gShrapnel[15];
+tShrapnel* gShrapnel; // changed by dethrace: owned by gShrapnel_pool
 
 // gSmoke_column has 25 elements but all the code just checks the first 5 elements
 #define MAX_SMOKE_COLUMNS 5
@@ -143,6 +170,190 @@ tShrapnel gShrapnel[15];
 #define FLIP_BIT(var, pos)   (var ^= (1 << pos))
 #define CLEAR_BIT(var, pos)  (var &= ~(1 << pos))
 
+// Added by dethrace
+// Sparks, smoke, shrapnel and smoke columns used to live in fixed arrays with a bit mask of
+// live slots, and a new effect simply overwrote the next slot, live or not. Each kind now has
+// a pool that starts at the original size and grows on demand up to
+// `harness_game_config.particle_pool_scale` times that. New effects take a dead slot from the
+// free list; only a pool that cannot grow any further recycles live slots, like the original.
+// Slot indices are what the replay records, so the limits also respect the bits the piping
+// code has for them.
+#define SPARK_POOL_LIMIT    256  // AddSparkToPipingSession keeps the colour in bit 8
+#define SHRAPNEL_POOL_LIMIT 0x8000 // AddShrapnelToPipingSession keeps a flag in bit 15
+#define SMOKE_POOL_LIMIT    0x10000
+#define COLUMN_POOL_LIMIT   0x1000 // AddFlameToPipingSession packs the column into bits 4-15
+
+#define SMOKE_DEPTH_BUCKETS 256
+
+typedef struct tEffect_pool {
+    void** records;
+    size_t record_size;
+    int capacity;
+    int limit;
+    int live_count;
+    int next_recycle;
+    int free_count;
+    int* free_list;
+    tU8* live;
+    tU8* on_free_list;
+    tU8* mark; // per-slot scratch for the owner
+    void (*init_slot)(int pIndex);
+} tEffect_pool;
+
+static tEffect_pool gSpark_pool;
+static tEffect_pool gSmoke_pool;
+static tEffect_pool gShrapnel_pool;
+static tEffect_pool gColumn_pool;
+
+static int gBR_smoke_capacity;
+static tBRender_smoke** gBR_smoke_sorted;
+
+#define EFFECT_LIVE(pool, i) ((pool)->live[i])
+
+// Added by dethrace
+static int EffectPoolGrow(tEffect_pool* pPool, int pCapacity) {
+    int old_capacity;
+    int new_capacity;
+    int i;
+    void* records;
+    int* free_list;
+    tU8* flags;
+
+    if (pCapacity <= pPool->capacity) {
+        return 1;
+    }
+    if (pCapacity > pPool->limit) {
+        return 0;
+    }
+    old_capacity = pPool->capacity;
+    new_capacity = MAX(pCapacity, old_capacity * 2);
+    new_capacity = MIN(new_capacity, pPool->limit);
+
+    records = BrMemAllocate(new_capacity * pPool->record_size, kMem_misc);
+    memset(records, 0, new_capacity * pPool->record_size);
+    free_list = BrMemAllocate(new_capacity * sizeof(int), kMem_misc);
+    flags = BrMemAllocate(new_capacity * 3, kMem_misc);
+    memset(flags, 0, new_capacity * 3);
+    if (old_capacity != 0) {
+        memcpy(records, *pPool->records, old_capacity * pPool->record_size);
+        memcpy(free_list, pPool->free_list, pPool->free_count * sizeof(int));
+        memcpy(flags, pPool->live, old_capacity);
+        memcpy(flags + new_capacity, pPool->on_free_list, old_capacity);
+        memcpy(flags + 2 * new_capacity, pPool->mark, old_capacity);
+        BrMemFree(*pPool->records);
+        BrMemFree(pPool->free_list);
+        BrMemFree(pPool->live);
+    }
+    *pPool->records = records;
+    pPool->free_list = free_list;
+    pPool->live = flags;
+    pPool->on_free_list = flags + new_capacity;
+    pPool->mark = flags + 2 * new_capacity;
+    pPool->capacity = new_capacity;
+    // Push the new slots so that the lowest index comes off the free list first
+    for (i = new_capacity - 1; i >= old_capacity; i--) {
+        pPool->free_list[pPool->free_count] = i;
+        pPool->free_count++;
+        pPool->on_free_list[i] = 1;
+    }
+    if (pPool->init_slot != NULL) {
+        for (i = old_capacity; i < new_capacity; i++) {
+            pPool->init_slot(i);
+        }
+    }
+    return 1;
+}
+
+// Added by dethrace
+static void EffectPoolSetup(tEffect_pool* pPool, void** pRecords, size_t pRecord_size, int pBase_capacity, int pHard_limit, void (*pInit_slot)(int)) {
+    int scale;
+
+    memset(pPool, 0, sizeof(*pPool));
+    scale = MAX(harness_game_config.particle_pool_scale, 1);
+    pPool->records = pRecords;
+    pPool->record_size = pRecord_size;
+    pPool->limit = MIN(pBase_capacity * scale, pHard_limit);
+    pPool->init_slot = pInit_slot;
+    EffectPoolGrow(pPool, pBase_capacity);
+}
+
+// Added by dethrace
+static void EffectPoolDispose(tEffect_pool* pPool) {
+
+    if (pPool->capacity != 0) {
+        BrMemFree(*pPool->records);
+        BrMemFree(pPool->free_list);
+        BrMemFree(pPool->live);
+        *pPool->records = NULL;
+    }
+    memset(pPool, 0, sizeof(*pPool));
+}
+
+// Added by dethrace
+// Returns the slot for a new effect, or -1 before EffectPoolSetup. The caller marks it live; a recycled slot
+// already is.
+static int EffectPoolAllocate(tEffect_pool* pPool) {
+    int i;
+
+    if (pPool->capacity == 0) {
+        return -1;
+    }
+    for (;;) {
+        while (pPool->free_count != 0) {
+            pPool->free_count--;
+            i = pPool->free_list[pPool->free_count];
+            pPool->on_free_list[i] = 0;
+            // Replay may have brought the slot back to life while it sat on the free list
+            if (!pPool->live[i]) {
+                return i;
+            }
+        }
+        if (!EffectPoolGrow(pPool, pPool->capacity + 1)) {
+            break;
+        }
+    }
+    i = pPool->next_recycle;
+    pPool->next_recycle = (i + 1) % pPool->capacity;
+    return i;
+}
+
+// Added by dethrace
+// Returns 0 if the slot is beyond what the pool may grow to.
+static int EffectPoolSetLive(tEffect_pool* pPool, int pIndex) {
+
+    if (!EffectPoolGrow(pPool, pIndex + 1)) {
+        return 0;
+    }
+    if (!pPool->live[pIndex]) {
+        pPool->live[pIndex] = 1;
+        pPool->live_count++;
+    }
+    return 1;
+}
+
+// Added by dethrace
+static void EffectPoolRelease(tEffect_pool* pPool, int pIndex) {
+
+    if (pPool->live[pIndex]) {
+        pPool->live[pIndex] = 0;
+        pPool->live_count--;
+    }
+    if (!pPool->on_free_list[pIndex]) {
+        pPool->on_free_list[pIndex] = 1;
+        pPool->free_list[pPool->free_count] = pIndex;
+        pPool->free_count++;
+    }
+}
+
+// Added by dethrace
+static void EffectPoolReleaseAll(tEffect_pool* pPool) {
+    int i;
+
+    for (i = pPool->capacity - 1; i >= 0; i--) {
+        EffectPoolRelease(pPool, i);
+    }
+}
+
 // IDA: void __cdecl DrawDot(br_scalar z, tU8 *scr_ptr, tU16 *depth_ptr, tU8 *shade_ptr)
 // FUNCTION: CARM95 0x00466310
 void DrawDot(br_scalar z, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr) {
@@ -427,8 +638,8 @@ void ReplaySparks(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_ac
     br_vector3 tv;
     br_vector3 new_pos;
 
-    for (i = 0; i < COUNT_OF(gSparks); i++) {
-        if (TEST_BIT(gSpark_flags, i)) {
+    for (i = 0; i < gSpark_pool.capacity; i++) {  // changed by dethrace
+        if (EFFECT_LIVE(&gSpark_pool, i)) { // changed by dethrace
             if (gSparks[i].car == NULL) {
                 BrVector3Copy(&pos, &gSparks[i].pos);
             } else {
@@ -465,7 +676,8 @@ void RenderSparks(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_ac
     gSpark_cam = pCamera->type_data;
     SetWorldToScreen(pRender_screen);
 
-    if (!gSpark_flags) {
+    // if (!gSpark_flags) {
+    if (gSpark_pool.live_count == 0) { // changed by dethrace
         return;
     }
 
@@ -487,13 +699,13 @@ void RenderSparks(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_ac
         return;
     }
     StartPipingSession(ePipe_chunk_spark);
-    for (i = 0; i < COUNT_OF(gSparks); i++) {
-        if (!TEST_BIT(gSpark_flags, i)) {
+    for (i = 0; i < gSpark_pool.capacity; i++) { // changed by dethrace
+        if (!EFFECT_LIVE(&gSpark_pool, i)) {       // changed by dethrace
             continue;
         }
         if (gSparks[i].count <= 0) {
             gSparks[i].count = 0;
-            CLEAR_BIT(gSpark_flags, i);
+            EffectPoolRelease(&gSpark_pool, i); // changed by dethrace
         }
         ts = BrVector3Dot(&gSparks[i].normal, &gSparks[i].v);
         BrVector3Scale(&tv, &gSparks[i].normal, ts);
@@ -562,18 +774,18 @@ void RenderSparks(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_ac
 // FUNCTION: CARM95 0x0046e43e
 void CreateSingleSpark(tCar_spec* pCar, br_vector3* pPos, br_vector3* pVel) {
 
+    gNext_spark = EffectPoolAllocate(&gSpark_pool); // changed by dethrace: take a slot from the pool, not the next one in the ring
+    if (gNext_spark < 0) { // added by dethrace: the pool has not been set up
+        return;
+    }
     BrVector3Copy(&gSparks[gNext_spark].pos, pPos);
     BrVector3SetFloat(&gSparks[gNext_spark].normal, 0.0f, 0.0f, 0.0f);
     BrVector3Copy(&gSparks[gNext_spark].v, pVel);
     gSparks[gNext_spark].count = 500;
     gSparks[gNext_spark].car = pCar;
-    SET_BIT(gSpark_flags, gNext_spark);
+    EffectPoolSetLive(&gSpark_pool, gNext_spark); // changed by dethrace
     gSparks[gNext_spark].time_sync = 1;
     gSparks[gNext_spark].colour = 1;
-    gNext_spark++;
-    if (gNext_spark >= COUNT_OF(gSparks)) {
-        gNext_spark = 0;
-    }
 }
 
 // IDA: void __usercall CreateSparks(br_vector3 *pos@<EAX>, br_vector3 *v@<EDX>, br_vector3 *pForce@<EBX>, br_scalar sparkiness, tCar_spec *pCar)
@@ -606,6 +818,10 @@ void CreateSparks(br_vector3* pos, br_vector3* v, br_vector3* pForce, br_scalar
         num = 10;
     }
     for (i = 0; i < num; i++) {
+        gNext_spark = EffectPoolAllocate(&gSpark_pool); // changed by dethrace
+        if (gNext_spark < 0) { // added by dethrace: the pool has not been set up
+            break;
+        }
         BrVector3Copy(&gSparks[gNext_spark].pos, pos);
         BrVector3Copy(&gSparks[gNext_spark].normal, &normal);
         BrVector3Copy(&gSparks[gNext_spark].v, v);
@@ -614,13 +830,9 @@ void CreateSparks(br_vector3* pos, br_vector3* v, br_vector3* pForce, br_scalar
         gSparks[gNext_spark].v.v[2] *= FRandomBetween(.5f, .9f);
         gSparks[gNext_spark].count = 1000;
         gSparks[gNext_spark].car = NULL;
-        SET_BIT(gSpark_flags, gNext_spark);
+        EffectPoolSetLive(&gSpark_pool, gNext_spark); // changed by dethrace
         gSparks[gNext_spark].time_sync = gMechanics_time_sync;
         gSparks[gNext_spark].colour = 0;
-        gNext_spark++;
-        if (gNext_spark >= COUNT_OF(gSparks)) {
-            gNext_spark = 0;
-        }
     }
     if ((ts * sparkiness) >= 10.f) {
         tv.v[0] = pos->v[0] - pCar->car_master_actor->t.t.translate.t.v[0] / WORLD_SCALE;
@@ -635,6 +847,10 @@ void CreateSparks(br_vector3* pos, br_vector3* v, br_vector3* pForce, br_scalar
             num = 10;
         }
         for (i = 0; i < num; i++) {
+            gNext_spark = EffectPoolAllocate(&gSpark_pool); // changed by dethrace
+            if (gNext_spark < 0) { // added by dethrace: the pool has not been set up
+                break;
+            }
             BrVector3Copy(&gSparks[gNext_spark].pos, &pos2);
             BrVector3Copy(&gSparks[gNext_spark].normal, &norm);
             BrVector3SetFloat(&tv, FRandomBetween(-1.f, 1.f), FRandomBetween(-.2f, 1.f), FRandomBetween(-1.f, 1.f));
@@ -643,13 +859,9 @@ void CreateSparks(br_vector3* pos, br_vector3* v, br_vector3* pForce, br_scalar
             BrVector3Sub(&gSparks[gNext_spark].v, &tv, &tv2);
             gSparks[gNext_spark].count = 1000;
             gSparks[gNext_spark].car = pCar;
-            SET_BIT(gSpark_flags, gNext_spark);
+            EffectPoolSetLive(&gSpark_pool, gNext_spark); // changed by dethrace
             gSparks[gNext_spark].time_sync = gMechanics_time_sync;
             gSparks[gNext_spark].colour = 0;
-            gNext_spark++;
-            if (gNext_spark >= COUNT_OF(gSparks)) {
-                gNext_spark = 0;
-            }
         }
         CreateShrapnelShower(pos, v, &normal, ts, pCar, pCar);
     }
@@ -687,6 +899,10 @@ void CreateSparkShower(br_vector3* pos, br_vector3* v, br_vector3* pForce, tCar_
     BrMatrix34TApplyV(&normal, pForce, &c->car_master_actor->t.t.mat);
     num = (ts / 10.f) + 3;
     for (i = 0; i < num; i++) {
+        gNext_spark = EffectPoolAllocate(&gSpark_pool); // changed by dethrace
+        if (gNext_spark < 0) { // added by dethrace: the pool has not been set up
+            break;
+        }
         BrVector3Copy(&gSparks[gNext_spark].pos, pos);
         BrVector3SetFloat(&gSparks[gNext_spark].normal, 0.f, 0.f, 0.f);
         BrVector3SetFloat(&normal, FRandomBetween(-1.f, 1.f), FRandomBetween(-.2f, 1.f), FRandomBetween(-1.f, 1.f));
@@ -696,13 +912,9 @@ void CreateSparkShower(br_vector3* pos, br_vector3* v, br_vector3* pForce, tCar_
         BrVector3Accumulate(&gSparks[gNext_spark].v, v);
         gSparks[gNext_spark].count = 1000;
         gSparks[gNext_spark].car = c;
-        SET_BIT(gSpark_flags, gNext_spark);
+        EffectPoolSetLive(&gSpark_pool, gNext_spark); // changed by dethrace
         gSparks[gNext_spark].time_sync = gMechanics_time_sync;
         gSparks[gNext_spark].colour = 0;
-        gNext_spark++;
-        if (gNext_spark >= COUNT_OF(gSparks)) {
-            gNext_spark = 0;
-        }
     }
 }
 
@@ -714,7 +926,10 @@ void AdjustSpark(int pSpark_num, br_vector3* pos, br_vector3* length) {
     int i;
 
     i = pSpark_num & 0xff;
-    SET_BIT(gSpark_flags, pSpark_num);
+    // SET_BIT(gSpark_flags, pSpark_num);
+    if (!EffectPoolSetLive(&gSpark_pool, i)) { // changed by dethrace
+        return;
+    }
     if (gSparks[i].car != NULL) {
         mat = &gSparks[i].car->car_master_actor->t.t.mat;
         tv.v[0] = pos->v[0] - mat->m[3][0];
@@ -738,10 +953,14 @@ void AdjustShrapnel(int pShrapnel_num, br_vector3* pos, tU16 pAge, br_material*
     int i;
 
     i = pShrapnel_num & 0x7fff;
-    if (!TEST_BIT(gShrapnel_flags, i)) {
+    // changed by dethrace: liveness is kept by gShrapnel_pool
+    if (i >= gShrapnel_pool.capacity && !EffectPoolGrow(&gShrapnel_pool, i + 1)) {
+        return;
+    }
+    if (!EFFECT_LIVE(&gShrapnel_pool, i)) {
         BrActorAdd(gNon_track_actor, gShrapnel[i].actor);
     }
-    SET_BIT(gShrapnel_flags, i);
+    EffectPoolSetLive(&gShrapnel_pool, i);
     gShrapnel[i].actor->t.t.translate.t.v[0] = pos->v[0];
     gShrapnel[i].actor->t.t.translate.t.v[1] = pos->v[1];
     gShrapnel[i].actor->t.t.translate.t.v[2] = pos->v[2];
@@ -755,7 +974,8 @@ void AdjustShrapnel(int pShrapnel_num, br_vector3* pos, tU16 pAge, br_material*
 // FUNCTION: CARM95 0x00467abf
 void ResetSparks(void) {
 
-    gSpark_flags = 0;
+    // gSpark_flags = 0;
+    EffectPoolReleaseAll(&gSpark_pool); // changed by dethrace
 }
 
 // IDA: void __cdecl ResetShrapnel()
@@ -763,15 +983,16 @@ void ResetSparks(void) {
 void ResetShrapnel(void) {
     int i;
 
-    if (gShrapnel_flags == 0) {
+    // changed by dethrace: liveness is kept by gShrapnel_pool
+    if (gShrapnel_pool.live_count == 0) {
         return;
     }
-    for (i = 0; i < COUNT_OF(gShrapnel); i++) {
-        if (TEST_BIT(gShrapnel_flags, i)) {
+    for (i = 0; i < gShrapnel_pool.capacity; i++) {
+        if (EFFECT_LIVE(&gShrapnel_pool, i)) {
             BrActorRemove(gShrapnel[i].actor);
         }
     }
-    gShrapnel_flags = 0;
+    EffectPoolReleaseAll(&gShrapnel_pool);
 }
 
 // IDA: void __usercall CreateShrapnelShower(br_vector3 *pos@<EAX>, br_vector3 *v@<EDX>, br_vector3 *pNormal@<EBX>, br_scalar pForce, tCar_spec *c1, tCar_spec *c2)
@@ -803,10 +1024,15 @@ void CreateShrapnelShower(br_vector3* pos, br_vector3* v, br_vector3* pNormal, b
     num = (int)(pForce / 10.f) * 3;
     rnd = ((pForce + 20.f) * 3.f) / 200.f;
     for (i = 0; i < num; i++) {
-        if (!TEST_BIT(gShrapnel_flags, gNext_shrapnel)) {
+        // changed by dethrace: take a slot from the pool rather than the next one in the ring
+        gNext_shrapnel = EffectPoolAllocate(&gShrapnel_pool);
+        if (gNext_shrapnel < 0) { // added by dethrace: the pool has not been set up
+            break;
+        }
+        if (!EFFECT_LIVE(&gShrapnel_pool, gNext_shrapnel)) {
             BrActorAdd(gNon_track_actor, gShrapnel[gNext_shrapnel].actor);
         }
-        SET_BIT(gShrapnel_flags, gNext_shrapnel);
+        EffectPoolSetLive(&gShrapnel_pool, gNext_shrapnel);
         BrVector3Copy(&gShrapnel[gNext_shrapnel].actor->t.t.translate.t, pos);
         BrVector3SetFloat(&tv, FRandomBetween(-rnd, rnd), FRandomBetween(-vel.v[1] + 0.3, rnd), FRandomBetween(-rnd, rnd));
         ts2 = BrVector3Dot(pNormal, &tv);
@@ -821,33 +1047,34 @@ void CreateShrapnelShower(br_vector3* pos, br_vector3* v, br_vector3* pNormal, b
             c = (IRandomBetween(0, 1) != 0) ? c1 : c2;
             gShrapnel[gNext_shrapnel].actor->material = c->shrapnel_material[IRandomBetween(0, c->max_shrapnel_material - 1)];
         }
-        gNext_shrapnel++;
-        if (gNext_shrapnel >= COUNT_OF(gShrapnel)) {
-            gNext_shrapnel = 0;
-        }
     }
 }
 
+// Added by dethrace: the body of the InitShrapnel loop, run for every slot the pool adds
+static void InitShrapnelSlot(int i) {
+
+    gShrapnel[i].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
+    gShrapnel[i].actor->parent = NULL;
+    gShrapnel[i].actor->model = gShrapnel_model[1];
+    gShrapnel[i].actor->render_style = BR_RSTYLE_DEFAULT;
+    gShrapnel[i].actor->t.type = BR_TRANSFORM_MATRIX34;
+    gShrapnel[i].actor->material = BrMaterialFind("DEBRIS.MAT");
+    gShrapnel[i].age = 0;
+    gShrapnel[i].shear1 = FRandomBetween(-2.f, 2.f);
+    gShrapnel[i].shear2 = FRandomBetween(-2.f, 2.f);
+    BrVector3SetFloat(&gShrapnel[i].axis,
+        FRandomBetween(-1.f, 1.f), FRandomBetween(-1.f, 1.f), FRandomBetween(-1.f, 1.f));
+    BrVector3Normalise(&gShrapnel[i].axis, &gShrapnel[i].axis);
+}
+
 // IDA: void __cdecl InitShrapnel()
 // FUNCTION: CARM95 0x0046ec02
 void InitShrapnel(void) {
     int i;
     int j;
 
-    for (i = 0; i < COUNT_OF(gShrapnel); i++) {
-        gShrapnel[i].actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
-        gShrapnel[i].actor->parent = NULL;
-        gShrapnel[i].actor->model = gShrapnel_model[1];
-        gShrapnel[i].actor->render_style = BR_RSTYLE_DEFAULT;
-        gShrapnel[i].actor->t.type = BR_TRANSFORM_MATRIX34;
-        gShrapnel[i].actor->material = BrMaterialFind("DEBRIS.MAT");
-        gShrapnel[i].age = 0;
-        gShrapnel[i].shear1 = FRandomBetween(-2.f, 2.f);
-        gShrapnel[i].shear2 = FRandomBetween(-2.f, 2.f);
-        BrVector3SetFloat(&gShrapnel[i].axis,
-            FRandomBetween(-1.f, 1.f), FRandomBetween(-1.f, 1.f), FRandomBetween(-1.f, 1.f));
-        BrVector3Normalise(&gShrapnel[i].axis, &gShrapnel[i].axis);
-    }
+    // changed by dethrace: slots are initialized by InitShrapnelSlot as the pool grows
+    EffectPoolSetup(&gShrapnel_pool, (void**)&gShrapnel, sizeof(tShrapnel), 15, SHRAPNEL_POOL_LIMIT, InitShrapnelSlot);
 }
 
 // IDA: void __cdecl LoadInShrapnel()
@@ -866,7 +1093,8 @@ void LoadInShrapnel(void) {
 void KillShrapnel(int i) {
 
     BrActorRemove(gShrapnel[i].actor);
-    CLEAR_BIT(gShrapnel_flags, i);
+    // CLEAR_BIT(gShrapnel_flags, i);
+    EffectPoolRelease(&gShrapnel_pool, i); // changed by dethrace
 }
 
 // IDA: void __cdecl DisposeShrapnel()
@@ -874,13 +1102,14 @@ void KillShrapnel(int i) {
 void DisposeShrapnel(void) {
     int i;
 
-    for (i = 0; i < COUNT_OF(gShrapnel); i++) {
-        if (TEST_BIT(gShrapnel_flags, i)) {
+    // changed by dethrace: liveness is kept by gShrapnel_pool
+    for (i = 0; i < gShrapnel_pool.capacity; i++) {
+        if (EFFECT_LIVE(&gShrapnel_pool, i)) {
             BrActorRemove(gShrapnel[i].actor);
         }
         BrActorFree(gShrapnel[i].actor);
     }
-    gShrapnel_flags = 0;
+    EffectPoolDispose(&gShrapnel_pool);
     for (i = 0; i < COUNT_OF(gShrapnel_model); i++) {
         BrModelRemove(gShrapnel_model[i]);
         BrModelFree(gShrapnel_model[i]);
@@ -893,9 +1122,9 @@ void ReplayShrapnel(tU32 pTime) {
     int i;
     br_matrix34* mat;
 
-    for (i = 0; i < COUNT_OF(gShrapnel); i++) {
+    for (i = 0; i < gShrapnel_pool.capacity; i++) { // changed by dethrace
         mat = &gShrapnel[i].actor->t.t.mat;
-        if (TEST_BIT(gShrapnel_flags, i)) {
+        if (EFFECT_LIVE(&gShrapnel_pool, i)) { // changed by dethrace
             gShrapnel[i].age += GetReplayRate() * pTime;
             DrMatrix34Rotate(mat, gShrapnel[i].age * BrDegreeToAngle(1), &gShrapnel[i].axis);
             BrMatrix34PreShearX(mat, gShrapnel[i].shear1, gShrapnel[i].shear2);
@@ -920,9 +1149,9 @@ void MungeShrapnel(tU32 pTime) {
     }
 
     StartPipingSession(ePipe_chunk_shrapnel);
-    for (i = 0; i < COUNT_OF(gShrapnel); i++) {
+    for (i = 0; i < gShrapnel_pool.capacity; i++) { // changed by dethrace
         mat = &gShrapnel[i].actor->t.t.mat;
-        if (!TEST_BIT(gShrapnel_flags, i)) {
+        if (!EFFECT_LIVE(&gShrapnel_pool, i)) { // changed by dethrace
             continue;
         }
         if (gShrapnel[i].age == -1) {
@@ -943,7 +1172,9 @@ void MungeShrapnel(tU32 pTime) {
         DrMatrix34Rotate(mat, 182 * gShrapnel[i].age, &gShrapnel[i].axis);
         BrMatrix34PreShearX(mat, gShrapnel[i].shear1, gShrapnel[i].shear2);
         // bug: should this be using "&gShrapnel[i].v"??
-        ts = 1.0f - BrVector3Length(&gSparks[i].v) / 1.4f * pTime / 1000.0f;
+        // ts = 1.0f - BrVector3Length(&gSparks[i].v) / 1.4f * pTime / 1000.0f;
+        // changed by dethrace: the shrapnel pool can outgrow the spark pool
+        ts = 1.0f - BrVector3Length(&gSparks[i % gSpark_pool.capacity].v) / 1.4f * pTime / 1000.0f;
         if (ts < 0.1f) {
             ts = 0.1f;
         }
@@ -989,6 +1220,304 @@ void DrMatrix34Rotate(br_matrix34* mat, br_angle r, br_vector3* a) {
     mat->m[2][2] = a->v[2] * a->v[2] * t + c;
 }
 
+// Added by dethrace
+// SmokeLine span kernels. The depth test and shade offsets are done for a block of lanes at a time,
+// blocks without a visible pixel are skipped and the shade table lookups are done for the visible lanes only.
+// Lane k of the block at pixel i uses r_squared(i + k) = r_squared(i) + 2 * x(i) * k + k * k, which is
+// what the float stepping of the reference loop produces as long as every value stays below 2^24.
+typedef void (*tSmoke_span_func)(int l, int x, int r_squared, tU16 z, int r_multiplier_int, int shade_offset_int, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr);
+
+static tSmoke_span_func gSmoke_span;
+static int gSmoke_span_selected;
+
+// Integer stepping version of the reference loop, used for the pixels after the last full block
+static void SmokeSpanTail(int l, int x, int r_squared, tU16 z, int r_multiplier_int, int shade_offset_int, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr) {
+    int i;
+    int offset;
+
+    for (i = 0; i < l; i++) {
+        if (depth_ptr[i] > z) {
+            offset = ((int)((tU32)shade_offset_int - (tU32)r_squared * (tU32)r_multiplier_int) >> 8) & 0xffffff00;
+#if defined(DETHRACE_FIX_BUGS)
+            offset = MAX(0, offset);
+#endif
+            scr_ptr[i] = shade_ptr[scr_ptr[i] + offset];
+        }
+        r_squared += 2 * (x + i) + 1;
+    }
+}
+
+// Shade numerator of every lane of the first block, and how much more each lane loses per block than lane 0
+static void SmokeSpanLanes(tU32* pNumerator, tU32* pLane_step, int pLanes, int x, int r_squared, int r_multiplier_int, int shade_offset_int) {
+    int k;
+
+    for (k = 0; k < pLanes; k++) {
+        pNumerator[k] = (tU32)shade_offset_int - (tU32)(r_squared + 2 * x * k + k * k) * (tU32)r_multiplier_int;
+        pLane_step[k] = 2u * pLanes * k * (tU32)r_multiplier_int;
+    }
+}
+
+// Amount every lane loses when moving on one block from pixel x
+static tU32 SmokeSpanBlockStep(int pLanes, int x, int r_multiplier_int) {
+    return (tU32)(2 * pLanes * x + pLanes * pLanes) * (tU32)r_multiplier_int;
+}
+
+static void SmokeSpanPut(tU8* scr_ptr, tU8* shade_ptr, int* pIndex, int pLanes, unsigned int pMask) {
+    int k;
+
+    for (k = 0; k < pLanes; k++) {
+        if (pMask & (1u << k)) {
+            scr_ptr[k] = shade_ptr[pIndex[k]];
+        }
+    }
+}
+
+#if defined(DETHRACE_SMOKE_SSE2)
+static void SmokeSpanSSE2(int l, int x, int r_squared, tU16 z, int r_multiplier_int, int shade_offset_int, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr) {
+    int i;
+    unsigned int mask;
+    int index[8];
+    tU32 numerator[8];
+    tU32 lane_step[8];
+    __m128i zero;
+    __m128i bias;
+    __m128i z_vec;
+    __m128i offset_mask;
+    __m128i depth_vec;
+    __m128i scr_vec;
+    __m128i n_lo;
+    __m128i n_hi;
+    __m128i step_lo;
+    __m128i step_hi;
+    __m128i block_step;
+    __m128i off_lo;
+    __m128i off_hi;
+
+    SmokeSpanLanes(numerator, lane_step, 8, x, r_squared, r_multiplier_int, shade_offset_int);
+    n_lo = _mm_loadu_si128((const __m128i*)&numerator[0]);
+    n_hi = _mm_loadu_si128((const __m128i*)&numerator[4]);
+    step_lo = _mm_loadu_si128((const __m128i*)&lane_step[0]);
+    step_hi = _mm_loadu_si128((const __m128i*)&lane_step[4]);
+    zero = _mm_setzero_si128();
+    // SSE2 only compares signed words
+    bias = _mm_set1_epi16((short)0x8000);
+    z_vec = _mm_xor_si128(_mm_set1_epi16((short)z), bias);
+    offset_mask = _mm_set1_epi32((int)0xffffff00);
+
+    for (i = 0; i + 8 <= l; i += 8) {
+        depth_vec = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&depth_ptr[i]), bias);
+        mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpgt_epi16(depth_vec, z_vec), zero));
+        if (mask != 0) {
+            off_lo = _mm_and_si128(_mm_srai_epi32(n_lo, 8), offset_mask);
+            off_hi = _mm_and_si128(_mm_srai_epi32(n_hi, 8), offset_mask);
+#if defined(DETHRACE_FIX_BUGS)
+            off_lo = _mm_andnot_si128(_mm_srai_epi32(off_lo, 31), off_lo);
+            off_hi = _mm_andnot_si128(_mm_srai_epi32(off_hi, 31), off_hi);
+#endif
+            scr_vec = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&scr_ptr[i]), zero);
+            _mm_storeu_si128((__m128i*)&index[0], _mm_add_epi32(off_lo, _mm_unpacklo_epi16(scr_vec, zero)));
+            _mm_storeu_si128((__m128i*)&index[4], _mm_add_epi32(off_hi, _mm_unpackhi_epi16(scr_vec, zero)));
+            SmokeSpanPut(&scr_ptr[i], shade_ptr, index, 8, mask);
+        }
+        block_step = _mm_set1_epi32((int)SmokeSpanBlockStep(8, x + i, r_multiplier_int));
+        n_lo = _mm_sub_epi32(n_lo, _mm_add_epi32(block_step, step_lo));
+        n_hi = _mm_sub_epi32(n_hi, _mm_add_epi32(block_step, step_hi));
+        r_squared += 16 * (x + i) + 64;
+    }
+    SmokeSpanTail(l - i, x + i, r_squared, z, r_multiplier_int, shade_offset_int, &scr_ptr[i], &depth_ptr[i], shade_ptr);
+}
+#endif
+
+#if defined(DETHRACE_SMOKE_AVX2)
+DETHRACE_SMOKE_AVX2_TARGET static void SmokeSpanAVX2(int l, int x, int r_squared, tU16 z, int r_multiplier_int, int shade_offset_int, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr) {
+    int i;
+    unsigned int mask;
+    int index[16];
+    tU32 numerator[16];
+    tU32 lane_step[16];
+    __m256i bias;
+    __m256i z_vec;
+    __m256i offset_mask;
+    __m256i depth_vec;
+    __m128i scr_vec;
+    __m256i n_lo;
+    __m256i n_hi;
+    __m256i step_lo;
+    __m256i step_hi;
+    __m256i block_step;
+    __m256i off_lo;
+    __m256i off_hi;
+
+    SmokeSpanLanes(numerator, lane_step, 16, x, r_squared, r_multiplier_int, shade_offset_int);
+    n_lo = _mm256_loadu_si256((const __m256i*)&numerator[0]);
+    n_hi = _mm256_loadu_si256((const __m256i*)&numerator[8]);
+    step_lo = _mm256_loadu_si256((const __m256i*)&lane_step[0]);
+    step_hi = _mm256_loadu_si256((const __m256i*)&lane_step[8]);
+    bias = _mm256_set1_epi16((short)0x8000);
+    z_vec = _mm256_xor_si256(_mm256_set1_epi16((short)z), bias);
+    offset_mask = _mm256_set1_epi32((int)0xffffff00);
+
+    for (i = 0; i + 16 <= l; i += 16) {
+        depth_vec = _mm256_cmpgt_epi16(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&depth_ptr[i]), bias), z_vec);
+        mask = _mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(depth_vec), _mm256_extracti128_si256(depth_vec, 1)));
+        if (mask != 0) {
+            off_lo = _mm256_and_si256(_mm256_srai_epi32(n_lo, 8), offset_mask);
+            off_hi = _mm256_and_si256(_mm256_srai_epi32(n_hi, 8), offset_mask);
+#if defined(DETHRACE_FIX_BUGS)
+            off_lo = _mm256_max_epi32(off_lo, _mm256_setzero_si256());
+            off_hi = _mm256_max_epi32(off_hi, _mm256_setzero_si256());
+#endif
+            scr_vec = _mm_loadu_si128((const __m128i*)&scr_ptr[i]);
+            _mm256_storeu_si256((__m256i*)&index[0], _mm256_add_epi32(off_lo, _mm256_cvtepu8_epi32(scr_vec)));
+            _mm256_storeu_si256((__m256i*)&index[8], _mm256_add_epi32(off_hi, _mm256_cvtepu8_epi32(_mm_srli_si128(scr_vec, 8))));
+            SmokeSpanPut(&scr_ptr[i], shade_ptr, index, 16, mask);
+        }
+        block_step = _mm256_set1_epi32((int)SmokeSpanBlockStep(16, x + i, r_multiplier_int));
+        n_lo = _mm256_sub_epi32(n_lo, _mm256_add_epi32(block_step, step_lo));
+        n_hi = _mm256_sub_epi32(n_hi, _mm256_add_epi32(block_step, step_hi));
+        r_squared += 32 * (x + i) + 256;
+    }
+    SmokeSpanTail(l - i, x + i, r_squared, z, r_multiplier_int, shade_offset_int, &scr_ptr[i], &depth_ptr[i], shade_ptr);
+}
+
+static int SmokeCPUHasAVX2(void) {
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return 0;
+    }
+    __cpuid(info, 1);
+    // osxsave and avx, then check the os saves the ymm registers
+    if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6) {
+        return 0;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#if defined(DETHRACE_SMOKE_NEON)
+static void SmokeSpanNEON(int l, int x, int r_squared, tU16 z, int r_multiplier_int, int shade_offset_int, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr) {
+    static const tU8 lane_bits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    int i;
+    unsigned int mask;
+    int index[8];
+    tU32 numerator[8];
+    tU32 lane_step[8];
+    uint16x8_t z_vec;
+    uint8x8_t bits;
+    uint16x8_t scr_vec;
+    int32x4_t offset_mask;
+    int32x4_t n_lo;
+    int32x4_t n_hi;
+    int32x4_t step_lo;
+    int32x4_t step_hi;
+    int32x4_t block_step;
+    int32x4_t off_lo;
+    int32x4_t off_hi;
+
+    SmokeSpanLanes(numerator, lane_step, 8, x, r_squared, r_multiplier_int, shade_offset_int);
+    n_lo = vreinterpretq_s32_u32(vld1q_u32(&numerator[0]));
+    n_hi = vreinterpretq_s32_u32(vld1q_u32(&numerator[4]));
+    step_lo = vreinterpretq_s32_u32(vld1q_u32(&lane_step[0]));
+    step_hi = vreinterpretq_s32_u32(vld1q_u32(&lane_step[4]));
+    z_vec = vdupq_n_u16(z);
+    bits = vld1_u8(lane_bits);
+    offset_mask = vdupq_n_s32((int)0xffffff00);
+
+    for (i = 0; i + 8 <= l; i += 8) {
+        mask = vaddv_u8(vand_u8(vmovn_u16(vcgtq_u16(vld1q_u16(&depth_ptr[i]), z_vec)), bits));
+        if (mask != 0) {
+            off_lo = vandq_s32(vshrq_n_s32(n_lo, 8), offset_mask);
+            off_hi = vandq_s32(vshrq_n_s32(n_hi, 8), offset_mask);
+#if defined(DETHRACE_FIX_BUGS)
+            off_lo = vmaxq_s32(off_lo, vdupq_n_s32(0));
+            off_hi = vmaxq_s32(off_hi, vdupq_n_s32(0));
+#endif
+            scr_vec = vmovl_u8(vld1_u8(&scr_ptr[i]));
+            vst1q_s32(&index[0], vaddq_s32(off_lo, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(scr_vec)))));
+            vst1q_s32(&index[4], vaddq_s32(off_hi, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(scr_vec)))));
+            SmokeSpanPut(&scr_ptr[i], shade_ptr, index, 8, mask);
+        }
+        block_step = vdupq_n_s32((int)SmokeSpanBlockStep(8, x + i, r_multiplier_int));
+        n_lo = vsubq_s32(n_lo, vaddq_s32(block_step, step_lo));
+        n_hi = vsubq_s32(n_hi, vaddq_s32(block_step, step_hi));
+        r_squared += 16 * (x + i) + 64;
+    }
+    SmokeSpanTail(l - i, x + i, r_squared, z, r_multiplier_int, shade_offset_int, &scr_ptr[i], &depth_ptr[i], shade_ptr);
+}
+#endif
+
+int SmokeSpanKernelSupported(tSmoke_span_kernel pKernel) {
+    switch (pKernel) {
+    case eSmoke_span_scalar:
+    case eSmoke_span_auto:
+        return 1;
+#if defined(DETHRACE_SMOKE_SSE2)
+    case eSmoke_span_sse2:
+        return 1;
+#endif
+#if defined(DETHRACE_SMOKE_AVX2)
+    case eSmoke_span_avx2:
+        return SmokeCPUHasAVX2();
+#endif
+#if defined(DETHRACE_SMOKE_NEON)
+    case eSmoke_span_neon:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+// Unsupported kernels fall back to the scalar reference loop
+void SetSmokeSpanKernel(tSmoke_span_kernel pKernel) {
+    if (pKernel == eSmoke_span_auto) {
+        pKernel = eSmoke_span_scalar;
+        if (SmokeSpanKernelSupported(eSmoke_span_avx2)) {
+            pKernel = eSmoke_span_avx2;
+        } else if (SmokeSpanKernelSupported(eSmoke_span_sse2)) {
+            pKernel = eSmoke_span_sse2;
+        } else if (SmokeSpanKernelSupported(eSmoke_span_neon)) {
+            pKernel = eSmoke_span_neon;
+        }
+    }
+    if (!SmokeSpanKernelSupported(pKernel)) {
+        pKernel = eSmoke_span_scalar;
+    }
+    switch (pKernel) {
+#if defined(DETHRACE_SMOKE_SSE2)
+    case eSmoke_span_sse2:
+        gSmoke_span = SmokeSpanSSE2;
+        break;
+#endif
+#if defined(DETHRACE_SMOKE_AVX2)
+    case eSmoke_span_avx2:
+        gSmoke_span = SmokeSpanAVX2;
+        break;
+#endif
+#if defined(DETHRACE_SMOKE_NEON)
+    case eSmoke_span_neon:
+        gSmoke_span = SmokeSpanNEON;
+        break;
+#endif
+    default:
+        gSmoke_span = NULL;
+        break;
+    }
+    gSmoke_span_selected = 1;
+}
+
+// The kernels step r_squared with integers, the reference loop with floats. They agree while nothing passes 2^24.
+static int SmokeSpanIsExact(int l, int x, int r_squared) {
+    return fabs((double)r_squared) + (double)l * (2.0 * (fabs((double)x) + l) + 1.0) + fabs((double)x) + l < 16777216.0;
+}
+
 // IDA: void __usercall SmokeLine(int l@<EAX>, int x@<EDX>, br_scalar zbuff, int r_squared, tU8 *scr_ptr, tU16 *depth_ptr, tU8 *shade_ptr, br_scalar r_multiplier, br_scalar z_multiplier, br_scalar shade_offset)
 // FUNCTION: CARM95 0x00469fc0
 void SmokeLine(int l, int x, br_scalar zbuff, int r_squared, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr, br_scalar r_multiplier, br_scalar z_multiplier, br_scalar shade_offset) {
@@ -1006,6 +1535,15 @@ void SmokeLine(int l, int x, br_scalar zbuff, int r_squared, tU8* scr_ptr, tU16*
     r_multiplier_int = r_multiplier * 65536.0f;
     shade_offset_int = shade_offset * 65536.0f;
 
+    // Added by dethrace
+    if (!gSmoke_span_selected) {
+        SetSmokeSpanKernel(eSmoke_span_auto);
+    }
+    if (gSmoke_span != NULL && SmokeSpanIsExact(l, x, r_squared)) {
+        gSmoke_span(l, x, r_squared, z, r_multiplier_int, shade_offset_int, scr_ptr, depth_ptr, shade_ptr);
+        return;
+    }
+
     for (i = 0; i < l; i++) {
         if (*depth_ptr > z) {
             offset = ((shade_offset_int - r_squared * r_multiplier_int) >> 8) & 0xffffff00;
@@ -1219,6 +1757,46 @@ int CmpSmokeZ(const void* p1, const void* p2) {
     }
 }
 
+// Added by dethrace
+// Orders gBR_smoke_pointers back to front like BrQsort(CmpSmokeZ) did, but in linear time by
+// distributing the circles over depth buckets. Circles that share a bucket keep the order they
+// were recorded in.
+static void SortRecordedSmokeByDepth(void) {
+    static int bucket_start[SMOKE_DEPTH_BUCKETS + 1];
+    int i;
+    int b;
+    br_scalar min_z;
+    br_scalar max_z;
+    br_scalar scale;
+
+    if (gN_BR_smoke_structs < 2) {
+        return;
+    }
+    min_z = max_z = gBR_smoke_pointers[0]->pos.v[2];
+    for (i = 1; i < gN_BR_smoke_structs; i++) {
+        min_z = MIN(min_z, gBR_smoke_pointers[i]->pos.v[2]);
+        max_z = MAX(max_z, gBR_smoke_pointers[i]->pos.v[2]);
+    }
+    if (max_z <= min_z) {
+        return;
+    }
+    scale = (SMOKE_DEPTH_BUCKETS - 1) / (max_z - min_z);
+    memset(bucket_start, 0, sizeof(bucket_start));
+    for (i = 0; i < gN_BR_smoke_structs; i++) {
+        b = (int)((gBR_smoke_pointers[i]->pos.v[2] - min_z) * scale);
+        bucket_start[b + 1]++;
+    }
+    for (b = 0; b < SMOKE_DEPTH_BUCKETS; b++) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    for (i = 0; i < gN_BR_smoke_structs; i++) {
+        b = (int)((gBR_smoke_pointers[i]->pos.v[2] - min_z) * scale);
+        gBR_smoke_sorted[bucket_start[b]] = gBR_smoke_pointers[i];
+        bucket_start[b]++;
+    }
+    memcpy(gBR_smoke_pointers, gBR_smoke_sorted, gN_BR_smoke_structs * sizeof(tBRender_smoke*));
+}
+
 // IDA: void __cdecl RenderRecordedSmokeCircles()
 void RenderRecordedSmokeCircles(void) {
     int i;
@@ -1227,7 +1805,8 @@ void RenderRecordedSmokeCircles(void) {
     tU8 grn;
     tU8 blu;
 
-    BrQsort(gBR_smoke_pointers, gN_BR_smoke_structs, sizeof(void*), CmpSmokeZ);
+    // BrQsort(gBR_smoke_pointers, gN_BR_smoke_structs, sizeof(void*), CmpSmokeZ);
+    SortRecordedSmokeByDepth(); // changed by dethrace
 
     for (i = 0; i < gN_BR_smoke_structs; i++) {
         smoke = gBR_smoke_pointers[i];
@@ -1257,11 +1836,39 @@ void RenderRecordedSmokeCircles(void) {
     }
 }
 
+// Added by dethrace
+static void GrowRecordedSmoke(void) {
+    int i;
+    int capacity;
+    tBRender_smoke* structs;
+
+    capacity = MAX(30, gBR_smoke_capacity * 2);
+    structs = BrMemAllocate(capacity * sizeof(tBRender_smoke), kMem_misc);
+    if (gBR_smoke_capacity != 0) {
+        memcpy(structs, gBR_smoke_structs, gN_BR_smoke_structs * sizeof(tBRender_smoke));
+        BrMemFree(gBR_smoke_structs);
+        BrMemFree(gBR_smoke_pointers);
+        BrMemFree(gBR_smoke_sorted);
+    }
+    gBR_smoke_structs = structs;
+    gBR_smoke_pointers = BrMemAllocate(capacity * sizeof(tBRender_smoke*), kMem_misc);
+    gBR_smoke_sorted = BrMemAllocate(capacity * sizeof(tBRender_smoke*), kMem_misc);
+    for (i = 0; i < gN_BR_smoke_structs; i++) {
+        gBR_smoke_pointers[i] = &gBR_smoke_structs[i];
+    }
+    gBR_smoke_capacity = capacity;
+}
+
 // IDA: void __usercall RecordSmokeCircle(br_vector3 *pCent@<EAX>, br_scalar pR, br_scalar pStrength, br_pixelmap *pShade, br_scalar pAspect)
 void RecordSmokeCircle(br_vector3* pCent, br_scalar pR, br_scalar pStrength, br_pixelmap* pShade, br_scalar pAspect) {
     tU8 shade_index;
     br_colour shade_rgb;
 
+    // Added by dethrace: there can be more circles than the original 30
+    if (gN_BR_smoke_structs >= gBR_smoke_capacity) {
+        GrowRecordedSmoke();
+    }
+
     if (gRendering_mirror) {
         DRMatrix34TApplyP(&gBR_smoke_structs[gN_BR_smoke_structs].pos, pCent, &gRearview_camera_to_world);
     } else {
@@ -1314,8 +1921,9 @@ void ReplaySmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
     br_scalar aspect;
     int i;
 
-    for (i = 0; i < COUNT_OF(gSmoke_column); i++) {
-        if (TEST_BIT(gSmoke_flags, i)) {
+    // for (i = 0; i < COUNT_OF(gSmoke_column); i++) {
+    for (i = 0; i < gSmoke_pool.capacity; i++) { // changed by dethrace
+        if (EFFECT_LIVE(&gSmoke_pool, i)) {      // changed by dethrace
             aspect = 1.0 + (gSmoke[i].radius - .05f) / .25f * .5;
             if (gSmoke[i].type & 0x10) {
                 SmokeCircle3D(&gSmoke[i].pos, gSmoke[i].radius / aspect, gSmoke[i].strength, 1.f,
@@ -1410,10 +2018,13 @@ void RenderSmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
     br_scalar aspect;
     br_scalar ts;
     tU32 seed;
-    tU32 not_lonely;
+    // tU32 not_lonely;
+    tU8* not_lonely; // changed by dethrace: one flag per pool slot
 
     BrVector3Set(&tv, 0, 0, 0);
-    not_lonely = 0;
+    // not_lonely = 0;
+    not_lonely = gSmoke_pool.mark; // changed by dethrace
+    memset(not_lonely, 0, gSmoke_pool.capacity);
 #ifdef DETHRACE_3DFX_PATCH
     if (gNo_2d_effects) {
         gBlend_actor->render_style = BR_RSTYLE_FACES;
@@ -1424,7 +2035,8 @@ void RenderSmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
 #endif
     DrawTheGlow(pRender_screen, pDepth_buffer, pCamera);
 
-    if (gSmoke_flags == 0) {
+    // if (gSmoke_flags == 0) {
+    if (gSmoke_pool.live_count == 0) { // changed by dethrace
 #ifdef DETHRACE_3DFX_PATCH
         if (gNo_2d_effects) {
             BrActorRemove(gBlend_actor);
@@ -1448,12 +2060,12 @@ void RenderSmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
         return;
     }
     StartPipingSession(ePipe_chunk_smoke);
-    for (i = 0; i < COUNT_OF(gSmoke); i++) {
-        if (!TEST_BIT(gSmoke_flags, i)) {
+    for (i = 0; i < gSmoke_pool.capacity; i++) { // changed by dethrace
+        if (!EFFECT_LIVE(&gSmoke_pool, i)) {       // changed by dethrace
             continue;
         }
         if (gSmoke[i].strength <= 0.0f) {
-            CLEAR_BIT(gSmoke_flags, i);
+            EffectPoolRelease(&gSmoke_pool, i); // changed by dethrace
             continue;
         }
         if (gSmoke[i].time_sync) {
@@ -1464,27 +2076,28 @@ void RenderSmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
         }
         BrVector3Accumulate(&gSmoke[i].pos, &tv);
     }
-    for (i = 0; i < COUNT_OF(gSmoke); i++) {
-        if (!TEST_BIT(gSmoke_flags, i)) {
+    // changed by dethrace: the pool replaces gSmoke_flags, and not_lonely holds a byte per slot
+    for (i = 0; i < gSmoke_pool.capacity; i++) {
+        if (!EFFECT_LIVE(&gSmoke_pool, i)) {
             continue;
         }
         if ((gSmoke[i].type & 0xf) == 7) {
-            SET_BIT(not_lonely, i);
-        } else if (!TEST_BIT(not_lonely, i)) {
-            for (j = i + 1; j < COUNT_OF(gSmoke); j++) {
-                if (!TEST_BIT(gSmoke_flags, j)) {
+            not_lonely[i] = 1;
+        } else if (!not_lonely[i]) {
+            for (j = i + 1; j < gSmoke_pool.capacity; j++) {
+                if (!EFFECT_LIVE(&gSmoke_pool, j)) {
                     continue;
                 }
                 BrVector3Sub(&tv, &gSmoke[i].pos, &gSmoke[i].pos);
                 ts = BrVector3LengthSquared(&tv);
                 if ((gSmoke[i].radius + gSmoke[j].radius) * (gSmoke[i].radius + gSmoke[j].radius) > ts) {
-                    SET_BIT(not_lonely, i);
-                    SET_BIT(not_lonely, j);
+                    not_lonely[i] = 1;
+                    not_lonely[j] = 1;
                     break;
                 }
             }
         }
-        if (!TEST_BIT(not_lonely, i)) {
+        if (!not_lonely[i]) {
             gSmoke[i].strength = gSmoke[i].strength / 2.0f;
         }
         aspect = (gSmoke[i].radius - 0.05f) / 0.25f * 0.5 + 1.0;
@@ -1502,7 +2115,7 @@ void RenderSmoke(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
             gSmoke[i].radius = 0.3f;
         }
         if (gSmoke[i].strength <= 0.0f) {
-            CLEAR_BIT(gSmoke_flags, i);
+            EffectPoolRelease(&gSmoke_pool, i); // changed by dethrace
             continue;
         }
         ts = 1.0f - pTime * 0.002f;
@@ -1554,6 +2167,10 @@ void CreatePuffOfSmoke(br_vector3* pos, br_vector3* v, br_scalar strength, br_sc
         pipe_me = 0;
     }
 
+    gSmoke_num = EffectPoolAllocate(&gSmoke_pool); // changed by dethrace: take a slot from the pool, not the next one in the ring
+    if (gSmoke_num < 0) { // added by dethrace: the pool has not been set up
+        return;
+    }
     BrVector3InvScale(&gSmoke[gSmoke_num].v, v, WORLD_SCALE);
     gSmoke[gSmoke_num].v.v[1] += (1.0 / WORLD_SCALE_D);
     BrVector3Copy(&gSmoke[gSmoke_num].pos, pos);
@@ -1568,33 +2185,34 @@ void CreatePuffOfSmoke(br_vector3* pos, br_vector3* v, br_scalar strength, br_sc
         strength = 1.0f;
     }
     gSmoke[gSmoke_num].strength = strength;
-    SET_BIT(gSmoke_flags, gSmoke_num);
+    EffectPoolSetLive(&gSmoke_pool, gSmoke_num); // changed by dethrace
     gSmoke[gSmoke_num].time_sync = gMechanics_time_sync;
     gSmoke[gSmoke_num].type = pType;
     gSmoke[gSmoke_num].decay_factor = pDecay_factor;
     gSmoke[gSmoke_num].pipe_me = 1;
-    gSmoke_num++;
-    if (gSmoke_num >= COUNT_OF(gSmoke)) {
-        gSmoke_num = 0;
-    }
 }
 
 // IDA: void __cdecl ResetSmoke()
 // FUNCTION: CARM95 0x0046a58d
 void ResetSmoke(void) {
 
-    gSmoke_flags = 0;
+    // gSmoke_flags = 0;
+    EffectPoolReleaseAll(&gSmoke_pool); // changed by dethrace
 }
 
 // IDA: void __usercall AdjustSmoke(int pIndex@<EAX>, tU8 pType@<EDX>, br_vector3 *pPos@<EBX>, br_scalar pRadius, br_scalar pStrength)
 // FUNCTION: CARM95 0x0046a5a2
 void AdjustSmoke(int pIndex, tU8 pType, br_vector3* pPos, br_scalar pRadius, br_scalar pStrength) {
 
+    // Added by dethrace: the slot has to exist before it is written
+    if (!EffectPoolSetLive(&gSmoke_pool, pIndex)) {
+        return;
+    }
     gSmoke[pIndex].type = pType;
     gSmoke[pIndex].radius = pRadius;
     gSmoke[pIndex].strength = pStrength;
     BrVector3Copy(&gSmoke[pIndex].pos, pPos);
-    SET_BIT(gSmoke_flags, pIndex);
+    // SET_BIT(gSmoke_flags, pIndex);
 }
 
 // IDA: void __cdecl ActorError()
@@ -1608,7 +2226,16 @@ void AdjustSmokeColumn(int pIndex, tCar_spec* pCar, int pVertex, int pColour) {
     int i;
     br_actor* actor;
 
-    FLIP_BIT(gColumn_flags, pIndex);
+    // FLIP_BIT(gColumn_flags, pIndex);
+    // changed by dethrace: liveness is kept by gColumn_pool
+    if (pIndex >= gColumn_pool.capacity && !EffectPoolGrow(&gColumn_pool, pIndex + 1)) {
+        return;
+    }
+    if (EFFECT_LIVE(&gColumn_pool, pIndex)) {
+        EffectPoolRelease(&gColumn_pool, pIndex);
+    } else {
+        EffectPoolSetLive(&gColumn_pool, pIndex);
+    }
     gSmoke_column[pIndex].car = pCar;
     gSmoke_column[pIndex].vertex_index = pVertex;
     gSmoke_column[pIndex].colour = pColour;
@@ -1616,7 +2243,7 @@ void AdjustSmokeColumn(int pIndex, tCar_spec* pCar, int pVertex, int pColour) {
         gSmoke_column[pIndex].frame_count[i] = 100;
     }
     if (pColour == 0) {
-        if (TEST_BIT(gColumn_flags, pIndex)) {
+        if (EFFECT_LIVE(&gColumn_pool, pIndex)) {
             if (gSmoke_column[pIndex].flame_actor->depth != 0) {
                 ActorError();
             }
@@ -1637,7 +2264,7 @@ void CreateSmokeColumn(tCar_spec* pCar, int pColour, int pVertex_index, tU32 pLi
     br_actor* actor;
     tSmoke_column* col;
 
-    col = &gSmoke_column[gNext_column];
+    // col = &gSmoke_column[gNext_column];
     if (pCar->last_special_volume != NULL && pCar->last_special_volume->gravity_multiplier < 1.0f) {
         return;
     }
@@ -1648,7 +2275,13 @@ void CreateSmokeColumn(tCar_spec* pCar, int pColour, int pVertex_index, tU32 pLi
     if (!gSmoke_on) {
         return;
     }
-    if (TEST_BIT(gColumn_flags, gNext_column)) {
+    // changed by dethrace: take a column from the pool rather than the next one in the ring
+    gNext_column = EffectPoolAllocate(&gColumn_pool);
+    if (gNext_column < 0) { // added by dethrace: the pool has not been set up
+        return;
+    }
+    col = &gSmoke_column[gNext_column];
+    if (EFFECT_LIVE(&gColumn_pool, gNext_column)) {
         if (gSmoke_column[gNext_column].car != NULL) {
             gSmoke_column[gNext_column].car->num_smoke_columns--;
         }
@@ -1668,10 +2301,10 @@ void CreateSmokeColumn(tCar_spec* pCar, int pColour, int pVertex_index, tU32 pLi
             EndPipingSession();
         }
     }
-    if (pColour == 0 && (!TEST_BIT(gColumn_flags, gNext_column) || gSmoke_column[gNext_column].colour != 0)) {
+    if (pColour == 0 && (!EFFECT_LIVE(&gColumn_pool, gNext_column) || gSmoke_column[gNext_column].colour != 0)) {
         BrActorAdd(gNon_track_actor, gSmoke_column[gNext_column].flame_actor);
     }
-    if (pColour != 0 && (TEST_BIT(gColumn_flags, gNext_column) && gSmoke_column[gNext_column].colour == 0)) {
+    if (pColour != 0 && (EFFECT_LIVE(&gColumn_pool, gNext_column) && gSmoke_column[gNext_column].colour == 0)) {
         BrActorRemove(gSmoke_column[gNext_column].flame_actor);
     }
     StartPipingSession(ePipe_chunk_smoke_column);
@@ -1684,15 +2317,11 @@ void CreateSmokeColumn(tCar_spec* pCar, int pColour, int pVertex_index, tU32 pLi
     gSmoke_column[gNext_column].smudge_timer = 1000;
     gSmoke_column[gNext_column].vertex_index = pVertex_index;
     gSmoke_column[gNext_column].upright = 1;
-    SET_BIT(gColumn_flags, gNext_column);
+    EffectPoolSetLive(&gColumn_pool, gNext_column); // changed by dethrace
     pCar->num_smoke_columns++;
     for (i = 0; i < COUNT_OF(gSmoke_column[gNext_column].frame_count); i++) {
         gSmoke_column[gNext_column].frame_count[i] = 100;
     }
-    gNext_column++;
-    if (gNext_column >= MAX_SMOKE_COLUMNS) {
-        gNext_column = 0;
-    }
 }
 
 // IDA: void __cdecl GenerateSmokeShades()
@@ -1749,6 +2378,10 @@ void AdjustFlame(int pIndex, int pFrame_count, br_scalar pScale_x, br_scalar pSc
 
     i = pIndex >> 4;
     j = pIndex & 0xf;
+    // Added by dethrace: the column may be beyond what the pool can hold
+    if (i >= gColumn_pool.capacity && !EffectPoolGrow(&gColumn_pool, i + 1)) {
+        return;
+    }
     col = &gSmoke_column[i];
     col->frame_count[j] = pFrame_count;
     col->scale_x[j] = pScale_x;
@@ -1880,8 +2513,8 @@ void ReplaySmokeColumn(tU32 pTime) {
     int i;
     br_vector3 dummy;
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-        if (!TEST_BIT(gColumn_flags, i)) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
+        if (!EFFECT_LIVE(&gColumn_pool, i)) {
             continue;
         }
         DoSmokeColumn(i, pTime, &dummy);
@@ -1908,7 +2541,8 @@ void MungeSmokeColumn(tU32 pTime) {
     br_scalar decay_factor;
     tCar_spec* c;
 
-    if (gColumn_flags == 0) {
+    // if (gColumn_flags == 0) {
+    if (gColumn_pool.live_count == 0) { // changed by dethrace
         return;
     }
     if (gAction_replay_mode) {
@@ -1917,8 +2551,8 @@ void MungeSmokeColumn(tU32 pTime) {
     }
 
     gMechanics_time_sync = 1;
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-        if (!TEST_BIT(gColumn_flags, i)) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
+        if (!EFFECT_LIVE(&gColumn_pool, i)) {
             continue;
         }
 
@@ -1928,7 +2562,7 @@ void MungeSmokeColumn(tU32 pTime) {
                 AddSmokeColumnToPipingSession(i, gSmoke_column[i].car, gSmoke_column[i].vertex_index, gSmoke_column[i].colour);
                 EndPipingSession();
             }
-            CLEAR_BIT(gColumn_flags, i);
+            EffectPoolRelease(&gColumn_pool, i); // changed by dethrace
             if (gSmoke_column[i].colour == 0) {
                 BrActorRemove(gSmoke_column[i].flame_actor);
             }
@@ -2001,8 +2635,8 @@ void DisposeFlame(void) {
         BrPixelmapFree(gFlame_map[i]);
     }
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-        if (TEST_BIT(gColumn_flags, i) && gSmoke_column[i].colour == 0) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
+        if (EFFECT_LIVE(&gColumn_pool, i) && gSmoke_column[i].colour == 0) {
             BrActorRemove(gSmoke_column[i].flame_actor);
         }
         actor = gSmoke_column[i].flame_actor->children;
@@ -2013,10 +2647,32 @@ void DisposeFlame(void) {
         }
         BrActorFree(gSmoke_column[i].flame_actor);
     }
+    EffectPoolDispose(&gColumn_pool); // added by dethrace
     BrModelRemove(gLollipop_model);
     BrModelFree(gLollipop_model);
 }
 
+// Added by dethrace: the body of the InitFlame loop, run for every column the pool adds
+static void InitFlameSlot(int i) {
+    int j;
+    br_actor* actor;
+    br_material* material;
+
+    gSmoke_column[i].flame_actor = BrActorAllocate(BR_ACTOR_NONE, NULL);
+    for (j = 0; j < COUNT_OF(gSmoke_column[0].frame_count); j++) {
+        actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
+        material = BrMaterialAllocate(NULL);
+        BrActorAdd(gSmoke_column[i].flame_actor, actor);
+        actor->model = gLollipop_model;
+        actor->material = material;
+        material->flags &= ~BR_MATF_LIGHT;
+        material->flags |= BR_MATF_ALWAYS_VISIBLE;
+        material->colour_map = gFlame_map[0];
+        BrMaterialAdd(material);
+        gSmoke_column[i].frame_count[j] = 100;
+    }
+}
+
 // IDA: void __cdecl InitFlame()
 // FUNCTION: CARM95 0x0046bcf7
 void InitFlame(void) {
@@ -2027,7 +2683,6 @@ void InitFlame(void) {
     br_actor* actor;
     br_material* material;
 
-    gColumn_flags = 0;
     gLollipop_model = BrModelAllocate("Lollipop", 4, 2);
     PathCat(the_path, gApplication_path, "PIXELMAP");
     PathCat(the_path, the_path, "FLAMES.PIX");
@@ -2036,21 +2691,8 @@ void InitFlame(void) {
         FatalError(kFatalError_LoadPixelmapFile_S, the_path);
     }
     BrMapAddMany(gFlame_map, num);
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-        gSmoke_column[i].flame_actor = BrActorAllocate(BR_ACTOR_NONE, NULL);
-        for (j = 0; j < COUNT_OF(gSmoke_column[0].frame_count); j++) {
-            actor = BrActorAllocate(BR_ACTOR_MODEL, NULL);
-            material = BrMaterialAllocate(NULL);
-            BrActorAdd(gSmoke_column[i].flame_actor, actor);
-            actor->model = gLollipop_model;
-            actor->material = material;
-            material->flags &= ~BR_MATF_LIGHT;
-            material->flags |= BR_MATF_ALWAYS_VISIBLE;
-            material->colour_map = gFlame_map[0];
-            BrMaterialAdd(material);
-            gSmoke_column[i].frame_count[j] = 100;
-        }
-    }
+    // changed by dethrace: the flame actors of each column are set up by InitFlameSlot as the pool grows
+    EffectPoolSetup(&gColumn_pool, (void**)&gSmoke_column, sizeof(tSmoke_column), MAX_SMOKE_COLUMNS, COLUMN_POOL_LIMIT, InitFlameSlot);
     gLollipop_model->nvertices = 4;
     BrVector3SetFloat(&gLollipop_model->vertices[0].p, -.5f, 0.f, .0f);
     BrVector3SetFloat(&gLollipop_model->vertices[1].p, .5f, 0.f, .0f);
@@ -2182,11 +2824,12 @@ void DrawTheGlow(br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_act
     br_vector3 tv;
     tU32 seed;
 
-    if (gColumn_flags) {
+    // if (gColumn_flags) {
+    if (gColumn_pool.live_count != 0) { // changed by dethrace
         seed = rand();
         srand(GetTotalTime());
-        for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-            if (TEST_BIT(gColumn_flags, i) && gSmoke_column[i].colour <= 1) {
+        for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
+            if (EFFECT_LIVE(&gColumn_pool, i) && gSmoke_column[i].colour <= 1) {
                 strength = 0.5f;
                 if (gSmoke_column[i].lifetime < 4000) {
                     strength = gSmoke_column[i].lifetime * 0.5f / 4000.f;
@@ -2392,12 +3035,13 @@ void SmudgeCar(tCar_spec* pCar, int fire_point) {
 void ResetSmokeColumns(void) {
     int i;
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
-        if (TEST_BIT(gColumn_flags, i)) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
+        if (EFFECT_LIVE(&gColumn_pool, i)) {
             BrActorRemove(gSmoke_column[i].flame_actor);
         }
     }
-    gColumn_flags = 0;
+    // gColumn_flags = 0;
+    EffectPoolReleaseAll(&gColumn_pool); // changed by dethrace
 }
 
 // IDA: void __usercall SetSmokeOn(int pSmoke_on@<EAX>)
@@ -2435,7 +3079,7 @@ int GetSmokeOn(void) {
 void StopCarSmoking(tCar_spec* pCar) {
     int i;
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
         if (gSmoke_column[i].car == pCar && gSmoke_column[i].lifetime > 2000) {
             gSmoke_column[i].lifetime = 2000;
         }
@@ -2447,7 +3091,7 @@ void StopCarSmoking(tCar_spec* pCar) {
 void StopCarSmokingInstantly(tCar_spec* pCar) {
     int i;
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
         if (gSmoke_column[i].car == pCar) {
             gSmoke_column[i].lifetime = 0;
         }
@@ -2463,9 +3107,9 @@ void ConditionalSmokeColumn(tCar_spec* pCar, int pDamage_index, int pColour) {
         pColour = pCar->driver < eDriver_net_human;
     }
     if (pCar->num_smoke_columns != 0) {
-        for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
+        for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
             if (gSmoke_column[i].car == pCar) {
-                if (TEST_BIT(gColumn_flags, i) && gSmoke_column[i].colour <= pColour && gSmoke_column[i].lifetime) {
+                if (EFFECT_LIVE(&gColumn_pool, i) && gSmoke_column[i].colour <= pColour && gSmoke_column[i].lifetime) {
                     return;
                 }
                 gSmoke_column[i].lifetime = 2000;
@@ -2841,6 +3485,11 @@ void FreeSmokeShadeTables(void) {
 // FUNCTION: CARM95 0x0046ebc8
 void LoadInKevStuff(FILE* pF) {
 
+    // Added by dethrace: sparks and smoke have no actors, so their pools outlive the race
+    if (gSpark_pool.capacity == 0) {
+        EffectPoolSetup(&gSpark_pool, (void**)&gSparks, sizeof(tSpark), 32, SPARK_POOL_LIMIT, NULL);
+        EffectPoolSetup(&gSmoke_pool, (void**)&gSmoke, sizeof(tSmoke), 25, SMOKE_POOL_LIMIT, NULL);
+    }
     PossibleService();
     LoadInShrapnel();
     PossibleService();
@@ -2865,19 +3514,19 @@ void DisposeKevStuff(void) {
 void DisposeKevStuffCar(tCar_spec* pCar) {
     int i;
 
-    for (i = 0; i < MAX_SMOKE_COLUMNS; i++) {
+    for (i = 0; i < gColumn_pool.capacity; i++) { // changed by dethrace
         if (gSmoke_column[i].car == pCar) {
             gSmoke_column[i].lifetime = 0;
             gSmoke_column[i].car = NULL;
         }
     }
-    for (i = 0; i < COUNT_OF(gSparks); i++) {
-        if (!TEST_BIT(gSpark_flags, i)) {
+    for (i = 0; i < gSpark_pool.capacity; i++) { // changed by dethrace
+        if (!EFFECT_LIVE(&gSpark_pool, i)) {       // changed by dethrace
             continue;
         }
         if (gSparks[i].car == pCar) {
             gSparks[i].count = 0;
-            CLEAR_BIT(gSpark_flags, i);
+            EffectPoolRelease(&gSpark_pool, i); // changed by dethrace
         }
     }
     if (gCar_to_view == pCar) {
@@ -3,6 +3,15 @@
 
 #include "dr_types.h"
 
+// Added by dethrace
+typedef enum tSmoke_span_kernel {
+    eSmoke_span_scalar,
+    eSmoke_span_sse2,
+    eSmoke_span_avx2,
+    eSmoke_span_neon,
+    eSmoke_span_auto // best kernel supported by this cpu
+} tSmoke_span_kernel;
+
 extern int gNext_spark;
 extern int gSpark_flags;
 extern int gNext_shrapnel;
@@ -22,16 +31,16 @@ extern int gIt_type;
 extern br_pixelmap* gIt_shade_table;
 extern br_pixelmap** gDust_table;
 extern br_pixelmap* gFlame_map[20];
-extern tBRender_smoke* gBR_smoke_pointers[30];
+extern tBRender_smoke** gBR_smoke_pointers;
 extern tSplash gSplash[32];
 extern br_material* gSplash_material[20];
-extern tBRender_smoke gBR_smoke_structs[30];
-extern tSmoke_column gSmoke_column[25];
+extern tBRender_smoke* gBR_smoke_structs;
+extern tSmoke_column* gSmoke_column;
 extern br_matrix4 gCameraToScreen;
-extern tSpark gSparks[32];
+extern tSpark* gSparks;
 extern br_pixelmap* gShade_list[16];
 extern int gN_BR_smoke_structs;
-extern tSmoke gSmoke[25];
+extern tSmoke* gSmoke;
 extern tU32 gSplash_flags;
 extern tU32 gNext_splash;
 extern br_model* gLollipop_model;
@@ -40,7 +49,7 @@ extern br_model* gSplash_model;
 extern int gDust_rotate;
 extern br_camera* gSpark_cam;
 extern br_material* gBlack_material;
-extern tShrapnel gShrapnel[15];
+extern tShrapnel* gShrapnel;
 
 void DrawDot(br_scalar z, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr);
 
@@ -88,6 +97,12 @@ void MungeShrapnel(tU32 pTime);
 
 void DrMatrix34Rotate(br_matrix34* mat, br_angle r, br_vector3* a);
 
+// Added by dethrace
+int SmokeSpanKernelSupported(tSmoke_span_kernel pKernel);
+
+// Added by dethrace
+void SetSmokeSpanKernel(tSmoke_span_kernel pKernel);
+
 void SmokeLine(int l, int x, br_scalar zbuff, int r_squared, tU8* scr_ptr, tU16* depth_ptr, tU8* shade_ptr, br_scalar r_multiplier, br_scalar z_multiplier, br_scalar shade_offset);
 
 void SmokeCircle(br_vector3* o, br_scalar r, br_scalar extra_z, br_scalar strength, br_scalar pAspect, br_pixelmap* pRender_screen, br_pixelmap* pDepth_buffer, br_pixelmap* pShade_table);
@@ -544,6 +544,8 @@ void DoGame(void) {
             PrintMemoryDump(0, "AFTER START RACE SCREEN");
             DoNewGameAnimation();
             StartLoadingScreen();
+            // added by dethrace: opponents, track, peds and cops share per-race arena chunks
+            DRMemBeginRaceArena();
             if (gNet_mode == eNet_mode_none) {
                 LoadOpponentsCars(&gCurrent_race);
             } else {
@@ -555,6 +557,7 @@ void DoGame(void) {
             }
             PrintMemoryDump(0, "AFTER LOADING OPPONENTS IN");
             InitRace();
+            DRMemEndRaceArena(); // added by dethrace
             if (gNet_mode_of_last_game != gNet_mode) {
                 gProgram_state.prog_status = eProg_idling;
             } else {
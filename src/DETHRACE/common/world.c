@@ -2598,6 +2598,7 @@ void LoadTrack(char* pFile_name, tTrack_spec* pTrack_spec, tRace_info* pRace_inf
     br_vector3 temp_v;
     br_bounds temp_bounds;
     tPed_subs* ped_subs;
+    tPath_name actor_path; // added by dethrace
     br_pixelmap* sky;
     br_material* material;
 
@@ -2766,6 +2767,7 @@ void LoadTrack(char* pFile_name, tTrack_spec* pTrack_spec, tRace_info* pRace_inf
         PathCat(the_path, the_path, str);
     }
     pTrack_spec->the_actor = BrActorLoad(the_path);
+    strcpy(actor_path, the_path); // added by dethrace
     if (gRace_file_version > 6) {
         GetAString(f, s);
         if (!sscanf(s, "%d", &gDefault_blend_pc) || gDefault_blend_pc < 0 || gDefault_blend_pc > 100) {
@@ -3111,6 +3113,8 @@ void LoadTrack(char* pFile_name, tTrack_spec* pTrack_spec, tRace_info* pRace_inf
 #ifdef DETHRACE_3DFX_PATCH
     FreeExceptions();
 #endif
+    // Added by dethrace: once the groovidelics are known, so moving actors don't hide anything
+    LoadColumnPVS(pTrack_spec, actor_path);
 }
 
 // IDA: br_uint_32 __cdecl RemoveBounds(br_actor *pActor, void *pArg)
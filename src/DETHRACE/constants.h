@@ -846,6 +846,9 @@ enum {
     NETMSGID_OILSPILL = 0x1e,
     NETMSGID_CRUSHPOINT = 0x1f,
     NETMSGID_NONE = 0x20,
+    // Added by dethrace
+    NETMSGID_MECHANICS_DELTA = 0x21,
+    NETMSGID_MECHANICS_ACK = 0x22,
 };
 
 // Introduced with 3DFX patch
@@ -906,6 +909,15 @@ enum ExceptionFlags {
 // average frame time in carm95
 #define MUNGE_ENGINE_INTERVAL 50
 
+// Added by dethrace: worst case size of an encoded NETMSGID_MECHANICS_DELTA bitstream
+#define MECHANICS_DELTA_DATA_SIZE 100
+
+// Added by dethrace: remote car snapshot buffer (see netgame.c)
+#define NET_SNAPSHOT_COUNT 16
+#define NET_SNAPSHOT_MAX_DELAY 500          // ms, upper bound of the adaptive playout delay
+#define NET_SNAPSHOT_MAX_EXTRAPOLATION 250  // ms past the newest snapshot before the car is held
+#define NET_SNAPSHOT_CORRECTION_DISTANCE 1.f // physics units the played out position may jump before it counts as a correction
+
 #define HIRES_Y_OFFSET 40
 
 #endif
@@ -425,6 +425,14 @@ typedef struct tTrack_spec {
     br_actor*** blends;
     int ampersand_digits;
     br_actor** non_car_list;
+    br_bounds* column_bounds;   // Added by dethrace: [z * ncolumns_x + x], track space
+    tU8* column_visible;        // Added by dethrace: culling result of the last RenderTrack, reused by the blend pass
+    tU8* column_pvs;            // Added by dethrace: bit [from * columns + to], NULL without a visibility set
+    br_scalar* column_eye_top;  // Added by dethrace: highest viewpoint the visibility set was sampled from
+    tU8* column_pvs_view;       // Added by dethrace: visibility set rows around the last camera, or'ed together
+    br_actor** lollipop_actors; // Added by dethrace: children of every lollipops actor, column after column
+    int* lollipop_first;        // Added by dethrace: [z * ncolumns_x + x] into lollipop_actors, one past the last column too
+    tU32* lollipop_facing;      // Added by dethrace: gLollipop_facing when the column's children were last turned
 } tTrack_spec;
 
 typedef struct tCrush_neighbour {
@@ -516,6 +524,28 @@ typedef struct tNet_message_mechanics_info { // size: 0x84
     br_scalar wheel_dam_offset[4];           // @0x74
 } tNet_message_mechanics_info;
 
+// Added by dethrace: tNet_message_mechanics_info quantised the way NETMSGID_MECHANICS_DELTA transmits it
+typedef struct tMechanics_snapshot {
+    tU32 time;
+    tU32 position[3];     // fixed point across the track bounds
+    tU8 rotation_largest; // smallest-three quaternion
+    tU16 rotation[3];
+    tU16 v[3]; // half floats
+    tU16 omega[3];
+    tU8 d[4];
+    tU32 keys;
+    tU32 cc_coll_time;
+    tS16 curvature;
+    tU16 revs;
+    br_scalar front;
+    br_scalar back;
+    tU32 repair_time;
+    tU8 damage[12];
+    tU16 powerups;
+    int damaged_wheels;
+    br_scalar wheel_dam_offset[4];
+} tMechanics_snapshot;
+
 typedef struct tDamage_unit {
     int x_coord;
     int y_coord;
@@ -580,6 +610,7 @@ typedef struct tCar_actor {
     br_scalar min_distance_squared;
     tCrush_data crush_data;
     br_vertex* undamaged_vertices;
+    struct tCrush_lookup* crush_lookup; // added by dethrace
 } tCar_actor;
 
 typedef struct tJoystick {
@@ -876,6 +907,7 @@ typedef struct tCar_spec_struct {              // size: 0x1a9c
     tU32 repair_time;                          // @0x1a88
     int power_up_levels[3];                    // @0x1a8c
     tS3_sound_tag horn_sound_tag;              // @0x1a98
+    br_vector3 wheel_world[4];                 // added by dethrace: wpos in world space, set by CalcForce
 } tCar_spec;
 
 typedef struct tOppo_psyche {
@@ -1347,6 +1379,68 @@ typedef struct tNet_message_crush_point {
     br_vector3 energy_vector;
 } tNet_message_crush_point;
 
+// Added by dethrace: NETMSGID_MECHANICS bit-packed against a snapshot the receiver has acknowledged
+typedef struct tNet_message_mechanics_delta {
+    tU8 contents_size;
+    tNet_message_type type;
+    tU8 seq;
+    tU8 baseline;
+    tPlayer_ID ID;
+    tU8 epoch;
+    tU8 flags;
+    tU8 data[MECHANICS_DELTA_DATA_SIZE];
+} tNet_message_mechanics_delta;
+
+// Added by dethrace
+typedef struct tNet_mechanics_ack {
+    tPlayer_ID ID;
+    tU32 received; // bit n set: seq latest-1-n was received too
+    tU8 latest;
+    tU8 epoch;
+} tNet_mechanics_ack;
+
+// Added by dethrace
+typedef struct tNet_message_mechanics_ack {
+    tU8 contents_size;
+    tNet_message_type type;
+    tU8 count;
+    tNet_mechanics_ack acks[6];
+} tNet_message_mechanics_ack;
+
+// Added by dethrace: jitter buffer of the mechanics received for one remote car
+typedef struct tNet_snapshot_buffer {
+    tU32 ID;
+    int count;
+    tNet_message_mechanics_info snapshots[NET_SNAPSHOT_COUNT]; // oldest first
+    int have_timing;
+    float transit;        // smoothed arrival time - race time of the snapshot
+    float last_transit;
+    float jitter;         // smoothed transit variation, as RFC 3550
+    float interval;       // smoothed time between snapshots
+    float playout_delay;  // how far behind the clock snapshots are played out
+    int have_sample;
+    tU32 last_sample_time;
+    tU32 last_render_time;
+    br_vector3 last_position;
+    br_vector3 last_v;
+    int received;
+    int late;
+    int duplicates;
+    int extrapolated;
+    int corrections;
+} tNet_snapshot_buffer;
+
+// Added by dethrace: what NetReceiveAndProcessMessages has been through since NetResetReceiveStats
+typedef struct tNet_receive_stats {
+    int calls;
+    int messages;
+    int bytes;
+    int out_of_order; // older than a message already received from the same player
+    int duplicates;   // guaranteed messages received again after they were replied to
+    tU32 total_us;
+    tU32 max_us;
+} tNet_receive_stats;
+
 typedef union tNet_contents {                           // size: 0x160
     struct {                                            // size: 0x2
         tU8 contents_size;                              // @0x0
@@ -1385,6 +1479,8 @@ typedef union tNet_contents {                           // size: 0x160
         tNet_message_game_scores game_scores;           // @0x0
         tNet_message_oil_spill oil_spill;               // @0x0
         tNet_message_crush_point crush;                 // @0x0
+        tNet_message_mechanics_delta mech_delta;        // Added by dethrace
+        tNet_message_mechanics_ack mech_ack;            // Added by dethrace
     } data;                                             // @0x0
 } tNet_contents;
 
@@ -3064,7 +3160,10 @@ typedef struct tRectangle {
 } tRectangle;
 
 typedef struct tSkid {
-    br_actor* actor;
+    // br_actor* actor; // changed by dethrace: segments are written into a shared mesh, see skidmark.c
+    br_matrix34 mat;       // added by dethrace
+    br_material* material; // added by dethrace
+    int visible;           // added by dethrace
     br_vector3 normal;
     br_vector3 pos;
 } tSkid;
@@ -1,3 +1,8 @@
+// Added by dethrace: recvmmsg and sendmmsg are GNU extensions
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "pd/net.h"
 
 #include "brender.h"
@@ -28,6 +33,12 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <sys/socket.h>
+
+#if defined(__linux__)
+// Added by dethrace: several datagrams per system call
+#define DETHRACE_NET_MMSG
+#include <sys/uio.h>
+#endif
 #endif
 
 // dethrace: have switched out IPX implementation for IP
@@ -64,6 +75,56 @@ int gPlayer_id;
 #define JOINABLE_GAMES_CAPACITY 16
 #define PORT 12286
 
+// Added by dethrace
+tPD_net_stats gNet_frame_stats;
+tPD_net_stats gNet_last_frame_stats;
+
+#ifdef DETHRACE_NET_MMSG
+// Added by dethrace
+// The socket is drained into a ring of datagrams with one recvmmsg call, and handed out one at a time
+#define RECEIVE_RING_CAPACITY 32
+
+typedef struct tReceive_slot {
+    char buffer[512];
+    struct sockaddr_in addr;
+} tReceive_slot;
+
+tReceive_slot gReceive_ring[RECEIVE_RING_CAPACITY];
+struct mmsghdr gReceive_headers[RECEIVE_RING_CAPACITY];
+struct iovec gReceive_iovecs[RECEIVE_RING_CAPACITY];
+int gReceive_ring_count;
+int gReceive_ring_next;
+int gMmsg_unavailable;
+#endif
+
+// Added by dethrace
+// In-memory stand-in for the socket, see harness_game_config.net_loopback. Every endpoint has a queue of the
+// datagrams sent to it, in the order they are due
+#define LOOPBACK_ENDPOINT_CAPACITY 16
+
+typedef struct tLoopback_datagram {
+    int next;
+    tU32 due_time;
+    struct sockaddr_in from;
+    int size;
+    char data[512];
+} tLoopback_datagram;
+
+typedef struct tLoopback_endpoint {
+    int in_use;
+    struct sockaddr_in addr;
+    int head;
+    int tail;
+} tLoopback_endpoint;
+
+tLoopback_datagram* gLoopback_datagrams;
+int gLoopback_capacity;
+int gLoopback_free;
+int gLoopback_in_flight;
+tLoopback_endpoint gLoopback_endpoints[LOOPBACK_ENDPOINT_CAPACITY];
+tU32 gLoopback_seed;
+tPD_net_loopback_stats gLoopback_stats;
+
 DR_STATIC_ASSERT(offsetof(tNet_message, pd_stuff_so_DO_NOT_USE) == 0);
 DR_STATIC_ASSERT(offsetof(tNet_message, magic_number) == 4);
 DR_STATIC_ASSERT(offsetof(tNet_message, guarantee_number) == 8);
@@ -77,6 +138,305 @@ DR_STATIC_ASSERT(offsetof(tNet_message, contents) == 28);
 // dethrace added
 void PDNetCopyFromNative(tCopyable_sockaddr_in* pAddress, struct sockaddr_in* sock);
 void PDNetCopyToNative(struct sockaddr_in* sock, tCopyable_sockaddr_in* pAddress);
+int SameEthernetAddress(struct sockaddr_in* pAddr_1, struct sockaddr_in* pAddr_2);
+
+#ifdef DETHRACE_NET_MMSG
+// Added by dethrace
+// Returns the number of datagrams received, or -1 with errno set
+static int FillReceiveRing(void) {
+    int i;
+    int res;
+
+    for (i = 0; i < RECEIVE_RING_CAPACITY; i++) {
+        gReceive_iovecs[i].iov_base = gReceive_ring[i].buffer;
+        gReceive_iovecs[i].iov_len = sizeof(gReceive_ring[i].buffer);
+        memset(&gReceive_headers[i], 0, sizeof(gReceive_headers[i]));
+        gReceive_headers[i].msg_hdr.msg_name = &gReceive_ring[i].addr;
+        gReceive_headers[i].msg_hdr.msg_namelen = sizeof(gReceive_ring[i].addr);
+        gReceive_headers[i].msg_hdr.msg_iov = &gReceive_iovecs[i];
+        gReceive_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    res = recvmmsg(gSocket, gReceive_headers, RECEIVE_RING_CAPACITY, MSG_DONTWAIT, NULL);
+    gNet_frame_stats.receive_calls++;
+    gReceive_ring_count = 0;
+    gReceive_ring_next = 0;
+    if (res > 0) {
+        gReceive_ring_count = res;
+        gNet_frame_stats.packets_received += res;
+        for (i = 0; i < res; i++) {
+            gNet_frame_stats.bytes_received += gReceive_headers[i].msg_len;
+        }
+    }
+    return res;
+}
+#endif
+
+// Added by dethrace
+// Seeded the same every time, so a run with loss and reordering can be repeated
+static int LoopbackRandom(int pRange) {
+    gLoopback_seed = gLoopback_seed * 1103515245 + 12345;
+    if (pRange <= 0) {
+        return 0;
+    }
+    return (gLoopback_seed >> 16) % pRange;
+}
+
+// Added by dethrace
+static void LoopbackReset(void) {
+    if (gLoopback_datagrams != NULL) {
+        BrMemFree(gLoopback_datagrams);
+    }
+    gLoopback_datagrams = NULL;
+    gLoopback_capacity = 0;
+    gLoopback_free = -1;
+    gLoopback_in_flight = 0;
+    memset(gLoopback_endpoints, 0, sizeof(gLoopback_endpoints));
+    memset(&gLoopback_stats, 0, sizeof(gLoopback_stats));
+    gLoopback_seed = 1;
+}
+
+// Added by dethrace
+// Datagrams are linked by index, so they can move when there are too many in flight
+static int LoopbackGrow(void) {
+    tLoopback_datagram* datagrams;
+    int capacity;
+    int i;
+
+    capacity = gLoopback_capacity == 0 ? 64 : gLoopback_capacity * 2;
+    datagrams = BrMemAllocate(capacity * sizeof(tLoopback_datagram), kMem_misc);
+    if (datagrams == NULL) {
+        return 0;
+    }
+    if (gLoopback_datagrams != NULL) {
+        memcpy(datagrams, gLoopback_datagrams, gLoopback_capacity * sizeof(tLoopback_datagram));
+        BrMemFree(gLoopback_datagrams);
+    }
+    for (i = gLoopback_capacity; i < capacity; i++) {
+        datagrams[i].next = i + 1 < capacity ? i + 1 : gLoopback_free;
+    }
+    gLoopback_free = gLoopback_capacity;
+    gLoopback_datagrams = datagrams;
+    gLoopback_capacity = capacity;
+    return 1;
+}
+
+// Added by dethrace
+static int LoopbackAddEndpoint(struct sockaddr_in* pAddr) {
+    int i;
+
+    for (i = 0; i < COUNT_OF(gLoopback_endpoints); i++) {
+        if (!gLoopback_endpoints[i].in_use) {
+            gLoopback_endpoints[i].in_use = 1;
+            gLoopback_endpoints[i].addr.sin_family = AF_INET;
+            gLoopback_endpoints[i].addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            gLoopback_endpoints[i].addr.sin_port = htons(PORT + i);
+            gLoopback_endpoints[i].head = -1;
+            gLoopback_endpoints[i].tail = -1;
+            memcpy(pAddr, &gLoopback_endpoints[i].addr, sizeof(*pAddr));
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Added by dethrace
+// Lost, or queued to be due after the latency and jitter, or later still if it is to be reordered
+static void LoopbackQueue(int pTo, const char* pData, int pSize, struct sockaddr_in* pFrom) {
+    tLoopback_endpoint* endpoint;
+    tLoopback_datagram* datagram;
+    tU32 due_time;
+    int index;
+    int previous;
+    int i;
+
+    endpoint = &gLoopback_endpoints[pTo];
+    gLoopback_stats.packets_queued++;
+    if (LoopbackRandom(100) < harness_game_config.net_loopback_loss) {
+        gLoopback_stats.packets_lost++;
+        return;
+    }
+    due_time = PDGetTotalTime() + harness_game_config.net_loopback_latency + LoopbackRandom(harness_game_config.net_loopback_jitter + 1);
+    if (LoopbackRandom(100) < harness_game_config.net_loopback_reorder) {
+        due_time += 1 + LoopbackRandom(harness_game_config.net_loopback_latency + harness_game_config.net_loopback_jitter + 1);
+        gLoopback_stats.packets_reordered++;
+    }
+    if (gLoopback_free == -1 && !LoopbackGrow()) {
+        gLoopback_stats.packets_lost++;
+        return;
+    }
+    index = gLoopback_free;
+    datagram = &gLoopback_datagrams[index];
+    gLoopback_free = datagram->next;
+    datagram->due_time = due_time;
+    memcpy(&datagram->from, pFrom, sizeof(datagram->from));
+    datagram->size = MIN(pSize, (int)sizeof(datagram->data));
+    memcpy(datagram->data, pData, datagram->size);
+
+    // behind everything due no later, which is nearly always the tail
+    if (endpoint->head == -1) {
+        datagram->next = -1;
+        endpoint->head = endpoint->tail = index;
+    } else if ((int)(gLoopback_datagrams[endpoint->tail].due_time - due_time) <= 0) {
+        datagram->next = -1;
+        gLoopback_datagrams[endpoint->tail].next = index;
+        endpoint->tail = index;
+    } else {
+        previous = -1;
+        for (i = endpoint->head; (int)(gLoopback_datagrams[i].due_time - due_time) <= 0; i = gLoopback_datagrams[i].next) {
+            previous = i;
+        }
+        datagram->next = i;
+        if (previous == -1) {
+            endpoint->head = index;
+        } else {
+            gLoopback_datagrams[previous].next = index;
+        }
+    }
+    gLoopback_in_flight++;
+    gLoopback_stats.most_in_flight = MAX(gLoopback_stats.most_in_flight, gLoopback_in_flight);
+}
+
+// Added by dethrace
+// As UDP: broadcasts go to every other endpoint, and sending to nobody is no error
+static void LoopbackSend(int pFrom, const char* pData, int pSize, struct sockaddr_in* pTo) {
+    int i;
+
+    for (i = 0; i < COUNT_OF(gLoopback_endpoints); i++) {
+        if (gLoopback_endpoints[i].in_use && i != pFrom
+            && (pTo->sin_addr.s_addr == INADDR_BROADCAST || SameEthernetAddress(&gLoopback_endpoints[i].addr, pTo))) {
+            LoopbackQueue(i, pData, pSize, &gLoopback_endpoints[pFrom].addr);
+        }
+    }
+}
+
+// Added by dethrace
+// Returns -1 if nothing is due yet
+static int LoopbackReceive(int pEndpoint, char* pBuffer, int pSize, struct sockaddr_in* pFrom) {
+    tLoopback_endpoint* endpoint;
+    tLoopback_datagram* datagram;
+    int index;
+    int size;
+
+    endpoint = &gLoopback_endpoints[pEndpoint];
+    index = endpoint->head;
+    if (!endpoint->in_use || index == -1 || (int)(gLoopback_datagrams[index].due_time - PDGetTotalTime()) > 0) {
+        return -1;
+    }
+    datagram = &gLoopback_datagrams[index];
+    endpoint->head = datagram->next;
+    if (endpoint->head == -1) {
+        endpoint->tail = -1;
+    }
+    size = MIN(datagram->size, pSize);
+    memcpy(pBuffer, datagram->data, size);
+    memcpy(pFrom, &datagram->from, sizeof(*pFrom));
+    datagram->next = gLoopback_free;
+    gLoopback_free = index;
+    gLoopback_in_flight--;
+    gLoopback_stats.packets_delivered++;
+    return size;
+}
+
+// Added by dethrace
+// recvfrom() into pBuffer, taking the datagram from the receive ring where there is one
+static int ReceiveDatagram(char* pBuffer, int pSize, struct sockaddr_in* pFrom) {
+    socklen_t sa_len;
+    int res;
+
+    if (harness_game_config.net_loopback) {
+        res = LoopbackReceive(0, pBuffer, pSize, pFrom);
+        gNet_frame_stats.receive_calls++;
+        if (res != -1) {
+            gNet_frame_stats.packets_received++;
+            gNet_frame_stats.bytes_received += res;
+        }
+        return res;
+    }
+#ifdef DETHRACE_NET_MMSG
+    if (!gMmsg_unavailable && gReceive_ring_next >= gReceive_ring_count) {
+        if (FillReceiveRing() == -1 && errno == ENOSYS) {
+            gMmsg_unavailable = 1;
+        } else if (gReceive_ring_count == 0) {
+            // errno says whether the socket was just empty
+            return -1;
+        }
+    }
+    if (!gMmsg_unavailable) {
+        res = MIN((int)gReceive_headers[gReceive_ring_next].msg_len, pSize);
+        memcpy(pBuffer, gReceive_ring[gReceive_ring_next].buffer, res);
+        memcpy(pFrom, &gReceive_ring[gReceive_ring_next].addr, sizeof(*pFrom));
+        gReceive_ring_next++;
+        return res;
+    }
+#endif
+    sa_len = sizeof(*pFrom);
+    res = recvfrom(gSocket, pBuffer, pSize, 0, (struct sockaddr*)pFrom, &sa_len);
+    gNet_frame_stats.receive_calls++;
+    if (res != -1) {
+        gNet_frame_stats.packets_received++;
+        gNet_frame_stats.bytes_received += res;
+    }
+    return res;
+}
+
+// Added by dethrace
+// sendto() every address in turn, returns -1 at the first error
+static int SendDatagrams(const char* pData, int pSize, struct sockaddr_in* pAddrs, int pCount) {
+    int i;
+    int sent;
+#ifdef DETHRACE_NET_MMSG
+    struct mmsghdr headers[8];
+    struct iovec iov;
+    int batch;
+    int res;
+#endif
+
+    if (harness_game_config.net_loopback) {
+        for (i = 0; i < pCount; i++) {
+            LoopbackSend(0, pData, pSize, &pAddrs[i]);
+            gNet_frame_stats.send_calls++;
+            gNet_frame_stats.packets_sent++;
+            gNet_frame_stats.bytes_sent += pSize;
+        }
+        return 0;
+    }
+    sent = 0;
+#ifdef DETHRACE_NET_MMSG
+    iov.iov_base = (void*)pData;
+    iov.iov_len = pSize;
+    while (!gMmsg_unavailable && sent < pCount) {
+        batch = MIN(pCount - sent, COUNT_OF(headers));
+        memset(headers, 0, batch * sizeof(headers[0]));
+        for (i = 0; i < batch; i++) {
+            headers[i].msg_hdr.msg_name = &pAddrs[sent + i];
+            headers[i].msg_hdr.msg_namelen = sizeof(pAddrs[sent + i]);
+            headers[i].msg_hdr.msg_iov = &iov;
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        res = sendmmsg(gSocket, headers, batch, 0);
+        gNet_frame_stats.send_calls++;
+        if (res == -1) {
+            if (errno != ENOSYS) {
+                return -1;
+            }
+            gMmsg_unavailable = 1;
+            break;
+        }
+        gNet_frame_stats.packets_sent += res;
+        gNet_frame_stats.bytes_sent += res * pSize;
+        sent += res;
+    }
+#endif
+    for (i = sent; i < pCount; i++) {
+        gNet_frame_stats.send_calls++;
+        if (sendto(gSocket, pData, pSize, 0, (struct sockaddr*)&pAddrs[i], sizeof(pAddrs[i])) == -1) {
+            return -1;
+        }
+        gNet_frame_stats.packets_sent++;
+        gNet_frame_stats.bytes_sent += pSize;
+    }
+    return 0;
+}
 
 // IDA: void __cdecl ClearupPDNetworkStuff()
 void ClearupPDNetworkStuff(void) {
@@ -181,7 +541,8 @@ int ReceiveHostResponses(void) {
 
     sa_len = sizeof(gRemote_addr);
     while (1) {
-        if (recvfrom(gSocket, gReceive_buffer, sizeof(gReceive_buffer), 0, (struct sockaddr*)&gRemote_addr, &sa_len) == -1) {
+        // if (recvfrom(gSocket, gReceive_buffer, sizeof(gReceive_buffer), 0, (struct sockaddr*)&gRemote_addr, &sa_len) == -1) {
+        if (ReceiveDatagram(gReceive_buffer, sizeof(gReceive_buffer), &gRemote_addr) == -1) { // changed by dethrace
             break;
         }
         SockAddrToString(addr_string, &gRemote_addr);
@@ -222,7 +583,8 @@ int ReceiveHostResponses(void) {
             }
         }
     }
-    error = OS_GetLastSocketError() != EWOULDBLOCK;
+    // error = OS_GetLastSocketError() != EWOULDBLOCK;
+    error = !harness_game_config.net_loopback && OS_GetLastSocketError() != EWOULDBLOCK; // changed by dethrace: the loopback has no errors
     if (error == 0) {
         return 1;
     }
@@ -241,7 +603,8 @@ int BroadcastMessage(void) {
     for (i = 0; i < gNumber_of_networks; i++) {
         SockAddrToString(broadcast_addr_string, &gBroadcast_addr);
         dr_dprintf("Broadcasting on address '%s'", broadcast_addr_string);
-        if (sendto(gSocket, gSend_buffer, strlen(gSend_buffer) + 1, 0, (struct sockaddr*)&gBroadcast_addr, sizeof(gBroadcast_addr)) == -1) {
+        // if (sendto(gSocket, gSend_buffer, strlen(gSend_buffer) + 1, 0, (struct sockaddr*)&gBroadcast_addr, sizeof(gBroadcast_addr)) == -1) {
+        if (SendDatagrams(gSend_buffer, strlen(gSend_buffer) + 1, &gBroadcast_addr, 1) == -1) { // changed by dethrace
             dr_dprintf("BroadcastMessage(): Error on sendto() - WSAGetLastError=%d", OS_GetLastSocketError());
             errors = 1;
         }
@@ -278,6 +641,23 @@ int PDNetInitialise(void) {
     gAny_addr.sin_addr.s_addr = INADDR_ANY;
     gAny_addr.sin_port = htons(PORT);
 
+    // Added by dethrace: in-memory queues only, no socket
+    if (harness_game_config.net_loopback) {
+        LoopbackReset();
+        LoopbackAddEndpoint(&gLocal_addr);
+        PDNetCopyFromNative(&gLocal_addr_copyable, &gLocal_addr);
+        gRemote_addr.sin_family = AF_INET;
+        gRemote_addr.sin_port = htons(PORT);
+        gBroadcast_addr.sin_family = AF_INET;
+        gBroadcast_addr.sin_port = htons(PORT);
+        gBroadcast_addr.sin_addr.s_addr = INADDR_BROADCAST;
+        gSocket = -1;
+        SockAddrToString(gLocal_addr_string, &gLocal_addr);
+        LOG_INFO2("Loopback transport, this game is %s", gLocal_addr_string);
+        gMsg_header_strlen = 7;
+        return 0;
+    }
+
     int found = OS_GetAdapterAddress(harness_game_config.network_adapter_name, &gLocal_addr);
     if (!found) {
         gLocal_addr.sin_addr.s_addr = INADDR_LOOPBACK;
@@ -354,6 +734,12 @@ int PDNetShutdown(void) {
         OS_CloseSocket(gSocket);
     }
     gSocket = -1;
+#ifdef DETHRACE_NET_MMSG
+    // added by dethrace: datagrams left in the ring belong to the closed socket
+    gReceive_ring_count = 0;
+    gReceive_ring_next = 0;
+#endif
+    LoopbackReset(); // added by dethrace
     return 0;
 }
 
@@ -494,7 +880,10 @@ int PDNetSendMessageToAllPlayers(tNet_game_details* pDetails, tNet_message* pMes
     int i;
 
     struct sockaddr_in someaddr;
+    struct sockaddr_in addrs[COUNT_OF(gNet_players)]; // added by dethrace
+    int count;                                         // added by dethrace
 
+    count = 0;
     for (i = 0; i < gNumber_of_net_players; ++i) {
         if (i == gThis_net_player_index) {
             continue;
@@ -503,11 +892,15 @@ int PDNetSendMessageToAllPlayers(tNet_game_details* pDetails, tNet_message* pMes
         PDNetCopyToNative(&someaddr, &gNet_players[i].pd_net_info.addr_in);
         SockAddrToString(str, &someaddr);
         LOG_DEBUG(str);
-        if (sendto(gSocket, (const char*)pMessage, pMessage->overall_size, 0, (struct sockaddr*)&someaddr, sizeof(someaddr)) == -1) {
-            dr_dprintf("PDNetSendMessageToAllPlayers(): Error on sendto() - WSAGetLastError=%d", OS_GetLastSocketError());
-            NetDisposeMessage(pDetails, pMessage);
-            return 1;
-        }
+        // Changed by dethrace: sent together below
+        // if (sendto(gSocket, (const char*)pMessage, pMessage->overall_size, 0, (struct sockaddr*)&someaddr, sizeof(someaddr)) == -1) {
+        addrs[count] = someaddr;
+        count++;
+    }
+    if (SendDatagrams((const char*)pMessage, pMessage->overall_size, addrs, count) == -1) {
+        dr_dprintf("PDNetSendMessageToAllPlayers(): Error on sendto() - WSAGetLastError=%d", OS_GetLastSocketError());
+        NetDisposeMessage(pDetails, pMessage);
+        return 1;
     }
     NetDisposeMessage(pDetails, pMessage);
     return 0;
@@ -527,10 +920,12 @@ tNet_message* PDNetGetNextMessage(tNet_game_details* pDetails, void** pSender_ad
     sa_len = sizeof(gRemote_addr);
     msg = NetAllocateMessage(512);
     receive_buffer = (char*)msg;
-    res = recvfrom(gSocket, receive_buffer, 512, 0, (struct sockaddr*)&gRemote_addr, &sa_len);
+    // res = recvfrom(gSocket, receive_buffer, 512, 0, (struct sockaddr*)&gRemote_addr, &sa_len);
+    res = ReceiveDatagram(receive_buffer, 512, &gRemote_addr); // changed by dethrace
     res = res != -1;
     if (res == 0) {
-        res = OS_GetLastSocketError() != EWOULDBLOCK;
+        // res = OS_GetLastSocketError() != EWOULDBLOCK;
+        res = !harness_game_config.net_loopback && OS_GetLastSocketError() != EWOULDBLOCK; // changed by dethrace
         if (res) {
             sprintf(str, "PDNetGetNextMessage(): Error on recvfrom() - WSAGetLastError=%d", res);
             PDFatalError(str);
@@ -544,7 +939,8 @@ tNet_message* PDNetGetNextMessage(tNet_game_details* pDetails, void** pSender_ad
                 if (gNet_mode == eNet_mode_host) {
                     dr_dprintf("PDNetGetNextMessage(): Received '%s' from '%s', replying to joiner", receive_buffer, addr_str);
                     MakeMessageToSend(2);
-                    if (sendto(gSocket, gSend_buffer, strlen(gSend_buffer) + 1, 0, (struct sockaddr*)&gRemote_addr, sizeof(gRemote_addr)) == -1) {
+                    // if (sendto(gSocket, gSend_buffer, strlen(gSend_buffer) + 1, 0, (struct sockaddr*)&gRemote_addr, sizeof(gRemote_addr)) == -1) {
+                    if (SendDatagrams(gSend_buffer, strlen(gSend_buffer) + 1, &gRemote_addr, 1) == -1) { // changed by dethrace
                         dr_dprintf("PDNetGetNextMessage(): Error on sendto() - WSAGetLastError=%d", OS_GetLastSocketError());
                     }
                 }
@@ -599,7 +995,8 @@ int PDNetSendMessageToAddress(tNet_game_details* pDetails, tNet_message* pMessag
 
     SockAddrToString(str, &someaddr);
 
-    if (sendto(gSocket, (const char*)pMessage, pMessage->overall_size, 0, (struct sockaddr*)&someaddr, sizeof(someaddr)) == -1) {
+    // if (sendto(gSocket, (const char*)pMessage, pMessage->overall_size, 0, (struct sockaddr*)&someaddr, sizeof(someaddr)) == -1) {
+    if (SendDatagrams((const char*)pMessage, pMessage->overall_size, &someaddr, 1) == -1) { // changed by dethrace
         dr_dprintf("PDNetSendMessageToAddress(): Error on sendto() - WSAGetLastError=%d", OS_GetLastSocketError());
         NetDisposeMessage(pDetails, pMessage);
         return 1;
@@ -619,6 +1016,65 @@ int PDNetGetHeaderSize(void) {
     return 0;
 }
 
+// Added by dethrace
+// The counters of the frame just finished. A frame starts at every NetReceiveAndProcessMessages.
+void PDNetNextFrame(void) {
+    gNet_last_frame_stats = gNet_frame_stats;
+    memset(&gNet_frame_stats, 0, sizeof(gNet_frame_stats));
+}
+
+// Added by dethrace
+void PDNetGetFrameStats(tPD_net_stats* pStats) {
+    *pStats = gNet_last_frame_stats;
+}
+
+// Added by dethrace
+int PDNetLoopbackAddEndpoint(tPD_net_player_info* pAddress) {
+    struct sockaddr_in addr;
+    int endpoint;
+
+    if (!harness_game_config.net_loopback) {
+        return -1;
+    }
+    endpoint = LoopbackAddEndpoint(&addr);
+    if (endpoint != -1) {
+        PDNetCopyFromNative(&pAddress->addr_in, &addr);
+    }
+    return endpoint;
+}
+
+// Added by dethrace
+int PDNetLoopbackSend(int pEndpoint, void* pData, int pSize, tPD_net_player_info* pTo) {
+    struct sockaddr_in addr;
+
+    if (!harness_game_config.net_loopback || pEndpoint < 0 || pEndpoint >= COUNT_OF(gLoopback_endpoints) || !gLoopback_endpoints[pEndpoint].in_use) {
+        return -1;
+    }
+    PDNetCopyToNative(&addr, &pTo->addr_in);
+    LoopbackSend(pEndpoint, pData, pSize, &addr);
+    return 0;
+}
+
+// Added by dethrace
+int PDNetLoopbackReceive(int pEndpoint, void* pBuffer, int pSize, tPD_net_player_info* pFrom) {
+    struct sockaddr_in addr;
+    int res;
+
+    if (!harness_game_config.net_loopback || pEndpoint < 0 || pEndpoint >= COUNT_OF(gLoopback_endpoints) || !gLoopback_endpoints[pEndpoint].in_use) {
+        return -1;
+    }
+    res = LoopbackReceive(pEndpoint, pBuffer, pSize, &addr);
+    if (res != -1) {
+        PDNetCopyFromNative(&pFrom->addr_in, &addr);
+    }
+    return res;
+}
+
+// Added by dethrace
+void PDNetLoopbackGetStats(tPD_net_loopback_stats* pStats) {
+    *pStats = gLoopback_stats;
+}
+
 void PDNetCopyFromNative(tCopyable_sockaddr_in* pAddress, struct sockaddr_in* sock) {
     pAddress->port = sock->sin_port;
     pAddress->address = sock->sin_addr.s_addr;
@@ -746,6 +746,12 @@ int PDGetTotalTime(void) {
     return gHarness_platform.GetTicks();
 }
 
+// Added by dethrace
+// For timing work that takes less than a millisecond
+tU32 PDGetMicroseconds(void) {
+    return Harness_GetMicroseconds();
+}
+
 // IDA: int __usercall PDServiceSystem@<EAX>(tU32 pTime_since_last_call@<EAX>)
 // FUNCTION: CARM95 0x004a7b63
 int PDServiceSystem(tU32 pTime_since_last_call) {
@@ -199,3 +199,32 @@ int PDNetInitClient(tNet_game_details* pDetails) {
 int PDNetGetHeaderSize(void) {
     return 0;
 }
+
+// Added by dethrace
+void PDNetNextFrame(void) {
+}
+
+// Added by dethrace
+void PDNetGetFrameStats(tPD_net_stats* pStats) {
+    memset(pStats, 0, sizeof(*pStats));
+}
+
+// Added by dethrace
+int PDNetLoopbackAddEndpoint(tPD_net_player_info* pAddress) {
+    return -1;
+}
+
+// Added by dethrace
+int PDNetLoopbackSend(int pEndpoint, void* pData, int pSize, tPD_net_player_info* pTo) {
+    return -1;
+}
+
+// Added by dethrace
+int PDNetLoopbackReceive(int pEndpoint, void* pBuffer, int pSize, tPD_net_player_info* pFrom) {
+    return -1;
+}
+
+// Added by dethrace
+void PDNetLoopbackGetStats(tPD_net_loopback_stats* pStats) {
+    memset(pStats, 0, sizeof(*pStats));
+}
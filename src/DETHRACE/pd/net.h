@@ -9,6 +9,25 @@
 
 #include "dr_types.h"
 
+// Added by dethrace
+typedef struct tPD_net_stats {
+    int receive_calls; // socket calls made to receive, including the ones that found nothing
+    int packets_received;
+    int bytes_received;
+    int send_calls;
+    int packets_sent;
+    int bytes_sent;
+} tPD_net_stats;
+
+// Added by dethrace
+typedef struct tPD_net_loopback_stats {
+    int packets_queued;
+    int packets_delivered;
+    int packets_lost;
+    int packets_reordered; // held back behind ones sent after them
+    int most_in_flight;
+} tPD_net_loopback_stats;
+
 void ClearupPDNetworkStuff(void);
 
 void MATTMessageCheck(char* pFunction_name, tNet_message* pMessage, int pAlleged_size);
@@ -67,4 +86,25 @@ int PDNetInitClient(tNet_game_details* pDetails);
 
 int PDNetGetHeaderSize(void);
 
+// Added by dethrace
+void PDNetNextFrame(void);
+
+// Added by dethrace
+void PDNetGetFrameStats(tPD_net_stats* pStats);
+
+// Added by dethrace
+// The in-memory transport used instead of the socket with harness_game_config.net_loopback. Endpoint 0 is this
+// game, the others stand in for the games of other players in the same process. -1 if there is no loopback
+int PDNetLoopbackAddEndpoint(tPD_net_player_info* pAddress);
+
+// Added by dethrace
+int PDNetLoopbackSend(int pEndpoint, void* pData, int pSize, tPD_net_player_info* pTo);
+
+// Added by dethrace
+// Size of the next datagram that is due for the endpoint, -1 if there is none yet
+int PDNetLoopbackReceive(int pEndpoint, void* pBuffer, int pSize, tPD_net_player_info* pFrom);
+
+// Added by dethrace
+void PDNetLoopbackGetStats(tPD_net_loopback_stats* pStats);
+
 #endif
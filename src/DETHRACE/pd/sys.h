@@ -165,6 +165,9 @@ br_model* PDMissingModel(char* name);
 // Added function
 br_pixelmap* PDMissingMap(char* name);
 
+// Added function
+tU32 PDGetMicroseconds(void);
+
 void PDEndItAllAndReRunTheBastard(void);
 
 // int matherr(struct exception_* err);
@@ -5,6 +5,7 @@
 #include "s3sound.h"
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 tS3_vector3 gS3_listener_position_old;
@@ -24,6 +25,13 @@ float dword_531D9C;
 float flt_531D7C;
 float flt_531D98;
 
+// Added by dethrace: backend pushes made and skipped by the batched 3D pass since startup, reported by S3Shutdown
+int gS3_spatial_syncs;
+int gS3_spatial_syncs_skipped;
+
+// Added by dethrace: channels are processed by S3Calculate3DBatch in groups of this size
+#define S3_SPATIAL_BATCH_SIZE 32
+
 void S3Set3DSoundEnvironment(float pInverse_world_scale, float a2, float a3) {
     float tmp;
 
@@ -158,6 +166,35 @@ int S3UpdateSpatialSound(tS3_channel* chan) {
     return close_enough_to_play;
 }
 
+// Added by dethrace: true if a volume change is bigger than about half a decibel
+static int S3VolumeChangeAudible(tS3_volume pOld, tS3_volume pNew) {
+    if ((pOld == 0) != (pNew == 0)) {
+        return 1;
+    }
+    return abs(pNew - pOld) * 16 > MAX(pOld, pNew);
+}
+
+// Added by dethrace. Pushes volume, pan and rate of a 3D channel to the audio backend, but only
+// when they moved far enough from the values last pushed to be heard.
+int S3SyncSpatialSample(tS3_channel* chan) {
+    if (!chan->synced_volume
+        || S3VolumeChangeAudible(chan->synced_left_volume, chan->left_volume)
+        || S3VolumeChangeAudible(chan->synced_right_volume, chan->right_volume)) {
+        S3SyncSampleVolumeAndPan(chan);
+        gS3_spatial_syncs++;
+    } else {
+        gS3_spatial_syncs_skipped++;
+    }
+    // a rate change of 1/256 is about 7 cents
+    if (!chan->synced_rate || abs(chan->rate - chan->synced_rate_value) * 256 > chan->synced_rate_value) {
+        S3SyncSampleRate(chan);
+        gS3_spatial_syncs++;
+    } else {
+        gS3_spatial_syncs_skipped++;
+    }
+    return 1;
+}
+
 int S3BindAmbientSoundToOutlet(tS3_outlet* pOutlet, int pSound, tS3_sound_source* source, float pMax_distance, int pPeriod, int pRepeats, int pVolume, int pPitch, int pSpeed) {
     tS3_descriptor* desc; // [esp+Ch] [ebp-4h]
 
@@ -560,3 +597,105 @@ int S3Calculate3D(tS3_channel* chan, int pIs_ambient) {
     }
     return 1;
 }
+
+// Added by dethrace. Same calculation as S3Calculate3D, for every active 3D channel at once.
+// Positions and velocities are gathered relative to the listener into flat arrays, evaluated in
+// one loop, and the results are written back with `spatial_in_range` set like the return value of
+// S3Calculate3D. S3Service then only pushes results which changed audibly.
+void S3Calculate3DBatch(void) {
+    static tS3_channel* chans[S3_SPATIAL_BATCH_SIZE];
+    static float px[S3_SPATIAL_BATCH_SIZE];
+    static float py[S3_SPATIAL_BATCH_SIZE];
+    static float pz[S3_SPATIAL_BATCH_SIZE];
+    static float vx[S3_SPATIAL_BATCH_SIZE];
+    static float vy[S3_SPATIAL_BATCH_SIZE];
+    static float vz[S3_SPATIAL_BATCH_SIZE];
+    static float max_dist_squared[S3_SPATIAL_BATCH_SIZE];
+    static float doppler[S3_SPATIAL_BATCH_SIZE];
+    static float vol_multiplier[S3_SPATIAL_BATCH_SIZE];
+    static float attenuation[S3_SPATIAL_BATCH_SIZE];
+    static int in_range[S3_SPATIAL_BATCH_SIZE];
+    static int is_ambient[S3_SPATIAL_BATCH_SIZE];
+    tS3_channel* c;
+    tS3_channel* chan;
+    tS3_sound_source* sound_source_ptr;
+    float dist_squared;
+    float dist;
+    float cockpit_multiplier;
+    int count;
+    int i;
+
+    cockpit_multiplier = gS3_inside_cockpit ? 1.0f : 1.3f;
+    c = gS3_active_channels;
+    while (c) {
+        count = 0;
+        for (; c && count < S3_SPATIAL_BATCH_SIZE; c = c->next_active) {
+            c->spatial_in_range = 0;
+            if (!c->spatial_sound || !c->active || c->needs_service) {
+                continue;
+            }
+            sound_source_ptr = c->sound_source_ptr;
+            if (sound_source_ptr) {
+                if (sound_source_ptr->position_ptr) {
+                    S3CopyVector3(&c->position, sound_source_ptr->position_ptr, sound_source_ptr->brender_vector);
+                }
+                if (sound_source_ptr->velocity_ptr) {
+                    S3CopyVector3(&c->velocity, sound_source_ptr->velocity_ptr, sound_source_ptr->brender_vector);
+                } else {
+                    c->velocity.x = (c->position.x - c->lastpos.x) / 1000.0f * gS3_service_time_delta;
+                    c->velocity.y = (c->position.y - c->lastpos.y) / 1000.0f * gS3_service_time_delta;
+                    c->velocity.z = (c->position.z - c->lastpos.z) / 1000.0f * gS3_service_time_delta;
+                    c->lastpos = c->position;
+                }
+            }
+            chans[count] = c;
+            px[count] = c->position.x - gS3_listener_position_now.x;
+            py[count] = c->position.y - gS3_listener_position_now.y;
+            pz[count] = c->position.z - gS3_listener_position_now.z;
+            vx[count] = c->velocity.x - gS3_listener_vel_now.x;
+            vy[count] = c->velocity.y - gS3_listener_vel_now.y;
+            vz[count] = c->velocity.z - gS3_listener_vel_now.z;
+            max_dist_squared[count] = c->pMax_distance_squared;
+            is_ambient[count] = sound_source_ptr && sound_source_ptr->ambient;
+            count++;
+        }
+
+        for (i = 0; i < count; i++) {
+            dist_squared = pz[i] * pz[i] + px[i] * px[i] + py[i] * py[i];
+            in_range[i] = dist_squared <= max_dist_squared[i];
+            dist = dist_squared == 0.0f ? 0.0f : sqrt(dist_squared);
+            doppler[i] = 1.0f;
+            if (is_ambient[i]) {
+                doppler[i] = 1.0f - (pz[i] * vz[i] + vy[i] * py[i] + px[i] * vx[i]) / dist / flt_531D98;
+                doppler[i] = doppler[i] > 2.0f ? 2.0f : (doppler[i] < 0.5f ? 0.5f : doppler[i]);
+            }
+            vol_multiplier[i] = 1.0f / (dist / 6.0f + 1.0f) * cockpit_multiplier;
+            attenuation[i] = pz[i] * gS3_listener_left_now.z + py[i] * gS3_listener_left_now.y + px[i] * gS3_listener_left_now.x;
+            if (attenuation[i] < -1.0f) {
+                attenuation[i] -= ceilf(attenuation[i]);
+            }
+            if (attenuation[i] > 1.0f) {
+                attenuation[i] -= floorf(attenuation[i]);
+            }
+        }
+
+        for (i = 0; i < count; i++) {
+            chan = chans[i];
+            chan->spatial_in_range = in_range[i];
+            if (!in_range[i]) {
+                continue;
+            }
+            if (is_ambient[i]) {
+                chan->rate = chan->initial_pitch * doppler[i];
+            } else {
+                chan->rate = chan->initial_pitch;
+            }
+            chan->left_volume = (attenuation[i] + 1.0f) / 2.0f * ((double)chan->initial_volume * vol_multiplier[i]) * chan->volume_multiplier;
+            chan->right_volume = (1.0f - attenuation[i]) / 2.0f * ((double)chan->initial_volume * vol_multiplier[i]) * chan->volume_multiplier;
+            chan->left_volume = MAX(chan->left_volume, 0);
+            chan->left_volume = MIN(chan->left_volume, 255);
+            chan->right_volume = MAX(chan->right_volume, 0);
+            chan->right_volume = MIN(chan->right_volume, 255);
+        }
+    }
+}
@@ -4,6 +4,9 @@
 #include "brender.h"
 #include "s3_defs.h"
 
+extern int gS3_spatial_syncs;
+extern int gS3_spatial_syncs_skipped;
+
 void S3Set3DSoundEnvironment(float a1, float a2, float a3);
 
 void S3UpdateListenerVectors(void);
@@ -16,6 +19,8 @@ void S3StopSoundSource(tS3_sound_source* src);
 tS3_sound_tag S3ServiceSoundSource(tS3_sound_source* src);
 
 int S3Calculate3D(tS3_channel* chan, int pIs_ambient);
+void S3Calculate3DBatch(void);
+int S3SyncSpatialSample(tS3_channel* chan);
 
 void S3CopyVector3(void* a1, void* a2, int pBrender_vector);
 void S3CopyBrVector3(tS3_vector3* a1, br_vector3* a2);
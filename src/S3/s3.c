@@ -28,6 +28,10 @@ int gS3_next_outlet_id;
 tS3_outlet* gS3_outlets;
 tS3_sound_source* gS3_sound_sources;
 tS3_descriptor* gS3_descriptors;
+
+// Added by dethrace: backend sample start counters summed over all in-race frames, reported by S3Shutdown
+tAudioBackend_stats gS3_backend_totals;
+int gS3_backend_frames;
 tS3_descriptor* gS3_root_descriptor;
 int gS3_opened_output_devices;
 int gS3_last_service_time;
@@ -51,6 +55,15 @@ char gS3_current_dir[260];
 
 int dword_5216C0;
 
+// Added by dethrace: open-addressed hash of descriptors keyed by sound id, so play requests
+// don't walk the descriptor list. Sized to a power of two, kept at most half full.
+tS3_descriptor** gS3_descriptor_hash;
+int gS3_descriptor_hash_size;
+int gS3_descriptor_hash_count;
+
+// Added by dethrace: channels which are active, so S3Service skips idle ones
+tS3_channel* gS3_active_channels;
+
 int S3Init(char* pPath, int pLow_memory_mode) {
     tS3_descriptor* root_descriptor;
 
@@ -80,6 +93,11 @@ int S3Init(char* pPath, int pLow_memory_mode) {
     root_descriptor->id = 2495081;
     gS3_root_descriptor = root_descriptor;
     gS3_descriptors = root_descriptor;
+    gS3_active_channels = NULL;
+    S3ReleaseDescriptorHash();
+    if (S3HashDescriptor(root_descriptor) != 0) {
+        return 3;
+    }
     if (S3LoadSoundbank(pPath, pLow_memory_mode)) {
         return 5;
     }
@@ -94,7 +112,21 @@ void S3Shutdown(void) {
     tS3_outlet* next_outlet;         // [esp+14h] [ebp-Ch]
     tS3_descriptor* next_descriptor; // [esp+18h] [ebp-8h]
     tS3_descriptor* descriptor;      // [esp+1Ch] [ebp-4h]
+    char s[160];                     // added by dethrace
 
+    // Added by dethrace
+    if (gS3_backend_frames != 0) {
+        sprintf(s, "%d frames: %d started (%d restarted, %d rebound, %d initialized), %d without a voice, %.2f ms starting",
+            gS3_backend_frames, gS3_backend_totals.samples_started, gS3_backend_totals.voices_restarted,
+            gS3_backend_totals.voices_rebound, gS3_backend_totals.voices_initialized,
+            gS3_backend_totals.voices_unavailable, gS3_backend_totals.start_time * 1000.0);
+        LOG_INFO2("Sample starts %s", s);
+    }
+    // Added by dethrace
+    if (gS3_spatial_syncs + gS3_spatial_syncs_skipped != 0) {
+        sprintf(s, "%d pushed, %d skipped as inaudible", gS3_spatial_syncs, gS3_spatial_syncs_skipped);
+        LOG_INFO2("3D sample updates %s", s);
+    }
     S3StopAllOutletSounds();
     S3DisableMIDI();
     S3DisableCDA();
@@ -105,6 +137,7 @@ void S3Shutdown(void) {
             S3ReleaseSound(descriptor->id);
             S3MemFree(descriptor);
         }
+        S3ReleaseDescriptorHash();
         for (outlet = gS3_outlets; outlet != NULL; outlet = next_outlet) {
             next_outlet = outlet->next;
             S3ReleaseOutlet(outlet);
@@ -351,6 +384,9 @@ int S3SoundBankReadEntry(tS3_soundbank_read_ctx* ctx, char* dir_name, int low_me
     if (sscanf(ctx->data, "%i%n", &desc->id, &char_count) != 1) {
         return 0;
     }
+    if (S3HashDescriptor(desc) != 0) {
+        return 0;
+    }
     S3SoundBankReaderAdvance(ctx, char_count);
     S3SoundBankReaderNextLine(ctx);
     if (sscanf(ctx->data, "%i,%i%n", &desc->type, &desc->flags, &char_count) != 2) {
@@ -587,6 +623,7 @@ int S3UnbindChannels(tS3_outlet* outlet) {
 
     for (chan = outlet->channel_list; chan; chan = next) {
         next = chan->next;
+        S3UnlinkActiveChannel(chan);
         S3ReleaseTypeStructs(chan);
         if (gS3_unbound_channels) {
             gS3_last_unbound_channel->next = chan;
@@ -625,6 +662,7 @@ tS3_channel* S3AllocateChannel(tS3_outlet* outlet, int priority) {
         if (!c->active || c->needs_service) {
             if (!c->needs_service) {
                 c->active = 1;
+                S3LinkActiveChannel(c);
                 return c;
             }
         } else {
@@ -764,14 +802,26 @@ int S3ReleaseSoundSource(tS3_sound_source* src) {
     return 0;
 }
 
+// Added by dethrace
+void S3AccumulateBackendStats(void) {
+    tAudioBackend_stats stats;
+
+    AudioBackend_GetFrameStats(&stats);
+    gS3_backend_totals.samples_started += stats.samples_started;
+    gS3_backend_totals.voices_restarted += stats.voices_restarted;
+    gS3_backend_totals.voices_rebound += stats.voices_rebound;
+    gS3_backend_totals.voices_initialized += stats.voices_initialized;
+    gS3_backend_totals.voices_unavailable += stats.voices_unavailable;
+    gS3_backend_totals.start_time += stats.start_time;
+    gS3_backend_frames++;
+}
+
 void S3Service(int inside_cockpit, int unk1) {
 
-    int now;        // [esp+Ch] [ebp-10h]
-    tS3_channel* c; // [esp+10h] [ebp-Ch]
-    tS3_outlet* o;  // [esp+14h] [ebp-8h]
-    int v5;         // [esp+18h] [ebp-4h]
+    int now;           // [esp+Ch] [ebp-10h]
+    tS3_channel* c;    // [esp+10h] [ebp-Ch]
+    tS3_channel* next; // added by dethrace
 
-    v5 = 0;
     gS3_inside_cockpit = inside_cockpit;
     if (!gS3_enabled) {
         return;
@@ -781,59 +831,93 @@ void S3Service(int inside_cockpit, int unk1) {
     gS3_last_service_time = now;
     S3ServiceOutlets();
     if (unk1 == 1) {
+        // added by dethrace: the in-race service runs once per frame
+        AudioBackend_NextFrame();
+        S3AccumulateBackendStats();
         S3UpdateListenerVectors();
         S3ServiceAmbientSoundSources();
     }
-    for (o = gS3_outlets; o; o = o->next) {
-        for (c = o->channel_list; c; c = c->next) {
-            if (c->needs_service) {
-                c->needs_service = 0;
-                if (c->descriptor && c->descriptor->flags == 2) {
-                    S3ReleaseSound(c->descriptor->id);
-                }
-                c->active = 0;
-                if (c->type != eS3_ST_midi) {
-                    c->tag = 0;
-                }
-            } else if (c->spatial_sound && c->active) {
-                if (S3UpdateSpatialSound(c)) {
-                    if (c->sound_source_ptr && c->sound_source_ptr->ambient && !S3SoundStillPlaying(c->tag)) {
-                        S3UpdateSoundSource(NULL, -1, c->sound_source_ptr, -1.0f, -1, -1, 0, -1, -1);
-                    }
-                } else if (c->sound_source_ptr) {
-                    if (c->sound_source_ptr->ambient) {
-                        S3UpdateSoundSource(NULL, -1, c->sound_source_ptr, -1.0f, -1, -1, 0, -1, -1);
-                    }
-                } else {
-                    S3StopChannel(c);
-                }
-            } else if (c->type == eS3_ST_midi && c->active) {
-                // sub_4124BE(c);
+    // added by dethrace: work out all 3D channels at once, below only pushes audible changes
+    S3Calculate3DBatch();
+    // changed by dethrace: the original visited every channel of every outlet. Only active
+    // channels have anything to do here; channels activated while walking are picked up next time
+    for (c = gS3_active_channels; c; c = next) {
+        next = c->next_active;
+        if (c->needs_service) {
+            c->needs_service = 0;
+            if (c->descriptor && c->descriptor->flags == 2) {
+                S3ReleaseSound(c->descriptor->id);
             }
-            if (unk1 < 2 && gS3_last_service_time > dword_5216C0) {
-                v5 = 1;
-                if (!c->active && c->spatial_sound == 2) {
-                    // null_unknown_libname_8();  /* no-op */
+            c->active = 0;
+            S3UnlinkActiveChannel(c);
+            if (c->type != eS3_ST_midi) {
+                c->tag = 0;
+            }
+        } else if (c->spatial_sound && c->active) {
+            // changed by dethrace
+            // if (S3UpdateSpatialSound(c)) {
+            if (c->spatial_in_range && S3SyncSpatialSample(c)) {
+                if (c->sound_source_ptr && c->sound_source_ptr->ambient && !S3SoundStillPlaying(c->tag)) {
+                    S3UpdateSoundSource(NULL, -1, c->sound_source_ptr, -1.0f, -1, -1, 0, -1, -1);
+                }
+            } else if (c->sound_source_ptr) {
+                if (c->sound_source_ptr->ambient) {
+                    S3UpdateSoundSource(NULL, -1, c->sound_source_ptr, -1.0f, -1, -1, 0, -1, -1);
                 }
+            } else {
+                S3StopChannel(c);
             }
+        } else if (c->type == eS3_ST_midi && c->active) {
+            // sub_4124BE(c);
         }
     }
-    if (v5) {
+    // every outlet has at least one channel
+    if (unk1 < 2 && gS3_outlets != NULL && gS3_last_service_time > dword_5216C0) {
         dword_5216C0 = gS3_last_service_time;
     }
 }
 
 void S3ServiceOutlets(void) {
-    tS3_channel* c; // [esp+Ch] [ebp-8h]
-    tS3_outlet* o;  // [esp+10h] [ebp-4h]
+    tS3_channel* c;    // [esp+Ch] [ebp-8h]
+    tS3_channel* next; // added by dethrace
 
-    for (o = gS3_outlets; o; o = o->next) {
-        for (c = o->channel_list; c; c = c->next) {
-            S3ServiceChannel(c);
-        }
+    // changed by dethrace: only poll the backend for active channels
+    for (c = gS3_active_channels; c; c = next) {
+        next = c->next_active;
+        S3ServiceChannel(c);
     }
 }
 
+void S3LinkActiveChannel(tS3_channel* chan) {
+    if (chan->in_active_list) {
+        return;
+    }
+    chan->prev_active = NULL;
+    chan->next_active = gS3_active_channels;
+    if (gS3_active_channels) {
+        gS3_active_channels->prev_active = chan;
+    }
+    gS3_active_channels = chan;
+    chan->in_active_list = 1;
+}
+
+void S3UnlinkActiveChannel(tS3_channel* chan) {
+    if (!chan->in_active_list) {
+        return;
+    }
+    if (chan->prev_active) {
+        chan->prev_active->next_active = chan->next_active;
+    } else {
+        gS3_active_channels = chan->next_active;
+    }
+    if (chan->next_active) {
+        chan->next_active->prev_active = chan->prev_active;
+    }
+    chan->next_active = NULL;
+    chan->prev_active = NULL;
+    chan->in_active_list = 0;
+}
+
 int S3ServiceChannel(tS3_channel* chan) {
     if (chan->type == eS3_ST_sample) {
         if (AudioBackend_SoundIsPlaying(chan->type_struct_sample)) {
@@ -1205,18 +1289,36 @@ char* S3GetCurrentDir(void) {
     return gS3_current_dir;
 }
 
+// Added by dethrace
+static unsigned int S3HashSoundID(tS3_sound_id id, int size) {
+    return (((unsigned int)id * 2654435769u) >> 8) & (size - 1);
+}
+
+// Added by dethrace
+static tS3_descriptor* S3FindHashedDescriptor(tS3_sound_id id) {
+    tS3_descriptor* d;
+    unsigned int i;
+
+    if (gS3_descriptor_hash == NULL) {
+        return NULL;
+    }
+    for (i = S3HashSoundID(id, gS3_descriptor_hash_size);; i = (i + 1) & (gS3_descriptor_hash_size - 1)) {
+        d = gS3_descriptor_hash[i];
+        if (d == NULL || d->id == id) {
+            return d;
+        }
+    }
+}
+
 tS3_descriptor* S3GetDescriptorByID(tS3_sound_tag id) {
     tS3_descriptor* d; // [esp+Ch] [ebp-4h]
 
     assert(id != 0);
 
-    for (d = gS3_descriptors;; d = d->next) {
-        if (!d) {
-            return 0;
-        }
-        if (d->id == id) {
-            break;
-        }
+    // changed by dethrace: look up the hash instead of walking gS3_descriptors
+    d = S3FindHashedDescriptor(id);
+    if (!d) {
+        return 0;
     }
     if (d->memory_proxy < 0) {
         return d;
@@ -1225,6 +1327,58 @@ tS3_descriptor* S3GetDescriptorByID(tS3_sound_tag id) {
     }
 }
 
+static void S3InsertDescriptorHash(tS3_descriptor** table, int size, tS3_descriptor* desc) {
+    unsigned int i;
+
+    for (i = S3HashSoundID(desc->id, size); table[i] != NULL; i = (i + 1) & (size - 1)) {
+        ;
+    }
+    table[i] = desc;
+}
+
+// Added by dethrace. Returns 0 on success
+int S3HashDescriptor(tS3_descriptor* desc) {
+    tS3_descriptor** table;
+    int size;
+    int i;
+
+    if (S3FindHashedDescriptor(desc->id) != NULL) {
+        // the list walk found the first descriptor with a given id, so keep that one
+        return 0;
+    }
+    if ((gS3_descriptor_hash_count + 1) * 2 > gS3_descriptor_hash_size) {
+        size = gS3_descriptor_hash_size ? gS3_descriptor_hash_size * 2 : 256;
+        table = S3MemAllocate(size * sizeof(tS3_descriptor*), kMem_S3_descriptor);
+        if (table == NULL) {
+            gS3_last_error = eS3_error_memory;
+            return gS3_last_error;
+        }
+        memset(table, 0, size * sizeof(tS3_descriptor*));
+        for (i = 0; i < gS3_descriptor_hash_size; i++) {
+            if (gS3_descriptor_hash[i] != NULL) {
+                S3InsertDescriptorHash(table, size, gS3_descriptor_hash[i]);
+            }
+        }
+        if (gS3_descriptor_hash != NULL) {
+            S3MemFree(gS3_descriptor_hash);
+        }
+        gS3_descriptor_hash = table;
+        gS3_descriptor_hash_size = size;
+    }
+    S3InsertDescriptorHash(gS3_descriptor_hash, gS3_descriptor_hash_size, desc);
+    gS3_descriptor_hash_count++;
+    return 0;
+}
+
+void S3ReleaseDescriptorHash(void) {
+    if (gS3_descriptor_hash != NULL) {
+        S3MemFree(gS3_descriptor_hash);
+    }
+    gS3_descriptor_hash = NULL;
+    gS3_descriptor_hash_size = 0;
+    gS3_descriptor_hash_count = 0;
+}
+
 int S3SetOutletVolume(tS3_outlet* pOutlet, tS3_volume pVolume) {
     tS3_channel* c; // [esp+10h] [ebp-4h]
 
@@ -11,6 +11,7 @@ extern tS3_channel gS3_channel_template;
 extern tS3_sound_source* gS3_sound_sources;
 extern int gS3_service_time_delta;
 extern int gS3_inside_cockpit;
+extern tS3_channel* gS3_active_channels;
 
 int S3Init(char* path, int low_memory_mode);
 
@@ -49,6 +50,11 @@ int S3SoundBankReadEntry(tS3_soundbank_read_ctx* ctx, char* dir_name, int low_me
 
 tS3_descriptor* S3CreateDescriptor(void);
 tS3_descriptor* S3GetDescriptorByID(tS3_sound_id id);
+int S3HashDescriptor(tS3_descriptor* desc);
+void S3ReleaseDescriptorHash(void);
+
+void S3LinkActiveChannel(tS3_channel* chan);
+void S3UnlinkActiveChannel(tS3_channel* chan);
 
 char* S3GetCurrentDir(void);
 
@@ -65,6 +71,7 @@ int S3ChangeVolume(tS3_sound_tag pTag, tS3_volume pVolume);
 
 void S3ServiceOutlets(void);
 int S3ServiceChannel(tS3_channel* chan);
+void S3AccumulateBackendStats(void);
 void S3Service(int inside_cockpit, int unk1);
 
 int S3SoundStillPlaying(tS3_sound_tag pSound);
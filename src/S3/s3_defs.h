@@ -98,6 +98,19 @@ typedef struct tS3_channel {
     char* type_struct_midi;
     char* type_struct_cda;
     tS3_sound_source* sound_source_ptr;
+
+    // Added by dethrace: links channels which S3Service needs to look at
+    tS3_channel* next_active;
+    tS3_channel* prev_active;
+    int in_active_list;
+
+    // Added by dethrace: result of the batched 3D pass, and the values last pushed to the audio backend
+    int spatial_in_range;
+    int synced_volume;
+    tS3_volume synced_left_volume;
+    tS3_volume synced_right_volume;
+    int synced_rate;
+    int synced_rate_value;
 } tS3_channel;
 
 typedef struct tS3_outlet {
@@ -377,6 +377,11 @@ int S3SyncSampleVolumeAndPan(tS3_channel* chan) {
         return 1;
     }
 
+    // added by dethrace
+    chan->synced_volume = 1;
+    chan->synced_left_volume = chan->left_volume;
+    chan->synced_right_volume = chan->right_volume;
+
     if (AudioBackend_SetVolumeSeparate(chan->type_struct_sample, chan->left_volume, chan->right_volume) == eAB_success) {
         return 1;
     }
@@ -417,6 +422,10 @@ int S3SyncSampleRate(tS3_channel* chan) {
         return 1;
     }
 
+    // added by dethrace
+    chan->synced_rate = 1;
+    chan->synced_rate_value = chan->rate;
+
     new_rate = chan->rate;
     if (new_rate >= 100000) {
         new_rate = 100000;
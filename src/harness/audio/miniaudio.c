@@ -24,13 +24,29 @@
 // duplicates DETHRACE/constants.h but is a necessary evil(?)
 static int kMem_S3_DOS_SOS_channel = 234;
 
-typedef struct tMiniaudio_sample {
+// Enough voices for every S3 channel the game creates at the highest sound detail level
+#define MINIAUDIO_VOICE_COUNT 32
+
+// A voice owns a sound node which stays attached to the engine graph. Starting a sample
+// only rebinds the buffer ref to the sample data, unless the voice was last initialized
+// for a different channel count or sample rate.
+typedef struct tMiniaudio_voice {
     ma_audio_buffer_ref buffer_ref;
     ma_sound sound;
+    int initialized;
+    int channels;
+    int rate;
+    int in_use;
+    unsigned int generation;
+    unsigned int released_at;
+} tMiniaudio_voice;
+
+typedef struct tMiniaudio_sample {
+    tMiniaudio_voice* voice;
+    unsigned int voice_generation;
     int init_volume;
     int init_pan;
     int init_new_rate;
-    int initialized;
 } tMiniaudio_sample;
 
 typedef struct tMiniaudio_stream {
@@ -47,9 +63,100 @@ ma_engine engine;
 ma_sound cda_sound;
 int cda_sound_initialized;
 
+static tMiniaudio_voice voices[MINIAUDIO_VOICE_COUNT];
+static unsigned int voice_release_counter;
+static tAudioBackend_stats frame_stats;
+static tAudioBackend_stats last_frame_stats;
+static ma_timer stats_timer;
+
+// Most of the game's samples are 8-bit mono at this rate
+static ma_uint8 voice_warmup_data[1] = { 0x80 };
+#define MINIAUDIO_VOICE_WARMUP_RATE 11025
+
+static ma_result Miniaudio_InitVoice(tMiniaudio_voice* voice, int channels, void* data, ma_uint64 size_in_frames, int rate) {
+    ma_result result;
+
+    result = ma_audio_buffer_ref_init(ma_format_u8, channels, data, size_in_frames, &voice->buffer_ref);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    voice->buffer_ref.sampleRate = rate;
+    result = ma_sound_init_from_data_source(&engine, &voice->buffer_ref, MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_NO_SPATIALIZATION, NULL, &voice->sound);
+    if (result != MA_SUCCESS) {
+        ma_audio_buffer_ref_uninit(&voice->buffer_ref);
+        return result;
+    }
+    voice->initialized = 1;
+    voice->channels = channels;
+    voice->rate = rate;
+    return MA_SUCCESS;
+}
+
+static void Miniaudio_UnInitVoice(tMiniaudio_voice* voice) {
+    if (voice->initialized) {
+        ma_sound_stop(&voice->sound);
+        ma_sound_uninit(&voice->sound);
+        ma_audio_buffer_ref_uninit(&voice->buffer_ref);
+        voice->initialized = 0;
+    }
+}
+
+static tMiniaudio_voice* Miniaudio_VoiceOf(tMiniaudio_sample* miniaudio) {
+    if (miniaudio->voice == NULL || !miniaudio->voice->in_use || miniaudio->voice->generation != miniaudio->voice_generation) {
+        return NULL;
+    }
+    return miniaudio->voice;
+}
+
+static void Miniaudio_ReleaseVoice(tMiniaudio_voice* voice) {
+    if (voice->initialized) {
+        ma_sound_stop(&voice->sound);
+    }
+    voice->in_use = 0;
+    voice->released_at = ++voice_release_counter;
+}
+
+// Prefer the free voice with a matching format which has been idle the longest, so the audio
+// thread is long done with it. Fall back to any free voice, then to one whose sound has ended.
+static tMiniaudio_voice* Miniaudio_FindVoice(int channels, int rate) {
+    int i;
+    tMiniaudio_voice* v;
+    tMiniaudio_voice* matching;
+    tMiniaudio_voice* free_voice;
+    tMiniaudio_voice* finished;
+
+    matching = NULL;
+    free_voice = NULL;
+    finished = NULL;
+    for (i = 0; i < MINIAUDIO_VOICE_COUNT; i++) {
+        v = &voices[i];
+        if (v->in_use) {
+            if (finished == NULL && v->initialized && !ma_sound_is_playing(&v->sound)) {
+                finished = v;
+            }
+            continue;
+        }
+        if (v->initialized && v->channels == channels && v->rate == rate) {
+            if (matching == NULL || v->released_at < matching->released_at) {
+                matching = v;
+            }
+        } else if (free_voice == NULL || !v->initialized || (free_voice->initialized && v->released_at < free_voice->released_at)) {
+            free_voice = v;
+        }
+    }
+    if (matching != NULL) {
+        return matching;
+    }
+    if (free_voice != NULL) {
+        return free_voice;
+    }
+    return finished;
+}
+
 tAudioBackend_error_code AudioBackend_Init(void) {
     ma_result result;
     ma_engine_config config;
+    int i;
 
     config = ma_engine_config_init();
     result = ma_engine_init(&config, &engine);
@@ -60,6 +167,17 @@ tAudioBackend_error_code AudioBackend_Init(void) {
     LOG_INFO2("Playback device: '%s'", engine.pDevice->playback.name);
     ma_engine_set_volume(&engine, harness_game_config.volume_multiplier);
 
+    memset(voices, 0, sizeof(voices));
+    for (i = 0; i < MINIAUDIO_VOICE_COUNT; i++) {
+        if (Miniaudio_InitVoice(&voices[i], 1, voice_warmup_data, 1, MINIAUDIO_VOICE_WARMUP_RATE) != MA_SUCCESS) {
+            LOG_WARN("Failed to preinitialize audio voice");
+            break;
+        }
+    }
+    memset(&frame_stats, 0, sizeof(frame_stats));
+    memset(&last_frame_stats, 0, sizeof(last_frame_stats));
+    ma_timer_init(&stats_timer);
+
     return eAB_success;
 }
 
@@ -72,6 +190,11 @@ tAudioBackend_error_code AudioBackend_InitCDA(void) {
 }
 
 void AudioBackend_UnInit(void) {
+    int i;
+
+    for (i = 0; i < MINIAUDIO_VOICE_COUNT; i++) {
+        Miniaudio_UnInitVoice(&voices[i]);
+    }
     ma_engine_uninit(&engine);
 }
 
@@ -142,43 +265,80 @@ void* AudioBackend_AllocateSampleTypeStruct(void) {
 
 tAudioBackend_error_code AudioBackend_PlaySample(void* type_struct_sample, int channels, void* data, int size, int rate, int loop) {
     tMiniaudio_sample* miniaudio;
-    ma_result result;
-    ma_int32 flags;
+    tMiniaudio_voice* voice;
+    ma_uint64 size_in_frames;
+    double start_time;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    result = ma_audio_buffer_ref_init(ma_format_u8, channels, data, size / channels, &miniaudio->buffer_ref);
-    miniaudio->buffer_ref.sampleRate = rate;
-    if (result != MA_SUCCESS) {
-        return eAB_error;
-    }
-
-    flags = MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_NO_SPATIALIZATION;
-    result = ma_sound_init_from_data_source(&engine, &miniaudio->buffer_ref, flags, NULL, &miniaudio->sound);
-    if (result != MA_SUCCESS) {
-        return eAB_error;
+    start_time = ma_timer_get_time_in_seconds(&stats_timer);
+    size_in_frames = size / channels;
+
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice != NULL && voice->initialized && voice->buffer_ref.pData == data && voice->buffer_ref.sizeInFrames == size_in_frames
+        && voice->channels == channels && voice->rate == rate) {
+        // restarting the same sample: the mixing thread performs the seek, nothing is rebound
+        ma_sound_seek_to_pcm_frame(&voice->sound, 0);
+        frame_stats.voices_restarted++;
+    } else {
+        if (voice != NULL) {
+            Miniaudio_ReleaseVoice(voice);
+        }
+        voice = Miniaudio_FindVoice(channels, rate);
+        if (voice == NULL) {
+            frame_stats.voices_unavailable++;
+            return eAB_error;
+        }
+        voice->in_use = 1;
+        voice->generation++;
+        miniaudio->voice = voice;
+        miniaudio->voice_generation = voice->generation;
+
+        if (voice->initialized && voice->channels == channels && voice->rate == rate) {
+            ma_sound_stop(&voice->sound);
+            ma_audio_buffer_ref_set_data(&voice->buffer_ref, data, size_in_frames);
+            ma_sound_seek_to_pcm_frame(&voice->sound, 0);
+            frame_stats.voices_rebound++;
+        } else {
+            Miniaudio_UnInitVoice(voice);
+            if (Miniaudio_InitVoice(voice, channels, data, size_in_frames, rate) != MA_SUCCESS) {
+                voice->in_use = 0;
+                miniaudio->voice = NULL;
+                return eAB_error;
+            }
+            frame_stats.voices_initialized++;
+        }
     }
-    miniaudio->initialized = 1;
 
+    // a reused voice still carries the volume, pan and pitch of its previous sample
     if (miniaudio->init_volume > 0) {
         AudioBackend_SetVolume(type_struct_sample, miniaudio->init_volume);
         AudioBackend_SetPan(type_struct_sample, miniaudio->init_pan);
         AudioBackend_SetFrequency(type_struct_sample, rate, miniaudio->init_new_rate);
+    } else {
+        ma_sound_set_volume(&voice->sound, 1.0f);
+        ma_sound_set_pan(&voice->sound, 0.0f);
+        ma_sound_set_pitch(&voice->sound, 1.0f);
     }
 
-    ma_sound_set_looping(&miniaudio->sound, loop);
-    ma_sound_start(&miniaudio->sound);
+    ma_sound_set_looping(&voice->sound, loop);
+    ma_sound_start(&voice->sound);
+
+    frame_stats.samples_started++;
+    frame_stats.start_time += ma_timer_get_time_in_seconds(&stats_timer) - start_time;
     return eAB_success;
 }
 
 int AudioBackend_SoundIsPlaying(void* type_struct_sample) {
     tMiniaudio_sample* miniaudio;
+    tMiniaudio_voice* voice;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    if (ma_sound_is_playing(&miniaudio->sound)) {
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice != NULL && ma_sound_is_playing(&voice->sound)) {
         return 1;
     }
     return 0;
@@ -186,50 +346,57 @@ int AudioBackend_SoundIsPlaying(void* type_struct_sample) {
 
 tAudioBackend_error_code AudioBackend_SetVolume(void* type_struct_sample, int volume) {
     tMiniaudio_sample* miniaudio;
+    tMiniaudio_voice* voice;
     float linear_volume;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    if (!miniaudio->initialized) {
-        miniaudio->init_volume = volume;
+    // remembered so a restarted or rebound voice picks it up again
+    miniaudio->init_volume = volume;
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice == NULL) {
         return eAB_success;
     }
 
     linear_volume = volume / 510.0f;
-    ma_sound_set_volume(&miniaudio->sound, linear_volume);
+    ma_sound_set_volume(&voice->sound, linear_volume);
     return eAB_success;
 }
 
 tAudioBackend_error_code AudioBackend_SetPan(void* type_struct_sample, int pan) {
     tMiniaudio_sample* miniaudio;
+    tMiniaudio_voice* voice;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    if (!miniaudio->initialized) {
-        miniaudio->init_pan = pan;
+    miniaudio->init_pan = pan;
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice == NULL) {
         return eAB_success;
     }
 
     // convert from directsound -10000 - 10000 pan scale
-    ma_sound_set_pan(&miniaudio->sound, pan / 10000.0f);
+    ma_sound_set_pan(&voice->sound, pan / 10000.0f);
     return eAB_success;
 }
 
 tAudioBackend_error_code AudioBackend_SetFrequency(void* type_struct_sample, int original_rate, int new_rate) {
     tMiniaudio_sample* miniaudio;
+    tMiniaudio_voice* voice;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    if (!miniaudio->initialized) {
-        miniaudio->init_new_rate = new_rate;
+    miniaudio->init_new_rate = new_rate;
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice == NULL) {
         return eAB_success;
     }
 
     // convert from directsound frequency to linear pitch scale
-    ma_sound_set_pitch(&miniaudio->sound, (new_rate / (float)original_rate));
+    ma_sound_set_pitch(&voice->sound, (new_rate / (float)original_rate));
     return eAB_success;
 }
 
@@ -239,19 +406,29 @@ tAudioBackend_error_code AudioBackend_SetVolumeSeparate(void* type_struct_sample
 
 tAudioBackend_error_code AudioBackend_StopSample(void* type_struct_sample) {
     tMiniaudio_sample* miniaudio;
+    tMiniaudio_voice* voice;
 
     miniaudio = (tMiniaudio_sample*)type_struct_sample;
     assert(miniaudio != NULL);
 
-    if (miniaudio->initialized) {
-        ma_sound_stop(&miniaudio->sound);
-        ma_sound_uninit(&miniaudio->sound);
-        ma_audio_buffer_ref_uninit(&miniaudio->buffer_ref);
-        miniaudio->initialized = 0;
+    // the voice keeps its sound node so the next sample can be started without reinitializing it
+    voice = Miniaudio_VoiceOf(miniaudio);
+    if (voice != NULL) {
+        Miniaudio_ReleaseVoice(voice);
     }
+    miniaudio->voice = NULL;
     return eAB_success;
 }
 
+void AudioBackend_NextFrame(void) {
+    last_frame_stats = frame_stats;
+    memset(&frame_stats, 0, sizeof(frame_stats));
+}
+
+void AudioBackend_GetFrameStats(tAudioBackend_stats* stats) {
+    *stats = last_frame_stats;
+}
+
 tAudioBackend_stream* AudioBackend_StreamOpen(int bit_depth, int channels, unsigned int sample_rate) {
     tMiniaudio_stream* new;
     ma_data_converter_config data_converter_config;
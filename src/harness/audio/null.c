@@ -45,6 +45,13 @@ tAudioBackend_error_code AudioBackend_SetVolumeSeparate(void* type_struct_sample
     return eAB_error;
 }
 
+void AudioBackend_NextFrame(void) {
+}
+
+void AudioBackend_GetFrameStats(tAudioBackend_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
 tAudioBackend_error_code AudioBackend_PlayCDA(int track) {
     return eAB_error;
 }
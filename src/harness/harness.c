@@ -60,6 +60,18 @@ tHarness_platform gHarness_platform;
 
 static int force_null_platform = 0;
 
+// Frame times kept for the percentiles reported at exit, in microseconds
+#define FRAME_TIME_SAMPLES 4096
+// How far short of the deadline the hybrid limiter stops sleeping and spins, as a sleep can overrun by a scheduler tick
+#define FRAME_PACING_SPIN_US 2000
+
+static br_uint_32 frame_times[FRAME_TIME_SAMPLES];
+static br_uint_32 frame_times_sorted[FRAME_TIME_SAMPLES];
+static int frame_time_count;
+static br_uint_32 last_frame_start;
+static br_uint_32 frame_deadline;
+static int frame_pacing_started;
+
 static int Harness_ProcessCommandLine(int* argc, char* argv[]);
 static int Harness_ProcessIniFile(void);
 
@@ -277,8 +289,16 @@ int Harness_Init(int* argc, char* argv[]) {
     harness_game_config.enable_cd_check = 0;
     // original physics time step. Lower values seem to work better at 30+ fps
     harness_game_config.physics_step_time = 40;
+    // as many physics steps in a frame as cover 200 ms, which is the original 5 at 40 ms each
+    harness_game_config.physics_max_steps = 0;
+    // draw cars between their poses before and after the last physics step
+    harness_game_config.physics_interpolation = 1;
     // limit to 60 fps by default
     harness_game_config.fps = 60;
+    // sleep most of the way to the next frame and spin the rest
+    harness_game_config.frame_pacing = eFrame_pacing_hybrid;
+    // expand frames through the palette on the game thread, PresentThread moves it to a worker
+    harness_game_config.present_thread = 0;
     // do not freeze timer
     harness_game_config.freeze_timer = 0;
     // default demo time out is 240s
@@ -293,8 +313,35 @@ int Harness_Init(int* argc, char* argv[]) {
     harness_game_config.gore_check = 0;
     // Disable "Sound Options" menu
     harness_game_config.sound_options = 0;
+    // decode up to 4 FLIC frames ahead on a worker thread
+    harness_game_config.flic_decode_ahead = 4;
+    // load whole FLICs into memory before playing them
+    harness_game_config.flic_stream = 0;
+    // let spark, smoke, shrapnel and smoke column pools grow to 10 times their original size
+    harness_game_config.particle_pool_scale = 10;
+    // cull track columns against the view frustum (2: and a visibility set precomputed from the track)
+    harness_game_config.column_culling = 1;
+    // render the rear view mirror every frame
+    harness_game_config.mirror_refresh_interval = 1;
+    // draw splashes, smoke and sparks in the rear view mirror however small it is
+    harness_game_config.mirror_particle_min_height = 0;
+    // render the map view's 3d inset every frame
+    harness_game_config.map_inset_fps = 0;
+    // draw the sky image after the scene, only where nothing covers it
+    harness_game_config.deferred_sky = 1;
     // Skip binding socket to allow local network testing
     harness_game_config.no_bind = 0;
+    // Send car mechanics as full NETMSGID_MECHANICS messages, which every version understands
+    harness_game_config.net_delta_mechanics = 0;
+    // Snap remote cars to the newest mechanics message, as the original game
+    harness_game_config.net_interpolation = 0;
+    // Talk over UDP sockets, not the in-memory loopback for running several players in one process
+    harness_game_config.net_loopback = 0;
+    // loopback delivery: fixed latency plus up to jitter ms, percent of datagrams dropped and held back
+    harness_game_config.net_loopback_latency = 0;
+    harness_game_config.net_loopback_jitter = 0;
+    harness_game_config.net_loopback_loss = 0;
+    harness_game_config.net_loopback_reorder = 0;
     // Disable verbose logging
     harness_game_config.verbose = 0;
 
@@ -333,7 +380,91 @@ int Harness_Init(int* argc, char* argv[]) {
     return 0;
 }
 
+br_uint_32 Harness_GetMicroseconds(void) {
+    if (gHarness_platform.GetMicroseconds != NULL) {
+        return gHarness_platform.GetMicroseconds();
+    }
+    return gHarness_platform.GetTicks() * 1000;
+}
+
+// Called by the platforms after presenting a frame. Holds the frame rate to harness_game_config.fps and records how long each frame took
+void Harness_PaceFrame(void) {
+    br_uint_32 now;
+    br_uint_32 period;
+    br_uint_32 frame_time;
+    int remaining;
+
+    now = Harness_GetMicroseconds();
+    if (harness_game_config.fps != 0 && harness_game_config.frame_pacing != eFrame_pacing_vsync) {
+        period = (br_uint_32)(1000000.f / harness_game_config.fps);
+        frame_time = now - last_frame_start;
+        if (harness_game_config.frame_pacing == eFrame_pacing_sleep) {
+            // whole milliseconds from the end of the last frame, as before
+            if (frame_pacing_started && frame_time < 100000 && frame_time < period && (period - frame_time) / 1000 > 5) {
+                gHarness_platform.Sleep((period - frame_time) / 1000);
+            }
+        } else {
+            // keep to a schedule of deadlines one period apart, so the time lost oversleeping one frame is made up in the next
+            frame_deadline += period;
+            remaining = (int)(frame_deadline - now);
+            if (!frame_pacing_started || remaining > (int)period || remaining < -(int)period) {
+                // a frame or more behind (loading, a menu, a stall), start again from now rather than rushing to catch up
+                frame_deadline = now;
+            } else if (remaining > 0) {
+                if (remaining > FRAME_PACING_SPIN_US) {
+                    gHarness_platform.Sleep((remaining - FRAME_PACING_SPIN_US) / 1000);
+                }
+                while ((int)(frame_deadline - Harness_GetMicroseconds()) > 0) {
+                }
+            }
+        }
+        now = Harness_GetMicroseconds();
+    }
+
+    if (frame_pacing_started) {
+        frame_times[frame_time_count % FRAME_TIME_SAMPLES] = now - last_frame_start;
+        frame_time_count++;
+    }
+    last_frame_start = now;
+    frame_pacing_started = 1;
+}
+
+static int Harness_CompareFrameTimes(const void* pA, const void* pB) {
+    br_uint_32 a = *(const br_uint_32*)pA;
+    br_uint_32 b = *(const br_uint_32*)pB;
+
+    return (a > b) - (a < b);
+}
+
+// Median, 99th percentile and longest of the last FRAME_TIME_SAMPLES frame times, in microseconds. Returns how many frames they cover
+int Harness_GetFrameTimeStats(br_uint_32* pP50, br_uint_32* pP99, br_uint_32* pMax) {
+    int count;
+
+    count = frame_time_count < FRAME_TIME_SAMPLES ? frame_time_count : FRAME_TIME_SAMPLES;
+    if (count == 0) {
+        *pP50 = *pP99 = *pMax = 0;
+        return 0;
+    }
+    memcpy(frame_times_sorted, frame_times, count * sizeof(br_uint_32));
+    qsort(frame_times_sorted, count, sizeof(br_uint_32), Harness_CompareFrameTimes);
+    *pP50 = frame_times_sorted[count / 2];
+    *pP99 = frame_times_sorted[(count * 99) / 100];
+    *pMax = frame_times_sorted[count - 1];
+    return count;
+}
+
 void Harness_Quit(void) {
+    char s[128];
+    br_uint_32 p50;
+    br_uint_32 p99;
+    br_uint_32 max;
+    int count;
+
+    count = Harness_GetFrameTimeStats(&p50, &p99, &max);
+    if (count != 0) {
+        sprintf(s, "last %d frames: p50 %.2f ms, p99 %.2f ms, max %.2f ms", count, p50 / 1000.f, p99 / 1000.f, max / 1000.f);
+        LOG_INFO2("Frame times %s", s);
+    }
 
     if (harness_game_config.install_signalhandler) {
         OS_RemoveSignalHandler();
@@ -383,11 +514,31 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
             harness_game_config.physics_step_time = atoi(s + 1);
             LOG_INFO2("Physics step time set to %d", harness_game_config.physics_step_time);
             consumed = 1;
+        } else if (strstr(argv[i], "--physics-max-steps=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.physics_max_steps = atoi(s + 1);
+            LOG_INFO2("Physics max steps set to %d", harness_game_config.physics_max_steps);
+            consumed = 1;
+        } else if (strstr(argv[i], "--physics-interpolation=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.physics_interpolation = atoi(s + 1);
+            LOG_INFO2("Physics interpolation set to %d", harness_game_config.physics_interpolation);
+            consumed = 1;
         } else if (strstr(argv[i], "--fps=") != NULL) {
             char* s = strstr(argv[i], "=");
             harness_game_config.fps = atoi(s + 1);
             LOG_INFO2("FPS limiter set to %f", harness_game_config.fps);
             consumed = 1;
+        } else if (strstr(argv[i], "--frame-pacing=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.frame_pacing = atoi(s + 1);
+            LOG_INFO2("Frame pacing set to %d", harness_game_config.frame_pacing);
+            consumed = 1;
+        } else if (strstr(argv[i], "--present-thread=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.present_thread = atoi(s + 1);
+            LOG_INFO2("Present thread set to %d", harness_game_config.present_thread);
+            consumed = 1;
         } else if (strcasecmp(argv[i], "--freeze-timer") == 0) {
             LOG_INFO("Timer frozen");
             harness_game_config.freeze_timer = 1;
@@ -425,6 +576,44 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
         } else if (strcasecmp(argv[i], "--sound-options") == 0) {
             harness_game_config.sound_options = 1;
             consumed = 1;
+        } else if (strstr(argv[i], "--flic-decode-ahead=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.flic_decode_ahead = atoi(s + 1);
+            LOG_INFO2("FLIC decode-ahead set to %d frames", harness_game_config.flic_decode_ahead);
+            consumed = 1;
+        } else if (strcasecmp(argv[i], "--flic-stream") == 0) {
+            harness_game_config.flic_stream = 1;
+            consumed = 1;
+        } else if (strstr(argv[i], "--particle-pool-scale=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.particle_pool_scale = atoi(s + 1);
+            LOG_INFO2("Particle pool scale set to %d", harness_game_config.particle_pool_scale);
+            consumed = 1;
+        } else if (strstr(argv[i], "--column-culling=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.column_culling = atoi(s + 1);
+            LOG_INFO2("Column culling set to %d", harness_game_config.column_culling);
+            consumed = 1;
+        } else if (strstr(argv[i], "--mirror-refresh-interval=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.mirror_refresh_interval = atoi(s + 1);
+            LOG_INFO2("Mirror refresh interval set to %d frames", harness_game_config.mirror_refresh_interval);
+            consumed = 1;
+        } else if (strstr(argv[i], "--mirror-particle-min-height=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.mirror_particle_min_height = atoi(s + 1);
+            LOG_INFO2("Mirror particle minimum height set to %d pixels", harness_game_config.mirror_particle_min_height);
+            consumed = 1;
+        } else if (strstr(argv[i], "--map-inset-fps=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.map_inset_fps = atoi(s + 1);
+            LOG_INFO2("Map inset fps set to %d", harness_game_config.map_inset_fps);
+            consumed = 1;
+        } else if (strstr(argv[i], "--deferred-sky=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.deferred_sky = atoi(s + 1);
+            LOG_INFO2("Deferred sky set to %d", harness_game_config.deferred_sky);
+            consumed = 1;
         } else if (strcasecmp(argv[i], "--opengl") == 0) {
             harness_game_config.opengl_3dfx_mode = 1;
             consumed = 1;
@@ -434,6 +623,35 @@ int Harness_ProcessCommandLine(int* argc, char* argv[]) {
         } else if (strcasecmp(argv[i], "--no-bind") == 0) {
             harness_game_config.no_bind = 1;
             consumed = 1;
+        } else if (strcasecmp(argv[i], "--net-delta-mechanics") == 0) {
+            harness_game_config.net_delta_mechanics = 1;
+            consumed = 1;
+        } else if (strcasecmp(argv[i], "--net-interpolation") == 0) {
+            harness_game_config.net_interpolation = 1;
+            consumed = 1;
+        } else if (strcasecmp(argv[i], "--net-loopback") == 0) {
+            harness_game_config.net_loopback = 1;
+            consumed = 1;
+        } else if (strstr(argv[i], "--net-latency=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.net_loopback_latency = atoi(s + 1);
+            LOG_INFO2("Loopback latency set to %d", harness_game_config.net_loopback_latency);
+            consumed = 1;
+        } else if (strstr(argv[i], "--net-jitter=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.net_loopback_jitter = atoi(s + 1);
+            LOG_INFO2("Loopback jitter set to %d", harness_game_config.net_loopback_jitter);
+            consumed = 1;
+        } else if (strstr(argv[i], "--net-loss=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.net_loopback_loss = atoi(s + 1);
+            LOG_INFO2("Loopback loss set to %d", harness_game_config.net_loopback_loss);
+            consumed = 1;
+        } else if (strstr(argv[i], "--net-reorder=") != NULL) {
+            char* s = strstr(argv[i], "=");
+            harness_game_config.net_loopback_reorder = atoi(s + 1);
+            LOG_INFO2("Loopback reordering set to %d", harness_game_config.net_loopback_reorder);
+            consumed = 1;
         } else if (strstr(argv[i], "--network-adapter-name") != NULL) {
             if (i < *argc + 1) {
                 safe_strcpy(harness_game_config.network_adapter_name, argv[i + 1]);
@@ -480,6 +698,10 @@ static int Harness_Ini_Callback(void* user, const char* section, const char* nam
     } else if (MATCH("General", "FPSLimit")) {
         i = atoi(value);
         harness_game_config.fps = i;
+    } else if (MATCH("General", "FramePacing")) {
+        harness_game_config.frame_pacing = atoi(value);
+    } else if (MATCH("General", "PresentThread")) {
+        harness_game_config.present_thread = (value[0] == '1');
     } else if (MATCH("General", "DemoTimeout")) {
         i = atoi(value);
         harness_game_config.demo_timeout = i * 1000;
@@ -493,6 +715,24 @@ static int Harness_Ini_Callback(void* user, const char* section, const char* nam
         gSausage_override = (value[0] == '1');
     } else if (MATCH("General", "Hires")) {
         gGraf_spec_index = (value[0] == '1');
+    } else if (MATCH("General", "FlicDecodeAhead")) {
+        i = atoi(value);
+        harness_game_config.flic_decode_ahead = i;
+    } else if (MATCH("General", "FlicStream")) {
+        harness_game_config.flic_stream = (value[0] == '1');
+    } else if (MATCH("General", "ParticlePoolScale")) {
+        i = atoi(value);
+        harness_game_config.particle_pool_scale = i;
+    } else if (MATCH("General", "ColumnCulling")) {
+        harness_game_config.column_culling = atoi(value);
+    } else if (MATCH("General", "MirrorRefreshInterval")) {
+        harness_game_config.mirror_refresh_interval = atoi(value);
+    } else if (MATCH("General", "MirrorParticleMinHeight")) {
+        harness_game_config.mirror_particle_min_height = atoi(value);
+    } else if (MATCH("General", "MapInsetFPS")) {
+        harness_game_config.map_inset_fps = atoi(value);
+    } else if (MATCH("General", "DeferredSky")) {
+        harness_game_config.deferred_sky = (value[0] == '1');
     }
 
     else if (MATCH("Cheats", "EditMode")) {
@@ -517,6 +757,20 @@ static int Harness_Ini_Callback(void* user, const char* section, const char* nam
 
     else if (MATCH("Network", "AdapterName")) {
         safe_strcpy(harness_game_config.network_adapter_name, value);
+    } else if (MATCH("Network", "DeltaMechanics")) {
+        harness_game_config.net_delta_mechanics = (value[0] == '1');
+    } else if (MATCH("Network", "Interpolation")) {
+        harness_game_config.net_interpolation = (value[0] == '1');
+    } else if (MATCH("Network", "Loopback")) {
+        harness_game_config.net_loopback = (value[0] == '1');
+    } else if (MATCH("Network", "LoopbackLatency")) {
+        harness_game_config.net_loopback_latency = atoi(value);
+    } else if (MATCH("Network", "LoopbackJitter")) {
+        harness_game_config.net_loopback_jitter = atoi(value);
+    } else if (MATCH("Network", "LoopbackLoss")) {
+        harness_game_config.net_loopback_loss = atoi(value);
+    } else if (MATCH("Network", "LoopbackReorder")) {
+        harness_game_config.net_loopback_reorder = atoi(value);
     }
 
     else if (MATCH("Developers", "Diagnostics")) {
@@ -524,6 +778,10 @@ static int Harness_Ini_Callback(void* user, const char* section, const char* nam
     } else if (MATCH("Developers", "PhysicsStepTime")) {
         i = atoi(value);
         harness_game_config.physics_step_time = i;
+    } else if (MATCH("Developers", "PhysicsMaxSteps")) {
+        harness_game_config.physics_max_steps = atoi(value);
+    } else if (MATCH("Developers", "PhysicsInterpolation")) {
+        harness_game_config.physics_interpolation = (value[0] == '1');
     } else if (MATCH("Developers", "InstallSignalHandler")) {
         harness_game_config.install_signalhandler = (value[0] == '1');
     }
@@ -5,6 +5,8 @@
 
 void Harness_ForceNullPlatform(void);
 int Harness_CalculateFrameDelay(int last_frame_time);
+void Harness_PaceFrame(void);
+int Harness_GetFrameTimeStats(br_uint_32* pP50, br_uint_32* pP99, br_uint_32* pMax);
 
 typedef struct tCamera {
     void (*update)(void);
@@ -9,6 +9,16 @@ typedef enum tAudioBackend_error_code {
 
 typedef void tAudioBackend_stream;
 
+// Sample start counters, collected per frame
+typedef struct tAudioBackend_stats {
+    int samples_started;
+    int voices_restarted;   // same sample restarted on the voice it already held
+    int voices_rebound;     // idle voice rebound to new sample data
+    int voices_initialized; // voice sound node had to be (re)initialized for a new format
+    int voices_unavailable;
+    double start_time; // seconds spent starting samples
+} tAudioBackend_stats;
+
 // Used by S3
 tAudioBackend_error_code AudioBackend_Init(void);
 void AudioBackend_UnInit(void);
@@ -22,6 +32,8 @@ tAudioBackend_error_code AudioBackend_SetVolume(void* type_struct_sample, int vo
 tAudioBackend_error_code AudioBackend_SetPan(void* type_struct_sample, int pan);
 tAudioBackend_error_code AudioBackend_SetFrequency(void* type_struct_sample, int original_rate, int new_rate);
 tAudioBackend_error_code AudioBackend_SetVolumeSeparate(void* type_struct_sample, int left_volume, int right_volume);
+void AudioBackend_NextFrame(void);
+void AudioBackend_GetFrameStats(tAudioBackend_stats* stats);
 
 tAudioBackend_error_code AudioBackend_PlayCDA(int track);
 tAudioBackend_error_code AudioBackend_StopCDA(void);
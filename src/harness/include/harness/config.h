@@ -19,6 +19,12 @@ typedef enum {
     eGameLocalization_french,
 } tHarness_game_localization;
 
+typedef enum {
+    eFrame_pacing_sleep,
+    eFrame_pacing_hybrid,
+    eFrame_pacing_vsync,
+} tHarness_frame_pacing;
+
 typedef struct tHarness_game_info {
     tHarness_game_type mode;
     tHarness_game_localization localization;
@@ -45,7 +51,11 @@ typedef struct tHarness_game_dir {
 typedef struct tHarness_game_config {
     int enable_cd_check;
     int physics_step_time;
+    int physics_max_steps;
+    int physics_interpolation;
     float fps;
+    int frame_pacing;
+    int present_thread;
     int freeze_timer;
     unsigned demo_timeout;
     int enable_diagnostics;
@@ -53,6 +63,14 @@ typedef struct tHarness_game_config {
     int start_full_screen;
     int gore_check;
     int sound_options;
+    int flic_decode_ahead;
+    int flic_stream;
+    int particle_pool_scale;
+    int column_culling;
+    int mirror_refresh_interval;
+    int mirror_particle_min_height;
+    int map_inset_fps;
+    int deferred_sky;
 
     int verbose;
     int opengl_3dfx_mode;
@@ -60,6 +78,13 @@ typedef struct tHarness_game_config {
 
     int install_signalhandler;
     int no_bind;
+    int net_delta_mechanics;
+    int net_interpolation;
+    int net_loopback;
+    int net_loopback_latency;
+    int net_loopback_jitter;
+    int net_loopback_loss;
+    int net_loopback_reorder;
     char network_adapter_name[256];
     char platform_name[256];
 
@@ -36,6 +36,8 @@ typedef struct tHarness_platform {
     void (*Sleep)(br_uint_32 dwMilliseconds);
     // Get ticks
     br_uint_32 (*GetTicks)(void);
+    // Get a high resolution time in microseconds, wrapping around. Optional, GetTicks is used when NULL
+    br_uint_32 (*GetMicroseconds)(void);
     // Show error message
     int (*ShowErrorMessage)(char* title, char* message);
 
@@ -68,6 +70,9 @@ extern int Harness_Init(int* argc, char* argv[]);
 
 extern void Harness_Quit(void);
 
+// The platform's microsecond clock, or its millisecond one where it has none
+extern br_uint_32 Harness_GetMicroseconds(void);
+
 // Hooks are called from original game code.
 
 // Filesystem hooks
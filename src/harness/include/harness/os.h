@@ -55,4 +55,31 @@ int OS_SetSocketNonBlocking(int socket);
 
 int OS_CloseSocket(int socket);
 
+typedef struct tOS_thread tOS_thread;
+typedef struct tOS_mutex tOS_mutex;
+typedef struct tOS_cond tOS_cond;
+
+// Start pFunction(pArg) on a new thread. Returns NULL if the platform has no threads
+tOS_thread* OS_CreateThread(void (*pFunction)(void*), void* pArg);
+
+// Wait for the thread to return and release it
+void OS_JoinThread(tOS_thread* thread);
+
+tOS_mutex* OS_CreateMutex(void);
+
+void OS_DestroyMutex(tOS_mutex* mutex);
+
+void OS_LockMutex(tOS_mutex* mutex);
+
+void OS_UnlockMutex(tOS_mutex* mutex);
+
+tOS_cond* OS_CreateCond(void);
+
+void OS_DestroyCond(tOS_cond* cond);
+
+// mutex must be locked by the caller
+void OS_WaitCond(tOS_cond* cond, tOS_mutex* mutex);
+
+void OS_BroadcastCond(tOS_cond* cond);
+
 #endif
@@ -20,6 +20,7 @@
 #include <ifaddrs.h>
 #include <libgen.h>
 #include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -492,3 +493,96 @@ int OS_SetSocketNonBlocking(int socket) {
 int OS_CloseSocket(int socket) {
     return close(socket);
 }
+
+struct tOS_thread {
+    pthread_t thread;
+    void (*function)(void*);
+    void* arg;
+};
+
+struct tOS_mutex {
+    pthread_mutex_t mutex;
+};
+
+struct tOS_cond {
+    pthread_cond_t cond;
+};
+
+static void* thread_trampoline(void* arg) {
+    tOS_thread* thread = arg;
+
+    thread->function(thread->arg);
+    return NULL;
+}
+
+tOS_thread* OS_CreateThread(void (*pFunction)(void*), void* pArg) {
+    tOS_thread* thread = malloc(sizeof(tOS_thread));
+
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->function = pFunction;
+    thread->arg = pArg;
+    if (pthread_create(&thread->thread, NULL, thread_trampoline, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void OS_JoinThread(tOS_thread* thread) {
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
+
+tOS_mutex* OS_CreateMutex(void) {
+    tOS_mutex* mutex = malloc(sizeof(tOS_mutex));
+
+    if (mutex == NULL) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&mutex->mutex, NULL) != 0) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+
+void OS_DestroyMutex(tOS_mutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+void OS_LockMutex(tOS_mutex* mutex) {
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void OS_UnlockMutex(tOS_mutex* mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+tOS_cond* OS_CreateCond(void) {
+    tOS_cond* cond = malloc(sizeof(tOS_cond));
+
+    if (cond == NULL) {
+        return NULL;
+    }
+    if (pthread_cond_init(&cond->cond, NULL) != 0) {
+        free(cond);
+        return NULL;
+    }
+    return cond;
+}
+
+void OS_DestroyCond(tOS_cond* cond) {
+    pthread_cond_destroy(&cond->cond);
+    free(cond);
+}
+
+void OS_WaitCond(tOS_cond* cond, tOS_mutex* mutex) {
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+void OS_BroadcastCond(tOS_cond* cond) {
+    pthread_cond_broadcast(&cond->cond);
+}
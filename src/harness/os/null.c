@@ -1,3 +1,5 @@
+#include "harness/os.h"
+
 #include <stdio.h>
 #include <string.h>
 
@@ -36,8 +38,8 @@ char* OS_GetWorkingDirectory(char* argv0) {
     return NULL;
 }
 
-char* OS_GetPrefPath(char* app) {
-    return NULL;
+int OS_GetPrefPath(char* dest, char* app) {
+    return 0;
 }
 
 int OS_GetAdapterAddress(char* name, void* pSockaddr_in) {
@@ -62,3 +64,36 @@ int OS_SetSocketNonBlocking(int socket) {
 int OS_CloseSocket(int socket) {
     return 1;
 }
+
+tOS_thread* OS_CreateThread(void (*pFunction)(void*), void* pArg) {
+    return NULL;
+}
+
+void OS_JoinThread(tOS_thread* thread) {
+}
+
+tOS_mutex* OS_CreateMutex(void) {
+    return NULL;
+}
+
+void OS_DestroyMutex(tOS_mutex* mutex) {
+}
+
+void OS_LockMutex(tOS_mutex* mutex) {
+}
+
+void OS_UnlockMutex(tOS_mutex* mutex) {
+}
+
+tOS_cond* OS_CreateCond(void) {
+    return NULL;
+}
+
+void OS_DestroyCond(tOS_cond* cond) {
+}
+
+void OS_WaitCond(tOS_cond* cond, tOS_mutex* mutex) {
+}
+
+void OS_BroadcastCond(tOS_cond* cond) {
+}
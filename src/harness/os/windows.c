@@ -506,3 +506,91 @@ int OS_SetSocketNonBlocking(int socket) {
 int OS_CloseSocket(int socket) {
     return closesocket(socket);
 }
+
+struct tOS_thread {
+    HANDLE handle;
+    void (*function)(void*);
+    void* arg;
+};
+
+struct tOS_mutex {
+    CRITICAL_SECTION section;
+};
+
+struct tOS_cond {
+    CONDITION_VARIABLE cond;
+};
+
+static DWORD WINAPI thread_trampoline(LPVOID arg) {
+    tOS_thread* thread = arg;
+
+    thread->function(thread->arg);
+    return 0;
+}
+
+tOS_thread* OS_CreateThread(void (*pFunction)(void*), void* pArg) {
+    tOS_thread* thread = malloc(sizeof(tOS_thread));
+
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->function = pFunction;
+    thread->arg = pArg;
+    thread->handle = CreateThread(NULL, 0, thread_trampoline, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void OS_JoinThread(tOS_thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+tOS_mutex* OS_CreateMutex(void) {
+    tOS_mutex* mutex = malloc(sizeof(tOS_mutex));
+
+    if (mutex == NULL) {
+        return NULL;
+    }
+    InitializeCriticalSection(&mutex->section);
+    return mutex;
+}
+
+void OS_DestroyMutex(tOS_mutex* mutex) {
+    DeleteCriticalSection(&mutex->section);
+    free(mutex);
+}
+
+void OS_LockMutex(tOS_mutex* mutex) {
+    EnterCriticalSection(&mutex->section);
+}
+
+void OS_UnlockMutex(tOS_mutex* mutex) {
+    LeaveCriticalSection(&mutex->section);
+}
+
+tOS_cond* OS_CreateCond(void) {
+    tOS_cond* cond = malloc(sizeof(tOS_cond));
+
+    if (cond == NULL) {
+        return NULL;
+    }
+    InitializeConditionVariable(&cond->cond);
+    return cond;
+}
+
+void OS_DestroyCond(tOS_cond* cond) {
+    free(cond);
+}
+
+void OS_WaitCond(tOS_cond* cond, tOS_mutex* mutex) {
+    SleepConditionVariableCS(&cond->cond, &mutex->section, INFINITE);
+}
+
+void OS_BroadcastCond(tOS_cond* cond) {
+    WakeAllConditionVariable(&cond->cond);
+}
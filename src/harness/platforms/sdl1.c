@@ -13,8 +13,6 @@ static SDL_Surface* screen;
 static br_uint_32 converted_palette[256];
 static br_pixelmap* last_screen_src;
 
-static Uint32 last_frame_time;
-
 static void (*gKeyHandler_func)(void);
 
 // 32 bytes, 1 bit per key. Matches dos executable behavior
@@ -217,21 +215,6 @@ static int SDL1_Harness_GetMousePosition(int* pX, int* pY) {
     return 0;
 }
 
-static void limit_fps(void) {
-    Uint32 now = SDL1_GetTicks();
-    if (last_frame_time != 0) {
-        unsigned int frame_time = now - last_frame_time;
-        last_frame_time = now;
-        if (frame_time < 100) {
-            int sleep_time = (1000 / harness_game_config.fps) - frame_time;
-            if (sleep_time > 5) {
-                gHarness_platform.Sleep(sleep_time);
-            }
-        }
-    }
-    last_frame_time = SDL1_GetTicks();
-}
-
 static void SDL1_Renderer_Present(br_pixelmap* src) {
     int i;
     // fastest way to convert 8 bit indexed to 32 bit
@@ -251,9 +234,7 @@ static void SDL1_Renderer_Present(br_pixelmap* src) {
 
     last_screen_src = src;
 
-    if (harness_game_config.fps != 0) {
-        limit_fps();
-    }
+    Harness_PaceFrame();
 }
 
 static void SDL1_Harness_Swap(br_pixelmap* back_buffer) {
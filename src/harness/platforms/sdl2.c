@@ -4,6 +4,7 @@
 #include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/trace.h"
+#include "present.h"
 #include "sdl2_scancode_map.h"
 #include "sdl2_syms.h"
 
@@ -16,11 +17,12 @@ static br_uint_32 converted_palette[256];
 static br_pixelmap* last_screen_src;
 
 static SDL_GLContext* gl_context;
+static int present_pipelined;
+// a frame is being expanded into the locked screen_texture
+static int present_pending;
 
 static int render_width, render_height;
 
-static Uint32 last_frame_time;
-
 static void (*gKeyHandler_func)(void);
 
 // 32 bytes, 1 bit per key. Matches dos executable behavior
@@ -112,8 +114,25 @@ static int SDL2_Harness_SetWindowPos(void* hWnd, int x, int y, int nWidth, int n
     return 0;
 }
 
+// Show the frame being expanded on the present thread as soon as it is done, so a screen the game has stopped swapping
+// (a menu waiting for a key) doesn't stay a frame behind
+static void SDL2_Harness_PresentPending(int wait) {
+    if (present_pending && Present_Finish(wait)) {
+        SDL2_UnlockTexture(screen_texture);
+        SDL2_RenderClear(renderer);
+        SDL2_RenderCopy(renderer, screen_texture, NULL, NULL);
+        SDL2_RenderPresent(renderer);
+        present_pending = 0;
+    }
+}
+
 static void SDL2_Harness_DestroyWindow(void) {
     // SDL2_GL_DeleteContext(context);
+    if (present_pipelined) {
+        SDL2_Harness_PresentPending(1);
+        Present_Stop();
+        present_pipelined = 0;
+    }
     if (window != NULL) {
         SDL2_DestroyWindow(window);
     }
@@ -130,6 +149,10 @@ static int is_only_key_modifier(int modifier_flags, int flag_check) {
 static void SDL2_Harness_ProcessWindowMessages(void) {
     SDL_Event event;
 
+    if (present_pipelined) {
+        SDL2_Harness_PresentPending(0);
+    }
+
     while (SDL2_PollEvent(&event)) {
         switch (event.type) {
         case SDL_KEYDOWN:
@@ -221,21 +244,6 @@ static int SDL2_Harness_GetMousePosition(int* pX, int* pY) {
     return 0;
 }
 
-static void limit_fps(void) {
-    Uint32 now = SDL2_GetTicks();
-    if (last_frame_time != 0) {
-        unsigned int frame_time = now - last_frame_time;
-        last_frame_time = now;
-        if (frame_time < 100) {
-            int sleep_time = (1000 / harness_game_config.fps) - frame_time;
-            if (sleep_time > 5) {
-                gHarness_platform.Sleep(sleep_time);
-            }
-        }
-    }
-    last_frame_time = SDL2_GetTicks();
-}
-
 static int SDL2_Harness_ShowErrorMessage(char* title, char* message) {
     fprintf(stderr, "%s", message);
     SDL2_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, title, message, window);
@@ -322,6 +330,8 @@ static void SDL2_Harness_CreateWindow(const char* title, int width, int height,
             }
             LOG_PANIC2("Failed to create screen_texture: %s", SDL2_GetError());
         }
+        // SDL's renderer has to stay on this thread, the worker only expands frames into the texture locked here
+        present_pipelined = Present_Start();
     }
 
     SDL2_ShowCursor(SDL_DISABLE);
@@ -342,6 +352,13 @@ static void SDL2_Harness_Swap(br_pixelmap* back_buffer) {
 
     if (gl_context != NULL) {
         SDL2_GL_SwapWindow(window);
+    } else if (present_pipelined) {
+        // the previous frame is shown first, then the worker expands this one straight into the texture
+        SDL2_Harness_PresentPending(1);
+        SDL2_LockTexture(screen_texture, NULL, (void**)&dest_pixels, &dest_pitch);
+        Present_Submit(back_buffer, converted_palette, dest_pixels, dest_pitch);
+        present_pending = 1;
+        last_screen_src = back_buffer;
     } else {
         src_pixels = back_buffer->pixels;
 
@@ -358,9 +375,7 @@ static void SDL2_Harness_Swap(br_pixelmap* back_buffer) {
         last_screen_src = back_buffer;
     }
 
-    if (harness_game_config.fps != 0) {
-        limit_fps();
-    }
+    Harness_PaceFrame();
 }
 
 static void SDL2_Harness_PaletteChanged(br_colour entries[256]) {
@@ -380,6 +395,14 @@ static void SDL2_Harness_GetViewport(int* x, int* y, float* width_multipler, flo
     *height_multiplier = viewport.scale_y;
 }
 
+static br_uint_32 SDL2_Harness_GetMicroseconds(void) {
+    Uint64 counter = SDL2_GetPerformanceCounter();
+    Uint64 frequency = SDL2_GetPerformanceFrequency();
+
+    // split into seconds and the remainder so that scaling up to microseconds cannot overflow
+    return (br_uint_32)((counter / frequency) * 1000000 + ((counter % frequency) * 1000000) / frequency);
+}
+
 static int SDL2_Harness_Platform_Init(tHarness_platform* platform) {
     if (SDL2_LoadSymbols() != 0) {
         return 1;
@@ -387,6 +410,7 @@ static int SDL2_Harness_Platform_Init(tHarness_platform* platform) {
     platform->ProcessWindowMessages = SDL2_Harness_ProcessWindowMessages;
     platform->Sleep = SDL2_Delay;
     platform->GetTicks = SDL2_GetTicks;
+    platform->GetMicroseconds = SDL2_Harness_GetMicroseconds;
     platform->ShowCursor = SDL2_ShowCursor;
     platform->SetWindowPos = SDL2_Harness_SetWindowPos;
     platform->DestroyWindow = SDL2_Harness_DestroyWindow;
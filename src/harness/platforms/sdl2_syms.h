@@ -8,6 +8,8 @@
     X(Quit, void, (void))                                                               \
     X(Delay, void, (Uint32))                                                            \
     X(GetTicks, Uint32, (void))                                                         \
+    X(GetPerformanceCounter, Uint64, (void))                                            \
+    X(GetPerformanceFrequency, Uint64, (void))                                          \
     X(GetError, const char*, (void))                                                    \
     X(PollEvent, int, (SDL_Event*))                                                     \
     X(ShowSimpleMessageBox, int, (Uint32, const char*, const char*, SDL_Window*))       \
@@ -4,6 +4,7 @@
 #include "harness/config.h"
 #include "harness/hooks.h"
 #include "harness/trace.h"
+#include "present.h"
 #include "sdl3_scancode_map.h"
 #include "sdl3_syms.h"
 
@@ -16,11 +17,12 @@ static uint32_t converted_palette[256];
 static br_pixelmap* last_screen_src;
 
 static SDL_GLContext gl_context;
+static int present_pipelined;
+// a frame is being expanded into the locked screen_texture
+static int present_pending;
 
 static int render_width, render_height;
 
-static Uint32 last_frame_time;
-
 static void (*gKeyHandler_func)(void);
 
 // 32 bytes, 1 bit per key. Matches dos executable behavior
@@ -112,8 +114,25 @@ static int SDL3_Harness_SetWindowPos(void* hWnd, int x, int y, int nWidth, int n
     return 0;
 }
 
+// Show the frame being expanded on the present thread as soon as it is done, so a screen the game has stopped swapping
+// (a menu waiting for a key) doesn't stay a frame behind
+static void SDL3_Harness_PresentPending(int wait) {
+    if (present_pending && Present_Finish(wait)) {
+        SDL3_UnlockTexture(screen_texture);
+        SDL3_RenderClear(renderer);
+        SDL3_RenderTexture(renderer, screen_texture, NULL, NULL);
+        SDL3_RenderPresent(renderer);
+        present_pending = 0;
+    }
+}
+
 static void SDL3_Harness_DestroyWindow(void) {
     // SDL3_GL_DeleteContext(context);
+    if (present_pipelined) {
+        SDL3_Harness_PresentPending(1);
+        Present_Stop();
+        present_pipelined = 0;
+    }
     if (window != NULL) {
         SDL3_DestroyWindow(window);
     }
@@ -130,6 +149,10 @@ static int is_only_key_modifier(SDL_Keymod modifier_flags, SDL_Keymod flag_check
 static void SDL3_Harness_ProcessWindowMessages(void) {
     SDL_Event event;
 
+    if (present_pipelined) {
+        SDL3_Harness_PresentPending(0);
+    }
+
     while (SDL3_PollEvent(&event)) {
         switch (event.type) {
         case SDL_EVENT_KEY_DOWN:
@@ -220,21 +243,6 @@ static int SDL3_Harness_GetMousePosition(int* pX, int* pY) {
     return 0;
 }
 
-static void limit_fps(void) {
-    Uint32 now = SDL3_GetTicks();
-    if (last_frame_time != 0) {
-        unsigned int frame_time = now - last_frame_time;
-        last_frame_time = now;
-        if (frame_time < 100) {
-            int sleep_time = (1000 / harness_game_config.fps) - frame_time;
-            if (sleep_time > 5) {
-                gHarness_platform.Sleep(sleep_time);
-            }
-        }
-    }
-    last_frame_time = SDL3_GetTicks();
-}
-
 static int SDL3_Harness_ShowErrorMessage(char* text, char* caption) {
     fprintf(stderr, "%s", text);
     SDL3_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, caption, text, window);
@@ -324,6 +332,8 @@ static void SDL3_Harness_CreateWindow(const char* title, int width, int height,
             }
             LOG_PANIC2("Failed to create renderer texture (%s)", SDL3_GetError());
         }
+        // SDL's renderer has to stay on this thread, the worker only expands frames into the texture locked here
+        present_pipelined = Present_Start();
     }
 
     SDL3_HideCursor();
@@ -340,6 +350,16 @@ static void SDL3_Harness_Swap(br_pixelmap* back_buffer) {
 
     if (gl_context != NULL) {
         SDL3_GL_SwapWindow(window);
+    } else if (present_pipelined) {
+        void* dest_pixels;
+        int dest_pitch;
+
+        // the previous frame is shown first, then the worker expands this one straight into the texture
+        SDL3_Harness_PresentPending(1);
+        SDL3_LockTexture(screen_texture, NULL, &dest_pixels, &dest_pitch);
+        Present_Submit(back_buffer, converted_palette, dest_pixels, dest_pitch);
+        present_pending = 1;
+        last_screen_src = back_buffer;
     } else {
         uint8_t* src_pixels = back_buffer->pixels;
         uint32_t* dest_pixels;
@@ -358,9 +378,7 @@ static void SDL3_Harness_Swap(br_pixelmap* back_buffer) {
         last_screen_src = back_buffer;
     }
 
-    if (harness_game_config.fps != 0) {
-        limit_fps();
-    }
+    Harness_PaceFrame();
 }
 
 static void SDL3_Harness_PaletteChanged(br_colour entries[256]) {
@@ -383,6 +401,10 @@ static uint32_t SDL3_Harness_GetTicks(void) {
     return SDL3_GetTicks();
 }
 
+static br_uint_32 SDL3_Harness_GetMicroseconds(void) {
+    return (br_uint_32)(SDL3_GetTicksNS() / 1000);
+}
+
 static int SDL3_Harness_ShowCursor(int show) {
     if (show) {
         SDL3_ShowCursor();
@@ -403,6 +425,7 @@ static int SDL3_Harness_Platform_Init(tHarness_platform* platform) {
     platform->ProcessWindowMessages = SDL3_Harness_ProcessWindowMessages;
     platform->Sleep = SDL3_Delay;
     platform->GetTicks = SDL3_Harness_GetTicks;
+    platform->GetMicroseconds = SDL3_Harness_GetMicroseconds;
     platform->ShowCursor = SDL3_Harness_ShowCursor;
     platform->SetWindowPos = SDL3_Harness_SetWindowPos;
     platform->DestroyWindow = SDL3_Harness_DestroyWindow;
@@ -9,6 +9,7 @@
     X(Quit, void, (void))                                                                               \
     X(Delay, void, (Uint32))                                                                            \
     X(GetTicks, Uint64, (void))                                                                         \
+    X(GetTicksNS, Uint64, (void))                                                                       \
     X(GetError, const char*, (void))                                                                    \
     X(GetPointerProperty, void*, (SDL_PropertiesID, const char*, void*))                                \
     X(PollEvent, bool, (SDL_Event*))                                                                    \
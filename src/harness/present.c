@@ -0,0 +1,163 @@
+#include "present.h"
+#include "harness/config.h"
+#include "harness/os.h"
+#include "harness/trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    ePresent_idle,
+    ePresent_submitted,
+    ePresent_done,
+} tPresent_state;
+
+// The game may draw over its back buffer as soon as it has been handed over, so the worker expands a copy of the
+// indexed pixels. That is a quarter of the 32 bit frame, which goes straight into the texture
+static br_uint_8* indexed;
+static int indexed_size;
+static int width;
+static int height;
+static br_uint_32 palette[256];
+static br_uint_8* dest;
+static int dest_pitch;
+static tPresent_state state;
+static int stop;
+static tOS_thread* thread;
+static tOS_mutex* mutex;
+static tOS_cond* cond;
+
+static void expand_frame(const br_uint_8* pSrc, int pSrc_pitch) {
+    const br_uint_8* src;
+    br_uint_32* row;
+    int x;
+    int y;
+
+    for (y = 0; y < height; y++) {
+        src = pSrc + y * pSrc_pitch;
+        row = (br_uint_32*)(dest + y * dest_pitch);
+        for (x = 0; x < width; x++) {
+            row[x] = palette[src[x]];
+        }
+    }
+}
+
+static void present_worker(void* pArg) {
+    OS_LockMutex(mutex);
+    for (;;) {
+        while (!stop && state != ePresent_submitted) {
+            OS_WaitCond(cond, mutex);
+        }
+        if (stop) {
+            break;
+        }
+        OS_UnlockMutex(mutex);
+        expand_frame(indexed, width);
+        OS_LockMutex(mutex);
+        state = ePresent_done;
+        OS_BroadcastCond(cond);
+    }
+    OS_UnlockMutex(mutex);
+}
+
+int Present_Start(void) {
+    if (!harness_game_config.present_thread) {
+        return 0;
+    }
+    if (thread != NULL) {
+        return 1;
+    }
+    mutex = OS_CreateMutex();
+    cond = OS_CreateCond();
+    if (mutex != NULL && cond != NULL) {
+        stop = 0;
+        state = ePresent_idle;
+        thread = OS_CreateThread(present_worker, NULL);
+    }
+    if (thread == NULL) {
+        LOG_WARN("No present thread, frames are presented on the game thread");
+        Present_Stop();
+        return 0;
+    }
+    return 1;
+}
+
+void Present_Stop(void) {
+    if (thread != NULL) {
+        OS_LockMutex(mutex);
+        stop = 1;
+        OS_BroadcastCond(cond);
+        OS_UnlockMutex(mutex);
+        OS_JoinThread(thread);
+        thread = NULL;
+    }
+    if (cond != NULL) {
+        OS_DestroyCond(cond);
+        cond = NULL;
+    }
+    if (mutex != NULL) {
+        OS_DestroyMutex(mutex);
+        mutex = NULL;
+    }
+    free(indexed);
+    indexed = NULL;
+    indexed_size = 0;
+    state = ePresent_idle;
+}
+
+void Present_Submit(br_pixelmap* pSrc, const br_uint_32* pPalette, void* pDest, int pDest_pitch) {
+    int size;
+    int y;
+
+    OS_LockMutex(mutex);
+    while (state == ePresent_submitted) {
+        OS_WaitCond(cond, mutex);
+    }
+    OS_UnlockMutex(mutex);
+
+    // the worker is idle until the frame is marked submitted
+    width = pSrc->width;
+    height = pSrc->height;
+    memcpy(palette, pPalette, sizeof(palette));
+    dest = pDest;
+    dest_pitch = pDest_pitch;
+    size = pSrc->width * pSrc->height;
+    if (indexed_size != size) {
+        free(indexed);
+        indexed = malloc(size);
+        indexed_size = indexed != NULL ? size : 0;
+    }
+    if (indexed == NULL) {
+        LOG_WARN("Out of memory for the present thread, expanding on the game thread");
+        expand_frame(pSrc->pixels, pSrc->row_bytes);
+        OS_LockMutex(mutex);
+        state = ePresent_done;
+        OS_UnlockMutex(mutex);
+        return;
+    }
+    for (y = 0; y < pSrc->height; y++) {
+        memcpy(indexed + y * pSrc->width, (br_uint_8*)pSrc->pixels + y * pSrc->row_bytes, pSrc->width);
+    }
+
+    OS_LockMutex(mutex);
+    state = ePresent_submitted;
+    OS_BroadcastCond(cond);
+    OS_UnlockMutex(mutex);
+}
+
+int Present_Finish(int pWait) {
+    int done;
+
+    OS_LockMutex(mutex);
+    if (pWait) {
+        while (state == ePresent_submitted) {
+            OS_WaitCond(cond, mutex);
+        }
+    }
+    done = state == ePresent_done;
+    if (done) {
+        state = ePresent_idle;
+    }
+    OS_UnlockMutex(mutex);
+    return done;
+}
@@ -0,0 +1,21 @@
+#ifndef HARNESS_PRESENT_H
+#define HARNESS_PRESENT_H
+
+#include "brender.h"
+
+// Start expanding frames on a worker thread. Returns 0 if pipelining is disabled or there are no threads,
+// frames are then presented on the game thread as before
+int Present_Start(void);
+
+void Present_Stop(void);
+
+// Hand over a finished frame together with the palette it is to be shown with and the locked 32 bit texture the
+// worker expands it into. The texture has to stay locked until Present_Finish says the frame is done.
+// Only waits while the previous frame is still being expanded
+void Present_Submit(br_pixelmap* pSrc, const br_uint_32* pPalette, void* pDest, int pDest_pitch);
+
+// Whether the frame last handed over has been written into its texture, so it can be unlocked and presented.
+// If pWait, waits for the worker to finish it
+int Present_Finish(int pWait);
+
+#endif
@@ -46,6 +46,7 @@ typedef struct SmackTag {
     void* smk_handle; // opaque pointer to the libsmacker instance
     void* f;          // opaque file pointer
     tAudioBackend_stream* audio_stream;
+    void* queue; // opaque pointer to the queue of decoded frames
 } Smack;
 
 Smack* SmackOpen(const char* name, unsigned int flags, unsigned int extrabuf);
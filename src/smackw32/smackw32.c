@@ -14,8 +14,170 @@
 
 static unsigned int smack_last_frame_time = 0;
 
+// Number of decoded frames a video can be ahead of the one on screen
+#define SMACK_QUEUE_FRAMES 8
+
+typedef struct smack_frame {
+    unsigned char* video;
+    unsigned char palette[256 * 3];
+    unsigned char* audio;
+    unsigned long audio_size;
+    unsigned long audio_capacity;
+} smack_frame;
+
+// Frames are decoded in order into a ring of slots. The decoder thread fills slots ahead of the one
+// being shown and blocks while the ring is full, so memory use does not depend on the video length.
+typedef struct smack_queue {
+    smk smk_handle;
+    unsigned long width;
+    unsigned long height;
+    unsigned long frames;
+    int audio_enabled;
+    smack_frame slots[SMACK_QUEUE_FRAMES];
+    int current;           // slot being shown
+    int ready_count;       // decoded slots, including the current one
+    unsigned long decoded; // frames decoded so far
+    int stop;
+    tOS_thread* thread;
+    tOS_mutex* mutex;
+    tOS_cond* cond;
+} smack_queue;
+
+static void decode_into_slot(smack_queue* queue, smack_frame* slot) {
+    const unsigned char* audio_data;
+    unsigned long audio_size;
+
+    memcpy(slot->video, smk_get_video(queue->smk_handle), queue->width * queue->height);
+    memcpy(slot->palette, smk_get_palette(queue->smk_handle), sizeof(slot->palette));
+    slot->audio_size = 0;
+    if (queue->audio_enabled) {
+        audio_data = smk_get_audio(queue->smk_handle, 0);
+        audio_size = smk_get_audio_size(queue->smk_handle, 0);
+        if (audio_data != NULL && audio_size != 0) {
+            if (audio_size > slot->audio_capacity) {
+                free(slot->audio);
+                slot->audio = malloc(audio_size);
+                slot->audio_capacity = audio_size;
+            }
+            memcpy(slot->audio, audio_data, audio_size);
+            slot->audio_size = audio_size;
+        }
+    }
+}
+
+static void decoder_thread(void* arg) {
+    smack_queue* queue = arg;
+    int slot;
+    int stop;
+
+    // only this thread changes `decoded` while it runs
+    while (queue->decoded < queue->frames) {
+        OS_LockMutex(queue->mutex);
+        while (!queue->stop && queue->ready_count == SMACK_QUEUE_FRAMES) {
+            OS_WaitCond(queue->cond, queue->mutex);
+        }
+        stop = queue->stop;
+        slot = (queue->current + queue->ready_count) % SMACK_QUEUE_FRAMES;
+        OS_UnlockMutex(queue->mutex);
+        if (stop) {
+            return;
+        }
+
+        smk_next(queue->smk_handle);
+        decode_into_slot(queue, &queue->slots[slot]);
+
+        OS_LockMutex(queue->mutex);
+        queue->ready_count++;
+        queue->decoded++;
+        OS_BroadcastCond(queue->cond);
+        OS_UnlockMutex(queue->mutex);
+    }
+}
+
+// Show the next decoded frame. Without a decoder thread, decode it here
+static void advance_queue(smack_queue* queue) {
+    if (queue->thread == NULL) {
+        if (queue->decoded < queue->frames) {
+            smk_next(queue->smk_handle);
+            decode_into_slot(queue, &queue->slots[queue->current]);
+            queue->decoded++;
+        }
+        return;
+    }
+    OS_LockMutex(queue->mutex);
+    if (queue->ready_count > 1 || queue->decoded < queue->frames) {
+        queue->current = (queue->current + 1) % SMACK_QUEUE_FRAMES;
+        queue->ready_count--;
+        OS_BroadcastCond(queue->cond);
+        while (queue->ready_count == 0) {
+            OS_WaitCond(queue->cond, queue->mutex);
+        }
+    }
+    OS_UnlockMutex(queue->mutex);
+}
+
+static void close_queue(smack_queue* queue) {
+    int i;
+
+    if (queue->thread != NULL) {
+        OS_LockMutex(queue->mutex);
+        queue->stop = 1;
+        OS_BroadcastCond(queue->cond);
+        OS_UnlockMutex(queue->mutex);
+        OS_JoinThread(queue->thread);
+    }
+    if (queue->cond != NULL) {
+        OS_DestroyCond(queue->cond);
+    }
+    if (queue->mutex != NULL) {
+        OS_DestroyMutex(queue->mutex);
+    }
+    for (i = 0; i < SMACK_QUEUE_FRAMES; i++) {
+        free(queue->slots[i].video);
+        free(queue->slots[i].audio);
+    }
+    free(queue);
+}
+
+static smack_queue* open_queue(smk smk_handle, unsigned long width, unsigned long height, unsigned long frames, int audio_enabled) {
+    smack_queue* queue;
+    int slot_count;
+    int i;
+
+    queue = calloc(1, sizeof(smack_queue));
+    queue->smk_handle = smk_handle;
+    queue->width = width;
+    queue->height = height;
+    queue->frames = frames;
+    queue->audio_enabled = audio_enabled;
+    queue->mutex = OS_CreateMutex();
+    queue->cond = OS_CreateCond();
+    // without threads, only the slot being shown is needed
+    slot_count = (queue->mutex != NULL && queue->cond != NULL) ? SMACK_QUEUE_FRAMES : 1;
+    for (i = 0; i < slot_count; i++) {
+        queue->slots[i].video = malloc(width * height);
+    }
+
+    // the first frame is decoded right away, so SmackOpen can report errors
+    if (smk_first(smk_handle) == SMK_ERROR) {
+        close_queue(queue);
+        return NULL;
+    }
+    decode_into_slot(queue, &queue->slots[0]);
+    queue->decoded = 1;
+    queue->ready_count = 1;
+    if (slot_count > 1) {
+        queue->thread = OS_CreateThread(decoder_thread, queue);
+    }
+    return queue;
+}
+
 static void copy_palette(Smack* smack) {
-    const unsigned char* pal = smk_get_palette(smack->smk_handle);
+    smack_queue* queue = smack->queue;
+    const unsigned char* pal = queue->slots[queue->current].palette;
+
+    // libsmacker doesn't tell us whether the palette is new on each frame, so compare it with the last one
+    smack->NewPalette = smack->FrameNum == 0 || memcmp(smack->Palette, pal, 256 * 3) != 0;
     memcpy(smack->Palette, pal, 256 * 3);
 }
 
@@ -34,16 +196,15 @@ Smack* SmackOpen(const char* name, unsigned int flags, unsigned int extrabuf) {
     if (f == NULL) {
         return NULL;
     }
-    smk_handle = smk_open_filepointer(f, SMK_MODE_MEMORY);
+    // frames are read from disk as they are decoded, rather than loading the whole file
+    smk_handle = smk_open_filepointer(f, SMK_MODE_DISK);
     if (smk_handle == NULL) {
         fclose(f);
         return NULL;
     }
 
     smack = malloc(sizeof(Smack));
-
-    // libsmacker doesn't tell us whether the palette is new on each frame or not, so just assume it always is new
-    smack->NewPalette = 1;
+    smack->FrameNum = 0;
 
     // smk_handle is added to hold a pointer to the underlying libsmacker instance
     smack->smk_handle = smk_handle;
@@ -68,8 +229,12 @@ Smack* SmackOpen(const char* name, unsigned int flags, unsigned int extrabuf) {
         }
     }
 
-    // load the first frame and return a handle to the Smack file
-    if (smk_first(smk_handle) == SMK_ERROR) {
+    // load the first frame, start decoding ahead and return a handle to the Smack file
+    smack->queue = open_queue(smk_handle, smack->Width, smack->Height, smack->Frames, smack->audio_stream != NULL);
+    if (smack->queue == NULL) {
+        if (smack->audio_stream != NULL) {
+            AudioBackend_StreamClose(smack->audio_stream);
+        }
         smk_close(smk_handle);
         free(smack);
         return NULL;
@@ -86,38 +251,39 @@ void SmackToBuffer(Smack* smack, unsigned int left, unsigned int top, unsigned i
     unsigned long i; // Pierre-Marie Baty -- fixed type
     char* char_buf = buf;
     const unsigned char* frame;
+    smack_queue* queue = smack->queue;
 
     // minimal implementation
     assert(left == 0);
     assert(top == 0);
     assert(flags == 0);
 
-    frame = smk_get_video(smack->smk_handle);
+    frame = queue->slots[queue->current].video;
     for (i = 0; i < smack->Height; i++) {
         memcpy(&char_buf[(i * pitch)], &frame[i * smack->Width], smack->Width);
     }
 }
 
 int SmackDoFrame(Smack* smack) {
-    const unsigned char* audio_data;
-    unsigned long audio_data_size;
+    smack_queue* queue = smack->queue;
+    smack_frame* frame;
 
     // process audio if we have some
     if (smack->audio_stream != NULL) {
-        audio_data = smk_get_audio(smack->smk_handle, 0);
-        audio_data_size = smk_get_audio_size(smack->smk_handle, 0);
-        if ((audio_data == NULL) || (audio_data_size == 0)) {
+        frame = &queue->slots[queue->current];
+        if (frame->audio_size == 0) {
             return 0;
         }
 
-        AudioBackend_StreamWrite(smack->audio_stream, audio_data, audio_data_size);
+        AudioBackend_StreamWrite(smack->audio_stream, frame->audio, frame->audio_size);
     }
 
     return 0;
 }
 
 void SmackNextFrame(Smack* smack) {
-    smk_next(smack->smk_handle);
+    advance_queue(smack->queue);
+    smack->FrameNum++;
     copy_palette(smack);
 }
 
@@ -136,6 +302,8 @@ void SmackClose(Smack* smack) {
         AudioBackend_StreamClose(smack->audio_stream);
     }
 
+    // stop decoding before libsmacker goes away
+    close_queue(smack->queue);
     smk_close(smack->smk_handle);
     // libsmacker closes file, no need to do `fclose(smack->f)`
     free(smack);
@@ -0,0 +1,239 @@
+#include "tests.h"
+
+#include "common/brucetrk.h"
+#include "common/globvrbm.h"
+#include "harness/config.h"
+#include <string.h>
+
+// Three columns of 10x10 in a row along x, with a wall between the second and third
+static br_actor dummy_actor;
+static br_actor* column_row[3];
+static br_actor* lollipop_row[3];
+static br_actor** columns[1];
+static br_actor** lollipops[1];
+static br_bounds column_bounds[3];
+static tU8 column_visible[3];
+static tU8 column_pvs[2];
+static br_scalar column_eye_top[3];
+static tU8 column_pvs_view[3];
+static br_vector3 triangles[4 * 3];
+
+static void set_triangle(br_vector3* pTriangle, float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2, float z2) {
+    BrVector3Set(&pTriangle[0], x0, y0, z0);
+    BrVector3Set(&pTriangle[1], x1, y1, z1);
+    BrVector3Set(&pTriangle[2], x2, y2, z2);
+}
+
+static void make_track(tTrack_spec* pTrack_spec) {
+    int x;
+
+    memset(pTrack_spec, 0, sizeof(*pTrack_spec));
+    pTrack_spec->ncolumns_x = 3;
+    pTrack_spec->ncolumns_z = 1;
+    pTrack_spec->column_size_x = 10.f;
+    pTrack_spec->column_size_z = 10.f;
+    for (x = 0; x < 3; x++) {
+        column_row[x] = &dummy_actor;
+        lollipop_row[x] = NULL;
+        BrVector3Set(&column_bounds[x].min, x * 10.f, 0.f, 0.f);
+        BrVector3Set(&column_bounds[x].max, x * 10.f + 10.f, 2.f, 10.f);
+        column_visible[x] = 1;
+    }
+    columns[0] = column_row;
+    lollipops[0] = lollipop_row;
+    pTrack_spec->columns = columns;
+    pTrack_spec->lollipops = lollipops;
+    pTrack_spec->column_bounds = column_bounds;
+    pTrack_spec->column_visible = column_visible;
+    pTrack_spec->column_pvs = column_pvs;
+    pTrack_spec->column_eye_top = column_eye_top;
+    pTrack_spec->column_pvs_view = column_pvs_view;
+
+    // floor
+    set_triangle(&triangles[0], 0.f, 0.f, 0.f, 30.f, 0.f, 0.f, 30.f, 0.f, 10.f);
+    set_triangle(&triangles[3], 0.f, 0.f, 0.f, 30.f, 0.f, 10.f, 0.f, 0.f, 10.f);
+    // wall at x = 20
+    set_triangle(&triangles[6], 20.f, -1.f, -1.f, 20.f, 50.f, -1.f, 20.f, 50.f, 11.f);
+    set_triangle(&triangles[9], 20.f, -1.f, -1.f, 20.f, 50.f, 11.f, 20.f, -1.f, 11.f);
+}
+
+static int pvs_bit(int pFrom, int pTo) {
+    return (column_pvs[(pFrom * 3 + pTo) >> 3] >> ((pFrom * 3 + pTo) & 7)) & 1;
+}
+
+// Camera looking along +x
+static void make_camera(br_actor* pActor, br_camera* pCamera, br_matrix34* pCamera_to_world, float x, float y, float z) {
+    memset(pActor, 0, sizeof(*pActor));
+    memset(pCamera, 0, sizeof(*pCamera));
+    pCamera->field_of_view = BR_ANGLE_DEG(90);
+    pCamera->aspect = 1.f;
+    pCamera->yon_z = 100.f;
+    pActor->type_data = pCamera;
+    BrMatrix34Identity(pCamera_to_world);
+    pCamera_to_world->m[0][0] = 0.f;
+    pCamera_to_world->m[0][2] = 1.f;
+    pCamera_to_world->m[2][0] = -1.f;
+    pCamera_to_world->m[2][2] = 0.f;
+    pCamera_to_world->m[3][0] = x;
+    pCamera_to_world->m[3][1] = y;
+    pCamera_to_world->m[3][2] = z;
+}
+
+void test_brucetrk_frustum(void) {
+    tTrack_spec track;
+    br_actor actor;
+    br_camera camera;
+    br_matrix34 camera_to_world;
+    br_scalar old_yon_factor;
+    int old_culling;
+
+    old_yon_factor = gYon_factor;
+    old_culling = harness_game_config.column_culling;
+    gYon_factor = 1.f;
+    harness_game_config.column_culling = 1;
+    make_track(&track);
+
+    // in the last column looking out of the track, the others are behind
+    make_camera(&actor, &camera, &camera_to_world, 25.f, 1.f, 5.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_FALSE(ColumnVisible(&track, 0, 0));
+    TEST_ASSERT_FALSE(ColumnVisible(&track, 1, 0));
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 2, 0));
+
+    // from the first everything is ahead
+    make_camera(&actor, &camera, &camera_to_world, 5.f, 1.f, 5.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 0, 0));
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 1, 0));
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 2, 0));
+
+    // unless it is past the yon
+    camera.yon_z = 8.f;
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 1, 0));
+    TEST_ASSERT_FALSE(ColumnVisible(&track, 2, 0));
+
+    gYon_factor = old_yon_factor;
+    harness_game_config.column_culling = old_culling;
+}
+
+void test_brucetrk_pvs(void) {
+    tTrack_spec track;
+    br_actor actor;
+    br_camera camera;
+    br_matrix34 camera_to_world;
+    br_scalar old_yon_factor;
+    int old_culling;
+    int built;
+    int reused;
+
+    old_yon_factor = gYon_factor;
+    old_culling = harness_game_config.column_culling;
+    gYon_factor = 1.f;
+    harness_game_config.column_culling = 2;
+    make_track(&track);
+
+    TEST_ASSERT_EQUAL_INT(5, BuildColumnPVS(&track, triangles, 4, 1000.f));
+    TEST_ASSERT_TRUE(pvs_bit(0, 0));
+    TEST_ASSERT_TRUE(pvs_bit(0, 1));
+    TEST_ASSERT_TRUE(pvs_bit(1, 0));
+    TEST_ASSERT_FALSE(pvs_bit(0, 2));
+    TEST_ASSERT_FALSE(pvs_bit(1, 2));
+    TEST_ASSERT_FALSE(pvs_bit(2, 0));
+    TEST_ASSERT_FALSE(pvs_bit(2, 1));
+    TEST_ASSERT_FLOAT_WITHIN(.001f, 1.f, column_eye_top[0]);
+
+    // the wall hides the last column from the first
+    make_camera(&actor, &camera, &camera_to_world, 5.f, 1.f, 5.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 1, 0));
+    TEST_ASSERT_FALSE(ColumnVisible(&track, 2, 0));
+
+    // a second camera in the same place reuses the rows of the first
+    built = gColumn_pvs_views_built;
+    reused = gColumn_pvs_views_reused;
+    make_camera(&actor, &camera, &camera_to_world, 6.f, 1.5f, 4.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_FALSE(ColumnVisible(&track, 2, 0));
+    TEST_ASSERT_EQUAL_INT(built, gColumn_pvs_views_built);
+    TEST_ASSERT_EQUAL_INT(reused + 1, gColumn_pvs_views_reused);
+    make_camera(&actor, &camera, &camera_to_world, 15.f, 1.f, 5.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_EQUAL_INT(built + 1, gColumn_pvs_views_built);
+
+    // too high above anything the set was sampled from
+    make_camera(&actor, &camera, &camera_to_world, 5.f, 10.f, 5.f);
+    CullColumns(&track, &actor, &camera_to_world, 0, 2, 0, 0);
+    TEST_ASSERT_TRUE(ColumnVisible(&track, 2, 0));
+
+    // without walls everything sees everything
+    TEST_ASSERT_EQUAL_INT(9, BuildColumnPVS(&track, triangles, 2, 1000.f));
+    // and nothing further apart than the radius is hidden
+    TEST_ASSERT_EQUAL_INT(7, BuildColumnPVS(&track, triangles, 4, 12.f));
+
+    gYon_factor = old_yon_factor;
+    harness_game_config.column_culling = old_culling;
+}
+
+void test_brucetrk_lollipops(void) {
+    tTrack_spec track;
+    br_actor* lollipop;
+    br_actor* billboards[2];
+    br_actor expected;
+    br_actor actor;
+    br_camera camera;
+    br_matrix34 camera_to_world;
+    int turned;
+    int kept;
+    int i;
+
+    make_track(&track);
+    lollipop = BrActorAllocate(BR_ACTOR_NONE, NULL);
+    for (i = 0; i < 2; i++) {
+        billboards[i] = BrActorAllocate(BR_ACTOR_MODEL, NULL);
+        BrMatrix34Translate(&billboards[i]->t.t.mat, 12.f + i, 0.f, 5.f);
+        BrActorAdd(lollipop, billboards[i]);
+    }
+    lollipop_row[1] = lollipop;
+    BuildLollipopStore(&track);
+    TEST_ASSERT_EQUAL_INT(0, track.lollipop_first[0]);
+    TEST_ASSERT_EQUAL_INT(0, track.lollipop_first[1]);
+    TEST_ASSERT_EQUAL_INT(2, track.lollipop_first[2]);
+    TEST_ASSERT_EQUAL_INT(2, track.lollipop_first[3]);
+
+    // the children end up as LollipopizeActor4 would leave them, and keep their places
+    make_camera(&actor, &camera, &camera_to_world, 5.f, 1.f, 5.f);
+    camera_to_world.m[2][1] = .2f;
+    memset(&expected, 0, sizeof(expected));
+    LollipopizeActor4(&expected, &camera_to_world, &actor);
+    TurnLollipopsTo(&camera_to_world);
+    FaceColumnLollipops(&track, &camera_to_world, 1, 0);
+    for (i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_MEMORY(expected.t.t.mat.m, billboards[i]->t.t.mat.m, sizeof(br_scalar) * 9);
+        TEST_ASSERT_EQUAL_FLOAT(12.f + i, billboards[i]->t.t.mat.m[3][0]);
+    }
+
+    // and are left alone until the camera turns
+    turned = gLollipop_columns_turned;
+    kept = gLollipop_columns_kept;
+    TurnLollipopsTo(&camera_to_world);
+    FaceColumnLollipops(&track, &camera_to_world, 1, 0);
+    TEST_ASSERT_EQUAL_INT(turned, gLollipop_columns_turned);
+    TEST_ASSERT_EQUAL_INT(kept + 1, gLollipop_columns_kept);
+    camera_to_world.m[2][0] = -.5f;
+    TurnLollipopsTo(&camera_to_world);
+    FaceColumnLollipops(&track, &camera_to_world, 1, 0);
+    TEST_ASSERT_EQUAL_INT(turned + 1, gLollipop_columns_turned);
+    TEST_ASSERT_EQUAL_FLOAT(-.5f, billboards[1]->t.t.mat.m[2][0]);
+
+    DisposeLollipopStore(&track);
+    lollipop_row[1] = NULL;
+    BrActorFree(lollipop);
+}
+
+void test_brucetrk_suite(void) {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_brucetrk_frustum);
+    RUN_TEST(test_brucetrk_pvs);
+    RUN_TEST(test_brucetrk_lollipops);
+}
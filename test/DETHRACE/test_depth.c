@@ -0,0 +1,281 @@
+#include "tests.h"
+
+#include "common/depth.h"
+#include "common/globvars.h"
+#include "common/replay.h"
+#include "harness/config.h"
+#include <string.h>
+
+#define RENDER_WIDTH 80
+#define RENDER_HEIGHT 60
+
+static br_pixelmap* make_sky(void) {
+    br_pixelmap* sky;
+    int x;
+    int y;
+
+    sky = BrPixelmapAllocate(BR_PMT_INDEX_8, 32, 16, NULL, 0);
+    for (y = 0; y < sky->height; y++) {
+        for (x = 0; x < sky->width; x++) {
+            ((tU8*)sky->pixels)[y * sky->row_bytes + x] = 16 + y * 8 + x % 8;
+        }
+    }
+    return sky;
+}
+
+static br_pixelmap* make_shade_table(void) {
+    br_pixelmap* table;
+    int x;
+    int y;
+
+    table = BrPixelmapAllocate(BR_PMT_INDEX_8, 256, 256, NULL, 0);
+    for (y = 0; y < 256; y++) {
+        for (x = 0; x < 256; x++) {
+            ((tU8*)table->pixels)[y * table->row_bytes + x] = (x + y * 3) & 0xff;
+        }
+    }
+    return table;
+}
+
+// Stands in for the track: a slope of ground across the bottom, and a block in the sky, both far enough
+// away for the depth effects to reach
+static void draw_scene(br_pixelmap* pRender, br_pixelmap* pDepth) {
+    tU16* depth;
+    tU8* render;
+    int x;
+    int y;
+
+    for (y = 0; y < pRender->height; y++) {
+        render = (tU8*)pRender->pixels + y * pRender->row_bytes;
+        depth = (tU16*)((tU8*)pDepth->pixels + y * pDepth->row_bytes);
+        for (x = 0; x < pRender->width; x++) {
+            if (y > 35 + x / 10 || (x >= 20 && x < 30 && y >= 5 && y < 15)) {
+                render[x] = (x * 7 + y * 3) & 0xff;
+                depth[x] = 0xfffe - (y * 37 + x * 11) % 0x600;
+            }
+        }
+    }
+}
+
+static void render_frame(br_pixelmap* pRender, br_pixelmap* pDepth, br_actor* pCamera, br_matrix34* pCamera_to_world, int pDeferred) {
+
+    BrPixelmapFill(pRender, pDeferred ? 0xaa : 0x55);
+    BrPixelmapFill(pDepth, 0xFFFFFFFF);
+    if (pDeferred) {
+        DeferExternalSky(pRender, pDepth, pCamera, pCamera_to_world);
+    } else {
+        ExternalSky(pRender, pDepth, pCamera, pCamera_to_world);
+    }
+    draw_scene(pRender, pDepth);
+    DepthEffect(pRender, pDepth, pCamera, pCamera_to_world);
+}
+
+void test_depth_deferred_sky_matches_external_sky(void) {
+    static const int effects[][3] = {
+        { eDepth_effect_none, 0, 0 },
+        { eDepth_effect_darkness, 7, 5 },
+        { eDepth_effect_darkness, 8, 8 },
+        { eDepth_effect_fog, 10, 8 },
+    };
+    static const float views[][2] = {
+        { 0.f, 0.f },
+        { 40.f, -10.f },
+        { 200.f, 15.f },
+        { -95.f, 5.f },
+    };
+    br_pixelmap* expected;
+    br_pixelmap* actual;
+    br_pixelmap* depth;
+    br_pixelmap* sky;
+    br_pixelmap* shade_table;
+    br_material material;
+    br_material* old_horizon_material;
+    br_angle old_image_height;
+    br_angle old_image_underground;
+    tDepth_effect old_effect;
+    br_pixelmap* old_depth_table;
+    br_pixelmap* old_fog_table;
+    int old_depth_power;
+    int old_fog_power;
+    int old_deferred_sky;
+    br_actor camera_actor;
+    br_camera camera;
+    br_matrix34 camera_to_world;
+    int e;
+    int v;
+
+    old_horizon_material = gHorizon_material;
+    old_image_height = gSky_image_height;
+    old_image_underground = gSky_image_underground;
+    old_effect = gProgram_state.current_depth_effect;
+    old_depth_table = gDepth_shade_table;
+    old_fog_table = gFog_shade_table;
+    old_depth_power = gDepth_shade_table_power;
+    old_fog_power = gFog_shade_table_power;
+    old_deferred_sky = harness_game_config.deferred_sky;
+
+    sky = make_sky();
+    shade_table = make_shade_table();
+    memset(&material, 0, sizeof(material));
+    material.colour_map = sky;
+    gHorizon_material = &material;
+    gSky_image_height = BR_ANGLE_DEG(40);
+    gSky_image_underground = BR_ANGLE_DEG(10);
+    gDepth_shade_table = shade_table;
+    gFog_shade_table = shade_table;
+    gDepth_shade_table_power = 8;
+    gFog_shade_table_power = 8;
+    harness_game_config.deferred_sky = 1;
+
+    expected = BrPixelmapAllocate(BR_PMT_INDEX_8, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    actual = BrPixelmapAllocate(BR_PMT_INDEX_8, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    depth = BrPixelmapAllocate(BR_PMT_DEPTH_16, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    expected->origin_x = actual->origin_x = RENDER_WIDTH / 2;
+    expected->origin_y = actual->origin_y = RENDER_HEIGHT / 2;
+
+    memset(&camera_actor, 0, sizeof(camera_actor));
+    memset(&camera, 0, sizeof(camera));
+    camera.field_of_view = BR_ANGLE_DEG(70);
+    camera.aspect = 1.6f;
+    camera_actor.type_data = &camera;
+
+    for (e = 0; e < COUNT_OF(effects); e++) {
+        gProgram_state.current_depth_effect.type = effects[e][0];
+        gProgram_state.current_depth_effect.start = effects[e][1];
+        gProgram_state.current_depth_effect.end = effects[e][2];
+        for (v = 0; v < COUNT_OF(views); v++) {
+            BrMatrix34RotateX(&camera_to_world, BR_ANGLE_DEG(views[v][1]));
+            BrMatrix34PostRotateY(&camera_to_world, BR_ANGLE_DEG(views[v][0]));
+            render_frame(expected, depth, &camera_actor, &camera_to_world, 0);
+            render_frame(actual, depth, &camera_actor, &camera_to_world, 1);
+            TEST_ASSERT_EQUAL_MEMORY(expected->pixels, actual->pixels, RENDER_WIDTH * RENDER_HEIGHT);
+        }
+    }
+
+    BrPixelmapFree(depth);
+    BrPixelmapFree(actual);
+    BrPixelmapFree(expected);
+    BrPixelmapFree(shade_table);
+    BrPixelmapFree(sky);
+    gHorizon_material = old_horizon_material;
+    gSky_image_height = old_image_height;
+    gSky_image_underground = old_image_underground;
+    gProgram_state.current_depth_effect = old_effect;
+    gDepth_shade_table = old_depth_table;
+    gFog_shade_table = old_fog_table;
+    gDepth_shade_table_power = old_depth_power;
+    gFog_shade_table_power = old_fog_power;
+    harness_game_config.deferred_sky = old_deferred_sky;
+}
+
+// With a TV or action camera outside replay DoHorizon draws nothing, so DepthEffectSky must leave the sky
+// deferred until DepthEffect instead of drawing it before the ground is depth-effected
+void test_depth_sky_stays_deferred_without_horizon(void) {
+    br_pixelmap* expected;
+    br_pixelmap* actual;
+    br_pixelmap* depth;
+    br_pixelmap* sky;
+    br_pixelmap* shade_table;
+    br_material material;
+    br_material* old_horizon_material;
+    br_angle old_image_height;
+    br_angle old_image_underground;
+    tDepth_effect old_effect;
+    br_pixelmap* old_depth_table;
+    int old_depth_power;
+    int old_deferred_sky;
+    int old_cockpit_on;
+    int old_replay_mode;
+    tAction_replay_camera_type old_camera_mode;
+    tSpecial_volume* old_special_volume;
+    br_actor camera_actor;
+    br_camera camera;
+    br_matrix34 camera_to_world;
+    int x;
+    int y;
+
+    old_horizon_material = gHorizon_material;
+    old_image_height = gSky_image_height;
+    old_image_underground = gSky_image_underground;
+    old_effect = gProgram_state.current_depth_effect;
+    old_depth_table = gDepth_shade_table;
+    old_depth_power = gDepth_shade_table_power;
+    old_deferred_sky = harness_game_config.deferred_sky;
+    old_cockpit_on = gProgram_state.cockpit_on;
+    old_replay_mode = gAction_replay_mode;
+    old_camera_mode = gAction_replay_camera_mode;
+    old_special_volume = gLast_camera_special_volume;
+
+    sky = make_sky();
+    shade_table = make_shade_table();
+    memset(&material, 0, sizeof(material));
+    material.colour_map = sky;
+    gHorizon_material = &material;
+    gSky_image_height = BR_ANGLE_DEG(40);
+    gSky_image_underground = BR_ANGLE_DEG(10);
+    gDepth_shade_table = shade_table;
+    gDepth_shade_table_power = 8;
+    harness_game_config.deferred_sky = 1;
+    gProgram_state.current_depth_effect.type = eDepth_effect_darkness;
+    gProgram_state.current_depth_effect.start = 7;
+    gProgram_state.current_depth_effect.end = 5;
+    gProgram_state.current_depth_effect.sky_texture = sky;
+    gProgram_state.cockpit_on = 0;
+    gAction_replay_mode = 0;
+    gAction_replay_camera_mode = eAction_replay_tv;
+    gLast_camera_special_volume = NULL;
+
+    expected = BrPixelmapAllocate(BR_PMT_INDEX_8, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    actual = BrPixelmapAllocate(BR_PMT_INDEX_8, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    depth = BrPixelmapAllocate(BR_PMT_DEPTH_16, RENDER_WIDTH, RENDER_HEIGHT, NULL, 0);
+    expected->origin_x = actual->origin_x = RENDER_WIDTH / 2;
+    expected->origin_y = actual->origin_y = RENDER_HEIGHT / 2;
+
+    memset(&camera_actor, 0, sizeof(camera_actor));
+    memset(&camera, 0, sizeof(camera));
+    camera.field_of_view = BR_ANGLE_DEG(70);
+    camera.aspect = 1.6f;
+    camera_actor.type_data = &camera;
+    BrMatrix34RotateX(&camera_to_world, BR_ANGLE_DEG(-10));
+    BrMatrix34PostRotateY(&camera_to_world, BR_ANGLE_DEG(40));
+
+    render_frame(expected, depth, &camera_actor, &camera_to_world, 0);
+
+    BrPixelmapFill(actual, 0xaa);
+    BrPixelmapFill(depth, 0xFFFFFFFF);
+    DeferExternalSky(actual, depth, &camera_actor, &camera_to_world);
+    draw_scene(actual, depth);
+    DepthEffectSky(actual, depth, &camera_actor, &camera_to_world);
+    for (y = 0; y < RENDER_HEIGHT; y++) {
+        for (x = 0; x < RENDER_WIDTH; x++) {
+            if (((tU16*)((tU8*)depth->pixels + y * depth->row_bytes))[x] == 0xFFFF) {
+                TEST_ASSERT_EQUAL_UINT8(0xaa, ((tU8*)actual->pixels)[y * actual->row_bytes + x]);
+            }
+        }
+    }
+    DepthEffect(actual, depth, &camera_actor, &camera_to_world);
+    TEST_ASSERT_EQUAL_MEMORY(expected->pixels, actual->pixels, RENDER_WIDTH * RENDER_HEIGHT);
+
+    BrPixelmapFree(depth);
+    BrPixelmapFree(actual);
+    BrPixelmapFree(expected);
+    BrPixelmapFree(shade_table);
+    BrPixelmapFree(sky);
+    gHorizon_material = old_horizon_material;
+    gSky_image_height = old_image_height;
+    gSky_image_underground = old_image_underground;
+    gProgram_state.current_depth_effect = old_effect;
+    gDepth_shade_table = old_depth_table;
+    gDepth_shade_table_power = old_depth_power;
+    harness_game_config.deferred_sky = old_deferred_sky;
+    gProgram_state.cockpit_on = old_cockpit_on;
+    gAction_replay_mode = old_replay_mode;
+    gAction_replay_camera_mode = old_camera_mode;
+    gLast_camera_special_volume = old_special_volume;
+}
+
+void test_depth_suite(void) {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_depth_deferred_sky_matches_external_sky);
+    RUN_TEST(test_depth_sky_stays_deferred_without_horizon);
+}
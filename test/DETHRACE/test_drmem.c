@@ -0,0 +1,72 @@
+#include "tests.h"
+
+#include "common/drmem.h"
+#include <stdint.h>
+#include <string.h>
+
+void test_drmem_type_stats() {
+    void* small;
+    void* large;
+    tMem_type_stats before;
+    tMem_type_stats stats;
+
+    DRMemGetTypeStats(kMem_crush_data, &before);
+    small = DRStdlibAllocate(24, kMem_crush_data);
+    large = DRStdlibAllocate(100000, kMem_crush_data);
+    TEST_ASSERT_NOT_NULL(small);
+    TEST_ASSERT_NOT_NULL(large);
+    TEST_ASSERT_EQUAL_INT(0, (uintptr_t)small % Claim4ByteAlignment(kMem_crush_data));
+    TEST_ASSERT_EQUAL_INT(0, (uintptr_t)large % Claim4ByteAlignment(kMem_crush_data));
+    memset(small, 0xaa, 24);
+    memset(large, 0xbb, 100000);
+
+    DRMemGetTypeStats(kMem_crush_data, &stats);
+    TEST_ASSERT_EQUAL_INT(before.count + 2, stats.count);
+    TEST_ASSERT_EQUAL_INT(before.bytes + 100024, stats.bytes);
+    TEST_ASSERT_EQUAL_INT(before.bytes + 100024, DRStdlibInquire(kMem_crush_data));
+
+    DRStdlibFree(large);
+    DRStdlibFree(small);
+    DRMemGetTypeStats(kMem_crush_data, &stats);
+    TEST_ASSERT_EQUAL_INT(before.count, stats.count);
+    TEST_ASSERT_EQUAL_INT(before.bytes, stats.bytes);
+    TEST_ASSERT_GREATER_OR_EQUAL(before.bytes + 100024, stats.high_water);
+}
+
+void test_drmem_pool_reuse() {
+    void* a;
+    void* b;
+
+    a = DRStdlibAllocate(40, kMem_misc);
+    DRStdlibFree(a);
+    b = DRStdlibAllocate(33, kMem_misc);
+    TEST_ASSERT_EQUAL_PTR(a, b);
+    DRStdlibFree(b);
+}
+
+void test_drmem_race_arena() {
+    void* blocks[100];
+    int chunks_before;
+    int i;
+
+    chunks_before = DRMemArenaChunkCount();
+    DRMemBeginRaceArena();
+    for (i = 0; i < COUNT_OF(blocks); i++) {
+        blocks[i] = DRStdlibAllocate(1000 + i * 100, kMem_misc);
+        TEST_ASSERT_EQUAL_INT(0, (uintptr_t)blocks[i] % Claim4ByteAlignment(kMem_misc));
+        memset(blocks[i], i, 1000 + i * 100);
+    }
+    DRMemEndRaceArena();
+    TEST_ASSERT_GREATER_THAN(chunks_before, DRMemArenaChunkCount());
+    for (i = 0; i < COUNT_OF(blocks); i++) {
+        DRStdlibFree(blocks[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(chunks_before, DRMemArenaChunkCount());
+}
+
+void test_drmem_suite() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_drmem_type_stats);
+    RUN_TEST(test_drmem_pool_reuse);
+    RUN_TEST(test_drmem_race_arena);
+}
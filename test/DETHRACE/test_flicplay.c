@@ -1,7 +1,9 @@
 #include "brender.h"
 #include "common/flicplay.h"
 #include "common/graphics.h"
+#include "harness/config.h"
 #include "tests.h"
+#include <string.h>
 
 int nbr_frames_rendered;
 
@@ -32,7 +34,58 @@ void test_flicplay_playflic() {
     TEST_ASSERT_EQUAL_INT(3, nbr_frames_rendered);
 }
 
+void play_flic_into(int pIndex, br_pixelmap* pTarget) {
+    TEST_ASSERT_EQUAL_INT(1, LoadFlic(pIndex));
+    nbr_frames_rendered = 0;
+    PlayFlic(
+        pIndex,
+        gMain_flic_list[pIndex].the_size,
+        gMain_flic_list[pIndex].data_ptr,
+        pTarget,
+        gMain_flic_list[pIndex].x_offset,
+        gMain_flic_list[pIndex].y_offset,
+        frame_render_callback,
+        0,
+        gMain_flic_list[pIndex].frame_rate);
+    UnlockFlic(pIndex);
+    FreeFlic(pIndex);
+}
+
+void test_flicplay_decode_ahead() {
+    REQUIRES_DATA_DIRECTORY();
+    int pIndex = 31; // main menu swing in
+    int old_decode_ahead;
+    br_pixelmap* expected;
+    br_pixelmap* actual;
+    tU8 start_palette[0x400];
+    tU8 expected_palette[0x400];
+
+    old_decode_ahead = harness_game_config.flic_decode_ahead;
+    expected = BrPixelmapAllocate(BR_MEMORY_PIXELS, 320, 200, NULL, 0);
+    actual = BrPixelmapAllocate(BR_MEMORY_PIXELS, 320, 200, NULL, 0);
+    BrPixelmapFill(expected, 0);
+    BrPixelmapFill(actual, 0);
+
+    memcpy(start_palette, gPalette_pixels, sizeof(start_palette));
+    harness_game_config.flic_decode_ahead = 0;
+    play_flic_into(pIndex, expected);
+    TEST_ASSERT_EQUAL_INT(3, nbr_frames_rendered);
+    memcpy(expected_palette, gPalette_pixels, sizeof(expected_palette));
+
+    harness_game_config.flic_decode_ahead = 2;
+    memcpy(gPalette_pixels, start_palette, sizeof(start_palette));
+    play_flic_into(pIndex, actual);
+    TEST_ASSERT_EQUAL_INT(3, nbr_frames_rendered);
+    TEST_ASSERT_EQUAL_MEMORY(expected->pixels, actual->pixels, expected->row_bytes * expected->height);
+    TEST_ASSERT_EQUAL_MEMORY(expected_palette, gPalette_pixels, sizeof(expected_palette));
+
+    harness_game_config.flic_decode_ahead = old_decode_ahead;
+    BrPixelmapFree(expected);
+    BrPixelmapFree(actual);
+}
+
 void test_flicplay_suite() {
     UnitySetTestFile(__FILE__);
     RUN_TEST(test_flicplay_playflic);
+    RUN_TEST(test_flicplay_decode_ahead);
 }
@@ -0,0 +1,600 @@
+#include "tests.h"
+
+#include "common/globvars.h"
+#include "common/globvrpb.h"
+#include "common/netgame.h"
+#include "common/network.h"
+#include "harness/config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define HAS_UDP_LOOPBACK
+#endif
+
+#define CAR_COUNT 6
+#define SEND_INTERVAL 80
+
+static br_bounds track_bounds = { { { -500.f, -20.f, -400.f } }, { { 500.f, 60.f, 400.f } } };
+
+static float random_float(float pMin, float pMax) {
+    return pMin + (pMax - pMin) * (rand() % 10001) / 10000.f;
+}
+
+static void set_rotation(tReduced_matrix* pMat, float x, float y, float z, float w) {
+    float l;
+
+    l = sqrtf(x * x + y * y + z * z + w * w);
+    x /= l;
+    y /= l;
+    z /= l;
+    w /= l;
+    pMat->row1.v[0] = 1.f - 2.f * (y * y + z * z);
+    pMat->row1.v[1] = 2.f * (x * y - z * w);
+    pMat->row1.v[2] = 2.f * (x * z + y * w);
+    pMat->row2.v[0] = 2.f * (x * y + z * w);
+    pMat->row2.v[1] = 1.f - 2.f * (x * x + z * z);
+    pMat->row2.v[2] = 2.f * (y * z - x * w);
+}
+
+// A car driving circles, with a bit of body roll
+static void drive(tNet_message_mechanics_info* pMech, int pCar, tU32 pTime) {
+    float angle;
+    float radius;
+    int j;
+
+    memset(pMech, 0, sizeof(*pMech));
+    angle = pTime / 1000.f * .4f + pCar;
+    radius = 50.f + 30.f * pCar;
+    pMech->ID = 100 + pCar;
+    pMech->time = pTime;
+    set_rotation(&pMech->mat, .03f * sinf(pTime / 300.f), sinf(angle / 2.f), 0.f, cosf(angle / 2.f));
+    pMech->mat.translation.v[0] = radius * cosf(angle) * WORLD_SCALE;
+    pMech->mat.translation.v[1] = 2.f * WORLD_SCALE;
+    pMech->mat.translation.v[2] = radius * sinf(angle) * WORLD_SCALE;
+    pMech->v.v[0] = -radius * sinf(angle) * .4f;
+    pMech->v.v[2] = radius * cosf(angle) * .4f;
+    pMech->omega.v[1] = .4f;
+    for (j = 0; j < COUNT_OF(pMech->d); j++) {
+        pMech->d[j] = 120 + (pTime / 160 + j) % 4;
+    }
+    pMech->cc_coll_time = 1000 * pCar;
+    pMech->curvature = 12000;
+    pMech->revs = 4000 + (pTime / 40) % 300;
+    pMech->front = -1.2f;
+    pMech->back = 1.5f;
+    for (j = 0; j < COUNT_OF(pMech->damage); j++) {
+        pMech->damage[j] = MIN(99, pTime / 4000 + j);
+    }
+    pMech->powerups = 9;
+}
+
+void test_netgame_mechanics_full_state(void) {
+    tNet_message_mechanics_info mech;
+    tNet_message_mechanics_info expanded;
+    tMechanics_snapshot snapshot;
+    tMechanics_snapshot decoded;
+    tU8 data[MECHANICS_DELTA_DATA_SIZE];
+    int damaged_wheels;
+    int size;
+    int n;
+    int i;
+
+    srand(1);
+    ResetMechanicsStreams(&track_bounds);
+    for (n = 0; n < 2000; n++) {
+        memset(&mech, 0, sizeof(mech));
+        mech.time = rand();
+        set_rotation(&mech.mat, random_float(-1.f, 1.f), random_float(-1.f, 1.f), random_float(-1.f, 1.f), random_float(-1.f, 1.f));
+        for (i = 0; i < 3; i++) {
+            mech.mat.translation.v[i] = random_float(track_bounds.min.v[i], track_bounds.max.v[i]);
+            mech.v.v[i] = random_float(-50.f, 50.f);
+            mech.omega.v[i] = random_float(-5.f, 5.f);
+        }
+        for (i = 0; i < COUNT_OF(mech.damage); i++) {
+            mech.damage[i] = rand() % 100;
+        }
+        mech.revs = rand() % 12000;
+        mech.curvature = rand() % 65536 - 32768;
+        mech.front = random_float(-2.f, 0.f);
+        mech.back = random_float(0.f, 2.f);
+        damaged_wheels = n & 1;
+        for (i = 0; i < COUNT_OF(mech.wheel_dam_offset); i++) {
+            mech.wheel_dam_offset[i] = damaged_wheels ? random_float(-.1f, .1f) : 0.f;
+        }
+
+        QuantiseMechanics(&snapshot, &mech, damaged_wheels);
+        size = EncodeMechanicsDelta(data, sizeof(data), &snapshot, NULL);
+        TEST_ASSERT_GREATER_THAN(0, size);
+        TEST_ASSERT_TRUE(DecodeMechanicsDelta(&decoded, data, size, NULL));
+        TEST_ASSERT_EQUAL_MEMORY(&snapshot, &decoded, sizeof(snapshot));
+
+        memset(&expanded, 0, sizeof(expanded));
+        TEST_ASSERT_EQUAL_INT(damaged_wheels, ExpandMechanics(&expanded, &decoded));
+        TEST_ASSERT_EQUAL_UINT32(mech.time, expanded.time);
+        for (i = 0; i < 3; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(.001f, mech.mat.translation.v[i], expanded.mat.translation.v[i]);
+            TEST_ASSERT_FLOAT_WITHIN(.001f, mech.mat.row1.v[i], expanded.mat.row1.v[i]);
+            TEST_ASSERT_FLOAT_WITHIN(.001f, mech.mat.row2.v[i], expanded.mat.row2.v[i]);
+            TEST_ASSERT_FLOAT_WITHIN(.05f, mech.v.v[i], expanded.v.v[i]);
+            TEST_ASSERT_FLOAT_WITHIN(.005f, mech.omega.v[i], expanded.omega.v[i]);
+        }
+        TEST_ASSERT_EQUAL_MEMORY(mech.damage, expanded.damage, sizeof(mech.damage));
+        TEST_ASSERT_EQUAL_INT(mech.revs, expanded.revs);
+        TEST_ASSERT_EQUAL_INT(mech.curvature, expanded.curvature);
+        TEST_ASSERT_EQUAL_FLOAT(mech.front, expanded.front);
+        TEST_ASSERT_EQUAL_MEMORY(mech.wheel_dam_offset, expanded.wheel_dam_offset, sizeof(mech.wheel_dam_offset));
+    }
+}
+
+void test_netgame_mechanics_delta(void) {
+    tNet_message_mechanics_info mech;
+    tMechanics_snapshot previous;
+    tMechanics_snapshot snapshot;
+    tMechanics_snapshot decoded;
+    tU8 data[MECHANICS_DELTA_DATA_SIZE];
+    int full_bytes;
+    int delta_bytes;
+    int size;
+    tU32 time;
+
+    ResetMechanicsStreams(&track_bounds);
+    drive(&mech, 2, 0);
+    QuantiseMechanics(&previous, &mech, 0);
+    full_bytes = 0;
+    delta_bytes = 0;
+    for (time = SEND_INTERVAL; time < 20000; time += SEND_INTERVAL) {
+        drive(&mech, 2, time);
+        QuantiseMechanics(&snapshot, &mech, 0);
+        full_bytes += EncodeMechanicsDelta(data, sizeof(data), &snapshot, NULL);
+        size = EncodeMechanicsDelta(data, sizeof(data), &snapshot, &previous);
+        TEST_ASSERT_GREATER_THAN(0, size);
+        delta_bytes += size;
+        TEST_ASSERT_TRUE(DecodeMechanicsDelta(&decoded, data, size, &previous));
+        TEST_ASSERT_EQUAL_MEMORY(&snapshot, &decoded, sizeof(snapshot));
+        // truncated data is rejected
+        TEST_ASSERT_FALSE(DecodeMechanicsDelta(&decoded, data, size - 1, &previous));
+        previous = snapshot;
+    }
+    TEST_ASSERT_LESS_THAN(full_bytes * 3 / 4, delta_bytes);
+}
+
+#ifdef HAS_UDP_LOOPBACK
+// The host broadcasting every car's mechanics over 127.0.0.1 in message stacks of at most 512 bytes, with
+// 10% of the datagrams lost in both directions. Both ends run the race code: GetMechanicsContents and
+// SendMechanicsContents pick the baselines on the host, ReceivedMechanicsDelta decodes on the client, and
+// the client's SendMechanicsAcks go back through ReceivedMechanicsAck. Host and client keep separate
+// streams, so they share this process; only the player index and net mode are switched between them.
+// The client stands in for every other player, each of its acks is lost on its own.
+#define LOOPBACK_HOST 0
+#define LOOPBACK_CLIENT 1
+#define LOOPBACK_STACK_SIZE 512
+
+static struct {
+    int host;
+    int client;
+    struct sockaddr_in address;
+    tNet_message_mechanics_info expected[CAR_COUNT];
+    tU32 packet_words[LOOPBACK_STACK_SIZE / 4];
+    int total_bytes;
+    int updates;
+} loopback;
+
+static tCar_spec loopback_cars[CAR_COUNT];
+static tMin_message loopback_min_pool[20];
+static tMid_message loopback_mid_pool[10];
+static tMax_message loopback_max_pool[20];
+
+static struct {
+    tHarness_game_config config;
+    tNet_game_player_info players[COUNT_OF(gNet_players)];
+    tNet_mode mode;
+    tMin_message* min_messages;
+    tMid_message* mid_messages;
+    tMax_message* max_messages;
+    tNet_message* broadcast_stack;
+    tNet_message* to_host_stack;
+    int number_of_players;
+    int this_player;
+} loopback_saved;
+
+static void loopback_close(void) {
+
+    if (loopback.host >= 0) {
+        close(loopback.host);
+        loopback.host = -1;
+    }
+    if (loopback.client >= 0) {
+        close(loopback.client);
+        loopback.client = -1;
+    }
+}
+
+static void loopback_restore(void) {
+
+    loopback_close();
+    harness_game_config = loopback_saved.config;
+    memcpy(gNet_players, loopback_saved.players, sizeof(gNet_players));
+    gNet_mode = loopback_saved.mode;
+    gMin_messages = loopback_saved.min_messages;
+    gMid_messages = loopback_saved.mid_messages;
+    gMax_messages = loopback_saved.max_messages;
+    gBroadcast_stack = loopback_saved.broadcast_stack;
+    gTo_host_stack = loopback_saved.to_host_stack;
+    gNumber_of_net_players = loopback_saved.number_of_players;
+    gThis_net_player_index = loopback_saved.this_player;
+}
+
+static void loopback_become(int pIndex) {
+
+    gThis_net_player_index = pIndex;
+    gNet_mode = pIndex == LOOPBACK_HOST ? eNet_mode_host : eNet_mode_client;
+}
+
+// Passes a message stack through the lossy channel. Returns what arrived, or NULL.
+static tNet_message* loopback_send(tNet_message* pMessage) {
+    tNet_message* received;
+    int size;
+
+    received = NULL;
+    if (rand() % 10 != 0) {
+        TEST_ASSERT_EQUAL_INT(pMessage->overall_size, sendto(loopback.host, pMessage, pMessage->overall_size, 0, (struct sockaddr*)&loopback.address, sizeof(loopback.address)));
+        size = recv(loopback.client, loopback.packet_words, sizeof(loopback.packet_words), 0);
+        TEST_ASSERT_EQUAL_INT(pMessage->overall_size, size);
+        received = (tNet_message*)loopback.packet_words;
+    }
+    return received;
+}
+
+static void loopback_client_receive(tNet_message* pMessage) {
+    tNet_contents* contents;
+    tCar_spec* car;
+    int i;
+
+    loopback_become(LOOPBACK_CLIENT);
+    contents = &pMessage->contents;
+    for (i = 0; i < pMessage->num_contents; i++) {
+        switch (contents->header.type) {
+        case NETMSGID_MECHANICS:
+            car = &loopback_cars[contents->data.mech.ID - 100];
+            ReceivedMechanics(contents);
+            break;
+        case NETMSGID_MECHANICS_DELTA:
+            car = &loopback_cars[contents->data.mech_delta.ID - 100];
+            ReceivedMechanicsDelta(contents);
+            break;
+        default:
+            TEST_FAIL_MESSAGE("unexpected contents in a mechanics stack");
+            return;
+        }
+        // whatever arrives can be decoded, so the host only ever uses a baseline the client has
+        TEST_ASSERT_EQUAL_UINT32(loopback.expected[car - loopback_cars].time, car->message.time);
+        TEST_ASSERT_EQUAL_MEMORY(&loopback.expected[car - loopback_cars].mat, &car->message.mat, sizeof(car->message.mat));
+        TEST_ASSERT_EQUAL_MEMORY(&loopback.expected[car - loopback_cars].v, &car->message.v, sizeof(car->message.v));
+        loopback.updates++;
+        contents = (tNet_contents*)((tU8*)contents + contents->header.contents_size);
+    }
+}
+
+static void loopback_host_flush(void) {
+    tNet_message* message;
+    tNet_message* received;
+
+    message = gBroadcast_stack;
+    gBroadcast_stack = NULL;
+    if (message == NULL) {
+        return;
+    }
+    loopback.total_bytes += message->overall_size;
+    received = loopback_send(message);
+    NetDisposeMessage(gCurrent_net_game, message);
+    if (received != NULL) {
+        loopback_client_receive(received);
+    }
+}
+
+static void loopback_client_acks(void) {
+    tNet_message* acks;
+    tNet_message* received;
+    int i;
+
+    loopback_become(LOOPBACK_CLIENT);
+    SendMechanicsAcks(1);
+    acks = gTo_host_stack;
+    gTo_host_stack = NULL;
+    if (acks == NULL) {
+        return;
+    }
+    loopback_become(LOOPBACK_HOST);
+    for (i = 0; i < gNumber_of_net_players; i++) {
+        if (i == LOOPBACK_HOST) {
+            continue;
+        }
+        received = loopback_send(acks);
+        if (received != NULL) {
+            received->sender = gNet_players[i].ID;
+            ReceivedMechanicsAck(&received->contents, received);
+        }
+    }
+    NetDisposeMessage(gCurrent_net_game, acks);
+}
+
+// Returns bytes per car per second
+static int run_loopback(int pDelta) {
+    tNet_message_mechanics_info mech;
+    tMechanics_snapshot snapshot;
+    tNet_contents* contents;
+    socklen_t address_length;
+    struct timeval timeout;
+    int largest;
+    int car;
+    tU32 time;
+
+    loopback.host = socket(AF_INET, SOCK_DGRAM, 0);
+    loopback.client = socket(AF_INET, SOCK_DGRAM, 0);
+    if (loopback.host < 0 || loopback.client < 0) {
+        loopback_close();
+        return -1;
+    }
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(loopback.client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    memset(&loopback.address, 0, sizeof(loopback.address));
+    loopback.address.sin_family = AF_INET;
+    loopback.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address_length = sizeof(loopback.address);
+    if (bind(loopback.client, (struct sockaddr*)&loopback.address, sizeof(loopback.address)) != 0
+        || getsockname(loopback.client, (struct sockaddr*)&loopback.address, &address_length) != 0) {
+        loopback_close();
+        return -1;
+    }
+
+    harness_game_config.net_delta_mechanics = pDelta;
+    harness_game_config.net_interpolation = 0;
+    ResetMechanicsStreams(&track_bounds);
+    for (car = 0; car < CAR_COUNT; car++) {
+        memset(&loopback_cars[car], 0, sizeof(loopback_cars[car]));
+        loopback_cars[car].active = 1;
+    }
+    loopback.total_bytes = 0;
+    loopback.updates = 0;
+    // NetGetBroadcastContents sends a full stack itself, so stacks are flushed while the largest
+    // contents still fit
+    largest = MAX(NetGetContentsSize(NETMSGID_MECHANICS, 0), NetGetContentsSize(NETMSGID_MECHANICS_DELTA, MECHANICS_DELTA_DATA_SIZE));
+    srand(7);
+    for (time = 0; time < 10000; time += SEND_INTERVAL) {
+        loopback_become(LOOPBACK_HOST);
+        for (car = 0; car < CAR_COUNT; car++) {
+            if (gBroadcast_stack != NULL && gBroadcast_stack->overall_size + largest > LOOPBACK_STACK_SIZE) {
+                loopback_host_flush();
+                loopback_become(LOOPBACK_HOST);
+            }
+            drive(&mech, car, time);
+            contents = GetMechanicsContents(0, 0);
+            memcpy(&contents->data.mech.ID, &mech.ID, offsetof(tNet_message_mechanics_info, wheel_dam_offset) - offsetof(tNet_message_mechanics_info, ID));
+            if (pDelta) {
+                QuantiseMechanics(&snapshot, &mech, 0);
+                memset(&loopback.expected[car], 0, sizeof(loopback.expected[car]));
+                ExpandMechanics(&loopback.expected[car], &snapshot);
+            } else {
+                loopback.expected[car] = mech;
+            }
+            SendMechanicsContents(contents, 0, 0);
+        }
+        loopback_host_flush();
+        loopback_client_acks();
+    }
+    loopback_close();
+    TEST_ASSERT_GREATER_THAN(CAR_COUNT * 10000 / SEND_INTERVAL * 8 / 10, loopback.updates);
+    return loopback.total_bytes / CAR_COUNT / 10;
+}
+#endif
+
+void test_netgame_mechanics_loopback(void) {
+#ifdef HAS_UDP_LOOPBACK
+    char s[256];
+    int full;
+    int delta;
+    int i;
+
+    loopback.host = -1;
+    loopback.client = -1;
+    loopback_saved.config = harness_game_config;
+    memcpy(loopback_saved.players, gNet_players, sizeof(gNet_players));
+    loopback_saved.mode = gNet_mode;
+    loopback_saved.min_messages = gMin_messages;
+    loopback_saved.mid_messages = gMid_messages;
+    loopback_saved.max_messages = gMax_messages;
+    loopback_saved.broadcast_stack = gBroadcast_stack;
+    loopback_saved.to_host_stack = gTo_host_stack;
+    loopback_saved.number_of_players = gNumber_of_net_players;
+    loopback_saved.this_player = gThis_net_player_index;
+    run_after_test(loopback_restore);
+
+    gMin_messages = loopback_min_pool;
+    gMid_messages = loopback_mid_pool;
+    gMax_messages = loopback_max_pool;
+    gBroadcast_stack = NULL;
+    gTo_host_stack = NULL;
+    memset(gNet_players, 0, sizeof(gNet_players));
+    for (i = 0; i < CAR_COUNT; i++) {
+        gNet_players[i].ID = 100 + i;
+        gNet_players[i].car = &loopback_cars[i];
+    }
+    gNet_players[LOOPBACK_HOST].host = 1;
+    gNumber_of_net_players = CAR_COUNT;
+
+    full = run_loopback(0);
+    delta = run_loopback(1);
+    if (full < 0 || delta < 0) {
+        TEST_IGNORE_MESSAGE("no UDP sockets on 127.0.0.1");
+    }
+    sprintf(s, "mechanics over 127.0.0.1: %d bytes/car/s full, %d bytes/car/s delta", full, delta);
+    TEST_MESSAGE(s);
+    TEST_ASSERT_LESS_THAN(full / 2, delta);
+#else
+    TEST_IGNORE_MESSAGE("UDP loopback test needs BSD sockets");
+#endif
+}
+
+// A car slaloming down a straight, braking and accelerating hard. Physics units, v in units per second
+static void weave(tNet_message_mechanics_info* pMech, tU32 pTime) {
+    float t;
+    float heading;
+
+    memset(pMech, 0, sizeof(*pMech));
+    t = pTime / 1000.f;
+    pMech->ID = 100;
+    pMech->time = pTime;
+    pMech->mat.translation.v[0] = 30.f * t + 10.f * sinf(2.f * t);
+    pMech->mat.translation.v[1] = 2.f;
+    pMech->mat.translation.v[2] = 8.f * sinf(3.f * t);
+    pMech->v.v[0] = 30.f + 20.f * cosf(2.f * t);
+    pMech->v.v[2] = 24.f * cosf(3.f * t);
+    heading = atan2f(pMech->v.v[0], pMech->v.v[2]);
+    set_rotation(&pMech->mat, 0.f, sinf(heading / 2.f), 0.f, cosf(heading / 2.f));
+}
+
+static float position_error(tNet_message_mechanics_info* pMech, tU32 pTime) {
+    tNet_message_mechanics_info truth;
+    br_vector3 d;
+
+    weave(&truth, pTime);
+    BrVector3Sub(&d, &pMech->mat.translation, &truth.mat.translation);
+    return BrVector3Length(&d);
+}
+
+void test_netgame_snapshot_interpolate(void) {
+    tNet_snapshot_buffer buffer;
+    tNet_message_mechanics_info mech;
+    tNet_message_mechanics_info sample;
+
+    NetSnapshotReset(&buffer);
+    TEST_ASSERT_FALSE(NetSnapshotSample(&buffer, 1000, &sample));
+
+    // out of order and duplicated arrivals
+    weave(&mech, 1080);
+    TEST_ASSERT_TRUE(NetSnapshotPush(&buffer, &mech, 1130));
+    weave(&mech, 1000);
+    TEST_ASSERT_FALSE(NetSnapshotPush(&buffer, &mech, 1140));
+    TEST_ASSERT_FALSE(NetSnapshotPush(&buffer, &mech, 1150));
+    TEST_ASSERT_EQUAL_INT(2, buffer.count);
+    TEST_ASSERT_EQUAL_INT(1, buffer.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1000, buffer.snapshots[0].time);
+
+    // played out between the two snapshots
+    TEST_ASSERT_TRUE(NetSnapshotSample(&buffer, 1120, &sample));
+    TEST_ASSERT_GREATER_THAN(1000, sample.time);
+    TEST_ASSERT_LESS_THAN(1080, sample.time);
+    TEST_ASSERT_FLOAT_WITHIN(.05f, 0.f, position_error(&sample, sample.time));
+    TEST_ASSERT_FLOAT_WITHIN(.001f, 1.f, BrVector3Length(&sample.mat.row1));
+    TEST_ASSERT_FLOAT_WITHIN(.001f, 0.f, BrVector3Dot(&sample.mat.row1, &sample.mat.row2));
+
+    // a snapshot the playout clock has passed is no use any more
+    weave(&mech, 1020);
+    TEST_ASSERT_FALSE(NetSnapshotPush(&buffer, &mech, 1200));
+    TEST_ASSERT_EQUAL_INT(1, buffer.late);
+    TEST_ASSERT_EQUAL_INT(2, buffer.count);
+}
+
+// The host sends every 80ms, the client steps every 40ms. Packets take 40-140ms, so they arrive out of
+// order, and 10% of them are lost. The buffered car is compared with the track it really drove at the
+// time it is shown; snapping to the newest message and dead reckoning from it is compared at the time
+// of the step.
+void test_netgame_snapshot_jitter(void) {
+    static tNet_message_mechanics_info sent[1000];
+    static tU32 arrival[1000];
+    tNet_snapshot_buffer buffer;
+    tNet_message_mechanics_info sample;
+    tNet_message_mechanics_info newest;
+    br_vector3 previous;
+    br_vector3 position;
+    br_vector3 d;
+    float buffered_error;
+    float snapped_error;
+    int snapped_corrections;
+    int samples;
+    int have_newest;
+    int next;
+    int count;
+    int i;
+    tU32 now;
+    char s[256];
+
+    srand(40);
+    count = 0;
+    for (i = 0; i < COUNT_OF(sent); i++) {
+        if (rand() % 10 == 0) {
+            continue;
+        }
+        weave(&sent[count], i * SEND_INTERVAL);
+        arrival[count] = i * SEND_INTERVAL + 40 + rand() % 100;
+        count++;
+    }
+
+    NetSnapshotReset(&buffer);
+    have_newest = 0;
+    buffered_error = 0.f;
+    snapped_error = 0.f;
+    snapped_corrections = 0;
+    samples = 0;
+    for (now = 40; now < (COUNT_OF(sent) - 10) * SEND_INTERVAL; now += 40) {
+        for (next = 0; next < count; next++) {
+            if (arrival[next] > now - 40 && arrival[next] <= now) {
+                NetSnapshotPush(&buffer, &sent[next], arrival[next]);
+                if (!have_newest || sent[next].time > newest.time) {
+                    newest = sent[next];
+                    have_newest = 1;
+                }
+            }
+        }
+        if (!NetSnapshotSample(&buffer, now, &sample)) {
+            continue;
+        }
+        buffered_error += position_error(&sample, sample.time);
+
+        BrVector3Scale(&position, &newest.v, (now - newest.time) / 1000.f);
+        BrVector3Accumulate(&position, &newest.mat.translation);
+        weave(&sample, now);
+        BrVector3Sub(&d, &position, &sample.mat.translation);
+        snapped_error += BrVector3Length(&d);
+        if (samples != 0) {
+            // where the car would have got to since the last step
+            BrVector3Scale(&d, &sample.v, .04f);
+            BrVector3Accumulate(&d, &previous);
+            BrVector3Sub(&d, &position, &d);
+            if (BrVector3Length(&d) > NET_SNAPSHOT_CORRECTION_DISTANCE) {
+                snapped_corrections++;
+            }
+        }
+        BrVector3Copy(&previous, &position);
+        samples++;
+    }
+    buffered_error /= samples;
+    snapped_error /= samples;
+
+    sprintf(s, "jitter buffer: %d ms delay, error %.3f (snapped %.3f), %d corrections (snapped %d) in %d steps, %d late, %d extrapolated",
+        (int)buffer.playout_delay, buffered_error, snapped_error, buffer.corrections, snapped_corrections, samples, buffer.late, buffer.extrapolated);
+    TEST_MESSAGE(s);
+    TEST_ASSERT_LESS_THAN(NET_SNAPSHOT_MAX_DELAY, buffer.playout_delay);
+    TEST_ASSERT_TRUE(buffered_error < .1f);
+    TEST_ASSERT_TRUE(buffered_error < snapped_error / 4.f);
+    TEST_ASSERT_LESS_THAN(samples / 100, buffer.corrections);
+    TEST_ASSERT_LESS_THAN(snapped_corrections, buffer.corrections);
+}
+
+void test_netgame_suite(void) {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_netgame_mechanics_full_state);
+    RUN_TEST(test_netgame_mechanics_delta);
+    RUN_TEST(test_netgame_mechanics_loopback);
+    RUN_TEST(test_netgame_snapshot_interpolate);
+    RUN_TEST(test_netgame_snapshot_jitter);
+}
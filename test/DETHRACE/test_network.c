@@ -0,0 +1,494 @@
+#include "tests.h"
+
+#include "common/globvars.h"
+#include "common/globvrpb.h"
+#include "common/network.h"
+#include "harness/config.h"
+#include "harness/hooks.h"
+#include "pd/net.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MESSAGE_COUNT 300
+#define PEER_COUNT 3
+
+static tNet_message messages[MESSAGE_COUNT];
+static tPD_net_player_info peers[PEER_COUNT];
+static br_uint_32 now;
+
+static br_uint_32 test_clock(void) {
+    return now;
+}
+
+static void make_message(tNet_message* pMessage) {
+    memset(pMessage, 0, sizeof(*pMessage));
+    pMessage->contents.header.type = NETMSGID_HEADUP;
+    pMessage->overall_size = sizeof(tNet_message);
+}
+
+static void reply(tU32 pGuarantee_number) {
+    tNet_contents contents;
+
+    memset(&contents, 0, sizeof(contents));
+    contents.data.reply.guarantee_number = pGuarantee_number;
+    ReceivedGuaranteeReply(&contents);
+}
+
+static struct {
+    tHarness_game_config config;
+    tNet_game_player_info players[COUNT_OF(gNet_players)];
+    br_uint_32 (*get_ticks)(void);
+    br_uint_32 (*get_microseconds)(void);
+    tNet_game_details* game;
+    tNet_mode mode;
+    tMin_message* min_messages;
+    tMid_message* mid_messages;
+    tMax_message* max_messages;
+    tU32 guarantee_number;
+    int number_of_players;
+    int this_player;
+    tPlayer_ID id;
+    int racing;
+} saved;
+static int net_initialised;
+
+static void network_restore(void) {
+
+    if (net_initialised) {
+        PDNetShutdown();
+        net_initialised = 0;
+    }
+    NetDisposeGuarantees();
+    harness_game_config = saved.config;
+    memcpy(gNet_players, saved.players, sizeof(gNet_players));
+    gHarness_platform.GetTicks = saved.get_ticks;
+    gHarness_platform.GetMicroseconds = saved.get_microseconds;
+    gCurrent_net_game = saved.game;
+    gNet_mode = saved.mode;
+    gMin_messages = saved.min_messages;
+    gMid_messages = saved.mid_messages;
+    gMax_messages = saved.max_messages;
+    gGuarantee_number = saved.guarantee_number;
+    gNumber_of_net_players = saved.number_of_players;
+    gThis_net_player_index = saved.this_player;
+    gLocal_net_ID = saved.id;
+    gProgram_state.racing = saved.racing;
+}
+
+// Whichever way the test ends, the network is left as it was found, without any guarantees
+static void network_save(void) {
+
+    saved.config = harness_game_config;
+    memcpy(saved.players, gNet_players, sizeof(gNet_players));
+    saved.get_ticks = gHarness_platform.GetTicks;
+    saved.get_microseconds = gHarness_platform.GetMicroseconds;
+    saved.game = gCurrent_net_game;
+    saved.mode = gNet_mode;
+    saved.min_messages = gMin_messages;
+    saved.mid_messages = gMid_messages;
+    saved.max_messages = gMax_messages;
+    saved.guarantee_number = gGuarantee_number;
+    saved.number_of_players = gNumber_of_net_players;
+    saved.this_player = gThis_net_player_index;
+    saved.id = gLocal_net_ID;
+    saved.racing = gProgram_state.racing;
+    run_after_test(network_restore);
+}
+
+static tGuaranteed_message* find_guarantee(tU32 pGuarantee_number) {
+    int i;
+
+    for (i = 0; i < gGuarantee_capacity; i++) {
+        if (gGuarantee_list[i].message != NULL && gGuarantee_list[i].guarantee_number == pGuarantee_number) {
+            return &gGuarantee_list[i];
+        }
+    }
+    return NULL;
+}
+
+void test_network_guarantees(void) {
+    static tNet_game_details game;
+    tU32 numbers[MESSAGE_COUNT];
+    tU32 number;
+    int i;
+
+    network_save();
+    gHarness_platform.GetTicks = test_clock;
+    memset(&game, 0, sizeof(game));
+    gCurrent_net_game = &game;
+    gNet_mode = eNet_mode_host;
+    gGuarantee_number = 1;
+    now = 1000;
+    NetDisposeGuarantees();
+    for (i = 0; i < PEER_COUNT; i++) {
+        memset(&peers[i], 0, sizeof(peers[i]));
+        ((tU8*)&peers[i])[4] = 10 + i;
+    }
+
+    // three times what used to fill the list, without losing any of them
+    for (i = 0; i < MESSAGE_COUNT; i++) {
+        make_message(&messages[i]);
+        NetGuaranteedSendMessageToAddress(&game, &messages[i], &peers[i % PEER_COUNT], NULL);
+        numbers[i] = messages[i].guarantee_number;
+        TEST_ASSERT_NOT_EQUAL(0, numbers[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(MESSAGE_COUNT, gNext_guarantee);
+    for (i = 0; i < PEER_COUNT; i++) {
+        TEST_ASSERT_EQUAL_INT(MESSAGE_COUNT / PEER_COUNT, NetGuaranteesOutstanding(&peers[i]));
+    }
+    for (i = MESSAGE_COUNT - 1; i >= 0; i--) {
+        reply(numbers[i]);
+        TEST_ASSERT_EQUAL_INT(NETMSGID_NONE, messages[i].contents.header.type);
+    }
+    TEST_ASSERT_EQUAL_INT(0, gNext_guarantee);
+    TEST_ASSERT_EQUAL_INT(0, NetGuaranteesOutstanding(&peers[0]));
+
+    // one message to two players is kept until both have replied
+    make_message(&messages[0]);
+    NetGuaranteedSendMessageToAddress(&game, &messages[0], &peers[0], NULL);
+    number = messages[0].guarantee_number;
+    NetGuaranteedSendMessageToAddress(&game, &messages[0], &peers[1], NULL);
+    reply(messages[0].guarantee_number);
+    TEST_ASSERT_EQUAL_INT(NETMSGID_HEADUP, messages[0].contents.header.type);
+    reply(number);
+    TEST_ASSERT_EQUAL_INT(NETMSGID_NONE, messages[0].contents.header.type);
+
+    // resent once it is over 100 ms old, then 120 ms later, and given up after 10 s. Resends are looked at
+    // every 10 ms
+    make_message(&messages[0]);
+    NetGuaranteedSendMessageToAddress(&game, &messages[0], &peers[2], NULL);
+    number = messages[0].guarantee_number;
+    now += 100;
+    ResendGuaranteedMessages();
+    TEST_ASSERT_EQUAL_INT(100, find_guarantee(number)->resend_period);
+    now += 10;
+    ResendGuaranteedMessages();
+    TEST_ASSERT_EQUAL_INT(120, find_guarantee(number)->resend_period);
+    TEST_ASSERT_EQUAL_INT(1220, find_guarantee(number)->next_resend_time);
+    now += 120;
+    ResendGuaranteedMessages();
+    TEST_ASSERT_EQUAL_INT(144, find_guarantee(number)->resend_period);
+    now = 1000 + 10000;
+    ResendGuaranteedMessages();
+    TEST_ASSERT_EQUAL_INT(1, gNext_guarantee);
+    now += 10;
+    ResendGuaranteedMessages();
+    TEST_ASSERT_EQUAL_INT(0, gNext_guarantee);
+    TEST_ASSERT_EQUAL_INT(NETMSGID_NONE, messages[0].contents.header.type);
+}
+
+// A lobby of one host and BOT_COUNT players over the loopback, all in this process. The host is this game's
+// network code. The bots stand in for the other players' games: they send mechanics every frame and a guaranteed
+// headup every half second, and reply to and resend guaranteed messages as the game does
+#define BOT_COUNT 5
+#define HOST_ID 1
+#define BOT_ID(B) (100 + (B))
+#define LOBBY_FRAME_TIME 40
+#define LOBBY_TIME 30000
+#define BOT_OUTSTANDING_CAPACITY 64
+
+typedef struct tBot {
+    int endpoint;
+    tU32 next_guarantee;
+    tU32 outstanding[BOT_OUTSTANDING_CAPACITY];
+    tU32 outstanding_time[BOT_OUTSTANDING_CAPACITY];
+    int outstanding_count;
+    tU8 seen[1024];
+    int headups;
+    int got_any;
+    tU32 latest_time_stamp;
+    int out_of_order;
+    int duplicates;
+} tBot;
+
+typedef struct tLobby_report {
+    tNet_receive_stats host;
+    tPD_net_stats host_traffic;
+    tPD_net_loopback_stats loopback;
+    int host_headups;
+    int bot_out_of_order;
+    int bot_duplicates;
+} tLobby_report;
+
+static tNet_game_details lobby_game;
+static tBot bots[BOT_COUNT];
+static tMin_message min_pool[32];
+static tMid_message mid_pool[16];
+static tMax_message max_pool[32];
+
+// Wraps like the platform's microsecond clock, the receive stats only ever take differences of it
+static br_uint_32 microsecond_clock(void) {
+    struct timespec ts;
+
+#if defined(__unix__) || defined(__APPLE__)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (br_uint_32)((unsigned long long)ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+static void add_traffic(tPD_net_stats* pTotal) {
+    tPD_net_stats frame;
+
+    PDNetGetFrameStats(&frame);
+    pTotal->packets_received += frame.packets_received;
+    pTotal->bytes_received += frame.bytes_received;
+    pTotal->packets_sent += frame.packets_sent;
+    pTotal->bytes_sent += frame.bytes_sent;
+}
+
+static void bot_send(int pBot, tNet_message* pMessage, tU32 pGuarantee_number) {
+    pMessage->sender = BOT_ID(pBot);
+    pMessage->senders_time_stamp = now;
+    pMessage->guarantee_number = pGuarantee_number;
+    TEST_ASSERT_EQUAL_INT(0, PDNetLoopbackSend(bots[pBot].endpoint, pMessage, pMessage->overall_size, &gNet_players[0].pd_net_info));
+    pMessage->guarantee_number = 0;
+    NetDisposeMessage(&lobby_game, pMessage);
+}
+
+static void bot_send_headup(int pBot, tU32 pGuarantee_number) {
+    tNet_message* message;
+
+    message = NetBuildMessage(NETMSGID_HEADUP, 0);
+    sprintf(message->contents.data.headup.text, "bot %d", pBot);
+    bot_send(pBot, message, pGuarantee_number);
+}
+
+static void bot_receive(int pBot) {
+    tBot* bot;
+    tU32 buffer[128];
+    tNet_message* message;
+    tNet_message* reply;
+    tPD_net_player_info from;
+    int i;
+
+    bot = &bots[pBot];
+    message = (tNet_message*)buffer;
+    memset(&from, 0, sizeof(from));
+    while (PDNetLoopbackReceive(bot->endpoint, buffer, sizeof(buffer), &from) != -1) {
+        TEST_ASSERT_EQUAL_MEMORY(&gNet_players[0].pd_net_info, &from, sizeof(from));
+        if (bot->got_any && (int)(message->senders_time_stamp - bot->latest_time_stamp) < 0) {
+            bot->out_of_order++;
+        } else {
+            bot->latest_time_stamp = message->senders_time_stamp;
+        }
+        bot->got_any = 1;
+        if (message->contents.header.type == NETMSGID_GUARANTEEREPLY) {
+            for (i = 0; i < bot->outstanding_count; i++) {
+                if (bot->outstanding[i] == message->contents.data.reply.guarantee_number) {
+                    bot->outstanding_count--;
+                    bot->outstanding[i] = bot->outstanding[bot->outstanding_count];
+                    bot->outstanding_time[i] = bot->outstanding_time[bot->outstanding_count];
+                    break;
+                }
+            }
+        } else if (message->guarantee_number != 0) {
+            TEST_ASSERT_LESS_THAN(sizeof(bot->seen), message->guarantee_number);
+            if (bot->seen[message->guarantee_number]) {
+                bot->duplicates++;
+            } else {
+                bot->seen[message->guarantee_number] = 1;
+                bot->headups++;
+            }
+            reply = NetBuildMessage(NETMSGID_GUARANTEEREPLY, 0);
+            reply->contents.data.reply.guarantee_number = message->guarantee_number;
+            bot_send(pBot, reply, 0);
+        }
+    }
+}
+
+static void bot_frame(int pBot, int pChatter) {
+    tBot* bot;
+    tNet_message* message;
+    int i;
+
+    bot = &bots[pBot];
+    bot_receive(pBot);
+    if (pChatter) {
+        message = NetBuildMessage(NETMSGID_MECHANICS, 0);
+        message->contents.data.mech.ID = BOT_ID(pBot);
+        message->contents.data.mech.time = now;
+        bot_send(pBot, message, 0);
+        if ((now / LOBBY_FRAME_TIME + pBot) % 12 == 0) {
+            TEST_ASSERT_LESS_THAN(BOT_OUTSTANDING_CAPACITY, bot->outstanding_count);
+            bot->outstanding[bot->outstanding_count] = bot->next_guarantee;
+            bot->outstanding_time[bot->outstanding_count] = now;
+            bot->outstanding_count++;
+            bot_send_headup(pBot, bot->next_guarantee);
+            bot->next_guarantee++;
+        }
+    }
+    for (i = 0; i < bot->outstanding_count; i++) {
+        if (now - bot->outstanding_time[i] >= 100) {
+            bot->outstanding_time[i] = now;
+            bot_send_headup(pBot, bot->outstanding[i]);
+        }
+    }
+}
+
+static int bots_waiting(void) {
+    int i;
+
+    for (i = 0; i < BOT_COUNT; i++) {
+        if (bots[i].outstanding_count != 0) {
+            return 1;
+        }
+    }
+    return gNext_guarantee != 0;
+}
+
+// Returns 0 if there is no loopback in this build
+static int run_lobby(int pLatency, int pJitter, int pLoss, int pReorder, tLobby_report* pReport) {
+    tNet_message* message;
+    void* host_address;
+    tU32 end_time;
+    int frame;
+    int i;
+
+    harness_game_config.net_loopback = 1;
+    harness_game_config.net_loopback_latency = pLatency;
+    harness_game_config.net_loopback_jitter = pJitter;
+    harness_game_config.net_loopback_loss = pLoss;
+    harness_game_config.net_loopback_reorder = pReorder;
+    memset(pReport, 0, sizeof(*pReport));
+    memset(bots, 0, sizeof(bots));
+    memset(&lobby_game, 0, sizeof(lobby_game));
+    memset(gNet_players, 0, sizeof(gNet_players));
+    gGuarantee_number = 1;
+    now = 1000;
+    NetDisposeGuarantees();
+    if (PDNetInitialise() != 0) {
+        return 0;
+    }
+    net_initialised = 1;
+    PDNetHostGame(&lobby_game, "host", &host_address);
+    memcpy(&gNet_players[0].pd_net_info, host_address, sizeof(gNet_players[0].pd_net_info));
+    gNet_players[0].ID = HOST_ID;
+    gNet_players[0].host = 1;
+    for (i = 0; i < BOT_COUNT; i++) {
+        bots[i].endpoint = PDNetLoopbackAddEndpoint(&gNet_players[i + 1].pd_net_info);
+        if (bots[i].endpoint < 0) {
+            return 0;
+        }
+        bots[i].next_guarantee = 1;
+        gNet_players[i + 1].ID = BOT_ID(i);
+    }
+    gNumber_of_net_players = BOT_COUNT + 1;
+    gThis_net_player_index = 0;
+    gLocal_net_ID = HOST_ID;
+    gCurrent_net_game = &lobby_game;
+    gNet_mode = eNet_mode_host;
+    NetResetReceiveStats();
+
+    // then nothing more is sent until every guaranteed message has got through
+    end_time = now + LOBBY_TIME;
+    for (frame = 0; now < end_time || bots_waiting(); frame++) {
+        TEST_ASSERT_LESS_THAN(end_time + 5000, now);
+        now += LOBBY_FRAME_TIME;
+        NetReceiveAndProcessMessages();
+        add_traffic(&pReport->host_traffic);
+        if (now < end_time) {
+            if (frame % 2 == 0) {
+                message = NetBuildMessage(NETMSGID_MECHANICS, 0);
+                message->contents.data.mech.ID = HOST_ID;
+                message->contents.data.mech.time = now;
+                NetSendMessageToAllPlayers(&lobby_game, message);
+            }
+            if (frame % 12 == 0) {
+                message = NetBuildMessage(NETMSGID_HEADUP, 0);
+                strcpy(message->contents.data.headup.text, "host");
+                NetGuaranteedSendMessageToAllPlayers(&lobby_game, message, NULL);
+                pReport->host_headups++;
+            }
+        }
+        ResendGuaranteedMessages();
+        for (i = 0; i < BOT_COUNT; i++) {
+            bot_frame(i, now < end_time);
+        }
+    }
+    PDNetNextFrame();
+    add_traffic(&pReport->host_traffic);
+
+    NetGetReceiveStats(&pReport->host);
+    PDNetLoopbackGetStats(&pReport->loopback);
+    for (i = 0; i < BOT_COUNT; i++) {
+        TEST_ASSERT_EQUAL_INT(pReport->host_headups, bots[i].headups);
+        pReport->bot_out_of_order += bots[i].out_of_order;
+        pReport->bot_duplicates += bots[i].duplicates;
+    }
+    PDNetShutdown();
+    net_initialised = 0;
+    return 1;
+}
+
+static void report_lobby(char* pName, tLobby_report* pReport) {
+    char s[512];
+    int seconds;
+
+    seconds = LOBBY_TIME / 1000;
+    sprintf(s, "%s: host in %d msg/s %d B/s, out %d msg/s %d B/s; NetReceiveAndProcessMessages %d us avg %d us max "
+               "(receive and dispatch only, the bots' mechanics are not applied outside a race); "
+               "desyncs: %d out of order, %d duplicates (bots %d, %d); %d datagrams lost, %d reordered",
+        pName,
+        pReport->host.messages / seconds,
+        pReport->host.bytes / seconds,
+        pReport->host_traffic.packets_sent / seconds,
+        pReport->host_traffic.bytes_sent / seconds,
+        pReport->host.calls == 0 ? 0 : (int)(pReport->host.total_us / pReport->host.calls),
+        (int)pReport->host.max_us,
+        pReport->host.out_of_order,
+        pReport->host.duplicates,
+        pReport->bot_out_of_order,
+        pReport->bot_duplicates,
+        pReport->loopback.packets_lost,
+        pReport->loopback.packets_reordered);
+    TEST_MESSAGE(s);
+}
+
+void test_network_loopback_lobby(void) {
+    tLobby_report clean;
+    tLobby_report lossy;
+    int i;
+
+    network_save();
+    gHarness_platform.GetTicks = test_clock;
+    gHarness_platform.GetMicroseconds = microsecond_clock;
+    gMin_messages = min_pool;
+    gMid_messages = mid_pool;
+    gMax_messages = max_pool;
+    for (i = 0; i < COUNT_OF(min_pool); i++) {
+        ((tNet_message*)&min_pool[i])->contents.header.type = NETMSGID_NONE;
+    }
+    for (i = 0; i < COUNT_OF(mid_pool); i++) {
+        ((tNet_message*)&mid_pool[i])->contents.header.type = NETMSGID_NONE;
+    }
+    for (i = 0; i < COUNT_OF(max_pool); i++) {
+        ((tNet_message*)&max_pool[i])->contents.header.type = NETMSGID_NONE;
+    }
+    // the bots' mechanics are passed over outside a race, only the network side of them is measured
+    gProgram_state.racing = 0;
+
+    if (!run_lobby(0, 0, 0, 0, &clean) || !run_lobby(40, 20, 5, 5, &lossy)) {
+        TEST_IGNORE_MESSAGE("no loopback transport in this build");
+    }
+
+    report_lobby("1 + 5 players over a perfect loopback", &clean);
+    report_lobby("1 + 5 players, 40+20 ms, 5% lost, 5% reordered", &lossy);
+
+    // the host hears every bot every frame
+    TEST_ASSERT_GREATER_OR_EQUAL(BOT_COUNT * (LOBBY_TIME / LOBBY_FRAME_TIME - 1), clean.host.messages);
+    TEST_ASSERT_EQUAL_INT(0, clean.host.out_of_order + clean.host.duplicates + clean.bot_out_of_order + clean.bot_duplicates);
+    TEST_ASSERT_EQUAL_INT(0, clean.loopback.packets_lost);
+
+    TEST_ASSERT_GREATER_THAN(0, lossy.loopback.packets_lost);
+    TEST_ASSERT_GREATER_THAN(0, lossy.host.out_of_order);
+    TEST_ASSERT_GREATER_THAN(0, lossy.host.duplicates + lossy.bot_duplicates);
+}
+
+void test_network_suite(void) {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_network_guarantees);
+    RUN_TEST(test_network_loopback_lobby);
+}
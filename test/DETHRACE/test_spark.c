@@ -0,0 +1,231 @@
+#include "tests.h"
+
+#include "common/globvars.h"
+#include "common/piping.h"
+#include "common/spark.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPAN_MAX 400
+#define SPAN_GUARD 32
+
+static tU8 shade_table[0x10000];
+static tU8 screen_ref[SPAN_MAX + 2 * SPAN_GUARD];
+static tU8 screen_test[SPAN_MAX + 2 * SPAN_GUARD];
+static tU16 depth[SPAN_MAX + 2 * SPAN_GUARD];
+
+static void run_spans(tSmoke_span_kernel kernel, int count, int huge) {
+    int n;
+    int i;
+    int l;
+    int r;
+    int y;
+    int x;
+    int r_squared;
+    br_scalar zbuff;
+    br_scalar shade_offset;
+    br_scalar r_multiplier;
+
+    for (n = 0; n < count; n++) {
+        r = 1 + rand() % 180;
+        y = rand() % (2 * r + 1) - r;
+        x = -(int)sqrt((double)(r * r - y * y));
+        // clipped at the left edge of the screen
+        if (rand() % 4 == 0) {
+            x += rand() % (r + 1);
+        }
+        l = MIN(SPAN_MAX, -2 * x + 1);
+        r_squared = x * x + y * y;
+        shade_offset = (rand() % 1001) / 1000.f * 14.99f;
+        r_multiplier = shade_offset / (r * r);
+        if (huge) {
+            r_squared += 1 << 24;
+            r_multiplier = 0.f;
+        }
+        zbuff = (rand() % 2001) / 1000.f - 1.f;
+        for (i = 0; i < COUNT_OF(depth); i++) {
+            depth[i] = (rand() % 8) == 0 ? (tU16)((1.f - zbuff) * 32768.0f) : (tU16)((rand() & 0xff) | (rand() & 0xff) << 8);
+        }
+        for (i = 0; i < COUNT_OF(screen_ref); i++) {
+            screen_ref[i] = rand();
+        }
+        memcpy(screen_test, screen_ref, sizeof(screen_ref));
+
+        SetSmokeSpanKernel(eSmoke_span_scalar);
+        SmokeLine(l, x, zbuff, r_squared, &screen_ref[SPAN_GUARD], &depth[SPAN_GUARD], &shade_table[0x8000], r_multiplier, 0.f, shade_offset);
+        SetSmokeSpanKernel(kernel);
+        SmokeLine(l, x, zbuff, r_squared, &screen_test[SPAN_GUARD], &depth[SPAN_GUARD], &shade_table[0x8000], r_multiplier, 0.f, shade_offset);
+        TEST_ASSERT_EQUAL_MEMORY(screen_ref, screen_test, sizeof(screen_ref));
+    }
+}
+
+void test_spark_smoke_span_kernels() {
+    tSmoke_span_kernel kernels[] = { eSmoke_span_sse2, eSmoke_span_avx2, eSmoke_span_neon, eSmoke_span_auto };
+    int i;
+    int old_offset;
+
+    for (i = 0; i < COUNT_OF(shade_table); i++) {
+        shade_table[i] = rand();
+    }
+    old_offset = gOffset;
+    // the screen is shifted by gOffset, the depth buffer only with the cockpit on
+    gOffset = 3;
+    srand(1234);
+    TEST_ASSERT_TRUE(SmokeSpanKernelSupported(eSmoke_span_scalar));
+    for (i = 0; i < COUNT_OF(kernels); i++) {
+        if (!SmokeSpanKernelSupported(kernels[i])) {
+            continue;
+        }
+        gProgram_state.cockpit_on = 0;
+        run_spans(kernels[i], 500, 0);
+        gProgram_state.cockpit_on = 1;
+        run_spans(kernels[i], 500, 0);
+        // too large for the lanes to match the float stepping, must fall back to the reference loop
+        run_spans(kernels[i], 20, 1);
+    }
+    SetSmokeSpanKernel(eSmoke_span_auto);
+    gOffset = old_offset;
+    gProgram_state.cockpit_on = 0;
+}
+
+void test_spark_smoke_line_offset() {
+    tSmoke_span_kernel kernels[] = { eSmoke_span_scalar, eSmoke_span_sse2, eSmoke_span_avx2, eSmoke_span_neon };
+    tU8 screen_off[SPAN_MAX + 2 * SPAN_GUARD];
+    tU8 screen_on[SPAN_MAX + 2 * SPAN_GUARD];
+    int old_offset;
+    int cockpit_on;
+    int i;
+    int k;
+    int l;
+
+    // every shade changes the pixel, so a changed pixel means its depth test passed
+    for (i = 0; i < COUNT_OF(shade_table); i++) {
+        shade_table[i] = (i ^ 0x55) & 0xff;
+    }
+    // only even depth entries are behind the smoke
+    for (i = 0; i < COUNT_OF(depth); i++) {
+        depth[i] = (i % 2) == 0 ? 0xffff : 0;
+    }
+    for (i = 0; i < COUNT_OF(screen_ref); i++) {
+        screen_ref[i] = i;
+    }
+    old_offset = gOffset;
+    cockpit_on = gProgram_state.cockpit_on;
+    gOffset = 3;
+    l = 64;
+    for (k = 0; k < COUNT_OF(kernels); k++) {
+        if (!SmokeSpanKernelSupported(kernels[k])) {
+            continue;
+        }
+        SetSmokeSpanKernel(kernels[k]);
+        memcpy(screen_off, screen_ref, sizeof(screen_ref));
+        memcpy(screen_on, screen_ref, sizeof(screen_ref));
+        gProgram_state.cockpit_on = 0;
+        SmokeLine(l, -l / 2, 0.f, l * l / 4, &screen_off[SPAN_GUARD], &depth[SPAN_GUARD], &shade_table[0x8000], 0.f, 0.f, 5.f);
+        gProgram_state.cockpit_on = 1;
+        SmokeLine(l, -l / 2, 0.f, l * l / 4, &screen_on[SPAN_GUARD], &depth[SPAN_GUARD], &shade_table[0x8000], 0.f, 0.f, 5.f);
+        for (i = 0; i < COUNT_OF(screen_ref); i++) {
+            if (i < SPAN_GUARD + gOffset || i >= SPAN_GUARD + gOffset + l) {
+                TEST_ASSERT_EQUAL_UINT8(screen_ref[i], screen_off[i]);
+                TEST_ASSERT_EQUAL_UINT8(screen_ref[i], screen_on[i]);
+                continue;
+            }
+            // cockpit off: the pixel gOffset along is tested against the unshifted depth entry
+            TEST_ASSERT_EQUAL_INT(((i - gOffset) % 2) == 0, screen_off[i] != screen_ref[i]);
+            // cockpit on: both are shifted, so pixel and depth entry line up
+            TEST_ASSERT_EQUAL_INT((i % 2) == 0, screen_on[i] != screen_ref[i]);
+        }
+        TEST_ASSERT_TRUE(memcmp(screen_off, screen_on, sizeof(screen_off)) != 0);
+    }
+    SetSmokeSpanKernel(eSmoke_span_auto);
+    gOffset = old_offset;
+    gProgram_state.cockpit_on = cockpit_on;
+}
+
+// A session counts its chunks in a tU8, so a full spark pool has to go into the pipe as more than one session
+#define PIPED_SPARKS 256
+#define SESSIONS_MAX 8
+
+void test_spark_pipe_full_pool() {
+    static tU8 pipe_buffer[0x10000];
+    static tU8 local_buffer[15000];
+    tU8* old_pipe_start;
+    tU8* old_pipe_end;
+    tU32 old_pipe_size;
+    tU8* old_local_buffer;
+    int old_racing;
+    int old_replay_mode;
+    tPipe_session* sessions[SESSIONS_MAX];
+    tPipe_chunk* chunk;
+    br_vector3 pos;
+    br_vector3 v;
+    tU8* ptr;
+    int session_count;
+    int spark;
+    int i;
+    int j;
+
+    old_pipe_start = gPipe_buffer_start;
+    old_pipe_end = gPipe_buffer_phys_end;
+    old_pipe_size = gPipe_buffer_size;
+    old_local_buffer = gLocal_buffer;
+    old_racing = gProgram_state.racing;
+    old_replay_mode = gAction_replay_mode;
+    gPipe_buffer_start = pipe_buffer;
+    gPipe_buffer_size = sizeof(pipe_buffer);
+    gPipe_buffer_phys_end = pipe_buffer + sizeof(pipe_buffer);
+    gLocal_buffer = local_buffer;
+    gProgram_state.racing = 1;
+    gAction_replay_mode = 0;
+    ResetPiping();
+
+    StartPipingSession(ePipe_chunk_spark);
+    for (i = 0; i < PIPED_SPARKS; i++) {
+        BrVector3Set(&pos, i, 2.f * i, 3.f * i);
+        BrVector3Set(&v, -i, 0.f, 1.f);
+        AddSparkToPipingSession(i + ((i & 1) << 8), &pos, &v);
+    }
+    EndPipingSession();
+
+    // each session ends with its length, so the pipe is read back from the newest one
+    session_count = 0;
+    for (ptr = gPipe_record_ptr; ptr > gPipe_buffer_start; ptr -= *(tU16*)(ptr - sizeof(tU16)) + sizeof(tU16)) {
+        TEST_ASSERT_LESS_THAN(SESSIONS_MAX, session_count);
+        sessions[session_count] = (tPipe_session*)(ptr - *(tU16*)(ptr - sizeof(tU16)) - sizeof(tU16));
+        session_count++;
+    }
+    TEST_ASSERT_EQUAL_PTR(gPipe_buffer_start, ptr);
+    TEST_ASSERT_GREATER_THAN(1, session_count);
+
+    spark = 0;
+    for (j = session_count - 1; j >= 0; j--) {
+        TEST_ASSERT_EQUAL_INT(ePipe_chunk_spark, sessions[j]->chunk_type);
+        TEST_ASSERT_NOT_EQUAL(0, sessions[j]->number_of_chunks);
+        gEnd_of_session = (tU8*)sessions[j] + LengthOfSession(sessions[j]) - sizeof(tU16);
+        chunk = &sessions[j]->chunks;
+        for (i = 0; i < sessions[j]->number_of_chunks; i++) {
+            TEST_ASSERT_EQUAL_INT(spark + ((spark & 1) << 8), chunk->subject_index);
+            TEST_ASSERT_EQUAL_FLOAT(2.f * spark, chunk->chunk_data.spark_data.pos.v[1]);
+            TEST_ASSERT_EQUAL_FLOAT(-spark, chunk->chunk_data.spark_data.v.v[0]);
+            AdvanceChunkPtr(&chunk, ePipe_chunk_spark);
+            spark++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(PIPED_SPARKS, spark);
+
+    gPipe_buffer_start = old_pipe_start;
+    gPipe_buffer_phys_end = old_pipe_end;
+    gPipe_buffer_size = old_pipe_size;
+    gLocal_buffer = old_local_buffer;
+    gProgram_state.racing = old_racing;
+    gAction_replay_mode = old_replay_mode;
+    ResetPiping();
+}
+
+void test_spark_suite() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_spark_smoke_span_kernels);
+    RUN_TEST(test_spark_smoke_line_offset);
+    RUN_TEST(test_spark_pipe_full_pool);
+}
@@ -36,6 +36,12 @@ extern void test_init_suite();
 extern void test_graphics_suite();
 extern void test_powerup_suite();
 extern void test_flicplay_suite();
+extern void test_drmem_suite();
+extern void test_spark_suite();
+extern void test_netgame_suite();
+extern void test_brucetrk_suite();
+extern void test_depth_suite();
+extern void test_network_suite();
 
 char* root_dir;
 
@@ -43,7 +49,20 @@ void setUp(void) {
     gEncryption_method = 0;
 }
 
+static void (*after_test)(void);
+
+void run_after_test(void (*pCleanup)(void)) {
+    after_test = pCleanup;
+}
+
 void tearDown(void) {
+    void (*cleanup)(void);
+
+    cleanup = after_test;
+    after_test = NULL;
+    if (cleanup != NULL) {
+        cleanup();
+    }
 }
 
 static const char* temp_folder;
@@ -232,6 +251,12 @@ int main(int argc, char** argv) {
     test_graphics_suite();
     test_powerup_suite();
     test_flicplay_suite();
+    test_drmem_suite();
+    test_spark_suite();
+    test_netgame_suite();
+    test_brucetrk_suite();
+    test_depth_suite();
+    test_network_suite();
 
     return UNITY_END();
 }
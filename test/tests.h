@@ -22,6 +22,9 @@ void TEST_ASSERT_EQUAL_FILE_TEXT(const char* expected, char* filename);
 extern int has_data_directory();
 void create_temp_file(char buffer[PATH_MAX + 1], const char* prefix);
 
+// pCleanup runs once the current test is over, also when an assertion failed
+void run_after_test(void (*pCleanup)(void));
+
 #define REQUIRES_DATA_DIRECTORY() \
     if (!has_data_directory())    \
         TEST_IGNORE();